@@ -16,6 +16,9 @@
 #include "owfs.h"
 #include "ow_pid.h"
 
+/* High level FUSE (2.x) callbacks -- FUSE 3 uses owfs_lowlevel.c */
+#if ! OW_FUSE3
+
 /* There was a major change in the function prototypes at FUSE 2.2, we'll make a flag */
 #undef FUSE22PLUS
 #undef FUSE1X
@@ -255,3 +258,5 @@ static void *FS_init(void)
 	return VOID_RETURN;
 }
 #endif							/* FUSE_VERSION > 22 */
+
+#endif							/* ! OW_FUSE3 */
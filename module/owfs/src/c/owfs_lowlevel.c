@@ -0,0 +1,818 @@
+/*
+    OW -- One-Wire filesystem
+
+    Function naming scheme:
+    OW -- Generic call to interface
+    LI -- LINK commands
+    FS -- filesystem commands
+    UT -- utility functions
+    COM - serial port functions
+    DS2480 -- DS9097U serial connector
+
+    Written 2003 Paul H Alfille
+*/
+
+/* FUSE 3 low level callbacks
+ *
+ * The kernel names files by inode number, each inode stands for an owfs
+ * path. A path is parsed (with the presence check) on lookup, the kernel
+ * then keeps the entry and its attributes for as long as the property's
+ * cache class allows, so a path isn't parsed again for every stat.
+ *
+ * Directories are listed with readdirplus: the attributes come with the
+ * names, straight from the parsed names FS_dir hands out, so "ls -l"
+ * needs no lookup or getattr per entry.
+ *
+ * An open file keeps only its path and a buffer the whole file fits in.
+ * Every read and write parses the path again, as with FUSE 2, so the bus
+ * is chosen (and the device looked for) at the time of the read.
+ */
+
+#include "owfs.h"
+#include "ow_pid.h"
+
+#if OW_FUSE3
+
+#define INODE_BUCKETS	1024
+#define INODE_UNKNOWN	0xFFFFFFFF // not looked up yet (as high level fuse)
+
+/* An inode -- a path the kernel has looked up (nlookup times) */
+struct owfs_inode {
+	struct owfs_inode * next_by_ino ;
+	struct owfs_inode * next_by_path ;
+	fuse_ino_t ino ;
+	uint64_t nlookup ;
+	unsigned int hash ;
+	char path[0] ;
+} ;
+
+/* An open file */
+struct owfs_file {
+	pthread_mutex_t mutex ; // one read at a time in the buffer
+	char * buffer ; // reads are formatted here and replied from here
+	size_t buffer_size ;
+	char path[0] ;
+} ;
+
+/* An open directory -- listed on opendir, handed out by readdir */
+struct owfs_dirent {
+	struct stat attr ;
+	double attr_timeout ;
+	double entry_timeout ;
+	const char * name ;
+	int dot ; // "." or ".." -- no inode reference
+	char path[0] ;
+} ;
+
+struct owfs_dir {
+	fuse_ino_t ino ;
+	size_t count ;
+	size_t allocated ;
+	struct owfs_dirent ** entries ;
+} ;
+
+static struct owfs_inode * inode_by_ino[INODE_BUCKETS] ;
+static struct owfs_inode * inode_by_path[INODE_BUCKETS] ;
+static fuse_ino_t inode_next = FUSE_ROOT_ID + 1 ;
+static pthread_mutex_t inode_mutex = PTHREAD_MUTEX_INITIALIZER ;
+
+static unsigned int Inode_hash( const char * path ) ;
+static char * Inode_path( fuse_ino_t ino ) ;
+static char * Inode_child( fuse_ino_t parent, const char * name ) ;
+static fuse_ino_t Inode_lookup( const char * path ) ;
+static fuse_ino_t Inode_peek( const char * path ) ;
+static void Inode_forget( fuse_ino_t ino, uint64_t nlookup ) ;
+static double Timeout_attr( const struct parsedname * pn ) ;
+static double Timeout_entry( const struct parsedname * pn ) ;
+
+static void LL_init( void * userdata, struct fuse_conn_info * conn ) ;
+static void LL_lookup( fuse_req_t req, fuse_ino_t parent, const char * name ) ;
+static void LL_forget( fuse_req_t req, fuse_ino_t ino, uint64_t nlookup ) ;
+static void LL_forget_multi( fuse_req_t req, size_t count, struct fuse_forget_data * forgets ) ;
+static void LL_getattr( fuse_req_t req, fuse_ino_t ino, struct fuse_file_info * file_info ) ;
+static void LL_setattr( fuse_req_t req, fuse_ino_t ino, struct stat * attr, int to_set, struct fuse_file_info * file_info ) ;
+static void LL_open( fuse_req_t req, fuse_ino_t ino, struct fuse_file_info * file_info ) ;
+static void LL_read( fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info * file_info ) ;
+static void LL_write( fuse_req_t req, fuse_ino_t ino, const char * buffer, size_t size, off_t offset, struct fuse_file_info * file_info ) ;
+static void LL_release( fuse_req_t req, fuse_ino_t ino, struct fuse_file_info * file_info ) ;
+static void LL_opendir( fuse_req_t req, fuse_ino_t ino, struct fuse_file_info * file_info ) ;
+static void LL_readdir( fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info * file_info ) ;
+static void LL_readdirplus( fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info * file_info ) ;
+static void LL_releasedir( fuse_req_t req, fuse_ino_t ino, struct fuse_file_info * file_info ) ;
+
+const struct fuse_lowlevel_ops owfs_lowlevel_oper = {
+	.init = LL_init,
+	.lookup = LL_lookup,
+	.forget = LL_forget,
+	.forget_multi = LL_forget_multi,
+	.getattr = LL_getattr,
+	.setattr = LL_setattr,
+	.open = LL_open,
+	.read = LL_read,
+	.write = LL_write,
+	.release = LL_release,
+	.opendir = LL_opendir,
+	.readdir = LL_readdir,
+	.readdirplus = LL_readdirplus,
+	.releasedir = LL_releasedir,
+} ;
+
+/* ---------------------------------------------- */
+/* Inode table                                    */
+/* ---------------------------------------------- */
+static unsigned int Inode_hash( const char * path )
+{
+	unsigned int hash = 5381 ;
+	while ( path[0] != '\0' ) {
+		hash = hash * 33 + (unsigned char) path[0] ;
+		++path ;
+	}
+	return hash ;
+}
+
+/* Path of the inode (owmalloc'ed copy), NULL if unknown */
+static char * Inode_path( fuse_ino_t ino )
+{
+	struct owfs_inode * inode ;
+	char * path = NULL ;
+
+	if ( ino == FUSE_ROOT_ID ) {
+		return owstrdup( "/" ) ;
+	}
+	_MUTEX_LOCK( inode_mutex ) ;
+	for ( inode = inode_by_ino[ ino % INODE_BUCKETS ] ; inode != NULL ; inode = inode->next_by_ino ) {
+		if ( inode->ino == ino ) {
+			path = owstrdup( inode->path ) ;
+			break ;
+		}
+	}
+	_MUTEX_UNLOCK( inode_mutex ) ;
+	return path ;
+}
+
+/* Path of name in directory parent (owmalloc'ed), NULL if unknown */
+static char * Inode_child( fuse_ino_t parent, const char * name )
+{
+	char * parent_path = Inode_path( parent ) ;
+	char * path ;
+	size_t parent_length ;
+	size_t name_length = strlen( name ) ;
+
+	if ( parent_path == NULL ) {
+		return NULL ;
+	}
+	parent_length = strlen( parent_path ) ;
+	if ( parent_path[parent_length-1] == '/' ) {
+		--parent_length ; // root
+	}
+	path = owmalloc( parent_length + 1 + name_length + 1 ) ;
+	if ( path != NULL ) {
+		memcpy( path, parent_path, parent_length ) ;
+		path[parent_length] = '/' ;
+		memcpy( &path[parent_length+1], name, name_length + 1 ) ;
+	}
+	owfree( parent_path ) ;
+	return path ;
+}
+
+/* Inode for path, one more lookup reference (created if needed). 0 if out of memory */
+static fuse_ino_t Inode_lookup( const char * path )
+{
+	unsigned int hash = Inode_hash( path ) ;
+	struct owfs_inode * inode ;
+	fuse_ino_t ino = 0 ;
+
+	if ( strcmp( path, "/" ) == 0 ) {
+		return FUSE_ROOT_ID ; // never forgotten
+	}
+
+	_MUTEX_LOCK( inode_mutex ) ;
+	for ( inode = inode_by_path[ hash % INODE_BUCKETS ] ; inode != NULL ; inode = inode->next_by_path ) {
+		if ( inode->hash == hash && strcmp( inode->path, path ) == 0 ) {
+			break ;
+		}
+	}
+	if ( inode == NULL ) {
+		size_t length = strlen( path ) ;
+		inode = owmalloc( sizeof(struct owfs_inode) + length + 1 ) ;
+		if ( inode != NULL ) {
+			memcpy( inode->path, path, length + 1 ) ;
+			inode->hash = hash ;
+			inode->nlookup = 0 ;
+			inode->ino = inode_next++ ;
+			inode->next_by_path = inode_by_path[ hash % INODE_BUCKETS ] ;
+			inode_by_path[ hash % INODE_BUCKETS ] = inode ;
+			inode->next_by_ino = inode_by_ino[ inode->ino % INODE_BUCKETS ] ;
+			inode_by_ino[ inode->ino % INODE_BUCKETS ] = inode ;
+		}
+	}
+	if ( inode != NULL ) {
+		++inode->nlookup ;
+		ino = inode->ino ;
+	}
+	_MUTEX_UNLOCK( inode_mutex ) ;
+	return ino ;
+}
+
+/* Inode for path if there is one, without a reference (for plain readdir) */
+static fuse_ino_t Inode_peek( const char * path )
+{
+	unsigned int hash = Inode_hash( path ) ;
+	struct owfs_inode * inode ;
+	fuse_ino_t ino = INODE_UNKNOWN ;
+
+	_MUTEX_LOCK( inode_mutex ) ;
+	for ( inode = inode_by_path[ hash % INODE_BUCKETS ] ; inode != NULL ; inode = inode->next_by_path ) {
+		if ( inode->hash == hash && strcmp( inode->path, path ) == 0 ) {
+			ino = inode->ino ;
+			break ;
+		}
+	}
+	_MUTEX_UNLOCK( inode_mutex ) ;
+	return ino ;
+}
+
+/* Drop nlookup references, the inode goes with the last one */
+static void Inode_forget( fuse_ino_t ino, uint64_t nlookup )
+{
+	struct owfs_inode ** by_ino ;
+	struct owfs_inode ** by_path ;
+	struct owfs_inode * inode ;
+
+	if ( ino == FUSE_ROOT_ID ) {
+		return ;
+	}
+
+	_MUTEX_LOCK( inode_mutex ) ;
+	for ( by_ino = &inode_by_ino[ ino % INODE_BUCKETS ] ; by_ino[0] != NULL ; by_ino = &(by_ino[0]->next_by_ino) ) {
+		if ( by_ino[0]->ino == ino ) {
+			break ;
+		}
+	}
+	inode = by_ino[0] ;
+	if ( inode != NULL ) {
+		if ( inode->nlookup > nlookup ) {
+			inode->nlookup -= nlookup ;
+		} else {
+			by_ino[0] = inode->next_by_ino ;
+			for ( by_path = &inode_by_path[ inode->hash % INODE_BUCKETS ] ; by_path[0] != inode ; by_path = &(by_path[0]->next_by_path) ) {
+				// find it in the path chain
+			}
+			by_path[0] = inode->next_by_path ;
+			owfree( inode ) ;
+		}
+	}
+	_MUTEX_UNLOCK( inode_mutex ) ;
+}
+
+/* ---------------------------------------------- */
+/* Kernel cache timeouts                          */
+/* ---------------------------------------------- */
+/* Attributes: as long as the value would stay in the owfs cache */
+static double Timeout_attr( const struct parsedname * pn )
+{
+	if ( IsUncachedDir(pn) ) {
+		return 0. ;
+	} else if ( pn->selected_device == NO_DEVICE || pn->selected_filetype == NO_FILETYPE ) {
+		return Globals.timeout_directory ;
+	}
+	switch ( pn->selected_filetype->change ) {
+		case fc_static:
+		case fc_stable:
+		case fc_read_stable:
+		case fc_link:
+		case fc_page:
+		case fc_directory:
+		case fc_subdir:
+			return Globals.timeout_stable ;
+		case fc_volatile:
+		case fc_simultaneous_temperature:
+		case fc_simultaneous_voltage:
+			return Globals.timeout_volatile ;
+		default:
+			// uncached, timers and statistics (time stamps change all the time)
+			return 0. ;
+	}
+}
+
+/* Names: a device's entries last as long as the device is known to be there */
+static double Timeout_entry( const struct parsedname * pn )
+{
+	if ( IsUncachedDir(pn) ) {
+		return 0. ;
+	} else if ( pn->selected_device == NO_DEVICE ) {
+		return Globals.timeout_directory ;
+	}
+	return Globals.timeout_presence ;
+}
+
+/* ---------------------------------------------- */
+/* Filesystem callback functions                  */
+/* ---------------------------------------------- */
+static void LL_init( void * userdata, struct fuse_conn_info * conn )
+{
+	(void) userdata ;
+	if ( conn->capable & FUSE_CAP_READDIRPLUS ) {
+		// always readdirplus, not just when the kernel guesses it's worth it
+		conn->want |= FUSE_CAP_READDIRPLUS ;
+		conn->want &= ~FUSE_CAP_READDIRPLUS_AUTO ;
+	}
+	PIDstart();
+	Announce_Systemd();
+}
+
+static void LL_lookup( fuse_req_t req, fuse_ino_t parent, const char * name )
+{
+	char * path = Inode_child( parent, name ) ;
+	struct parsedname pn ;
+	struct fuse_entry_param e ;
+
+	if ( path == NULL ) {
+		fuse_reply_err( req, ENOENT ) ;
+		return ;
+	}
+	LEVEL_CALL("LOOKUP path=%s", path);
+
+	if ( FS_ParsedName( path, &pn ) != 0 ) {
+		owfree( path ) ;
+		fuse_reply_err( req, ENOENT ) ;
+		return ;
+	}
+
+	memset( &e, 0, sizeof(struct fuse_entry_param) ) ;
+	if ( FS_fstat_postparse( &e.attr, &pn ) != 0 ) {
+		fuse_reply_err( req, ENOENT ) ;
+	} else if ( (e.ino = Inode_lookup( path )) == 0 ) {
+		fuse_reply_err( req, ENOMEM ) ;
+	} else {
+		e.attr.st_ino = e.ino ;
+		e.attr_timeout = Timeout_attr( &pn ) ;
+		e.entry_timeout = Timeout_entry( &pn ) ;
+		if ( fuse_reply_entry( req, &e ) != 0 ) {
+			Inode_forget( e.ino, 1 ) ; // interrupted, the kernel didn't take it
+		}
+	}
+	FS_ParsedName_destroy( &pn ) ;
+	owfree( path ) ;
+}
+
+static void LL_forget( fuse_req_t req, fuse_ino_t ino, uint64_t nlookup )
+{
+	Inode_forget( ino, nlookup ) ;
+	fuse_reply_none( req ) ;
+}
+
+static void LL_forget_multi( fuse_req_t req, size_t count, struct fuse_forget_data * forgets )
+{
+	size_t i ;
+	for ( i = 0 ; i < count ; ++i ) {
+		Inode_forget( forgets[i].ino, forgets[i].nlookup ) ;
+	}
+	fuse_reply_none( req ) ;
+}
+
+static void LL_getattr( fuse_req_t req, fuse_ino_t ino, struct fuse_file_info * file_info )
+{
+	char * path = Inode_path( ino ) ;
+	struct parsedname pn ;
+	struct stat attr ;
+
+	(void) file_info ;
+	if ( path == NULL ) {
+		fuse_reply_err( req, ENOENT ) ;
+		return ;
+	}
+	LEVEL_CALL("GETATTR path=%s", path);
+
+	if ( FS_ParsedName( path, &pn ) != 0 ) {
+		fuse_reply_err( req, ENOENT ) ;
+	} else {
+		if ( FS_fstat_postparse( &attr, &pn ) != 0 ) {
+			fuse_reply_err( req, ENOENT ) ;
+		} else {
+			attr.st_ino = ino ;
+			fuse_reply_attr( req, &attr, Timeout_attr( &pn ) ) ;
+		}
+		FS_ParsedName_destroy( &pn ) ;
+	}
+	owfree( path ) ;
+}
+
+/* chmod, chown, utime and truncate are accepted and ignored, as before */
+static void LL_setattr( fuse_req_t req, fuse_ino_t ino, struct stat * attr, int to_set, struct fuse_file_info * file_info )
+{
+	(void) attr ;
+	(void) to_set ;
+	LL_getattr( req, ino, file_info ) ;
+}
+
+/* The path is checked (and the file's size taken) here, kept for reads and writes */
+static void LL_open( fuse_req_t req, fuse_ino_t ino, struct fuse_file_info * file_info )
+{
+	char * path = Inode_path( ino ) ;
+	struct parsedname pn ;
+	struct owfs_file * of ;
+	size_t path_length ;
+
+	if ( path == NULL ) {
+		fuse_reply_err( req, ENOENT ) ;
+		return ;
+	}
+	LEVEL_CALL("OPEN path=%s", path);
+
+	if ( FS_ParsedName( path, &pn ) != 0 ) {
+		owfree( path ) ;
+		fuse_reply_err( req, ENOENT ) ;
+		return ;
+	}
+	if ( IsDir( &pn ) ) {
+		FS_ParsedName_destroy( &pn ) ;
+		owfree( path ) ;
+		fuse_reply_err( req, EISDIR ) ;
+		return ;
+	}
+
+	path_length = strlen( path ) ;
+	of = owmalloc( sizeof(struct owfs_file) + path_length + 1 ) ;
+	if ( of == NULL ) {
+		FS_ParsedName_destroy( &pn ) ;
+		owfree( path ) ;
+		fuse_reply_err( req, ENOMEM ) ;
+		return ;
+	}
+	memcpy( of->path, path, path_length + 1 ) ;
+	owfree( path ) ;
+	// the whole file fits, whatever size and offset are asked for
+	of->buffer_size = FullFileLength( &pn ) ;
+	FS_ParsedName_destroy( &pn ) ;
+	of->buffer = owmalloc( of->buffer_size + 1 ) ;
+	if ( of->buffer == NULL ) {
+		owfree( of ) ;
+		fuse_reply_err( req, ENOMEM ) ;
+		return ;
+	}
+	_MUTEX_INIT( of->mutex ) ;
+
+	file_info->fh = (uint64_t) (uintptr_t) of ;
+	file_info->direct_io = 1 ; // no page cache, every read goes to owlib (and its cache)
+	if ( fuse_reply_open( req, file_info ) != 0 ) {
+		// interrupted, no release will come
+		_MUTEX_DESTROY( of->mutex ) ;
+		owfree( of->buffer ) ;
+		owfree( of ) ;
+	}
+}
+
+static void LL_read( fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info * file_info )
+{
+	struct owfs_file * of = (struct owfs_file *) (uintptr_t) file_info->fh ;
+	SIZE_OR_ERROR read_return ;
+
+	(void) ino ;
+	LEVEL_CALL("READ path=%s size=%d offset=%d", of->path, (int) size, (int) offset);
+
+	if ( offset >= (off_t) of->buffer_size ) {
+		// fuse requests a useless read at end of file -- just return ok.
+		fuse_reply_buf( req, NULL, 0 ) ;
+		return ;
+	}
+	if ( size > of->buffer_size + 1 ) {
+		// never more than the file (and room for a terminator), the open file's buffer
+		size = of->buffer_size + 1 ;
+	}
+
+	// the buffer is the open file's, held until fuse has the reply
+	_MUTEX_LOCK( of->mutex ) ;
+	read_return = FS_read( of->path, of->buffer, size, offset ) ;
+	if ( read_return < 0 ) {
+		fuse_reply_err( req, -read_return ) ;
+	} else {
+		fuse_reply_buf( req, of->buffer, read_return ) ;
+	}
+	_MUTEX_UNLOCK( of->mutex ) ;
+}
+
+static void LL_write( fuse_req_t req, fuse_ino_t ino, const char * buffer, size_t size, off_t offset, struct fuse_file_info * file_info )
+{
+	struct owfs_file * of = (struct owfs_file *) (uintptr_t) file_info->fh ;
+	SIZE_OR_ERROR write_return ;
+
+	(void) ino ;
+	LEVEL_CALL("WRITE path=%s size=%d offset=%d", of->path, (int) size, (int) offset);
+
+	write_return = FS_write( of->path, buffer, size, offset ) ;
+	if ( write_return < 0 ) {
+		fuse_reply_err( req, -write_return ) ;
+	} else {
+		fuse_reply_write( req, size ) ;
+	}
+}
+
+static void LL_release( fuse_req_t req, fuse_ino_t ino, struct fuse_file_info * file_info )
+{
+	struct owfs_file * of = (struct owfs_file *) (uintptr_t) file_info->fh ;
+
+	(void) ino ;
+	LEVEL_CALL("RELEASE path=%s", of->path);
+	_MUTEX_DESTROY( of->mutex ) ;
+	owfree( of->buffer ) ;
+	owfree( of ) ;
+	fuse_reply_err( req, 0 ) ;
+}
+
+static void Dir_add( struct owfs_dir * dir, const char * path, const char * name, const struct parsedname * pn )
+{
+	size_t path_length = strlen( path ) ;
+	struct owfs_dirent * de ;
+
+	if ( dir->count == dir->allocated ) {
+		struct owfs_dirent ** entries = owrealloc( dir->entries, ( dir->allocated + 32 ) * sizeof(struct owfs_dirent *) ) ;
+		if ( entries == NULL ) {
+			return ;
+		}
+		dir->entries = entries ;
+		dir->allocated += 32 ;
+	}
+
+	de = owmalloc( sizeof(struct owfs_dirent) + path_length + 1 ) ;
+	if ( de == NULL ) {
+		return ;
+	}
+	memcpy( de->path, path, path_length + 1 ) ;
+	de->dot = ( name != NULL ) ;
+	de->name = de->dot ? name : FS_DirName( pn ) ;
+	if ( ! de->dot ) {
+		// point into our copy of the path
+		de->name = &de->path[ path_length - strlen( de->name ) ] ;
+	}
+	if ( FS_fstat_postparse( &de->attr, pn ) != 0 ) {
+		owfree( de ) ;
+		return ;
+	}
+	de->attr_timeout = Timeout_attr( pn ) ;
+	de->entry_timeout = Timeout_entry( pn ) ;
+	dir->entries[dir->count++] = de ;
+}
+
+	/* Callback function to FS_dir */
+static void LL_opendir_callback( void * v, const struct parsedname * pn_entry )
+{
+	Dir_add( v, pn_entry->path, NULL, pn_entry ) ;
+}
+
+/* Listed here (with attributes), readdir calls page through it */
+static void LL_opendir( fuse_req_t req, fuse_ino_t ino, struct fuse_file_info * file_info )
+{
+	char * path = Inode_path( ino ) ;
+	struct parsedname pn ;
+	struct owfs_dir * dir ;
+
+	if ( path == NULL ) {
+		fuse_reply_err( req, ENOENT ) ;
+		return ;
+	}
+	LEVEL_CALL("OPENDIR path=%s", path);
+
+	if ( FS_ParsedName( path, &pn ) != 0 ) {
+		owfree( path ) ;
+		fuse_reply_err( req, ENOENT ) ;
+		return ;
+	}
+	owfree( path ) ;
+
+	if ( pn.selected_filetype != NO_FILETYPE && ! IsDir( &pn ) ) {
+		FS_ParsedName_destroy( &pn ) ;
+		fuse_reply_err( req, ENOTDIR ) ;
+		return ;
+	}
+
+	dir = owcalloc( 1, sizeof(struct owfs_dir) ) ;
+	if ( dir == NULL ) {
+		FS_ParsedName_destroy( &pn ) ;
+		fuse_reply_err( req, ENOMEM ) ;
+		return ;
+	}
+	dir->ino = ino ;
+	Dir_add( dir, pn.path, ".", &pn ) ;
+	Dir_add( dir, pn.path, "..", &pn ) ;
+	/* Call directory spanning function */
+	FS_dir( LL_opendir_callback, dir, &pn ) ;
+	FS_ParsedName_destroy( &pn ) ;
+
+	file_info->fh = (uint64_t) (uintptr_t) dir ;
+	if ( fuse_reply_open( req, file_info ) != 0 ) {
+		LL_releasedir( NULL, ino, file_info ) ;
+	}
+}
+
+static void LL_readdir_common( fuse_req_t req, size_t size, off_t offset, struct fuse_file_info * file_info, int plus )
+{
+	struct owfs_dir * dir = (struct owfs_dir *) (uintptr_t) file_info->fh ;
+	char * buffer = owmalloc( size ) ;
+	size_t used = 0 ;
+	size_t i ;
+
+	if ( buffer == NULL ) {
+		fuse_reply_err( req, ENOMEM ) ;
+		return ;
+	}
+
+	for ( i = offset ; i < dir->count ; ++i ) {
+		struct owfs_dirent * de = dir->entries[i] ;
+		size_t entry_size ;
+
+		if ( plus ) {
+			struct fuse_entry_param e ;
+			memset( &e, 0, sizeof(struct fuse_entry_param) ) ;
+			if ( de->dot ) {
+				e.ino = dir->ino ; // the kernel skips . and ..
+			} else if ( (e.ino = Inode_lookup( de->path )) == 0 ) {
+				break ;
+			}
+			e.attr = de->attr ;
+			e.attr.st_ino = e.ino ;
+			e.attr_timeout = de->attr_timeout ;
+			e.entry_timeout = de->entry_timeout ;
+			entry_size = fuse_add_direntry_plus( req, &buffer[used], size - used, de->name, &e, i + 1 ) ;
+			if ( entry_size > size - used ) {
+				// doesn't fit, comes with the next call
+				if ( ! de->dot ) {
+					Inode_forget( e.ino, 1 ) ;
+				}
+				break ;
+			}
+		} else {
+			struct stat attr = de->attr ;
+			attr.st_ino = de->dot ? dir->ino : Inode_peek( de->path ) ;
+			entry_size = fuse_add_direntry( req, &buffer[used], size - used, de->name, &attr, i + 1 ) ;
+			if ( entry_size > size - used ) {
+				break ;
+			}
+		}
+		used += entry_size ;
+	}
+
+	fuse_reply_buf( req, buffer, used ) ;
+	owfree( buffer ) ;
+}
+
+static void LL_readdir( fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info * file_info )
+{
+	(void) ino ;
+	LL_readdir_common( req, size, offset, file_info, 0 ) ;
+}
+
+static void LL_readdirplus( fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info * file_info )
+{
+	(void) ino ;
+	LL_readdir_common( req, size, offset, file_info, 1 ) ;
+}
+
+static void LL_releasedir( fuse_req_t req, fuse_ino_t ino, struct fuse_file_info * file_info )
+{
+	struct owfs_dir * dir = (struct owfs_dir *) (uintptr_t) file_info->fh ;
+	size_t i ;
+
+	(void) ino ;
+	for ( i = 0 ; i < dir->count ; ++i ) {
+		owfree( dir->entries[i] ) ;
+	}
+	if ( dir->entries != NULL ) {
+		owfree( dir->entries ) ;
+	}
+	owfree( dir ) ;
+	if ( req != NULL ) {
+		fuse_reply_err( req, 0 ) ;
+	}
+}
+
+/* FUSE 2 mount options that FUSE 3's session doesn't take: gone from FUSE 3,
+ * or only known to the high level library. fuse_session_new fails on them. */
+static const char * Fuse2_only_options[] = {
+	"direct_io", // set on each open file instead
+	"big_writes", "large_read", "nonempty", "atomic_o_trunc",
+	"kernel_cache", "auto_cache", "ac_attr_timeout", "use_ino", "readdir_ino",
+	"hard_remove", "intr", "intr_signal", "umask", "uid", "gid",
+	"entry_timeout", "negative_timeout", "attr_timeout",
+	"noforget", "remember", "nopath", "modules",
+	NULL,
+} ;
+
+static int Fuse2_only( const char * option )
+{
+	size_t name_length = strcspn( option, "=" ) ;
+	const char ** name ;
+
+	for ( name = Fuse2_only_options ; *name != NULL ; ++name ) {
+		if ( strlen( *name ) == name_length && strncmp( *name, option, name_length ) == 0 ) {
+			return 1 ;
+		}
+	}
+	return 0 ;
+}
+
+/* The "command line" (built for FUSE 2's fuse_main) as FUSE 3 takes it:
+ * "-o a,b" and "-oa,b" lists are split, FUSE 2 only options left out and the
+ * rest put back in one "-o" list. Other arguments are passed as they are. */
+static int Fuse3_args( struct Fuse_option * fo, struct fuse_args * args )
+{
+	char * mount_options = NULL ;
+	int argc ;
+	int ret = 0 ;
+
+	for ( argc = 0 ; argc < fo->argc && ret == 0 ; ++argc ) {
+		char * arg = fo->argv[argc] ;
+		char * list ;
+		char * next ;
+		char * option ;
+
+		if ( arg[0] == '\0' ) {
+			// empty --fuse_opt
+			continue ;
+		}
+		if ( argc == 0 || strncmp( arg, "-o", 2 ) != 0 ) {
+			ret = fuse_opt_add_arg( args, arg ) ;
+			continue ;
+		}
+		if ( arg[2] != '\0' ) {
+			list = owstrdup( &arg[2] ) ;
+		} else if ( argc + 1 < fo->argc ) {
+			list = owstrdup( fo->argv[++argc] ) ;
+		} else {
+			LEVEL_DEFAULT("FUSE option -o without a value");
+			ret = -1 ;
+			break ;
+		}
+		if ( list == NULL ) {
+			ret = -1 ;
+			break ;
+		}
+		next = list ;
+		while ( ( option = strsep( &next, "," ) ) != NULL && ret == 0 ) {
+			if ( option[0] == '\0' ) {
+				continue ;
+			} else if ( Fuse2_only( option ) ) {
+				LEVEL_DEFAULT("FUSE 2 option %s left out for FUSE 3", option);
+			} else {
+				ret = fuse_opt_add_opt( &mount_options, option ) ;
+			}
+		}
+		owfree( list ) ;
+	}
+
+	if ( ret == 0 && mount_options != NULL ) {
+		LEVEL_DEBUG("FUSE 3 mount options %s", mount_options);
+		ret = fuse_opt_add_arg( args, "-o" ) ;
+		if ( ret == 0 ) {
+			ret = fuse_opt_add_arg( args, mount_options ) ;
+		}
+	}
+	free( mount_options ) ; // allocated by fuse
+	return ret ;
+}
+
+/* Mount and serve, instead of fuse_main. fo is the same "command line" */
+int Fuse_lowlevel_main( struct Fuse_option * fo )
+{
+	struct fuse_args args = FUSE_ARGS_INIT( 0, NULL ) ;
+	struct fuse_cmdline_opts opts ;
+	struct fuse_session * se ;
+	int ret = 1 ;
+
+	if ( Fuse3_args( fo, &args ) != 0 ) {
+		LEVEL_DEFAULT("Can't translate the FUSE options for FUSE 3");
+		fuse_opt_free_args( &args ) ;
+		return 1 ;
+	}
+	if ( fuse_parse_cmdline( &args, &opts ) != 0 ) {
+		fuse_opt_free_args( &args ) ;
+		return 1 ;
+	}
+	if ( opts.mountpoint == NULL ) {
+		LEVEL_DEFAULT("No FUSE mount point");
+		fuse_opt_free_args( &args ) ;
+		return 1 ;
+	}
+
+	se = fuse_session_new( &args, &owfs_lowlevel_oper, sizeof(owfs_lowlevel_oper), NULL ) ;
+	if ( se != NULL ) {
+		if ( fuse_set_signal_handlers( se ) == 0 ) {
+			if ( fuse_session_mount( se, opts.mountpoint ) == 0 ) {
+				fuse_daemonize( opts.foreground ) ;
+				if ( opts.singlethread ) {
+					ret = fuse_session_loop( se ) ;
+				} else {
+					ret = fuse_session_loop_mt( se, opts.clone_fd ) ;
+				}
+				fuse_session_unmount( se ) ;
+			}
+			fuse_remove_signal_handlers( se ) ;
+		}
+		fuse_session_destroy( se ) ;
+	}
+	free( opts.mountpoint ) ; // allocated by fuse
+	fuse_opt_free_args( &args ) ;
+	return ret ;
+}
+
+#endif							/* OW_FUSE3 */
@@ -22,7 +22,12 @@
 
 //#define FUSE_USE_VERSION 26
 // FUSE_USE_VERSION is set from configure script
+#if OW_FUSE3
+/* FUSE 3 -- low level API (owfs_lowlevel.c) */
+#include <fuse_lowlevel.h>
+#else							/* OW_FUSE3 */
 #include <fuse.h>
+#endif							/* OW_FUSE3 */
 #ifndef FUSE_VERSION
 #ifndef FUSE_MAJOR_VERSION
 #define FUSE_VERSION 11
@@ -33,7 +38,11 @@
 #endif							/* FUSE_MAJOR_VERSION */
 #endif							/* FUSE_VERSION */
 
+#if OW_FUSE3
+extern const struct fuse_lowlevel_ops owfs_lowlevel_oper;
+#else							/* OW_FUSE3 */
 extern struct fuse_operations owfs_oper;
+#endif							/* OW_FUSE3 */
 
 struct Fuse_option {
 	int allocated_slots;
@@ -46,5 +55,8 @@ void Fuse_cleanup(struct Fuse_option *fo);
 int Fuse_parse(char *opts, struct Fuse_option *fo);
 int Fuse_add(char *opt, struct Fuse_option *fo);
 char *Fuse_arg(char *opt_arg, char *entryname);
+#if OW_FUSE3
+int Fuse_lowlevel_main(struct Fuse_option *fo);
+#endif							/* OW_FUSE3 */
 
 #endif							/* OWFS_H */
@@ -0,0 +1,451 @@
+#include "owfs_testhelper.h"
+#include "ow_connection.h"
+
+// owfs's FUSE 3 low level callbacks, called as the kernel would
+//
+// The replies are taken here instead of by libfuse (the program's
+// definitions come first), the last one kept for the test to look at.
+// Directory entries are not packed for the kernel, each takes the same
+// room and is written down by name. The command line is taken where fuse
+// would parse it, and goes no further.
+
+#if OW_FUSE3
+
+#define LOWLEVEL_DEVICE		"10.67C6697351FF"
+#define FAKE_ENTRY_SIZE		64
+#define FAKE_ENTRIES		128
+#define FAKE_NAME			32
+#define FAKE_ARGS			16
+
+enum fake_reply { reply_nothing, reply_none, reply_err, reply_entry, reply_attr, reply_open, reply_buf, reply_write, } ;
+
+static struct {
+	enum fake_reply reply ;
+	int err ;
+	struct fuse_entry_param entry ;
+	struct stat attr ;
+	double attr_timeout ;
+	char buffer[256] ;
+	size_t length ;
+	int entries ;				// directory entries added since fake_reset
+	char name[FAKE_ENTRIES][FAKE_NAME] ;
+	fuse_ino_t ino[FAKE_ENTRIES] ;
+	mode_t mode[FAKE_ENTRIES] ;
+	off_t next[FAKE_ENTRIES] ;
+	int argc ;					// what fuse_parse_cmdline was given
+	char * argv[FAKE_ARGS] ;
+} fake ;
+
+#define FAKE_REQ	( (fuse_req_t) &fake )
+
+static void fake_reset( void )
+{
+	int i ;
+
+	for ( i = 0 ; i < fake.argc ; ++i ) {
+		free( fake.argv[i] ) ;
+	}
+	memset( &fake, 0, sizeof(fake) ) ;
+}
+
+int fuse_reply_err( fuse_req_t req, int err )
+{
+	(void) req ;
+	fake.reply = reply_err ;
+	fake.err = err ;
+	return 0 ;
+}
+
+void fuse_reply_none( fuse_req_t req )
+{
+	(void) req ;
+	fake.reply = reply_none ;
+}
+
+int fuse_reply_entry( fuse_req_t req, const struct fuse_entry_param * e )
+{
+	(void) req ;
+	fake.reply = reply_entry ;
+	fake.entry = *e ;
+	return 0 ;
+}
+
+int fuse_reply_attr( fuse_req_t req, const struct stat * attr, double attr_timeout )
+{
+	(void) req ;
+	fake.reply = reply_attr ;
+	fake.attr = *attr ;
+	fake.attr_timeout = attr_timeout ;
+	return 0 ;
+}
+
+int fuse_reply_open( fuse_req_t req, const struct fuse_file_info * file_info )
+{
+	(void) req ;
+	(void) file_info ;
+	fake.reply = reply_open ;
+	return 0 ;
+}
+
+int fuse_reply_write( fuse_req_t req, size_t count )
+{
+	(void) req ;
+	fake.reply = reply_write ;
+	fake.length = count ;
+	return 0 ;
+}
+
+int fuse_reply_buf( fuse_req_t req, const char * buffer, size_t size )
+{
+	(void) req ;
+	fake.reply = reply_buf ;
+	fake.length = size ;
+	if ( buffer != NULL && size <= sizeof(fake.buffer) ) {
+		memcpy( fake.buffer, buffer, size ) ;
+	}
+	return 0 ;
+}
+
+static size_t fake_direntry( size_t bufsize, const char * name, fuse_ino_t ino, mode_t mode, off_t off )
+{
+	if ( bufsize >= FAKE_ENTRY_SIZE ) {
+		ck_assert_int_lt( fake.entries, FAKE_ENTRIES ) ;
+		snprintf( fake.name[fake.entries], FAKE_NAME, "%s", name ) ;
+		fake.ino[fake.entries] = ino ;
+		fake.mode[fake.entries] = mode ;
+		fake.next[fake.entries] = off ;
+		++fake.entries ;
+	}
+	return FAKE_ENTRY_SIZE ;
+}
+
+size_t fuse_add_direntry( fuse_req_t req, char * buf, size_t bufsize, const char * name, const struct stat * stbuf, off_t off )
+{
+	(void) req ;
+	(void) buf ;
+	return fake_direntry( bufsize, name, stbuf->st_ino, stbuf->st_mode, off ) ;
+}
+
+size_t fuse_add_direntry_plus( fuse_req_t req, char * buf, size_t bufsize, const char * name, const struct fuse_entry_param * e, off_t off )
+{
+	(void) req ;
+	(void) buf ;
+	ck_assert_int_eq( e->ino, e->attr.st_ino ) ;
+	return fake_direntry( bufsize, name, e->ino, e->attr.st_mode, off ) ;
+}
+
+int fuse_parse_cmdline( struct fuse_args * args, struct fuse_cmdline_opts * opts )
+{
+	(void) opts ;
+	ck_assert_int_le( args->argc, FAKE_ARGS ) ;
+	for ( fake.argc = 0 ; fake.argc < args->argc ; ++fake.argc ) {
+		fake.argv[fake.argc] = strdup( args->argv[fake.argc] ) ;
+	}
+	return -1 ; // not mounted
+}
+
+static struct port_in * lowlevel_bus( void )
+{
+	struct port_in * pin ;
+
+	ck_assert( GOOD( ARG_Fake( LOWLEVEL_DEVICE ) ) ) ;
+	pin = Inbound_Control.head_port ;
+	ck_assert( GOOD( Fake_detect( pin ) ) ) ;
+	return pin ;
+}
+
+// inode of name in parent, looked up once more
+static fuse_ino_t lowlevel_lookup( fuse_ino_t parent, const char * name )
+{
+	fake_reset() ;
+	owfs_lowlevel_oper.lookup( FAKE_REQ, parent, name ) ;
+	ck_assert_int_eq( reply_entry, fake.reply ) ;
+	ck_assert_int_gt( fake.entry.ino, FUSE_ROOT_ID ) ;
+	ck_assert_int_eq( fake.entry.ino, fake.entry.attr.st_ino ) ;
+	return fake.entry.ino ;
+}
+
+// is the inode still known?
+static int lowlevel_known( fuse_ino_t ino )
+{
+	fake_reset() ;
+	owfs_lowlevel_oper.getattr( FAKE_REQ, ino, NULL ) ;
+	if ( fake.reply == reply_err ) {
+		ck_assert_int_eq( ENOENT, fake.err ) ;
+		return 0 ;
+	}
+	ck_assert_int_eq( reply_attr, fake.reply ) ;
+	ck_assert_int_eq( ino, fake.attr.st_ino ) ;
+	return 1 ;
+}
+
+static int lowlevel_find( const char * name )
+{
+	int i ;
+
+	for ( i = 0 ; i < fake.entries ; ++i ) {
+		if ( strcmp( fake.name[i], name ) == 0 ) {
+			return i ;
+		}
+	}
+	return -1 ;
+}
+
+// A path keeps its inode while looked up, loses it with the last forget
+START_TEST(test_lowlevel_inodes)
+{
+	struct port_in * pin = lowlevel_bus() ;
+	fuse_ino_t device ;
+	fuse_ino_t temperature ;
+	struct fuse_forget_data forgets[2] ;
+
+	device = lowlevel_lookup( FUSE_ROOT_ID, LOWLEVEL_DEVICE ) ;
+	ck_assert( S_ISDIR( fake.entry.attr.st_mode ) ) ;
+	ck_assert( fake.entry.entry_timeout == Globals.timeout_presence ) ;
+	ck_assert_int_eq( device, lowlevel_lookup( FUSE_ROOT_ID, LOWLEVEL_DEVICE ) ) ;
+
+	temperature = lowlevel_lookup( device, "temperature" ) ;
+	ck_assert( S_ISREG( fake.entry.attr.st_mode ) ) ;
+	ck_assert( fake.entry.attr_timeout == Globals.timeout_volatile ) ;
+	ck_assert_int_ne( device, temperature ) ;
+	ck_assert( lowlevel_known( temperature ) ) ;
+
+	// not there, or under an unknown directory
+	fake_reset() ;
+	owfs_lowlevel_oper.lookup( FAKE_REQ, device, "nothing" ) ;
+	ck_assert_int_eq( reply_err, fake.reply ) ;
+	ck_assert_int_eq( ENOENT, fake.err ) ;
+	fake_reset() ;
+	owfs_lowlevel_oper.lookup( FAKE_REQ, temperature + 1000, "temperature" ) ;
+	ck_assert_int_eq( reply_err, fake.reply ) ;
+	ck_assert_int_eq( ENOENT, fake.err ) ;
+
+	// looked up twice, forgotten once: still there
+	fake_reset() ;
+	owfs_lowlevel_oper.forget( FAKE_REQ, device, 1 ) ;
+	ck_assert_int_eq( reply_none, fake.reply ) ;
+	ck_assert( lowlevel_known( device ) ) ;
+
+	forgets[0].ino = device ;
+	forgets[0].nlookup = 1 ;
+	forgets[1].ino = temperature ;
+	forgets[1].nlookup = 1 ;
+	fake_reset() ;
+	owfs_lowlevel_oper.forget_multi( FAKE_REQ, 2, forgets ) ;
+	ck_assert_int_eq( reply_none, fake.reply ) ;
+	ck_assert( ! lowlevel_known( device ) ) ;
+	ck_assert( ! lowlevel_known( temperature ) ) ;
+
+	// the root is never forgotten
+	owfs_lowlevel_oper.forget( FAKE_REQ, FUSE_ROOT_ID, 1 ) ;
+	ck_assert( lowlevel_known( FUSE_ROOT_ID ) ) ;
+
+	RemovePort( pin ) ;
+}
+END_TEST
+
+// readdirplus hands out one lookup per entry it sends, no more
+START_TEST(test_lowlevel_readdirplus)
+{
+	struct port_in * pin = lowlevel_bus() ;
+	struct fuse_file_info file_info ;
+	fuse_ino_t device = lowlevel_lookup( FUSE_ROOT_ID, LOWLEVEL_DEVICE ) ;
+	fuse_ino_t ino[FAKE_ENTRIES] ;
+	char name[FAKE_ENTRIES][FAKE_NAME] ;
+	int count = 0 ;
+	off_t offset = 0 ;
+	int i ;
+
+	memset( &file_info, 0, sizeof(file_info) ) ;
+	fake_reset() ;
+	owfs_lowlevel_oper.opendir( FAKE_REQ, device, &file_info ) ;
+	ck_assert_int_eq( reply_open, fake.reply ) ;
+
+	// a page takes two entries and a half
+	do {
+		fake_reset() ;
+		owfs_lowlevel_oper.readdirplus( FAKE_REQ, device, FAKE_ENTRY_SIZE * 5 / 2, offset, &file_info ) ;
+		ck_assert_int_eq( reply_buf, fake.reply ) ;
+		ck_assert_int_eq( fake.entries * FAKE_ENTRY_SIZE, fake.length ) ;
+		ck_assert_int_le( fake.entries, 2 ) ;
+		for ( i = 0 ; i < fake.entries ; ++i ) {
+			ck_assert_int_eq( offset + 1, fake.next[i] ) ;
+			offset = fake.next[i] ;
+			ck_assert_int_lt( count, FAKE_ENTRIES ) ;
+			strcpy( name[count], fake.name[i] ) ;
+			ino[count] = fake.ino[i] ;
+			++count ;
+		}
+	} while ( fake.entries > 0 ) ;
+
+	ck_assert_int_gt( count, 4 ) ;
+	ck_assert_str_eq( ".", name[0] ) ;
+	ck_assert_str_eq( "..", name[1] ) ;
+	ck_assert_int_eq( device, ino[0] ) ;
+	for ( i = 2 ; i < count ; ++i ) {
+		if ( strcmp( name[i], "temperature" ) == 0 ) {
+			// the same inode a lookup gives
+			ck_assert_int_eq( ino[i], lowlevel_lookup( device, "temperature" ) ) ;
+			owfs_lowlevel_oper.forget( FAKE_REQ, ino[i], 1 ) ;
+		}
+		ck_assert( lowlevel_known( ino[i] ) ) ;
+		owfs_lowlevel_oper.forget( FAKE_REQ, ino[i], 1 ) ;
+		ck_assert_msg( ! lowlevel_known( ino[i] ), "%s looked up more than once", name[i] ) ;
+	}
+
+	fake_reset() ;
+	owfs_lowlevel_oper.releasedir( FAKE_REQ, device, &file_info ) ;
+	ck_assert_int_eq( reply_err, fake.reply ) ;
+	ck_assert_int_eq( 0, fake.err ) ;
+	owfs_lowlevel_oper.forget( FAKE_REQ, device, 1 ) ;
+
+	RemovePort( pin ) ;
+}
+END_TEST
+
+// Plain readdir only shows the inodes there are, and takes none
+START_TEST(test_lowlevel_readdir)
+{
+	struct port_in * pin = lowlevel_bus() ;
+	struct fuse_file_info file_info ;
+	fuse_ino_t device = lowlevel_lookup( FUSE_ROOT_ID, LOWLEVEL_DEVICE ) ;
+	fuse_ino_t temperature = lowlevel_lookup( device, "temperature" ) ;
+	int i ;
+
+	memset( &file_info, 0, sizeof(file_info) ) ;
+	fake_reset() ;
+	owfs_lowlevel_oper.opendir( FAKE_REQ, device, &file_info ) ;
+	ck_assert_int_eq( reply_open, fake.reply ) ;
+	fake_reset() ;
+	owfs_lowlevel_oper.readdir( FAKE_REQ, device, FAKE_ENTRY_SIZE * FAKE_ENTRIES, 0, &file_info ) ;
+	ck_assert_int_eq( reply_buf, fake.reply ) ;
+
+	i = lowlevel_find( "temperature" ) ;
+	ck_assert_int_ge( i, 0 ) ;
+	ck_assert_int_eq( temperature, fake.ino[i] ) ;
+	ck_assert( S_ISREG( fake.mode[i] ) ) ;
+	i = lowlevel_find( "type" ) ;
+	ck_assert_int_ge( i, 0 ) ;
+	ck_assert_int_eq( 0xFFFFFFFF, fake.ino[i] ) ;
+	owfs_lowlevel_oper.releasedir( FAKE_REQ, device, &file_info ) ;
+
+	owfs_lowlevel_oper.forget( FAKE_REQ, temperature, 1 ) ;
+	ck_assert( ! lowlevel_known( temperature ) ) ;
+	owfs_lowlevel_oper.forget( FAKE_REQ, device, 1 ) ;
+
+	RemovePort( pin ) ;
+}
+END_TEST
+
+// An open file reads whole into its buffer and replies from there
+START_TEST(test_lowlevel_read)
+{
+	struct port_in * pin = lowlevel_bus() ;
+	struct fuse_file_info file_info ;
+	fuse_ino_t device = lowlevel_lookup( FUSE_ROOT_ID, LOWLEVEL_DEVICE ) ;
+	fuse_ino_t type = lowlevel_lookup( device, "type" ) ;
+
+	memset( &file_info, 0, sizeof(file_info) ) ;
+	fake_reset() ;
+	owfs_lowlevel_oper.open( FAKE_REQ, type, &file_info ) ;
+	ck_assert_int_eq( reply_open, fake.reply ) ;
+	ck_assert( file_info.direct_io ) ;
+
+	fake_reset() ;
+	owfs_lowlevel_oper.read( FAKE_REQ, type, 4096, 0, &file_info ) ;
+	ck_assert_int_eq( reply_buf, fake.reply ) ;
+	ck_assert_int_eq( 7, fake.length ) ;
+	ck_assert( memcmp( "DS18S20", fake.buffer, 7 ) == 0 ) ;
+
+	fake_reset() ;
+	owfs_lowlevel_oper.read( FAKE_REQ, type, 3, 2, &file_info ) ;
+	ck_assert_int_eq( reply_buf, fake.reply ) ;
+	ck_assert_int_eq( 3, fake.length ) ;
+	ck_assert( memcmp( "18S", fake.buffer, 3 ) == 0 ) ;
+
+	// past the end
+	fake_reset() ;
+	owfs_lowlevel_oper.read( FAKE_REQ, type, 4096, 4096, &file_info ) ;
+	ck_assert_int_eq( reply_buf, fake.reply ) ;
+	ck_assert_int_eq( 0, fake.length ) ;
+
+	fake_reset() ;
+	owfs_lowlevel_oper.release( FAKE_REQ, type, &file_info ) ;
+	ck_assert_int_eq( reply_err, fake.reply ) ;
+	ck_assert_int_eq( 0, fake.err ) ;
+
+	// a directory isn't opened as a file
+	fake_reset() ;
+	owfs_lowlevel_oper.open( FAKE_REQ, device, &file_info ) ;
+	ck_assert_int_eq( reply_err, fake.reply ) ;
+	ck_assert_int_eq( EISDIR, fake.err ) ;
+
+	owfs_lowlevel_oper.forget( FAKE_REQ, type, 1 ) ;
+	owfs_lowlevel_oper.forget( FAKE_REQ, device, 1 ) ;
+
+	RemovePort( pin ) ;
+}
+END_TEST
+
+// the arguments Fuse_lowlevel_main gives fuse for command line args
+static int lowlevel_args( const char ** args )
+{
+	struct Fuse_option fo ;
+
+	fake_reset() ;
+	ck_assert_int_eq( 0, Fuse_setup( &fo ) ) ;
+	while ( *args != NULL ) {
+		ck_assert_int_eq( 0, Fuse_add( (char *) *args, &fo ) ) ;
+		++args ;
+	}
+	ck_assert_int_eq( 1, Fuse_lowlevel_main( &fo ) ) ;
+	Fuse_cleanup( &fo ) ;
+	return fake.argc ;
+}
+
+// FUSE 2 style options, as owfs builds them, the way FUSE 3 takes them
+START_TEST(test_lowlevel_args)
+{
+	static const char * owfs_args[] = { "/mnt/1wire", "-o", "direct_io", "-f", "-oallow_other,big_writes", "", "-o", "ro,,entry_timeout=5", NULL, } ;
+	static const char * fuse2_args[] = { "/mnt/1wire", "-o", "direct_io", NULL, } ;
+	static const char * missing_args[] = { "/mnt/1wire", "-o", NULL, } ;
+
+	ck_assert_int_eq( 5, lowlevel_args( owfs_args ) ) ;
+	ck_assert_str_eq( "OWFS", fake.argv[0] ) ;
+	ck_assert_str_eq( "/mnt/1wire", fake.argv[1] ) ;
+	ck_assert_str_eq( "-f", fake.argv[2] ) ;
+	ck_assert_str_eq( "-o", fake.argv[3] ) ;
+	ck_assert_str_eq( "allow_other,ro", fake.argv[4] ) ;
+
+	// nothing left for "-o"
+	ck_assert_int_eq( 2, lowlevel_args( fuse2_args ) ) ;
+	ck_assert_str_eq( "/mnt/1wire", fake.argv[1] ) ;
+
+	// never parsed
+	ck_assert_int_eq( 0, lowlevel_args( missing_args ) ) ;
+
+	fake_reset() ;
+}
+END_TEST
+
+#endif /* OW_FUSE3 */
+
+// Create test-suite
+Suite* owfs_lowlevel_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("lowlevel");
+
+#if OW_FUSE3
+	tcase_add_checked_fixture(tc, owfs_test_setup, owfs_test_teardown);
+	tcase_add_test(tc, test_lowlevel_inodes);
+	tcase_add_test(tc, test_lowlevel_readdirplus);
+	tcase_add_test(tc, test_lowlevel_readdir);
+	tcase_add_test(tc, test_lowlevel_read);
+	tcase_add_test(tc, test_lowlevel_args);
+#endif /* OW_FUSE3 */
+	suite_add_tcase (s, tc);
+	return s;
+}
@@ -0,0 +1,13 @@
+#ifndef OWFS_OWFSTEST_HELPER_H
+#define OWFS_OWFSTEST_HELPER_H
+
+#include <config.h>
+#include "owfs_config.h"
+#include "owfs.h"
+
+#include <check.h>
+
+void owfs_test_setup(void);
+void owfs_test_teardown(void);
+
+#endif //OWFS_OWFSTEST_HELPER_H
@@ -34,6 +34,16 @@
 #define DEFAULTPORT    80
 
 static void Acceptor(int listenfd);
+static GOOD_OR_BAD Request(FILE_DESCRIPTOR_OR_ERROR file_descriptor, void ** state);
+static void Release(void * state);
+
+/* One connection in the event loop, kept between its requests */
+struct http_connection {
+	FILE * in ;
+	FILE * out ;
+	struct http_stream * stream ;
+	int requests ;
+} ;
 
 int main(int argc, char *argv[])
 {
@@ -97,6 +107,7 @@ int main(int argc, char *argv[])
 	set_exit_signal_handlers(exit_handler);
 	set_signal_handlers(NULL);
 
+	ServerRequestRoutines(Request, Release);
 	ServerProcess(Acceptor);
 
 	LEVEL_DEBUG("ServerProcess done");
@@ -105,12 +116,108 @@ int main(int argc, char *argv[])
 	return 0;
 }
 
+/* Requests are read and answered in turn (HTTP/1.1 persistent connections
+ * and pipelining). Separate streams, since stdio drops read-ahead input
+ * (the next pipelined request) when a "w+" stream turns to writing.
+ * A connection idle for timeout_server is closed. */
 static void Acceptor(int listenfd)
 {
-	FILE *fp = fdopen(listenfd, "w+");
-	if (fp) {
-		handle_socket(fp);
-		fflush(fp);
-		fclose(fp);
+	struct timeval tv = { Globals.timeout_server, 0, } ;
+	struct http_stream * stream ;
+	FILE * in ;
+	FILE * out ;
+	int requests = 0 ;
+
+	setsockopt( listenfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(struct timeval) ) ;
+
+	out = HTTPstream_open( listenfd, &stream ) ;
+	if ( out == NULL ) {
+		return ;
+	}
+	in = fdopen(listenfd, "r");
+	if ( in != NULL ) {
+		while ( handle_socket( in, out, stream, requests ) ) {
+			++requests ;
+		}
+	}
+	fclose(out);
+	if ( in != NULL ) {
+		fclose(in);
+	}
+}
+
+/* Is the next request already read ahead into the input stream (or
+ * waiting on the socket)? Looked at without blocking. */
+static int RequestWaiting(FILE * in)
+{
+	int flags = fcntl( fileno(in), F_GETFL ) ;
+	int c ;
+
+	if ( flags < 0 ) {
+		return 0 ;
+	}
+	fcntl( fileno(in), F_SETFL, flags | O_NONBLOCK ) ;
+	c = fgetc( in ) ;
+	fcntl( fileno(in), F_SETFL, flags ) ;
+	if ( c == EOF ) {
+		clearerr( in ) ;
+		return 0 ;
+	}
+	ungetc( c, in ) ;
+	return 1 ;
+}
+
+/* Event loop (--server_workers): answer the requests that have arrived,
+ * then the connection waits in the loop for more instead of in a worker.
+ * The input stream has its own descriptor, the loop closes the socket. */
+static GOOD_OR_BAD Request(FILE_DESCRIPTOR_OR_ERROR file_descriptor, void ** state)
+{
+	struct http_connection * hc = state[0] ;
+
+	if ( hc == NULL ) {
+		struct timeval tv = { Globals.timeout_server, 0, } ;
+		FILE_DESCRIPTOR_OR_ERROR in_descriptor ;
+
+		hc = owcalloc( 1, sizeof(struct http_connection) ) ;
+		if ( hc == NULL ) {
+			return gbBAD ;
+		}
+		state[0] = hc ;
+		setsockopt( file_descriptor, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(struct timeval) ) ;
+		hc->out = HTTPstream_open( file_descriptor, &(hc->stream) ) ;
+		if ( hc->out == NULL ) {
+			return gbBAD ;
+		}
+		in_descriptor = dup( file_descriptor ) ;
+		if ( FILE_DESCRIPTOR_NOT_VALID( in_descriptor ) ) {
+			return gbBAD ;
+		}
+		hc->in = fdopen( in_descriptor, "r" ) ;
+		if ( hc->in == NULL ) {
+			close( in_descriptor ) ;
+			return gbBAD ;
+		}
+	}
+
+	do {
+		if ( ! handle_socket( hc->in, hc->out, hc->stream, hc->requests ) ) {
+			return gbBAD ;
+		}
+		++hc->requests ;
+	} while ( RequestWaiting( hc->in ) ) ;
+	return gbGOOD ;
+}
+
+/* Event loop connection closed */
+static void Release(void * state)
+{
+	struct http_connection * hc = state ;
+
+	if ( hc->out != NULL ) {
+		fclose( hc->out ) ;
+	}
+	if ( hc->in != NULL ) {
+		fclose( hc->in ) ;
 	}
+	owfree( hc ) ;
 }
@@ -138,5 +138,4 @@ void Favicon(struct OutputControl * oc)
 	for (i = 0; i < 894; ++i) {
 		fprintf(out, "%c", favicon[i]);
 	}
-	HTTPfoot(oc);
 }
@@ -24,7 +24,7 @@ struct urlparse {
 	char *value;
 };
 
-enum http_return { http_ok, http_dir, http_icon, http_400, http_404 } ;
+enum http_return { http_ok, http_dir, http_icon, http_snapshot, http_400, http_404 } ;
 
 	/* Error page functions */
 enum content_type PoorMansParser( char * bad_url ) ;
@@ -40,27 +40,41 @@ static void TrimBoundary( char ** boundary ) ;
 static int GetPostData( char * boundary, struct memblob * mb, struct OutputControl * oct ) ;
 static char * GetPostPath(  struct OutputControl * oc ) ;
 static GOOD_OR_BAD GetHostURL( struct OutputControl * oc ) ;
+static const char * SnapshotURL( const char * file ) ;
+static void HeaderLine( struct OutputControl * oc, const char * line ) ;
+static char * HeaderValue( const char * value ) ;
 
 /* --------------- Functions ---------------- */
 
-/* Main handler for a web page */
-int handle_socket(FILE * out)
+/* Main handler for a web page
+ * requests is the number already answered on this connection
+ * returns non-zero if the connection stays open for another */
+int handle_socket(FILE * in, FILE * out, struct http_stream * stream, int requests)
 {
 	enum http_return http_code ;
 	enum content_type pmp = ct_html;
+	int cacheable = 0 ;
+	const char * snapshot_path = NULL ;
 
 	struct urlparse up;
 	
-	struct OutputControl s_oc = { out, 0, NULL, NULL, } ;
+	struct OutputControl s_oc ;
 	struct OutputControl * oc = &s_oc ;
 
 	struct parsedname s_pn;
 	struct parsedname * pn = &s_pn ;
 	
+	memset( oc, 0, sizeof(struct OutputControl) ) ;
+	oc->owq = NO_ONE_WIRE_QUERY ;
+	oc->out = out ;
+	oc->in = in ;
+	oc->stream = stream ;
+
 	up.line = NULL ; // prep for getline with null. Will be allocated by getline.
-	if ( getline(&(up.line), &(up.line_length), out) >= 0 ) {
+	if ( getline(&(up.line), &(up.line_length), in) >= 0 ) {
 		LEVEL_CALL("PreParse line=%s", up.line);
 		URLparse(&up);				/* Break up URL */
+		oc->http11 = ( up.version != NULL && strcmp( up.version, "HTTP/1.1" ) == 0 ) ;
 		httpunescape((BYTE *) up.file    );
 		httpunescape((BYTE *) up.request );
 		httpunescape((BYTE *) up.value   );
@@ -90,6 +104,22 @@ int handle_socket(FILE * out)
 			ReadToCRLF(oc) ;
 			pn = NO_PARSEDNAME ;
 			http_code = http_icon ;
+		} else if ( (snapshot_path = SnapshotURL(up.file)) != NULL ) {
+			// bulk read of everything under the path
+			LEVEL_DEBUG("http snapshot request for %s.",snapshot_path);
+			ReadToCRLF(oc) ;
+			if (strcmp(up.cmd, "GET") != 0) {
+				pn = NO_PARSEDNAME ;
+				http_code = http_400 ;
+			} else if (FS_ParsedName(snapshot_path, pn) != 0) {
+				pn = NO_PARSEDNAME ;
+				http_code = http_404 ;
+			} else if (pn->selected_filetype != NO_FILETYPE) {
+				// a single property is no snapshot
+				http_code = http_404 ;
+			} else {
+				http_code = http_snapshot ;
+			}
 		} else 	if (FS_ParsedName(up.file, pn) != 0) {
 			// Can't understand the file name = URL
 			LEVEL_DEBUG("http %s not understood.",up.file);
@@ -106,6 +136,7 @@ int handle_socket(FILE * out)
 			http_code = handle_POST( oc, &up ) ;
 		} else if (strcmp(up.cmd, "GET") == 0) {
 			LEVEL_DEBUG("http GET request.");
+			cacheable = ( up.request == NULL ) ; // just a read
 			http_code = handle_GET( oc, &up ) ;
 			// special case for possible alias changes
 			// Parsedname structure may point to a device that no longer exists
@@ -130,7 +161,7 @@ int handle_socket(FILE * out)
 			case http_400:
 			case http_404:
 				// need to call this before freeing up.file
-				pmp = PoorMansParser(up.file) ;
+				pmp = ( snapshot_path != NULL ) ? ct_json : PoorMansParser(up.file) ;
 				break ;
 			default:
 				// not an error
@@ -138,15 +169,21 @@ int handle_socket(FILE * out)
 		}
 		// allocated by getline
 		free(up.line) ;
+	} else if ( requests > 0 ) {
+		// persistent connection closed by the client or idle
+		free(up.line) ;
+		LEVEL_DEBUG("No more http requests on this connection.");
+		return 0 ;
 	} else {
+		free(up.line) ;
 		LEVEL_DEBUG("No http data.");
 		pn = NO_PARSEDNAME ;
 		http_code = http_400 ;
 	}
 
-	// This is necessary for SunOS
-	fflush(out);
-	
+	// Keep the connection (HTTP/1.1) if the whole request was read
+	oc->persistent = oc->stream != NULL && oc->http11 && oc->request_done && ! oc->close && Globals.no_persistence == 0 ;
+
 	switch ( http_code ) {
 		case http_icon:
 			Favicon(oc);
@@ -160,10 +197,20 @@ int handle_socket(FILE * out)
 		case http_dir:
 			ShowDir(oc, pn);
 			break ;
+		case http_snapshot:
+			ShowSnapshot(oc, pn);
+			break ;
 		case http_ok:
-			ShowDevice(oc, pn);
+			if ( cacheable ) {
+				HTTPvalidator(oc, pn);
+			}
+			if ( ! HTTPnotmodified(oc) ) {
+				ShowDevice(oc, pn);
+			}
 			break ;
 	}
+	HTTPstream_finish(oc);
+
 	if ( pn != NO_PARSEDNAME ) {
 		FS_ParsedName_destroy(pn);
 	}
@@ -174,8 +221,17 @@ int handle_socket(FILE * out)
 	if ( oc->host != NULL ) {
 		owfree( oc->host ) ;
 	}
+	if ( oc->if_none_match != NULL ) {
+		owfree( oc->if_none_match ) ;
+	}
+	if ( oc->if_modified_since != NULL ) {
+		owfree( oc->if_modified_since ) ;
+	}
+	if ( oc->owq != NO_ONE_WIRE_QUERY ) {
+		OWQ_destroy( oc->owq ) ;
+	}
 	
-	return 0 ;
+	return oc->persistent ;
 }	
 
 /* The HTTP request is a GET message */
@@ -235,7 +291,7 @@ static enum http_return handle_GET( struct OutputControl * oc, struct urlparse *
 /* The HTTP request is a POST message */
 static enum http_return handle_POST( struct OutputControl * oc, struct urlparse * up)
 {
-	FILE* out = oc->out ;
+	FILE* in = oc->in ;
 	enum http_return http_code = http_404 ; // default error mode
 
 	char * boundary = NULL ;
@@ -245,9 +301,11 @@ static enum http_return handle_POST( struct OutputControl * oc, struct urlparse
 	if (up->version) {
 		ReadToCRLF( oc ) ;
 	}
+	// the upload may not be read to its end
+	oc->request_done = 0 ;
 	
 	// use getline because it handles null chars
-	if ( getline(&boundary,&boundary_length,out) > 2 ) {
+	if ( getline(&boundary,&boundary_length,in) > 2 ) {
 		char * post_path  = GetPostPath( oc ) ;
 
 		TrimBoundary( &boundary) ;
@@ -420,17 +478,19 @@ static void Bad404(struct OutputControl * oc, const enum content_type ct)
 
 static void ReadToCRLF( struct OutputControl * oc )
 {
-	FILE * out = oc->out ;
+	FILE * in = oc->in ;
 	char * text_in = NULL ;
 	size_t length_in = 0 ;
 	ssize_t getline_length ;
 
 	/* read lines until blank */
-	while ( (getline_length = getline(&text_in, &length_in, out)) > 0 )  {
+	while ( (getline_length = getline(&text_in, &length_in, in)) > 0 )  {
 		LEVEL_DEBUG("More (%d) data:%s",(int)getline_length,text_in);
 		if ( strcmp(text_in, "\r\n")==0 || strcmp(text_in, "\n")==0 ) {
+			oc->request_done = 1 ;
 			break ;
 		}
+		HeaderLine( oc, text_in ) ;
 	}
 	
 	
@@ -456,13 +516,13 @@ static void TrimBoundary( char ** boundary )
 
 static char * GetPostPath(struct OutputControl * oc )
 {
-	FILE * out = oc->out ;
+	FILE * in = oc->in ;
 	char * text_in = NULL ;
 	size_t length_in = 0 ;
 	char * path_found = NO_PATH ;
 	
 	/* read lines until blank */
-	while (getline(&text_in, &length_in, out)>-1)  {
+	while (getline(&text_in, &length_in, in)>-1)  {
 		char * namestart ;
 		LEVEL_DEBUG("Post data:%s",SAFESTRING(text_in));
 		if ( strcmp(text_in, "\r\n")==0 || strcmp(text_in, "\n")==0 ) {
@@ -493,14 +553,14 @@ static char * GetPostPath(struct OutputControl * oc )
 // read data from file upload
 static int GetPostData( char * boundary, struct memblob * mb, struct OutputControl * oc )
 {
-	FILE * out = oc->out ;
+	FILE * in = oc->in ;
 	char * data = NULL ;
 	size_t data_length ;
 
 	ssize_t read_this_pass ;
 
 	MemblobInit( mb, 1000 ) ; // increqment in 1K amounts (arbitrary)
-	while ( (read_this_pass = getline(&data, &data_length, out)) > -1 ) {
+	while ( (read_this_pass = getline(&data, &data_length, in)) > -1 ) {
 		Debug_Bytes(boundary,(BYTE *)data,(size_t)read_this_pass);
 		if ( strstr( data, boundary ) != NULL ) {
 			free(data) ; // allocated by getline with malloc, not owmalloc
@@ -521,6 +581,22 @@ static int GetPostData( char * boundary, struct memblob * mb, struct OutputContr
 	return 1 ;
 }
 
+/* "/snapshot/path" (or just "/snapshot") -- returns the owfs path, else NULL */
+static const char * SnapshotURL( const char * file )
+{
+	if ( strncasecmp( file, "/snapshot", 9 ) != 0 ) {
+		return NULL ;
+	}
+	switch ( file[9] ) {
+		case '\0':
+			return "/" ;
+		case '/':
+			return &file[9] ;
+		default:
+			return NULL ;
+	}
+}
+
 // Parse the line for just the text or json key since there was an error and Parsedname is null
 enum content_type PoorMansParser( char * bad_url )
 {
@@ -546,7 +622,7 @@ enum content_type PoorMansParser( char * bad_url )
 			
 static GOOD_OR_BAD GetHostURL( struct OutputControl * oc )
 {
-	FILE * out = oc->out ;
+	FILE * in = oc->in ;
 	char * line = NULL ;
 	static regex_t rx_host ;
 	struct ow_regmatch orm ;
@@ -558,12 +634,13 @@ static GOOD_OR_BAD GetHostURL( struct OutputControl * oc )
 	do {
 		size_t s ;
 
-		if ( getline( &line, &s, out ) < 0 ) {
+		if ( getline( &line, &s, in ) < 0 ) {
 			free( line ) ;
 			LEVEL_DEBUG("Couldn't find Host: line in HTTP header") ;
 			return gbBAD ;
 		}
 		LEVEL_DEBUG("Test line <%s>",line ) ;
+		HeaderLine( oc, line ) ;
 		if ( ow_regexec( &rx_host, line, &orm ) != 0 ) {
 			LEVEL_DEBUG("No match <%s>",line) ;
 			continue ;
@@ -574,3 +651,42 @@ static GOOD_OR_BAD GetHostURL( struct OutputControl * oc )
 		return gbGOOD ;				
 	} while (1) ;
 }
+
+/* Request headers that matter for the response */
+static void HeaderLine( struct OutputControl * oc, const char * line )
+{
+	if ( strncasecmp( line, "Connection:", 11 ) == 0 ) {
+		if ( strstr( line, "close" ) != NULL || strstr( line, "Close" ) != NULL ) {
+			oc->close = 1 ;
+		}
+	} else if ( strncasecmp( line, "If-None-Match:", 14 ) == 0 ) {
+		if ( oc->if_none_match == NULL ) {
+			oc->if_none_match = HeaderValue( &line[14] ) ;
+		}
+	} else if ( strncasecmp( line, "If-Modified-Since:", 18 ) == 0 ) {
+		if ( oc->if_modified_since == NULL ) {
+			oc->if_modified_since = HeaderValue( &line[18] ) ;
+		}
+	}
+}
+
+// value without the surrounding spaces and line end
+static char * HeaderValue( const char * value )
+{
+	size_t length ;
+	char * copy ;
+
+	while ( value[0] == ' ' || value[0] == '\t' ) {
+		++value ;
+	}
+	length = strcspn( value, "\r\n" ) ;
+	while ( length > 0 && ( value[length-1] == ' ' || value[length-1] == '\t' ) ) {
+		--length ;
+	}
+	copy = owmalloc( length + 1 ) ;
+	if ( copy != NULL ) {
+		memcpy( copy, value, length ) ;
+		copy[length] = '\0' ;
+	}
+	return copy ;
+}
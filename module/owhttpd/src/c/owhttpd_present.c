@@ -21,12 +21,18 @@ void HTTPstart(struct OutputControl * oc, const char *status, const enum content
 	FILE * out = oc->out ;
 	char d[44];
 	time_t t = NOW_TIME;
-	size_t l = strftime(d, sizeof(d), "%a, %d %b %Y %T GMT", gmtime(&t));
+	struct tm tm ;
+	size_t l = strftime(d, sizeof(d), "%a, %d %b %Y %T GMT", gmtime_r(&t, &tm));
 
-	fprintf(out, "HTTP/1.0 %s\r\n", status);
+	fprintf(out, "HTTP/1.%d %s\r\n", oc->http11, status);
 	fprintf(out, "Date: %*s\r\n", (int) l, d);
 	fprintf(out, "Server: %s\r\n", SVERSION);
-	fprintf(out, "Last-Modified: %*s\r\n", (int) l, d);
+	if ( oc->etag[0] != '\0' ) {
+		fprintf(out, "ETag: %s\r\n", oc->etag);
+		fprintf(out, "Last-Modified: %s\r\n", oc->last_modified);
+	} else {
+		fprintf(out, "Last-Modified: %*s\r\n", (int) l, d);
+	}
 	/*
 	 * fprintf( out, "MIME-version: 1.0\r\n" );
 	 */
@@ -36,7 +42,6 @@ void HTTPstart(struct OutputControl * oc, const char *status, const enum content
 		break;
 	case ct_icon:
 		fprintf(out, "Content-Length: 894\r\n");
-		fprintf(out, "Connection: close\r\n");
 		break ;
 	case ct_text:
 		fprintf(out, "Content-Type: text/plain\r\n");
@@ -46,7 +51,96 @@ void HTTPstart(struct OutputControl * oc, const char *status, const enum content
 		fprintf(out, "Content-Type: application/json\r\n");
 		break ;
 	}
+	if ( ! oc->persistent ) {
+		fprintf(out, "Connection: close\r\n");
+		fprintf(out, "\r\n");
+	} else if ( ct == ct_icon ) {
+		// length known
+		fprintf(out, "\r\n");
+	} else {
+		fprintf(out, "Transfer-Encoding: chunked\r\n");
+		fprintf(out, "\r\n");
+		HTTPstream_chunked(oc) ;
+	}
+}
+
+/* FNV-1a of the value */
+static UINT HTTPhash(const char * value, size_t length)
+{
+	UINT hash = 2166136261u ;
+	size_t i ;
+
+	for ( i = 0 ; i < length ; ++i ) {
+		hash ^= (BYTE) value[i] ;
+		hash *= 16777619u ;
+	}
+	return hash ;
+}
+
+/* ETag (hash of the value) and Last-Modified while the value stays in the cache
+ * The value is kept in oc for the page, so what is shown is what was hashed */
+void HTTPvalidator(struct OutputControl * oc, const struct parsedname * pn)
+{
+	time_t stored ;
+	time_t expires ;
+	struct tm tm ;
+	struct one_wire_query * owq ;
+
+	oc->etag[0] = '\0' ;
+	if ( pn->selected_filetype == NO_FILETYPE || IsStructureDir(pn) ) {
+		return ;
+	}
+	if ( BAD( Cache_Get_Expiry( &stored, &expires, pn ) ) ) {
+		return ;
+	}
+	owq = OWQ_create_from_path(pn->path); // for read
+	if ( owq == NO_ONE_WIRE_QUERY ) {
+		return ;
+	}
+	if ( BAD( OWQ_allocate_read_buffer(owq) ) ) {
+		OWQ_destroy(owq);
+		return ;
+	}
+	oc->owq = owq ;
+	oc->owq_read = FS_read_postparse(owq);
+	if ( oc->owq_read >= 0 ) {
+		snprintf(oc->etag, sizeof(oc->etag), "\"%08X-%X\"", HTTPhash( OWQ_buffer(owq), oc->owq_read ), (UINT) oc->owq_read);
+		strftime(oc->last_modified, sizeof(oc->last_modified), "%a, %d %b %Y %T GMT", gmtime_r(&stored, &tm));
+	}
+}
+
+/* Client has this version already -- 304 with no body */
+int HTTPnotmodified(struct OutputControl * oc)
+{
+	FILE * out = oc->out ;
+	char d[44];
+	time_t t = NOW_TIME;
+	struct tm tm ;
+	size_t l ;
+
+	if ( oc->etag[0] == '\0' ) {
+		return 0 ;
+	} else if ( oc->if_none_match != NULL ) {
+		// may be a list
+		if ( strstr( oc->if_none_match, oc->etag ) == NULL ) {
+			return 0 ;
+		}
+	} else if ( oc->if_modified_since == NULL || strcmp( oc->if_modified_since, oc->last_modified ) != 0 ) {
+		return 0 ;
+	}
+
+	LEVEL_CALL("Return a 304 HTTP not modified");
+	l = strftime(d, sizeof(d), "%a, %d %b %Y %T GMT", gmtime_r(&t, &tm));
+	fprintf(out, "HTTP/1.%d 304 Not Modified\r\n", oc->http11);
+	fprintf(out, "Date: %*s\r\n", (int) l, d);
+	fprintf(out, "Server: %s\r\n", SVERSION);
+	fprintf(out, "ETag: %s\r\n", oc->etag);
+	fprintf(out, "Last-Modified: %s\r\n", oc->last_modified);
+	if ( ! oc->persistent ) {
+		fprintf(out, "Connection: close\r\n");
+	}
 	fprintf(out, "\r\n");
+	return 1 ;
 }
 
 void HTTPtitle(struct OutputControl * oc, const char *title)
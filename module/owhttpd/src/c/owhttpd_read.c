@@ -14,6 +14,9 @@
 // #include <libgen.h>  /* for dirname() */
 
 /* --------------- Prototypes---------------- */
+static struct one_wire_query * ShowQuery(struct OutputControl * oc, const struct parsedname *pn_entry);
+static void ShowQueryDone(struct OutputControl * oc, struct one_wire_query *owq);
+static SIZE_OR_ERROR ShowRead(struct OutputControl * oc, struct one_wire_query *owq);
 static void Show(struct OutputControl * oc, const struct parsedname *pn_entry);
 static void ShowDirectory(struct OutputControl * oc, const struct parsedname *pn_entry);
 static void ShowReadWrite(struct OutputControl * oc, struct one_wire_query *owq);
@@ -41,19 +44,50 @@ static void StructureDetailJson(struct OutputControl * oc, const char * structur
 
 /* --------------- Functions ---------------- */
 
+/* Query for an entry's value, with room to read it. The item HTTPvalidator
+ * read for the ETag is shown from that same read */
+static struct one_wire_query * ShowQuery(struct OutputControl * oc, const struct parsedname *pn_entry)
+{
+	struct one_wire_query *owq ;
+
+	if ( oc->owq != NO_ONE_WIRE_QUERY && strcmp( PN(oc->owq)->path, pn_entry->path ) == 0 ) {
+		return oc->owq ;
+	}
+	owq = OWQ_create_from_path(pn_entry->path); // for read or dir
+	if ( owq != NO_ONE_WIRE_QUERY && BAD( OWQ_allocate_read_buffer(owq) ) ) {
+		OWQ_destroy(owq);
+		return NO_ONE_WIRE_QUERY ;
+	}
+	return owq ;
+}
+
+static void ShowQueryDone(struct OutputControl * oc, struct one_wire_query *owq)
+{
+	if ( owq != oc->owq ) {
+		OWQ_destroy(owq);
+	}
+}
+
+/* The value, unless HTTPvalidator has it already */
+static SIZE_OR_ERROR ShowRead(struct OutputControl * oc, struct one_wire_query *owq)
+{
+	if ( owq == oc->owq ) {
+		return oc->owq_read ;
+	}
+	return FS_read_postparse(owq);
+}
+
 /* Device entry -- table line for a filetype */
 static void Show(struct OutputControl * oc, const struct parsedname *pn_entry)
 {
 	FILE * out = oc->out ;
-	struct one_wire_query *owq = OWQ_create_from_path(pn_entry->path); // for read or dir
+	struct one_wire_query *owq = ShowQuery(oc, pn_entry);
 	struct filetype * ft = pn_entry->selected_filetype ;
 	/* Left column */
 	fprintf(out, "<TR><TD><B>%s</B></TD><TD>", FS_DirName(pn_entry));
 
 	if (owq == NO_ONE_WIRE_QUERY) {
 		fprintf(out, "<B>Memory exhausted</B>");
-	} else if ( BAD( OWQ_allocate_read_buffer(owq)) ) {
-		fprintf(out, "<B>Memory exhausted</B>");
 	} else if (ft == NO_FILETYPE) {
 		ShowDirectory(oc, pn_entry);
 	} else if (IsStructureDir(pn_entry)) {
@@ -78,7 +112,7 @@ static void Show(struct OutputControl * oc, const struct parsedname *pn_entry)
 		}
 	}
 	fprintf(out, "</TD></TR>\r\n");
-	OWQ_destroy(owq);
+	ShowQueryDone(oc, owq);
 }
 
 
@@ -88,7 +122,7 @@ static void ShowReadWrite(struct OutputControl * oc, struct one_wire_query *owq)
 	FILE * out = oc->out ;
 	struct parsedname * pn = PN(owq) ;
 	const char *file = FS_DirName(pn);
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ShowRead(oc, owq);
 	if (read_return < 0) {
 		fprintf(out, "Error: %s", strerror(-read_return));
 		return;
@@ -151,7 +185,7 @@ static void Extension( struct OutputControl * oc, const struct parsedname * pn )
 static void ShowReadonly(struct OutputControl * oc, struct one_wire_query *owq)
 {
 	FILE * out = oc->out ;
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ShowRead(oc, owq);
 	struct parsedname * pn = PN(owq) ;
 	if (read_return < 0) {
 		fprintf(out, "Error: %s", strerror(-read_return));
@@ -196,7 +230,7 @@ static void ShowReadonly(struct OutputControl * oc, struct one_wire_query *owq)
 static void ShowStructure(struct OutputControl * oc, struct one_wire_query *owq)
 {
 	FILE * out = oc->out ;
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ShowRead(oc, owq);
 	if (read_return < 0) {
 		fprintf(out, "Error: %s", strerror(-read_return));
 		return;
@@ -335,14 +369,13 @@ static void ShowDirectory(struct OutputControl * oc, const struct parsedname *pn
 static void ShowText(struct OutputControl * oc, const struct parsedname *pn_entry)
 {
 	FILE * out = oc->out ;
-	struct one_wire_query *owq = OWQ_create_from_path(pn_entry->path); // for read or dir
+	struct one_wire_query *owq = ShowQuery(oc, pn_entry);
 	struct filetype * ft = pn_entry->selected_filetype ;
 
 	/* Left column */
 	fprintf(out, "%s ", FS_DirName(pn_entry));
 
 	if (owq == NO_ONE_WIRE_QUERY) {
-	} else if ( BAD( OWQ_allocate_read_buffer(owq)) ) {
 		//fprintf(out, "(memory exhausted)");
 	} else if (ft == NO_FILETYPE) {
 		ShowTextDirectory(oc, pn_entry);
@@ -363,14 +396,14 @@ static void ShowText(struct OutputControl * oc, const struct parsedname *pn_entr
 		}
 	}
 	fprintf(out, "\r\n");
-	OWQ_destroy(owq);
+	ShowQueryDone(oc, owq);
 }
 
 /* Device entry -- table line for a filetype */
 static void ShowTextStructure(struct OutputControl * oc, struct one_wire_query *owq)
 {
 	FILE * out = oc->out ;
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ShowRead(oc, owq);
 	if (read_return < 0) {
 		//fprintf(out, "error: %s", strerror(-read_return));
 		return;
@@ -383,7 +416,7 @@ static void ShowTextStructure(struct OutputControl * oc, struct one_wire_query *
 static void ShowTextReadWrite(struct OutputControl * oc, struct one_wire_query *owq)
 {
 	FILE * out = oc->out ;
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ShowRead(oc, owq);
 	if (read_return < 0) {
 		//fprintf(out, "error: %s", strerror(-read_return));
 		return;
@@ -461,13 +494,11 @@ static void ShowDeviceText(struct OutputControl * oc, struct parsedname *pn)
 static void ShowJson(struct OutputControl * oc, const struct parsedname *pn_entry)
 {
 	FILE * out = oc->out ;
-	struct one_wire_query *owq = OWQ_create_from_path(pn_entry->path); // for read or dir
+	struct one_wire_query *owq = ShowQuery(oc, pn_entry);
 	struct filetype * ft = pn_entry->selected_filetype ;
 
 	if (owq == NO_ONE_WIRE_QUERY) {
 		fprintf(out, "null");
-	} else if ( BAD( OWQ_allocate_read_buffer(owq)) ) {
-		fprintf(out, "null");
 	} else if (ft == NO_FILETYPE) {
 		ShowJsonDirectory(oc, pn_entry);
 	} else if (IsStructureDir(pn_entry)) {
@@ -486,14 +517,14 @@ static void ShowJson(struct OutputControl * oc, const struct parsedname *pn_entr
 			ShowJsonReadWrite(oc, owq);
 		}
 	}
-	OWQ_destroy(owq);
+	ShowQueryDone(oc, owq);
 }
 
 /* Device entry -- table line for a filetype */
 static void ShowJsonStructure(struct OutputControl * oc, struct one_wire_query *owq)
 {
 	FILE * out = oc->out ;
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ShowRead(oc, owq);
 	if (read_return < 0) {
 		fprintf(out, "null");
 		return;
@@ -597,7 +628,7 @@ static void ShowJsonReadWrite(struct OutputControl * oc, struct one_wire_query *
 {
 	FILE * out = oc->out ;
 	struct parsedname * pn = PN(owq) ;
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ShowRead(oc, owq);
 
 	if (read_return < 0) {
 		fprintf(out, "null");
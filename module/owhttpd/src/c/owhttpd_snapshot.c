@@ -0,0 +1,369 @@
+/*
+ * http.c for owhttpd (1-wire web server)
+ * By Paul Alfille 2003, using libow
+ * offshoot of the owfs ( 1wire file system )
+ *
+ * GPL license ( Gnu Public Lincense )
+ *
+ * Based on chttpd. copyright(c) 0x7d0 greg olszewski <noop@nwonknu.org>
+ *
+ */
+
+/* Bulk JSON snapshot
+ * GET /snapshot/path reads every readable property of every device under
+ * path (or of the one device) and answers with a single JSON object:
+ *   { "10.67C6697351FF": { "temperature": "21.5", ... }, ... }
+ * Subdirectories are nested objects, arrays are read whole (.ALL).
+ *
+ * Each device is a job for its port's worker (see ow_port_worker.c), so the
+ * buses are read at the same time. A job only builds the device's JSON in
+ * memory, the request thread writes each device out as soon as it is done.
+ * Reads are ordinary reads, through the cache (unless under /uncached).
+ */
+
+#include "owhttpd.h"
+
+struct snapshot_path {
+	struct snapshot_path * next ;
+	int subdir ;
+	char path[0] ;
+} ;
+
+struct snapshot_device {
+	struct snapshot_device * next ;
+	struct snapshot_device * ready_next ;	// done, not written yet
+	struct port_in * pin ;		// NULL for devices not on a bus (statistics...)
+	struct snapshot * snap ;
+	struct memblob mb ;			// the device's JSON, written by the request thread
+	struct port_job job ;
+	char path[0] ;
+} ;
+
+struct snapshot {
+	pthread_mutex_t ready_mutex ;
+	pthread_cond_t ready_cond ;
+	struct snapshot_device * ready ;
+	struct snapshot_device * devices ;
+	struct snapshot_device ** last ;
+} ;
+
+struct snapshot_list {
+	struct snapshot_path * head ;
+	struct snapshot_path ** last ;
+} ;
+
+static struct snapshot_path * SnapshotPath( const char * path, int subdir ) ;
+static void SnapshotFree( struct snapshot_path * sp ) ;
+static void SnapshotAddDevice( struct snapshot * snap, const struct parsedname * pn_device ) ;
+static void SnapshotDeviceCallback( void * v, const struct parsedname * pn_entry ) ;
+static void SnapshotPropertyCallback( void * v, const struct parsedname * pn_entry ) ;
+static void SnapshotText( struct memblob * mb, const char * text ) ;
+static void SnapshotString( struct memblob * mb, const char * data, size_t length ) ;
+static void SnapshotValue( struct memblob * mb, const char * path ) ;
+static void SnapshotDir( struct memblob * mb, struct parsedname * pn_dir ) ;
+static void SnapshotDevice( void * v ) ;
+static void SnapshotWrite( struct OutputControl * oc, struct snapshot_device * device ) ;
+
+static struct snapshot_path * SnapshotPath( const char * path, int subdir )
+{
+	size_t length = strlen( path ) ;
+	struct snapshot_path * sp = owmalloc( sizeof(struct snapshot_path) + length + 1 ) ;
+
+	if ( sp != NULL ) {
+		sp->next = NULL ;
+		sp->subdir = subdir ;
+		memcpy( sp->path, path, length + 1 ) ;
+	}
+	return sp ;
+}
+
+static void SnapshotFree( struct snapshot_path * sp )
+{
+	while ( sp != NULL ) {
+		struct snapshot_path * next = sp->next ;
+		owfree( sp ) ;
+		sp = next ;
+	}
+}
+
+/* Add the device, keeping directory order */
+static void SnapshotAddDevice( struct snapshot * snap, const struct parsedname * pn_device )
+{
+	size_t length = strlen( pn_device->path ) ;
+	struct snapshot_device * device = owcalloc( 1, sizeof(struct snapshot_device) + length + 1 ) ;
+
+	if ( device == NULL ) {
+		return ;
+	}
+	device->pin = ( pn_device->selected_connection == NO_CONNECTION ) ? NULL : pn_device->selected_connection->pown ;
+	device->snap = snap ;
+	memcpy( device->path, pn_device->path, length + 1 ) ;
+	snap->last[0] = device ;
+	snap->last = &(device->next) ;
+}
+
+/* FS_dir callback -- devices only (not bus.n, settings, ...) */
+static void SnapshotDeviceCallback( void * v, const struct parsedname * pn_entry )
+{
+	struct snapshot * snap = v ;
+	struct device * dev = pn_entry->selected_device ;
+
+	if ( dev == NO_DEVICE || dev == DeviceSimultaneous || dev == DeviceThermostat ) {
+		return ;
+	}
+	if ( pn_entry->selected_filetype != NO_FILETYPE ) {
+		return ;
+	}
+	SnapshotAddDevice( snap, pn_entry ) ;
+}
+
+/* FS_dir callback -- properties worth reading, and subdirectories */
+static void SnapshotPropertyCallback( void * v, const struct parsedname * pn_entry )
+{
+	struct snapshot_list * list = v ;
+	struct filetype * ft = pn_entry->selected_filetype ;
+	struct snapshot_path * sp ;
+	int subdir = 0 ;
+
+	if ( IsStructureDir(pn_entry) ) {
+		return ;
+	} else if ( ft == NO_FILETYPE ) {
+		if ( pn_entry->subdir == NO_SUBDIR ) {
+			return ;
+		}
+		subdir = 1 ;
+	} else if ( ft->format == ft_subdir || ft->format == ft_directory ) {
+		subdir = 1 ;
+	} else if ( ft->read == NO_READ_FUNCTION ) {
+		return ;
+	} else if ( ft->ag != NON_AGGREGATE && pn_entry->extension != EXTENSION_ALL ) {
+		// single elements and .BYTE are in .ALL already
+		return ;
+	}
+
+	sp = SnapshotPath( pn_entry->path, subdir ) ;
+	if ( sp != NULL ) {
+		list->last[0] = sp ;
+		list->last = &(sp->next) ;
+	}
+}
+
+static void SnapshotText( struct memblob * mb, const char * text )
+{
+	MemblobAdd( (const BYTE *) text, strlen(text), mb ) ;
+}
+
+/* Quoted JSON string */
+static void SnapshotString( struct memblob * mb, const char * data, size_t length )
+{
+	size_t i ;
+
+	MemblobAddChar( '"', 1, mb ) ;
+	for ( i = 0 ; i < length ; ++i ) {
+		BYTE c = data[i] ;
+		if ( c == '"' || c == '\\' ) {
+			MemblobAddChar( '\\', 1, mb ) ;
+			MemblobAddChar( c, 1, mb ) ;
+		} else if ( c < ' ' ) {
+			char escaped[8] ;
+			snprintf( escaped, sizeof(escaped), "\\u%.4X", c ) ;
+			SnapshotText( mb, escaped ) ;
+		} else {
+			MemblobAddChar( c, 1, mb ) ;
+		}
+	}
+	MemblobAddChar( '"', 1, mb ) ;
+}
+
+/* One property, formatted like the single value json pages */
+static void SnapshotValue( struct memblob * mb, const char * path )
+{
+	struct one_wire_query * owq = OWQ_create_from_path( path ) ; // for read
+	SIZE_OR_ERROR read_return ;
+
+	if ( owq == NO_ONE_WIRE_QUERY ) {
+		SnapshotText( mb, "null" ) ;
+		return ;
+	}
+	if ( BAD( OWQ_allocate_read_buffer(owq)) ) {
+		SnapshotText( mb, "null" ) ;
+		OWQ_destroy(owq) ;
+		return ;
+	}
+
+	read_return = FS_read_postparse(owq) ;
+	if ( read_return < 0 ) {
+		SnapshotText( mb, "null" ) ;
+	} else {
+		struct parsedname * pn = PN(owq) ;
+		switch ( pn->selected_filetype->format ) {
+			case ft_binary:
+				{
+					int i ;
+					char hex[3] ;
+					MemblobAddChar( '"', 1, mb ) ;
+					for ( i = 0 ; i < read_return ; ++i ) {
+						snprintf( hex, sizeof(hex), "%.2hhX", OWQ_buffer(owq)[i] ) ;
+						MemblobAdd( (const BYTE *) hex, 2, mb ) ;
+					}
+					MemblobAddChar( '"', 1, mb ) ;
+				}
+				break ;
+			case ft_yesno:
+			case ft_bitfield:
+				if ( pn->extension >= 0 ) {
+					SnapshotText( mb, OWQ_buffer(owq)[0]=='0' ? "\"false\"" : "\"true\"" ) ;
+					break ;
+				}
+				// fall through
+			default:
+				SnapshotString( mb, OWQ_buffer(owq), read_return ) ;
+				break ;
+		}
+	}
+	OWQ_destroy(owq) ;
+}
+
+/* Members of a device (or subdirectory) object */
+static void SnapshotDir( struct memblob * mb, struct parsedname * pn_dir )
+{
+	struct snapshot_list list = { NULL, &(list.head), } ;
+	struct snapshot_path * sp ;
+	int not_first = 0 ;
+
+	// list first, then read -- not from inside FS_dir
+	FS_dir( SnapshotPropertyCallback, &list, pn_dir ) ;
+
+	for ( sp = list.head ; sp != NULL ; sp = sp->next ) {
+		const char * name = strrchr( sp->path, '/' ) ;
+
+		if ( not_first ) {
+			MemblobAddChar( ',', 1, mb ) ;
+		}
+		not_first = 1 ;
+		name = ( name == NULL ) ? sp->path : name + 1 ;
+		SnapshotString( mb, name, strlen(name) ) ;
+		MemblobAddChar( ':', 1, mb ) ;
+
+		if ( sp->subdir ) {
+			struct parsedname s_pn_sub ;
+			MemblobAddChar( '{', 1, mb ) ;
+			if ( FS_ParsedName( sp->path, &s_pn_sub ) == 0 ) {
+				SnapshotDir( mb, &s_pn_sub ) ;
+				FS_ParsedName_destroy( &s_pn_sub ) ;
+			}
+			MemblobAddChar( '}', 1, mb ) ;
+		} else {
+			SnapshotValue( mb, sp->path ) ;
+		}
+	}
+	SnapshotFree( list.head ) ;
+}
+
+/* Read the whole device into its memblob, then hand it to the request thread */
+static void SnapshotDevice( void * v )
+{
+	struct snapshot_device * device = v ;
+	struct snapshot * snap = device->snap ;
+	struct parsedname s_pn_device ;
+
+	MemblobInit( &(device->mb), 1024 ) ;
+	if ( FS_ParsedName( device->path, &s_pn_device ) != 0 ) {
+		LEVEL_DEBUG("Snapshot: device %s is gone", device->path ) ;
+	} else {
+		SnapshotString( &(device->mb), FS_DirName( &s_pn_device ), strlen( FS_DirName( &s_pn_device ) ) ) ;
+		SnapshotText( &(device->mb), ":{" ) ;
+		SnapshotDir( &(device->mb), &s_pn_device ) ;
+		MemblobAddChar( '}', 1, &(device->mb) ) ;
+		MemblobAddChar( '\0', 1, &(device->mb) ) ;
+		FS_ParsedName_destroy( &s_pn_device ) ;
+	}
+
+	_MUTEX_LOCK( snap->ready_mutex ) ;
+	device->ready_next = snap->ready ;
+	snap->ready = device ;
+	pthread_cond_signal( &(snap->ready_cond) ) ;
+	_MUTEX_UNLOCK( snap->ready_mutex ) ;
+}
+
+/* Send a finished device (request thread only) */
+static void SnapshotWrite( struct OutputControl * oc, struct snapshot_device * device )
+{
+	if ( ! MemblobPure( &(device->mb) ) ) {
+		LEVEL_DEBUG("Snapshot: out of memory for %s", device->path ) ;
+	} else if ( MemblobLength( &(device->mb) ) > 0 ) {
+		// (nothing for a device that is gone)
+		JSON_dir_entry( oc, "%s", (const char *) MemblobData( &(device->mb) ) ) ;
+		fflush( oc->out ) ;
+	}
+	MemblobClear( &(device->mb) ) ;
+}
+
+void ShowSnapshot( struct OutputControl * oc, struct parsedname * pn )
+{
+	FILE * out = oc->out ;
+	struct snapshot snap ;
+	struct snapshot_device * device ;
+	struct port_batch batch ;
+	int unwritten = 0 ;
+
+	snap.ready = NULL ;
+	snap.devices = NULL ;
+	snap.last = &(snap.devices) ;
+	_MUTEX_INIT( snap.ready_mutex ) ;
+	pthread_cond_init( &(snap.ready_cond), NULL ) ;
+
+	if ( pn->selected_device == NO_DEVICE ) {
+		FS_dir( SnapshotDeviceCallback, &snap, pn ) ;
+	} else {
+		SnapshotAddDevice( &snap, pn ) ;
+	}
+
+	HTTPstart(oc, "200 OK", ct_json);
+	JSON_dir_init( oc ) ;
+	fprintf(out, "{\n" ) ;
+
+	// one job per device on its port's workers, devices not on a bus here
+	PortBatch_init( &batch ) ;
+	for ( device = snap.devices ; device != NULL ; device = device->next ) {
+		++unwritten ;
+		if ( device->pin != NULL ) {
+			PortWorker_dispatch( device->pin, &(device->job), SnapshotDevice, device, &batch ) ;
+		}
+	}
+	for ( device = snap.devices ; device != NULL ; device = device->next ) {
+		if ( device->pin == NULL ) {
+			SnapshotDevice( device ) ;
+		}
+	}
+
+	// write them as they are done
+	while ( unwritten > 0 ) {
+		struct snapshot_device * ready ;
+
+		_MUTEX_LOCK( snap.ready_mutex ) ;
+		while ( snap.ready == NULL ) {
+			pthread_cond_wait( &(snap.ready_cond), &(snap.ready_mutex) ) ;
+		}
+		ready = snap.ready ;
+		snap.ready = NULL ;
+		_MUTEX_UNLOCK( snap.ready_mutex ) ;
+
+		for ( ; ready != NULL ; ready = ready->ready_next ) {
+			SnapshotWrite( oc, ready ) ;
+			--unwritten ;
+		}
+	}
+	PortBatch_wait( &batch ) ;
+
+	JSON_dir_finish( oc ) ;
+	fprintf(out, "}" ) ;
+
+	while ( snap.devices != NULL ) {
+		device = snap.devices ;
+		snap.devices = device->next ;
+		owfree( device ) ;
+	}
+	pthread_cond_destroy( &(snap.ready_cond) ) ;
+	_MUTEX_DESTROY( snap.ready_mutex ) ;
+}
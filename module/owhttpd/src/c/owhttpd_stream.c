@@ -0,0 +1,160 @@
+/*
+ * http.c for owhttpd (1-wire web server)
+ * By Paul Alfille 2003, using libow
+ * offshoot of the owfs ( 1wire file system )
+ *
+ * GPL license ( Gnu Public Lincense )
+ *
+ * Based on chttpd. copyright(c) 0x7d0 greg olszewski <noop@nwonknu.org>
+ *
+ */
+
+/* Output stream for a connection
+ * Headers go straight to the socket. On a persistent connection the body
+ * follows in chunked transfer encoding, so it is sent while the directory
+ * or value is still being produced and the length needn't be known.
+ * It is the same FILE throughout, callers can keep the oc->out they took.
+ */
+
+#include "owhttpd.h"
+
+#if HAVE_FOPENCOOKIE
+#include <sys/uio.h>
+
+struct http_stream {
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor ;
+	int chunked ;
+} ;
+
+static GOOD_OR_BAD HTTPstream_send( FILE_DESCRIPTOR_OR_ERROR file_descriptor, struct iovec * iov, int iovcnt ) ;
+static ssize_t HTTPstream_write( void * cookie, const char * buffer, size_t size ) ;
+static int HTTPstream_close( void * cookie ) ;
+
+// all of it, partial writes continue
+static GOOD_OR_BAD HTTPstream_send( FILE_DESCRIPTOR_OR_ERROR file_descriptor, struct iovec * iov, int iovcnt )
+{
+	while ( iovcnt > 0 ) {
+		ssize_t sent = writev( file_descriptor, iov, iovcnt ) ;
+		if ( sent < 0 ) {
+			if ( errno == EINTR ) {
+				continue ;
+			}
+			ERROR_DEBUG("http write error");
+			return gbBAD ;
+		}
+		while ( iovcnt > 0 && (size_t) sent >= iov->iov_len ) {
+			sent -= iov->iov_len ;
+			++iov ;
+			--iovcnt ;
+		}
+		if ( iovcnt > 0 ) {
+			iov->iov_base = (char *) iov->iov_base + sent ;
+			iov->iov_len -= sent ;
+		}
+	}
+	return gbGOOD ;
+}
+
+static ssize_t HTTPstream_write( void * cookie, const char * buffer, size_t size )
+{
+	struct http_stream * hs = cookie ;
+	union { const char * c ; void * v ; } data = { buffer, } ;
+	char chunk_size[20] ;
+	struct iovec iov[3] ;
+	int iovcnt = 0 ;
+
+	if ( size == 0 ) {
+		return 0 ;
+	}
+	if ( hs->chunked ) {
+		iov[iovcnt].iov_base = chunk_size ;
+		iov[iovcnt].iov_len = snprintf( chunk_size, sizeof(chunk_size), "%lX\r\n", (unsigned long) size ) ;
+		++iovcnt ;
+	}
+	iov[iovcnt].iov_base = data.v ;
+	iov[iovcnt].iov_len = size ;
+	++iovcnt ;
+	if ( hs->chunked ) {
+		iov[iovcnt].iov_base = "\r\n" ;
+		iov[iovcnt].iov_len = 2 ;
+		++iovcnt ;
+	}
+	return GOOD( HTTPstream_send( hs->file_descriptor, iov, iovcnt ) ) ? (ssize_t) size : -1 ;
+}
+
+// socket is closed by the caller
+static int HTTPstream_close( void * cookie )
+{
+	owfree( cookie ) ;
+	return 0 ;
+}
+
+FILE * HTTPstream_open( FILE_DESCRIPTOR_OR_ERROR file_descriptor, struct http_stream ** stream )
+{
+	cookie_io_functions_t functions = { NULL, HTTPstream_write, NULL, HTTPstream_close, } ;
+	struct http_stream * hs = owmalloc( sizeof(struct http_stream) ) ;
+	FILE * out ;
+
+	stream[0] = NULL ;
+	if ( hs == NULL ) {
+		return NULL ;
+	}
+	hs->file_descriptor = file_descriptor ;
+	hs->chunked = 0 ;
+	out = fopencookie( hs, "w", functions ) ;
+	if ( out == NULL ) {
+		owfree( hs ) ;
+		return NULL ;
+	}
+	stream[0] = hs ;
+	return out ;
+}
+
+/* Headers are done, the body goes in chunks */
+void HTTPstream_chunked( struct OutputControl * oc )
+{
+	fflush( oc->out ) ;
+	oc->stream->chunked = 1 ;
+}
+
+/* End of the response, with the last (empty) chunk if chunked */
+void HTTPstream_finish( struct OutputControl * oc )
+{
+	fflush( oc->out ) ;
+	if ( oc->stream != NULL && oc->stream->chunked ) {
+		oc->stream->chunked = 0 ;
+		fprintf( oc->out, "0\r\n\r\n" ) ;
+		fflush( oc->out ) ;
+	}
+}
+
+#else /* HAVE_FOPENCOOKIE */
+
+/* No cookie streams: plain stdio, one request per connection */
+FILE * HTTPstream_open( FILE_DESCRIPTOR_OR_ERROR file_descriptor, struct http_stream ** stream )
+{
+	FILE_DESCRIPTOR_OR_ERROR out_descriptor = dup( file_descriptor ) ;
+	FILE * out ;
+
+	stream[0] = NULL ;
+	if ( FILE_DESCRIPTOR_NOT_VALID( out_descriptor ) ) {
+		return NULL ;
+	}
+	out = fdopen( out_descriptor, "w" ) ;
+	if ( out == NULL ) {
+		close( out_descriptor ) ;
+	}
+	return out ;
+}
+
+void HTTPstream_chunked( struct OutputControl * oc )
+{
+	(void) oc ;
+}
+
+void HTTPstream_finish( struct OutputControl * oc )
+{
+	fflush( oc->out ) ;
+}
+
+#endif /* HAVE_FOPENCOOKIE */
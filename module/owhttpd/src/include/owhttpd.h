@@ -34,18 +34,33 @@
  * deals with a conncection
  */
 /* in owhttpd_handler.c */
-int handle_socket(FILE * out);
+struct http_stream ;
+int handle_socket(FILE * in, FILE * out, struct http_stream * stream, int requests);
 
 struct OutputControl {
 	FILE * out ;
 	int not_first ;
 	char * base_url ;
 	char * host ;
+	FILE * in ;
+	struct http_stream * stream ; // NULL if it can't do chunks
+	int http11 ; // request was HTTP/1.1
+	int close ; // "Connection: close" requested
+	int request_done ; // request read to the end (another can follow)
+	int persistent ; // response keeps the connection open
+	char * if_none_match ;
+	char * if_modified_since ;
+	char etag[40] ; // validator from the cached value, or empty
+	char last_modified[44] ;
+	struct one_wire_query * owq ; // value HTTPvalidator read, the page shows it
+	SIZE_OR_ERROR owq_read ;
 } ;
 
 /* in owhttpd_present */
 enum content_type { ct_text, ct_html, ct_icon, ct_json, };
 void HTTPstart( struct OutputControl * oc, const char *status, const enum content_type ct);
+void HTTPvalidator( struct OutputControl * oc, const struct parsedname * pn);
+int HTTPnotmodified( struct OutputControl * oc);
 void HTTPtitle( struct OutputControl * oc, const char *title);
 void HTTPheader( struct OutputControl * oc, const char *head);
 void HTTPfoot( struct OutputControl * oc);
@@ -57,6 +72,9 @@ void ChangeData(struct one_wire_query *owq);
 /* in owhttpd_read.c */
 void ShowDevice( struct OutputControl * oc, struct parsedname *const pn);
 
+/* in owhttpd_snapshot.c */
+void ShowSnapshot( struct OutputControl * oc, struct parsedname * pn);
+
 /* in owhttpd_dir.c */
 struct JsonCBstruct {
 	FILE * out ;
@@ -69,6 +87,11 @@ void JSON_dir_init(  struct OutputControl * oc ) ;
 void JSON_dir_entry(  struct OutputControl * oc, const char * format, const char * data ) ;
 void JSON_dir_finish(  struct OutputControl * oc ) ;
 
+/* in owhttpd_stream.c */
+FILE * HTTPstream_open( FILE_DESCRIPTOR_OR_ERROR file_descriptor, struct http_stream ** stream ) ;
+void HTTPstream_chunked( struct OutputControl * oc ) ;
+void HTTPstream_finish( struct OutputControl * oc ) ;
+
 /* in ow_favicon.c */
 void Favicon( struct OutputControl * oc);
 
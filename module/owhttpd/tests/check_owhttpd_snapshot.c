@@ -0,0 +1,178 @@
+#include "owhttpd_testhelper.h"
+
+// owhttpd's JSON snapshot of two fake buses
+//
+// The answer is taken whole (no chunks, connection closed) from a memory
+// stream and the body checked as JSON: objects, strings and null are all a
+// snapshot holds.
+
+static const char * snapshot_buses[] = {
+	"10.67C6697351FF",
+	"28.0123456789AB",
+} ;
+
+struct snapshot_answer {
+	char * text ;
+	size_t length ;
+	const char * body ;
+} ;
+
+static const char * json_skip( const char * p )
+{
+	while ( *p == ' ' || *p == '\n' || *p == '\r' || *p == '\t' ) {
+		++p ;
+	}
+	return p ;
+}
+
+static const char * json_string( const char * p )
+{
+	if ( *p++ != '"' ) {
+		return NULL ;
+	}
+	while ( *p != '"' ) {
+		if ( *p == '\0' || (BYTE) *p < ' ' ) {
+			return NULL ;
+		}
+		if ( *p == '\\' ) {
+			++p ;
+			if ( *p == 'u' ) {
+				p += 4 ;
+			} else if ( *p != '"' && *p != '\\' ) {
+				return NULL ;
+			}
+		}
+		++p ;
+	}
+	return p + 1 ;
+}
+
+// an object of strings, nulls and objects, NULL if not
+static const char * json_object( const char * p )
+{
+	p = json_skip( p ) ;
+	if ( *p++ != '{' ) {
+		return NULL ;
+	}
+	p = json_skip( p ) ;
+	if ( *p == '}' ) {
+		return p + 1 ;
+	}
+	while ( 1 ) {
+		p = json_string( json_skip( p ) ) ;
+		if ( p == NULL ) {
+			return NULL ;
+		}
+		p = json_skip( p ) ;
+		if ( *p++ != ':' ) {
+			return NULL ;
+		}
+		p = json_skip( p ) ;
+		if ( *p == '{' ) {
+			p = json_object( p ) ;
+		} else if ( *p == '"' ) {
+			p = json_string( p ) ;
+		} else if ( strncmp( p, "null", 4 ) == 0 ) {
+			p += 4 ;
+		} else {
+			return NULL ;
+		}
+		if ( p == NULL ) {
+			return NULL ;
+		}
+		p = json_skip( p ) ;
+		if ( *p == '}' ) {
+			return p + 1 ;
+		}
+		if ( *p++ != ',' ) {
+			return NULL ;
+		}
+	}
+}
+
+static void snapshot_take( const char * path, struct snapshot_answer * answer )
+{
+	struct OutputControl oc ;
+	struct parsedname s_pn ;
+
+	memset( &oc, 0, sizeof(oc) ) ;
+	memset( answer, 0, sizeof(struct snapshot_answer) ) ;
+	oc.out = open_memstream( &answer->text, &answer->length ) ;
+	ck_assert( oc.out != NULL ) ;
+	oc.http11 = 1 ;
+	ck_assert_int_eq( 0, FS_ParsedName( path, &s_pn ) ) ;
+	ShowSnapshot( &oc, &s_pn ) ;
+	FS_ParsedName_destroy( &s_pn ) ;
+	fclose( oc.out ) ;
+
+	ck_assert( strncmp( answer->text, "HTTP/1.1 200 OK\r\n", 17 ) == 0 ) ;
+	ck_assert( strstr( answer->text, "Content-Type: application/json\r\n" ) != NULL ) ;
+	answer->body = strstr( answer->text, "\r\n\r\n" ) ;
+	ck_assert( answer->body != NULL ) ;
+	answer->body += 4 ;
+}
+
+static int snapshot_count( const char * text, const char * find )
+{
+	int count = 0 ;
+
+	while ( ( text = strstr( text, find ) ) != NULL ) {
+		++count ;
+		text += strlen( find ) ;
+	}
+	return count ;
+}
+
+// Every device of every bus, once, as valid JSON
+START_TEST(test_snapshot_json)
+{
+	struct port_in * pins[2] ;
+	struct snapshot_answer answer ;
+	const char * end ;
+	size_t i ;
+
+	for ( i = 0 ; i < 2 ; ++i ) {
+		ck_assert( GOOD( ARG_Fake( snapshot_buses[i] ) ) ) ;
+		pins[i] = Inbound_Control.head_port ;
+		ck_assert( GOOD( Fake_detect( pins[i] ) ) ) ;
+	}
+
+	snapshot_take( "/", &answer ) ;
+	end = json_object( answer.body ) ;
+	ck_assert_msg( end != NULL, "not JSON: %s", answer.body ) ;
+	ck_assert_str_eq( "", json_skip( end ) ) ;
+	ck_assert_int_eq( 1, snapshot_count( answer.body, "\"10.67C6697351FF\":{" ) ) ;
+	ck_assert_int_eq( 1, snapshot_count( answer.body, "\"28.0123456789AB\":{" ) ) ;
+	ck_assert_int_eq( 1, snapshot_count( answer.body, "\"type\":\"DS18S20\"" ) ) ;
+	ck_assert_int_eq( 1, snapshot_count( answer.body, "\"type\":\"DS18B20\"" ) ) ;
+	ck_assert_int_eq( 0, snapshot_count( answer.body, "\"bus.0\"" ) ) ;
+	free( answer.text ) ;
+
+	// one device
+	snapshot_take( "/28.0123456789AB", &answer ) ;
+	end = json_object( answer.body ) ;
+	ck_assert_msg( end != NULL, "not JSON: %s", answer.body ) ;
+	ck_assert_int_eq( 0, snapshot_count( answer.body, "\"10.67C6697351FF\"" ) ) ;
+	ck_assert_int_eq( 1, snapshot_count( answer.body, "\"28.0123456789AB\":{" ) ) ;
+	ck_assert_int_eq( 1, snapshot_count( answer.body, "\"family\":\"28\"" ) ) ;
+	free( answer.text ) ;
+
+	for ( i = 0 ; i < 2 ; ++i ) {
+		RemovePort( pins[i] ) ;
+	}
+}
+END_TEST
+
+// Create test-suite
+Suite* owhttpd_snapshot_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("snapshot");
+
+	tcase_add_checked_fixture(tc, owhttpd_test_setup, owhttpd_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_snapshot_json);
+	return s;
+}
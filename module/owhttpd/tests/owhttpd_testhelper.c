@@ -0,0 +1,50 @@
+#include "owhttpd_testhelper.h"
+
+static void LockTeardown();
+
+/**
+ * Setup the owlib stack under owhttpd's pages. Should be setup via
+ *
+ * 		tcase_add_checked_fixture(tc, owhttpd_test_setup, owhttpd_test_teardown);
+ *
+ */
+void owhttpd_test_setup(void) {
+	LockSetup();
+	Pool_Open();
+	Cache_Open();
+	Detail_Init();
+	DeviceSort();
+	SetLocalControlFlags() ; // reset by every option and other change.
+}
+
+void owhttpd_test_teardown(void) {
+	LockTeardown();
+	Pool_Close();
+	Detail_Close();
+}
+
+static void LockTeardown() {
+	/* global mutex attribute */
+	_MUTEX_ATTR_DESTROY(Mutex.mattr);
+
+	_MUTEX_DESTROY(Mutex.stat_mutex);
+	_MUTEX_DESTROY(Mutex.controlflags_mutex);
+	_MUTEX_DESTROY(Mutex.fstat_mutex);
+	_MUTEX_DESTROY(Mutex.dir_mutex);
+#if OW_USB
+	_MUTEX_DESTROY(Mutex.libusb_mutex);
+#endif							/* OW_USB */
+	_MUTEX_DESTROY(Mutex.typedir_mutex);
+	_MUTEX_DESTROY(Mutex.externaldir_mutex);
+	_MUTEX_DESTROY(Mutex.namefind_mutex);
+	_MUTEX_DESTROY(Mutex.aliaslist_mutex);
+	_MUTEX_DESTROY(Mutex.externalcount_mutex);
+	_MUTEX_DESTROY(Mutex.timegm_mutex);
+	_MUTEX_DESTROY(Mutex.detail_mutex);
+
+	RWLOCK_DESTROY(Mutex.lib);
+	RWLOCK_DESTROY(Mutex.cache);
+	RWLOCK_DESTROY(Mutex.persistent_cache);
+	RWLOCK_DESTROY(Mutex.connin);
+	RWLOCK_DESTROY(Mutex.monitor);
+}
@@ -0,0 +1,13 @@
+#ifndef OWFS_OWHTTPDTEST_HELPER_H
+#define OWFS_OWHTTPDTEST_HELPER_H
+
+#include <config.h>
+#include "owfs_config.h"
+#include "owhttpd.h"
+
+#include <check.h>
+
+void owhttpd_test_setup(void);
+void owhttpd_test_teardown(void);
+
+#endif //OWFS_OWHTTPDTEST_HELPER_H
@@ -55,11 +55,16 @@ struct global Globals = {
 	.max_clients = 250,
 
 	.cache_size = 0,
+	.cache_shards = 1, // single cache tree (classic behavior)
+	.cache_timer_wheel = 0, // flip whole cache generations
+	.parse_cache = 256, // parsed paths kept
 
 	.one_device = 0,
 
 	.altUSB = 0,
 	.usb_flextime = 1,
+	.usb_async = 0,
+	.w1_multiplex = 0,
 	.serial_flextime = 1,
 	.serial_reverse = 0,  // 1 is "reverse" polarity
 	.serial_hardflow = 0, // hardware flow control
@@ -84,6 +89,11 @@ struct global Globals = {
 	.no_dirall = 0,
 	.no_get = 0,
 	.no_persistence = 0,
+	.no_pipeline = 0,
+	.convert_hold = 0,
+	.no_coalesce = 0,
+	.server_workers = 0, // thread per connection
+	.server_connections = 4,
 	.eightbit_serial = 0,
 	.trim = 0, // don't whitespace trim results by default
 	.zero = zero_unknown ,
@@ -170,7 +170,7 @@ static struct filetype DS1822[] = {
 DeviceEntryExtended(22, DS1822, DEV_temp | DEV_alarm, NO_GENERIC_READ, NO_GENERIC_WRITE);
 
 /* The DS1825 also includes the MAX31826 MAX31850 and MAX31851 */
-static struct aggregate AMAX = { 16, ag_numbers, ag_separate, };
+static struct aggregate AMAX = { 16, ag_numbers, ag_separate, NO_BULK_READ, };
 static struct filetype DS1825[] = {
 	F_STANDARD,
 	{"temperature", PROPERTY_LENGTH_TEMP, NON_AGGREGATE, ft_temperature, fc_link, FS_slowtemp, NO_WRITE_FUNCTION, VISIBLE, {.i=12}, },
@@ -199,7 +199,7 @@ static struct filetype DS1825[] = {
 
 DeviceEntryExtended(3B, DS1825, DEV_temp | DEV_alarm, NO_GENERIC_READ, NO_GENERIC_WRITE);
 
-static struct aggregate A28EA00 = { 2, ag_letters, ag_aggregate, };
+static struct aggregate A28EA00 = { 2, ag_letters, ag_aggregate, NO_BULK_READ, };
 static struct filetype DS28EA00[] = {
 	F_STANDARD,
 	{"temperature", PROPERTY_LENGTH_TEMP, NON_AGGREGATE, ft_temperature, fc_link, FS_slowtemp, NO_WRITE_FUNCTION, VISIBLE, {.i=12}, },
@@ -854,11 +854,18 @@ static GOOD_OR_BAD OW_temperature_ready( enum temperature_problem_flag accept_85
 		RETURN_BAD_IF_BAD(BUS_transaction(tunpowered, pn)) ;
 	} else if ( must_convert || !simul_good ) {
 		// No Simultaneous active, so need to "convert"
-		if ( pn->selected_connection->iroutines.flags & ADAP_FLAG_unlock_during_delay ) {
+		if ( !must_convert && GOOD( FS_Coalesce_Simultaneous( delay, pn ) ) ) {
+			// shared a conversion of the whole bus
+			LEVEL_DEBUG("Powered temperature conversion shared with the bus -- %d msec", delay);
+		} else if ( pn->selected_connection->iroutines.flags & ADAP_FLAG_unlock_during_delay ) {
 			// better to put in delay on this channel and allow other channels to work
 			LEVEL_DEBUG("Powered temperature conversion just one channel -- %d msec", delay);
 			// If not powered, no Simultaneous for this chip
 			RETURN_BAD_IF_BAD(BUS_transaction(tunpowered, pn)) ;
+		} else if ( ! Globals.convert_hold ) {
+			// powered, release the bus while converting
+			LEVEL_DEBUG("Powered temperature conversion -- bus released for %d msec", delay);
+			RETURN_BAD_IF_BAD( Convert_Powered( tpowered, delay, pn ) ) ;
 		} else {
 			// powered, so poll bus for faster conversion
 			GOOD_OR_BAD ret;
@@ -114,7 +114,7 @@ struct Mission {
 	int samples;
 };
 
-static struct aggregate A1923p = { 18, ag_numbers, ag_separate, };
+static struct aggregate A1923p = { 18, ag_numbers, ag_separate, NO_BULK_READ, };
 static struct filetype DS1923[] = {
 	F_STANDARD,
 #if 0
@@ -53,7 +53,7 @@ READ_FUNCTION(FS_counter);
 
 /* ------- Structures ----------- */
 
-static struct aggregate A1963S = { 16, ag_numbers, ag_separate, };
+static struct aggregate A1963S = { 16, ag_numbers, ag_separate, NO_BULK_READ, };
 static struct filetype DS1963S[] = {
 	F_STANDARD,
 	{"memory", 512, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
@@ -67,7 +67,7 @@ static struct filetype DS1963S[] = {
 
 DeviceEntryExtended(18, DS1963S, DEV_resume | DEV_ovdr, NO_GENERIC_READ, NO_GENERIC_WRITE);
 
-static struct aggregate A1963L = { 16, ag_numbers, ag_separate, };
+static struct aggregate A1963L = { 16, ag_numbers, ag_separate, NO_BULK_READ, };
 static struct filetype DS1963L[] = {
 	F_STANDARD,
 	{"memory", 512, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
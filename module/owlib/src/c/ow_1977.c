@@ -60,7 +60,7 @@ WRITE_FUNCTION(FS_use);
 enum _ds1977_passwords { _ds1977_full, _ds1977_read, _ds1977_control } ;
 off_t _ds1977_pwd_loc[] = { 0x7FC0, 0x7FC8, 0x7FD0, } ;
 
-static struct aggregate A1977 = { 511, ag_numbers, ag_separate, };
+static struct aggregate A1977 = { 511, ag_numbers, ag_separate, NO_BULK_READ, };
 static struct filetype DS1977[] = {
 	F_STANDARD,
 	{"memory", 32704, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
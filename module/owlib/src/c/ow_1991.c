@@ -69,7 +69,7 @@ BYTE subkey_byte[3] = { (0<<6), (1<<6), (2<<6), } ;
 
 /* ------- Structures ----------- */
 
-static struct aggregate A1991_password = { 0, ag_letters, ag_sparse, };
+static struct aggregate A1991_password = { 0, ag_letters, ag_sparse, NO_BULK_READ, };
 static struct filetype DS1991[] = {
 	F_STANDARD,
 
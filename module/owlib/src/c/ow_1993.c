@@ -46,13 +46,14 @@
 
 /* DS1902 ibutton memory */
 READ_FUNCTION(FS_r_page);
+READ_FUNCTION(FS_r_pages);
 WRITE_FUNCTION(FS_w_page);
 READ_FUNCTION(FS_r_mem);
 WRITE_FUNCTION(FS_w_mem);
 
 /* ------- Structures ----------- */
 
-static struct aggregate A1992 = { 4, ag_numbers, ag_separate, };
+static struct aggregate A1992 = { 4, ag_numbers, ag_separate, FS_r_pages, };
 static struct filetype DS1992[] = {
 	F_STANDARD,
 	{"memory", 128, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
@@ -62,7 +63,7 @@ static struct filetype DS1992[] = {
 
 DeviceEntry(08, DS1992, NO_GENERIC_READ, NO_GENERIC_WRITE);
 
-static struct aggregate A1993 = { 16, ag_numbers, ag_separate, };
+static struct aggregate A1993 = { 16, ag_numbers, ag_separate, FS_r_pages, };
 static struct filetype DS1993[] = {
 	F_STANDARD,
 	{"memory", 512, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
@@ -72,7 +73,7 @@ static struct filetype DS1993[] = {
 
 DeviceEntry(06, DS1993, NO_GENERIC_READ, NO_GENERIC_WRITE);
 
-static struct aggregate A1995 = { 64, ag_numbers, ag_separate, };
+static struct aggregate A1995 = { 64, ag_numbers, ag_separate, FS_r_pages, };
 static struct filetype DS1995[] = {
 	F_STANDARD,
 	{"memory", 2048, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
@@ -82,7 +83,7 @@ static struct filetype DS1995[] = {
 
 DeviceEntryExtended(0A, DS1995, DEV_ovdr, NO_GENERIC_READ, NO_GENERIC_WRITE);
 
-static struct aggregate A1996 = { 256, ag_numbers, ag_separate, };
+static struct aggregate A1996 = { 256, ag_numbers, ag_separate, FS_r_pages, };
 static struct filetype DS1996[] = {
 	F_STANDARD,
 	{"memory", 8192, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
@@ -109,6 +110,13 @@ static ZERO_OR_ERROR FS_r_page(struct one_wire_query *owq)
 	return COMMON_offset_process( FS_r_mem, owq, OWQ_pn(owq).extension*pagesize) ;
 }
 
+/* all pages in one read (pages/page.ALL) */
+static ZERO_OR_ERROR FS_r_pages(struct one_wire_query *owq)
+{
+	size_t pagesize = 32;
+	return COMMON_pages_process( FS_r_mem, owq, pagesize) ;
+}
+
 static ZERO_OR_ERROR FS_r_mem(struct one_wire_query *owq)
 {
 	/* read is not page-limited */
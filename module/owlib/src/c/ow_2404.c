@@ -46,6 +46,7 @@
 
 /* DS1902 ibutton memory */
 READ_FUNCTION(FS_r_page);
+READ_FUNCTION(FS_r_pages);
 WRITE_FUNCTION(FS_w_page);
 READ_FUNCTION(FS_r_mem);
 WRITE_FUNCTION(FS_w_mem);
@@ -61,7 +62,7 @@ WRITE_FUNCTION(FS_w_flag);
 
 /* ------- Structures ----------- */
 
-static struct aggregate A2404 = { 16, ag_numbers, ag_separate, };
+static struct aggregate A2404 = { 16, ag_numbers, ag_separate, FS_r_pages, };
 static struct filetype DS2404[] = {
 	F_STANDARD,
 	{"memory", 512, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
@@ -120,6 +121,13 @@ static ZERO_OR_ERROR FS_r_page(struct one_wire_query *owq)
 	return COMMON_offset_process( FS_r_mem, owq, OWQ_pn(owq).extension*pagesize) ;
 }
 
+/* all pages in one read (pages/page.ALL) */
+static ZERO_OR_ERROR FS_r_pages(struct one_wire_query *owq)
+{
+	size_t pagesize = 32;
+	return COMMON_pages_process( FS_r_mem, owq, pagesize) ;
+}
+
 static ZERO_OR_ERROR FS_r_mem(struct one_wire_query *owq)
 {
 	/* read is consecutive, unchecked. No paging */
@@ -53,6 +53,7 @@
 READ_FUNCTION(FS_r_mem);
 WRITE_FUNCTION(FS_w_mem);
 READ_FUNCTION(FS_r_page);
+READ_FUNCTION(FS_r_pages);
 WRITE_FUNCTION(FS_w_page);
 READ_FUNCTION(FS_r_infobyte);
 READ_FUNCTION(FS_r_flipflop);
@@ -81,10 +82,10 @@ static enum e_visibility VISIBLE_T8A( const struct parsedname * pn ) ;
 
 /* ------- Structures ----------- */
 
-static struct aggregate A2406 = { 2, ag_letters, ag_aggregate, };
-static struct aggregate A2406p = { 4, ag_numbers, ag_separate, };
-static struct aggregate AT8Ac = { 8, ag_numbers, ag_separate, }; // 8 channel T8A volt meter
-static struct aggregate ATAI8570 = { 6, ag_numbers, ag_aggregate, } ;
+static struct aggregate A2406 = { 2, ag_letters, ag_aggregate, NO_BULK_READ, };
+static struct aggregate A2406p = { 4, ag_numbers, ag_separate, FS_r_pages, };
+static struct aggregate AT8Ac = { 8, ag_numbers, ag_separate, NO_BULK_READ, }; // 8 channel T8A volt meter
+static struct aggregate ATAI8570 = { 6, ag_numbers, ag_aggregate, NO_BULK_READ, } ;
 static struct filetype DS2406[] = {
 	F_STANDARD,
 	{"memory", 128, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
@@ -214,6 +215,13 @@ static ZERO_OR_ERROR FS_r_page(struct one_wire_query *owq)
 	return COMMON_offset_process( FS_r_mem, owq, OWQ_pn(owq).extension*pagesize) ;
 }
 
+/* all pages in one read (pages/page.ALL) */
+static ZERO_OR_ERROR FS_r_pages(struct one_wire_query *owq)
+{
+	size_t pagesize = 32;
+	return COMMON_pages_process( FS_r_mem, owq, pagesize) ;
+}
+
 static ZERO_OR_ERROR FS_w_page(struct one_wire_query *owq)
 {
 	size_t pagesize = 32;
@@ -97,8 +97,8 @@ WRITE_FUNCTION(FS_redefchar_hex);
 
 /* ------- Structures ----------- */
 
-static struct aggregate A2408 = { 8, ag_numbers, ag_aggregate, };
-static struct aggregate A2408c = { 8, ag_numbers, ag_separate, };
+static struct aggregate A2408 = { 8, ag_numbers, ag_aggregate, NO_BULK_READ, };
+static struct aggregate A2408c = { 8, ag_numbers, ag_separate, NO_BULK_READ, };
 // LCD_M is HD44780 in 8bit mode
 // LCD_H is HD44780 in 4bit mode
 static struct filetype DS2408[] = {
@@ -56,8 +56,8 @@ WRITE_FUNCTION(FS_w_mincount);
 
 /* ------- Structures ----------- */
 
-static struct aggregate A2423 = { 16, ag_numbers, ag_separate, };
-static struct aggregate A2423c = { 2, ag_letters, ag_separate, };
+static struct aggregate A2423 = { 16, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A2423c = { 2, ag_letters, ag_separate, NO_BULK_READ, };
 static struct filetype DS2423[] = {
 	F_STANDARD,
 	{"memory", 512, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
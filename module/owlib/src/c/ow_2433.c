@@ -46,13 +46,14 @@
 
 /* DS2433 EEPROM */
 READ_FUNCTION(FS_r_page);
+READ_FUNCTION(FS_r_pages);
 WRITE_FUNCTION(FS_w_page);
 READ_FUNCTION(FS_r_mem);
 WRITE_FUNCTION(FS_w_mem);
 
  /* ------- Structures ----------- */
 
-static struct aggregate A2431 = { 4, ag_numbers, ag_separate, };
+static struct aggregate A2431 = { 4, ag_numbers, ag_separate, FS_r_pages, };
 static struct filetype DS2431[] = {
 	F_STANDARD,
 	{"memory", 128, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
@@ -62,7 +63,7 @@ static struct filetype DS2431[] = {
 
 DeviceEntryExtended(2D, DS2431, DEV_ovdr | DEV_resume, NO_GENERIC_READ, NO_GENERIC_WRITE);
 
-static struct aggregate A2433 = { 16, ag_numbers, ag_separate, };
+static struct aggregate A2433 = { 16, ag_numbers, ag_separate, FS_r_pages, };
 static struct filetype DS2433[] = {
 	F_STANDARD,
 	{"memory", 512, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
@@ -72,7 +73,7 @@ static struct filetype DS2433[] = {
 
 DeviceEntryExtended(23, DS2433, DEV_ovdr, NO_GENERIC_READ, NO_GENERIC_WRITE);
 
-static struct aggregate A28EC20 = { 80, ag_numbers, ag_separate, };
+static struct aggregate A28EC20 = { 80, ag_numbers, ag_separate, FS_r_pages, };
 static struct filetype DS28EC20[] = {
 	F_STANDARD,
 	{"memory", 2560, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
@@ -128,6 +129,13 @@ static ZERO_OR_ERROR FS_r_page(struct one_wire_query *owq)
 	return 0;
 }
 
+/* all pages in one read (pages/page.ALL) */
+static ZERO_OR_ERROR FS_r_pages(struct one_wire_query *owq)
+{
+	size_t pagesize = 32;
+	return COMMON_pages_process( FS_r_mem, owq, pagesize) ;
+}
+
 static ZERO_OR_ERROR FS_w_page(struct one_wire_query *owq)
 {
 	/* paged access */
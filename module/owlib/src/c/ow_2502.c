@@ -58,7 +58,7 @@ static enum e_visibility VISIBLE_DS2407( const struct parsedname * pn ) ;
 
 /* ------- Structures ----------- */
 
-static struct aggregate A2502 = { 4, ag_numbers, ag_separate, };
+static struct aggregate A2502 = { 4, ag_numbers, ag_separate, NO_BULK_READ, };
 static struct filetype DS2502[] = {
 	F_STANDARD,
 	{"memory", 128, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
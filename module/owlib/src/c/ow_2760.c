@@ -198,12 +198,12 @@ static struct LockPage P2760 = { Pages2760, 0x07, Size2760, {0x20, 0x30, 0x00,},
 static struct LockPage P2770 = { Pages2770, 0x07, Size2770, {0x20, 0x30, 0x40,}, };
 static struct LockPage P2780 = { Pages2780, 0x1F, Size2780, {0x20, 0x60, 0x00,}, };
 
-static struct aggregate L2720 = { Pages2720, ag_numbers, ag_separate };
-static struct aggregate L2751 = { Pages2751, ag_numbers, ag_separate };
-static struct aggregate L2755 = { Pages2755, ag_numbers, ag_separate };
-static struct aggregate L2760 = { Pages2760, ag_numbers, ag_separate };
-static struct aggregate L2770 = { Pages2770, ag_numbers, ag_separate };
-static struct aggregate L2780 = { Pages2780, ag_numbers, ag_separate };
+static struct aggregate L2720 = { Pages2720, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate L2751 = { Pages2751, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate L2755 = { Pages2755, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate L2760 = { Pages2760, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate L2770 = { Pages2770, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate L2780 = { Pages2780, ag_numbers, ag_separate, NO_BULK_READ, };
 
 static struct filetype DS2720[] = {
 	F_STANDARD,
@@ -299,7 +299,7 @@ static struct filetype DS2755[] = {
 
 DeviceEntryExtended(35, DS2755, DEV_alarm, NO_GENERIC_READ, NO_GENERIC_WRITE);
 
-struct aggregate Aled_control = { 4, ag_numbers, ag_aggregate, };
+struct aggregate Aled_control = { 4, ag_numbers, ag_aggregate, NO_BULK_READ, };
 static struct filetype DS2760[] = {
 	F_STANDARD,
 	{"memory", 256, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
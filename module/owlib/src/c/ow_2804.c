@@ -51,6 +51,7 @@
 READ_FUNCTION(FS_r_mem);
 WRITE_FUNCTION(FS_w_mem);
 READ_FUNCTION(FS_r_page);
+READ_FUNCTION(FS_r_pages);
 WRITE_FUNCTION(FS_w_page);
 READ_FUNCTION(FS_r_pio);
 WRITE_FUNCTION(FS_w_pio);
@@ -66,8 +67,8 @@ WRITE_FUNCTION(FS_w_por);
 
 /* ------- Structures ----------- */
 
-static struct aggregate A2804 = { 2, ag_numbers, ag_aggregate, };
-static struct aggregate A2804p = { 16, ag_numbers, ag_separate, };
+static struct aggregate A2804 = { 2, ag_numbers, ag_aggregate, NO_BULK_READ, };
+static struct aggregate A2804p = { 16, ag_numbers, ag_separate, FS_r_pages, };
 static struct filetype DS28E04[] = {
 	F_STANDARD,
 	{"memory", 550, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
@@ -135,6 +136,13 @@ static ZERO_OR_ERROR FS_r_page(struct one_wire_query *owq)
 	return COMMON_offset_process( FS_r_mem, owq, OWQ_pn(owq).extension*pagesize) ;
 }
 
+/* all pages in one read (pages/page.ALL) */
+static ZERO_OR_ERROR FS_r_pages(struct one_wire_query *owq)
+{
+	size_t pagesize = 32;
+	return COMMON_pages_process( FS_r_mem, owq, pagesize) ;
+}
+
 static ZERO_OR_ERROR FS_w_page(struct one_wire_query *owq)
 {
 	size_t pagesize = 32;
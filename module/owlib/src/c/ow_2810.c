@@ -65,7 +65,7 @@ WRITE_FUNCTION(FS_use);
 
 /* ------- Structures ----------- */
 
-static struct aggregate A28E10 = { 7, ag_numbers, ag_separate, };
+static struct aggregate A28E10 = { 7, ag_numbers, ag_separate, NO_BULK_READ, };
 static struct filetype DS28E10[] = {
 	F_STANDARD,
 	{"memory", 36, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
@@ -28,6 +28,7 @@
 #include <config.h>
 #include "owfs_config.h"
 #include "ow.h"
+#include "ow_counters.h"
 
 #if OW_ALLOC_DEBUG
 /* Special routines for tracking memory leakage */
@@ -76,3 +77,171 @@ char *OWstrdup(const char * file, int line, const char * func, const char *s)
 }
 
 #endif							/* OW_ALLOC_H */
+
+/* Size-class pools for small, frequently recycled blocks */
+/* Cache nodes and dirblob lists are created and destroyed at the polling rate,
+ * so freed blocks are kept on a per-size free list and handed out again.
+ * Each block carries a small header with its size class so owpool_free
+ * does not need to be told the size.
+ * The free lists are bounded, a burst of frees beyond that goes back to the heap.
+ * */
+
+#define OWPOOL_MIN_SIZE     32
+#define OWPOOL_CLASSES      8		// 32 .. 4096 bytes
+#define OWPOOL_UNPOOLED     OWPOOL_CLASSES
+#define OWPOOL_KEEP_BYTES   (1<<20)	// per class
+
+union pool_header {
+	union pool_header * next ;		// while on the free list
+	int size_class ;				// while in use
+	long double align ;
+} ;
+
+#define POOL_HEADER_SIZE    sizeof(union pool_header)
+
+static struct pool_class {
+	union pool_header * free_list ;
+	UINT free_count ;
+	UINT free_max ;
+	pthread_mutex_t mutex ;
+} pool[OWPOOL_CLASSES] ;
+
+#define POOL_BLOCK_SIZE(size_class)    ( (size_t) OWPOOL_MIN_SIZE << (size_class) )
+
+static int PoolClass( size_t size )
+{
+	int size_class ;
+	size += POOL_HEADER_SIZE ;
+	for ( size_class = 0 ; size_class < OWPOOL_CLASSES ; ++size_class ) {
+		if ( size <= POOL_BLOCK_SIZE(size_class) ) {
+			return size_class ;
+		}
+	}
+	return OWPOOL_UNPOOLED ;
+}
+
+void Pool_Open( void )
+{
+	int size_class ;
+	for ( size_class = 0 ; size_class < OWPOOL_CLASSES ; ++size_class ) {
+		pool[size_class].free_list = NULL ;
+		pool[size_class].free_count = 0 ;
+		pool[size_class].free_max = OWPOOL_KEEP_BYTES / POOL_BLOCK_SIZE(size_class) ;
+		_MUTEX_INIT( pool[size_class].mutex ) ;
+	}
+}
+
+/* Return the kept blocks to the heap. Blocks still in use are unaffected */
+void Pool_Close( void )
+{
+	int size_class ;
+	for ( size_class = 0 ; size_class < OWPOOL_CLASSES ; ++size_class ) {
+		struct pool_class * pc = &pool[size_class] ;
+		_MUTEX_LOCK( pc->mutex ) ;
+		while ( pc->free_list != NULL ) {
+			union pool_header * ph = pc->free_list ;
+			pc->free_list = ph->next ;
+			free( ph ) ;
+		}
+		pc->free_count = 0 ;
+		_MUTEX_UNLOCK( pc->mutex ) ;
+		_MUTEX_DESTROY( pc->mutex ) ;
+	}
+}
+
+#if ! OW_ALLOC_DEBUG
+void *owpool_alloc( size_t size )
+{
+	int size_class = PoolClass( size ) ;
+	union pool_header * ph = NULL ;
+
+	if ( size_class == OWPOOL_UNPOOLED ) {
+		ph = malloc( POOL_HEADER_SIZE + size ) ;
+	} else {
+		struct pool_class * pc = &pool[size_class] ;
+		_MUTEX_LOCK( pc->mutex ) ;
+		ph = pc->free_list ;
+		if ( ph != NULL ) {
+			pc->free_list = ph->next ;
+			--pc->free_count ;
+		}
+		_MUTEX_UNLOCK( pc->mutex ) ;
+
+		if ( ph != NULL ) {
+			STAT_ADD1( pool_hits ) ;
+		} else {
+			STAT_ADD1( pool_misses ) ;
+			ph = malloc( POOL_BLOCK_SIZE(size_class) ) ;
+		}
+	}
+
+	if ( ph == NULL ) {
+		return NULL ;
+	}
+	ph->size_class = size_class ;
+	return (void *) ( ph + 1 ) ;
+}
+
+void owpool_free( void * ptr )
+{
+	union pool_header * ph ;
+	int size_class ;
+
+	if ( ptr == NULL ) {
+		return ;
+	}
+	ph = ( (union pool_header *) ptr ) - 1 ;
+	size_class = ph->size_class ;
+
+	if ( size_class != OWPOOL_UNPOOLED ) {
+		struct pool_class * pc = &pool[size_class] ;
+		_MUTEX_LOCK( pc->mutex ) ;
+		if ( pc->free_count < pc->free_max ) {
+			ph->next = pc->free_list ;
+			pc->free_list = ph ;
+			++pc->free_count ;
+			ph = NULL ;
+		}
+		_MUTEX_UNLOCK( pc->mutex ) ;
+	}
+	if ( ph != NULL ) {
+		free( ph ) ;
+	}
+}
+
+/* Growth within the block's size class is free */
+void *owpool_realloc( void * ptr, size_t size )
+{
+	union pool_header * ph ;
+	int size_class ;
+	void * bigger ;
+
+	if ( ptr == NULL ) {
+		return owpool_alloc( size ) ;
+	}
+	ph = ( (union pool_header *) ptr ) - 1 ;
+	size_class = ph->size_class ;
+
+	if ( size_class == OWPOOL_UNPOOLED ) {
+		if ( PoolClass( size ) == OWPOOL_UNPOOLED ) {
+			union pool_header * resized = realloc( ph, POOL_HEADER_SIZE + size ) ;
+			return ( resized == NULL ) ? NULL : (void *) ( resized + 1 ) ;
+		}
+		// shrinking back into the pools isn't worth a copy
+		return ptr ;
+	}
+
+	if ( size + POOL_HEADER_SIZE <= POOL_BLOCK_SIZE(size_class) ) {
+		return ptr ;
+	}
+
+	bigger = owpool_alloc( size ) ;
+	if ( bigger == NULL ) {
+		// like realloc, the original is untouched
+		return NULL ;
+	}
+	memcpy( bigger, ptr, POOL_BLOCK_SIZE(size_class) - POOL_HEADER_SIZE ) ;
+	owpool_free( ptr ) ;
+	return bigger ;
+}
+#endif							/* OW_ALLOC_DEBUG */
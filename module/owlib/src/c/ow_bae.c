@@ -463,23 +463,23 @@ static enum e_visibility VISIBLE_910( const struct parsedname * pn ) ;
 static enum e_visibility VISIBLE_911( const struct parsedname * pn ) ;
 
 
-static struct aggregate ABAEeeprom = { _FC_MAX_EEPROM_PAGES, ag_numbers, ag_separate, };
-static struct aggregate A911pio = { 22, ag_numbers, ag_separate, };
-static struct aggregate A911piodd = { 22, ag_numbers, ag_separate, };
-static struct aggregate A911piods = { 22, ag_numbers, ag_separate, };
-static struct aggregate A911piope = { 22, ag_numbers, ag_separate, };
-static struct aggregate A911piopd = { 8, ag_numbers, ag_separate, };
-static struct aggregate A911latch = { 22, ag_numbers, ag_separate, };
-static struct aggregate A911elatch = { 22, ag_numbers, ag_separate, };
-static struct aggregate A911counter = { 18, ag_numbers, ag_separate, };
-static struct aggregate A911ecount = { 18, ag_numbers, ag_separate, };
-static struct aggregate A911adc = { 16, ag_numbers, ag_separate, };
-static struct aggregate A911userb = { 16, ag_numbers, ag_separate, };
-static struct aggregate A911userw = { 16, ag_numbers, ag_separate, };
-static struct aggregate A911userdw = { 8, ag_numbers, ag_separate, };
-static struct aggregate A911userarray = { 32, ag_numbers, ag_separate, };
-static struct aggregate A911globalmem = { 64, ag_numbers, ag_separate, };
-static struct aggregate A911globalmemory = { 0, ag_numbers, ag_sparse, };
+static struct aggregate ABAEeeprom = { _FC_MAX_EEPROM_PAGES, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911pio = { 22, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911piodd = { 22, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911piods = { 22, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911piope = { 22, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911piopd = { 8, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911latch = { 22, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911elatch = { 22, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911counter = { 18, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911ecount = { 18, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911adc = { 16, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911userb = { 16, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911userw = { 16, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911userdw = { 8, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911userarray = { 32, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911globalmem = { 64, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate A911globalmemory = { 0, ag_numbers, ag_sparse, NO_BULK_READ, };
 
 
 
@@ -69,6 +69,19 @@ GOOD_OR_BAD BUS_select_and_sendback(const BYTE * data, BYTE * resp, const size_t
 	}
 }
 
+/* Symmetric */
+/* select, send bytes, and read back -- strong pull-up left on after the last byte */
+/* No default, only bundled for adapters that have it */
+GOOD_OR_BAD BUS_select_and_power(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn)
+{
+	GOOD_OR_BAD (*select_and_power) (const BYTE * data, BYTE * resp, const size_t len, const struct parsedname * pn) = pn->selected_connection->iroutines.select_and_power ;
+	if ( select_and_power == NO_SELECTANDPOWER_ROUTINE ) {
+		LEVEL_DEBUG("No select and power routine for this bus master");
+		return gbBAD ;
+	}
+	return (select_and_power) (data, resp, len, pn);
+}
+
 /* Symmetric */
 /* send bytes, and read back -- calls lower level bit routine */
 GOOD_OR_BAD BUS_sendback_data(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn)
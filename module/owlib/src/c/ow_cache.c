@@ -43,23 +43,61 @@ int AliasMarkerLoc ;
 void * Alias_Marker = &AliasMarkerLoc ;
 
 
-/* Put the globals into a struct to declutter the namespace */
-struct cache_data {
+/* Upper limit to the number of independently locked cache shards */
+#define CACHE_SHARDS_MAX	64
+
+/* Per-entry expiry: one bucket per second, entries further out wrap around */
+#define CACHE_WHEEL_SLOTS	128
+/* Most entries examined by the reaper on a single call (bounds the added latency) */
+#define CACHE_REAP_BATCH	32
+
+/* Clock of the cache (expiry, flips), tests can set their own */
+static time_t (*cache_clock)( time_t * ) = time ;
+#define CACHE_NOW	( cache_clock( NULL ) )
+
+/* One slice of the temporary cache
+   Each shard holds its own new/old tree pair and lock and flips independently
+   so that readers of one shard aren't blocked by writers to another.
+   With a single shard this is exactly the classic global cache */
+struct cache_shard {
 	void *temporary_tree_new;			// current cache database
 	void *temporary_tree_old;			// older cache database
-	void *persistent_tree;				// persistent database
-	void *temporary_alias_tree_new;		// current cache database
-	void *temporary_alias_tree_old;		// older cache database
-	void *persistent_alias_tree;		// persistent database
 	size_t old_ram_size;				// cache size
 	size_t new_ram_size;				// cache size
 	time_t time_retired;				// start time of older
 	time_t time_to_kill;				// deathtime of older
+	UINT added;					// items added to newer
+	UINT retired;					// items in older
+	struct tree_node *ring_new;		// eviction ring of newer (clock hand)
+	struct tree_node *ring_old;		// eviction ring of older (oldest first)
+	struct tree_node *wheel[CACHE_WHEEL_SLOTS];	// per-entry expiry buckets
+	time_t wheel_time;				// last second fully reaped
+	struct tree_node *wheel_cursor;	// where the reaper stopped in bucket wheel_time+1
+	int wheel_resume;				// wheel_cursor is valid (NULL: bucket finished)
+	my_rwlock_t lock;
+};
+
+/* Put the globals into a struct to declutter the namespace */
+struct cache_data {
+	struct cache_shard shard[CACHE_SHARDS_MAX];
+	int shards;							// shards in use (power of 2)
+	int per_entry_expiry;				// timer wheel instead of tree flips
+	void *persistent_tree;				// persistent database
+	void *temporary_alias_tree_new;		// current cache database
+	void *temporary_alias_tree_old;		// older cache database
+	void *persistent_alias_tree;		// persistent database
+	size_t alias_old_ram_size;			// alias cache size
+	size_t alias_new_ram_size;			// alias cache size
+	time_t alias_time_to_kill;			// deathtime of older alias tree
 	time_t retired_lifespan;			// lifetime of older
-	UINT added;					// items added
 };
 static struct cache_data cache;
 
+#define SHARD_WLOCK(sh)		RWLOCK_WLOCK(   (sh)->lock )
+#define SHARD_WUNLOCK(sh)	RWLOCK_WUNLOCK( (sh)->lock )
+#define SHARD_RLOCK(sh)		RWLOCK_RLOCK(   (sh)->lock )
+#define SHARD_RUNLOCK(sh)	RWLOCK_RUNLOCK( (sh)->lock )
+
 /* Cache elements are placed in a Red/Black binary tree
 	-- standard glibc implementation
 	-- use gnu tdestroy extension
@@ -101,6 +139,11 @@ struct tree_node {
 	struct tree_key tk;
 	time_t expires;
 	size_t dsize;
+	struct tree_node *ring_next;	// eviction ring (temporary cache only)
+	struct tree_node *ring_prev;
+	struct tree_node *wheel_next;	// expiry bucket (per-entry expiry mode only)
+	struct tree_node *wheel_prev;
+	int referenced;					// CLOCK bit, set on every cache hit
 };
 
 struct alias_tree_node {
@@ -123,12 +166,26 @@ struct tree_opaque {
 #define TREE_DATA(tn)    ( (BYTE *)(tn) + sizeof(struct tree_node) )
 #define CONST_TREE_DATA(tn)    ( (const BYTE *)(tn) + sizeof(struct tree_node) )
 
+/* Real memory used by a cached item: header, payload and the tsearch node (key pointer and 2 links) */
+#define TREE_NODE_BYTES(tn)    ( sizeof(struct tree_node) + (tn)->dsize + 3 * sizeof(void *) )
+#define ALIAS_TREE_NODE_BYTES(atn)    ( sizeof(struct alias_tree_node) + (atn)->size + 1 + 3 * sizeof(void *) )
+
 #define ALIAS_TREE_DATA(atn)    ( (ASCII *)(atn) + sizeof(struct alias_tree_node) )
 #define CONST_ALIAS_TREE_DATA(atn)    ( (const ASCII *)(atn) + sizeof(struct alias_tree_node) )
 
 enum cache_task_return { ctr_ok, ctr_not_found, ctr_expired, ctr_size_mismatch, } ;
 
-static void FlipTree( void ) ;
+static void FlipTree( struct cache_shard * shard ) ;
+static void FlipAliasTree( void ) ;
+static struct cache_shard * ShardOf( const struct tree_node * tn ) ;
+static time_t RetiredLifespan( void ) ;
+static void Cache_Make_Room( struct cache_shard * shard, size_t needed, const struct tree_node * keep ) ;
+static size_t Cache_Evict( struct cache_shard * shard, struct tree_node * victim, void ** tree, struct tree_node ** ring ) ;
+static void RingInsert( struct tree_node * tn, struct tree_node ** ring ) ;
+static void RingRemove( struct tree_node * tn, struct tree_node ** ring ) ;
+static void Cache_Reap( struct cache_shard * shard, time_t now ) ;
+static void WheelInsert( struct cache_shard * shard, struct tree_node * tn ) ;
+static void WheelRemove( struct cache_shard * shard, struct tree_node * tn ) ;
 
 static int IsThisPersistent( const struct parsedname * pn ) ;
 
@@ -137,10 +194,11 @@ static GOOD_OR_BAD Cache_Add_Common(struct tree_node *tn);
 static GOOD_OR_BAD Cache_Add_Persistent(struct tree_node *tn);
 
 static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_t * duration, const struct tree_node *tn);
-static enum cache_task_return Cache_Get_Common_Dir(struct dirblob *db, time_t * duration, const struct tree_node *tn);
+static enum cache_task_return Cache_Get_Common_Dir(struct dirblob *db, const BYTE * sn, int * device_index, time_t * duration, const struct tree_node *tn);
 static enum cache_task_return Cache_Get_Persistent(void *data, size_t * dsize, time_t * duration, const struct tree_node *tn);
 
 static GOOD_OR_BAD Cache_Get_Simultaneous(const struct internal_prop *ip, struct one_wire_query *owq) ;
+static GOOD_OR_BAD Cache_Get_Simul_Common(const struct internal_prop *ip, struct timeval * start, time_t * duration, const struct parsedname * pn) ;
 static GOOD_OR_BAD Cache_Get_Internal(void *data, size_t * dsize, const struct internal_prop *ip, const struct parsedname *pn);
 static GOOD_OR_BAD Cache_Get_Strict(void *data, size_t dsize, const struct parsedname *pn);
 
@@ -249,8 +307,11 @@ static void tree_show(const void *node, const VISIT which, const int depth)
 }
 static void new_tree(void)
 {
-	fprintf(stderr,"Walk the new tree:\n");
-	twalk(cache.temporary_tree_new, tree_show);
+	int shard_index ;
+	for ( shard_index = 0 ; shard_index < cache.shards ; ++shard_index ) {
+		fprintf(stderr,"Walk the new tree of shard %d:\n",shard_index);
+		twalk(cache.shard[shard_index].temporary_tree_new, tree_show);
+	}
 }
 #else							/* CACHE_DEBUG */
 #define new_tree()
@@ -266,66 +327,176 @@ static int IsThisPersistent( const struct parsedname * pn )
 /* Note: done in single-threaded mode so locking not yet needed */
 void Cache_Open(void)
 {
+	int shard_index ;
+
 	memset(&cache, 0, sizeof(struct cache_data));
+	cache_bytes = 0 ;
+
+	// single shard until options are known (Cache_Configure)
+	cache.shards = 1 ;
+	cache.retired_lifespan = RetiredLifespan() ;
 
-	cache.retired_lifespan = TimeOut(fc_stable);
-	if (cache.retired_lifespan > 3600) {
-		cache.retired_lifespan = 3600;	/* 1 hour tops */
+	for ( shard_index = 0 ; shard_index < CACHE_SHARDS_MAX ; ++shard_index ) {
+		struct cache_shard * shard = &cache.shard[shard_index] ;
+		RWLOCK_INIT( shard->lock ) ;
+		shard->time_retired = CACHE_NOW ;
+		shard->time_to_kill = shard->time_retired + cache.retired_lifespan ;
+		shard->wheel_time = CACHE_NOW ;
 	}
+	cache.alias_time_to_kill = CACHE_NOW + cache.retired_lifespan ;
+}
+
+/* Apply option-dependent settings (called from LibStart after options are parsed) */
+/* The cache is emptied, so entries never sit in the wrong shard */
+void Cache_Configure(void)
+{
+	int shards = 1 ;
+
+	// round down to a power of 2 for cheap masking
+	while ( shards * 2 <= Globals.cache_shards && shards * 2 <= CACHE_SHARDS_MAX ) {
+		shards *= 2 ;
+	}
+
+	Cache_Clear() ;
 
-	// Flip once (at start) to set up old tree.
-	FlipTree() ;
+	LEVEL_DEBUG("Cache set up with %d shard%s, %s expiry", shards, shards==1 ? "" : "s", Globals.cache_timer_wheel ? "per-entry" : "generation" ) ;
+	cache.shards = shards ;
+	cache.per_entry_expiry = Globals.cache_timer_wheel ;
+	cache.retired_lifespan = RetiredLifespan() ;
+}
+
+/* Replace the cache's clock (NULL for the real one), for tests */
+void Cache_Set_Clock( time_t (*clock)( time_t * ) )
+{
+	cache_clock = ( clock == NULL ) ? time : clock ;
 }
 
 /* Note: done in a simgle single thread mode so locking not needed */
 void Cache_Close(void)
 {
+	int shard_index ;
+
 	Cache_Clear() ;
-	SAFETDESTROY( cache.persistent_tree, owfree_func);
-	SAFETDESTROY( cache.persistent_alias_tree, owfree_func);
+	SAFETDESTROY( cache.persistent_tree, owpool_free_func);
+	SAFETDESTROY( cache.persistent_alias_tree, owpool_free_func);
+	for ( shard_index = 0 ; shard_index < CACHE_SHARDS_MAX ; ++shard_index ) {
+		RWLOCK_DESTROY( cache.shard[shard_index].lock ) ;
+	}
+}
+
+/* How long the older tree is kept after a flip */
+static time_t RetiredLifespan( void )
+{
+	time_t lifespan = TimeOut(fc_stable);
+	if (lifespan > 3600) {
+		lifespan = 3600;	/* 1 hour tops */
+	}
+	return lifespan ;
+}
+
+/* Choose the shard from a hash of the key (FNV-1a) */
+/* The key is zeroed before loading (LoadTK) so padding bytes are stable */
+static struct cache_shard * ShardOf( const struct tree_node * tn )
+{
+	const BYTE * key = (const BYTE *) &(tn->tk) ;
+	UINT hash = 2166136261U ;
+	size_t byte_index ;
+
+	if ( cache.shards == 1 ) {
+		return &cache.shard[0] ;
+	}
+
+	for ( byte_index = 0 ; byte_index < sizeof(struct tree_key) ; ++byte_index ) {
+		hash ^= key[byte_index] ;
+		hash *= 16777619U ;
+	}
+	return &cache.shard[ hash & (cache.shards - 1) ] ;
 }
 
 /* Moves new to old tree, initializes new tree, and clears former old tree location */
-static void FlipTree( void )
+/* shard must be write locked (or single threaded) */
+static void FlipTree( struct cache_shard * shard )
 {
-	void * flip = cache.temporary_tree_old; // old old saved for later clearing
-	void * flip_alias = cache.temporary_alias_tree_old; // old old saved for later clearing
+	void * flip = shard->temporary_tree_old; // old old saved for later clearing
+	size_t flip_ram_size = shard->old_ram_size ;
+	UINT retired = shard->retired ;
+	UINT added = shard->added ;
 
 	/* Flip caches! old = new. New truncated, reset time and counters and flag */
 	LEVEL_DEBUG("Flipping cache tree (purging timed-out data)");
 
 	// move "new" pointers to "old"
-	cache.temporary_tree_old = cache.temporary_tree_new;
-	cache.old_ram_size = cache.new_ram_size;
-	cache.temporary_alias_tree_old = cache.temporary_alias_tree_new;
+	shard->temporary_tree_old = shard->temporary_tree_new;
+	shard->old_ram_size = shard->new_ram_size;
+	shard->retired = added ;
+	shard->ring_old = shard->ring_new ;
 
 	// New cache setup
-	cache.temporary_tree_new = NULL;
-	cache.temporary_alias_tree_new = NULL;
-	cache.new_ram_size = 0;
-	cache.added = 0;
+	shard->temporary_tree_new = NULL;
+	shard->new_ram_size = 0;
+	shard->added = 0;
+	shard->ring_new = NULL ;
+	// wheel only tracks the newer tree
+	memset( shard->wheel, 0, sizeof(shard->wheel) ) ;
+	shard->wheel_time = CACHE_NOW ;
+	shard->wheel_resume = 0 ;
 
 	// set up "old" cache times
-	cache.time_retired = NOW_TIME;
-	cache.time_to_kill = cache.time_retired + cache.retired_lifespan;
+	shard->time_retired = CACHE_NOW;
+	shard->time_to_kill = shard->time_retired + cache.retired_lifespan;
 
 	// delete really old tree
 	LEVEL_DEBUG("flip cache. tdestroy() will be called.");
-	SAFETDESTROY( flip, owfree_func);
-	SAFETDESTROY( flip_alias, owfree_func);
+	SAFETDESTROY( flip, owpool_free_func);
 	STATLOCK;
 	++cache_flips;			/* statistics */
-	memcpy(&old_avg, &new_avg, sizeof(struct average));
-	AVERAGE_CLEAR(&new_avg);
+	cache_bytes -= flip_ram_size ;
+	// the retired items move from primary to secondary
+	new_avg.current -= added ;
+	old_avg.current += added ;
+	old_avg.current -= retired ;
+	old_avg.count += added ;
+	old_avg.sum += old_avg.current ;
+	if ( old_avg.current > old_avg.max ) {
+		old_avg.max = old_avg.current ;
+	}
+	STATUNLOCK;
+}
+
+/* Same generation scheme for the alias->bus tree */
+/* Mutex.cache must be write locked (or single threaded) */
+static void FlipAliasTree( void )
+{
+	void * flip_alias = cache.temporary_alias_tree_old; // old old saved for later clearing
+	size_t flip_ram_size = cache.alias_old_ram_size ;
+
+	cache.temporary_alias_tree_old = cache.temporary_alias_tree_new;
+	cache.alias_old_ram_size = cache.alias_new_ram_size;
+	cache.temporary_alias_tree_new = NULL;
+	cache.alias_new_ram_size = 0;
+	cache.alias_time_to_kill = CACHE_NOW + cache.retired_lifespan;
+
+	SAFETDESTROY( flip_alias, owpool_free_func);
+	STATLOCK;
+	cache_bytes -= flip_ram_size ;
 	STATUNLOCK;
 }
 
 /* Clear the cache (a change was made that might give stale information) */
 void Cache_Clear(void)
 {
+	int shard_index ;
+
+	for ( shard_index = 0 ; shard_index < cache.shards ; ++shard_index ) {
+		struct cache_shard * shard = &cache.shard[shard_index] ;
+		SHARD_WLOCK( shard ) ;
+		FlipTree( shard ) ;
+		FlipTree( shard ) ;
+		SHARD_WUNLOCK( shard ) ;
+	}
 	CACHE_WLOCK;
-	FlipTree() ;
-	FlipTree() ;
+	FlipAliasTree() ;
+	FlipAliasTree() ;
 	CACHE_WUNLOCK;
 }
 
@@ -413,7 +584,7 @@ static GOOD_OR_BAD Cache_Add(const void *data, const size_t datasize, const stru
 	}
 
 	// allocate space for the node and data
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + datasize);
+	tn = (struct tree_node *) owpool_alloc(sizeof(struct tree_node) + datasize);
 	if (!tn) {
 		return gbBAD;
 	}
@@ -422,7 +593,7 @@ static GOOD_OR_BAD Cache_Add(const void *data, const size_t datasize, const stru
 
 	// populate the node structure with data
 	LoadTK( pn->sn, pn->selected_filetype, pn->extension, tn );
-	tn->expires = duration + NOW_TIME;
+	tn->expires = duration + CACHE_NOW;
 	tn->dsize = datasize;
 	if (datasize) {
 		memcpy(TREE_DATA(tn), data, datasize);
@@ -438,7 +609,7 @@ GOOD_OR_BAD Cache_Add_Dir(const struct dirblob *db, const struct parsedname *pn)
 {
 	time_t duration = TimeOut(fc_directory);
 	struct tree_node *tn;
-	size_t size = DirblobElements(db) * SERIAL_NUMBER_SIZE;
+	size_t size = DirblobPackedSize(db);	// list and its search index
 	struct parsedname pn_directory;
 
 	if (pn==NO_PARSEDNAME || pn->selected_connection==NO_CONNECTION) {
@@ -470,7 +641,7 @@ GOOD_OR_BAD Cache_Add_Dir(const struct dirblob *db, const struct parsedname *pn)
 	}
 	
 	// allocate space for the node and data
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + size);
+	tn = (struct tree_node *) owpool_alloc(sizeof(struct tree_node) + size);
 	if (!tn) {
 		return gbBAD;
 	}
@@ -480,11 +651,9 @@ GOOD_OR_BAD Cache_Add_Dir(const struct dirblob *db, const struct parsedname *pn)
 	// populate node with directory name and dirblob
 	FS_LoadDirectoryOnly(&pn_directory, pn);
 	LoadTK( pn_directory.sn, Directory_Marker, pn->selected_connection->index, tn );
-	tn->expires = duration + NOW_TIME;
+	tn->expires = duration + CACHE_NOW;
 	tn->dsize = size;
-	if (size) {
-		memcpy(TREE_DATA(tn), db->snlist, size);
-	}
+	DirblobPack(TREE_DATA(tn), db);
 	return Add_Stat(&cache_dir, Cache_Add_Common(tn));
 }
 
@@ -506,9 +675,9 @@ GOOD_OR_BAD Cache_Add_Simul(const struct internal_prop *ip, const struct parsedn
 		return gbGOOD;				/* in case timeout set to 0 */
 	}
 	
-	// allocate space for the node and data
+	// allocate space for the node and data (start of the conversion)
 	LEVEL_DEBUG("Adding for conversion time for "SNformat, SNvar(pn->sn));
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node));
+	tn = (struct tree_node *) owpool_alloc(sizeof(struct tree_node) + sizeof(struct timeval));
 	if (!tn) {
 		return gbBAD;
 	}
@@ -518,8 +687,9 @@ GOOD_OR_BAD Cache_Add_Simul(const struct internal_prop *ip, const struct parsedn
 	// populate node with directory name and dirblob
 	LoadTK( pn->sn, ip->name, 0, tn) ;
 	LEVEL_DEBUG("Simultaneous add type=%s",ip->name);
-	tn->expires = duration + NOW_TIME;
-	tn->dsize = 0;
+	tn->expires = duration + CACHE_NOW;
+	tn->dsize = sizeof(struct timeval);
+	timernow( (struct timeval *) TREE_DATA(tn) ) ;
 	return Add_Stat(&cache_dir, Cache_Add_Common(tn));
 }
 
@@ -538,14 +708,14 @@ GOOD_OR_BAD Cache_Add_Device(const int bus_nr, const BYTE * sn)
 		return gbGOOD ;
 	}
 
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + sizeof(int));
+	tn = (struct tree_node *) owpool_alloc(sizeof(struct tree_node) + sizeof(int));
 	if (!tn) {
 		return gbBAD;
 	}
 
 	LEVEL_DEBUG("Adding device location " SNformat " bus=%d", SNvar(sn), (int) bus_nr);
 	LoadTK(sn, Device_Marker, 0, tn );
-	tn->expires = duration + NOW_TIME;
+	tn->expires = duration + CACHE_NOW;
 	tn->dsize = sizeof(int);
 	memcpy(TREE_DATA(tn), &bus_nr, sizeof(int));
 	return Add_Stat(&cache_dev, Cache_Add_Common(tn));
@@ -576,14 +746,14 @@ GOOD_OR_BAD Cache_Add_SlaveSpecific(const void *data, const size_t datasize, con
 		return gbGOOD;				/* in case timeout set to 0 */
 	}
 
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + datasize);
+	tn = (struct tree_node *) owpool_alloc(sizeof(struct tree_node) + datasize);
 	if (!tn) {
 		return gbBAD;
 	}
 
 	LEVEL_DEBUG("Adding internal data for "SNformat " size=%d", SNvar(pn->sn), (int) datasize);
 	LoadTK( pn->sn, ip->name, EXTENSION_INTERNAL, tn );
-	tn->expires = duration + NOW_TIME;
+	tn->expires = duration + CACHE_NOW;
 	tn->dsize = datasize;
 	if (datasize) {
 		memcpy(TREE_DATA(tn), data, datasize);
@@ -609,14 +779,14 @@ GOOD_OR_BAD Cache_Add_Alias(const ASCII *name, const BYTE * sn)
 		return gbGOOD ;
 	}
 
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + size + 1 );
+	tn = (struct tree_node *) owpool_alloc(sizeof(struct tree_node) + size + 1 );
 	if (!tn) {
 		return gbBAD;
 	}
 
 	LEVEL_DEBUG("Adding alias for " SNformat " = %s", SNvar(sn), name);
 	LoadTK( sn, Alias_Marker, 0, tn );
-	tn->expires = NOW_TIME;
+	tn->expires = CACHE_NOW;
 	tn->dsize = size;
 	memcpy((ASCII *)TREE_DATA(tn), name, size+1 ); // includes NULL
 	Cache_Add_Alias_SN( name, sn ) ;
@@ -629,51 +799,274 @@ GOOD_OR_BAD Cache_Add_Alias(const ASCII *name, const BYTE * sn)
 static GOOD_OR_BAD Cache_Add_Common(struct tree_node *tn)
 {
 	struct tree_opaque *opaque;
-	enum { no_add, yes_add, just_update } state = no_add;
+	struct cache_shard * shard = ShardOf( tn ) ;
+	size_t tn_bytes = TREE_NODE_BYTES(tn) ;
+	ssize_t bytes_change = 0 ;
+	enum { no_add, yes_add, just_update, no_room } state = no_add;
 
 	node_show(tn);
 	LEVEL_DEBUG("Add to cache sn " SNformat " pointer=%p index=%d size=%d", SNvar(tn->tk.sn), tn->tk.p, tn->tk.extension, tn->dsize);
-	CACHE_WLOCK;
-	if (cache.time_to_kill < NOW_TIME) {	// old database has timed out
-		FlipTree() ;
+	tn->referenced = 0 ;
+	SHARD_WLOCK( shard ) ;
+	if ( cache.per_entry_expiry ) {
+		// reclaim a few expired entries instead of flipping
+		Cache_Reap( shard, CACHE_NOW ) ;
+	} else if (shard->time_to_kill < CACHE_NOW) {	// old database has timed out
+		FlipTree( shard ) ;
+	}
+	// size limit is shared evenly between the shards
+	if ( Globals.cache_size && tn_bytes > Globals.cache_size / cache.shards ) {
+		// can never fit
+		owpool_free(tn);
+		state = no_room ;
+	} else if ( Globals.cache_size ) {
+		// an update only needs room for the growth of the entry it replaces
+		struct tree_opaque * found = tfind(tn, &shard->temporary_tree_new, tree_compare) ;
+		const struct tree_node * tn_old = ( found != NULL ) ? found->key : NULL ;
+		size_t needed = tn_bytes ;
+		if ( tn_old != NULL ) {
+			size_t old_bytes = TREE_NODE_BYTES(tn_old) ;
+			needed = ( tn_bytes > old_bytes ) ? tn_bytes - old_bytes : 0 ;
+		}
+		if ( shard->old_ram_size + shard->new_ram_size + needed > Globals.cache_size / cache.shards ) {
+			// evict colder entries to make room
+			Cache_Make_Room( shard, needed, tn_old ) ;
+		}
 	}
-	if (Globals.cache_size && (cache.old_ram_size + cache.new_ram_size > Globals.cache_size)) {
-		// failed size test
-		owfree(tn);
-	} else if ((opaque = tsearch(tn, &cache.temporary_tree_new, tree_compare))) {
+	if ( state == no_room ) {
+		// already freed
+	} else if ((opaque = tsearch(tn, &shard->temporary_tree_new, tree_compare))) {
 		//printf("Cache_Add_Common to %p\n",opaque);
 		if (tn != opaque->key) {
-			cache.new_ram_size += sizeof(tn) - sizeof(opaque->key);
-			owfree(opaque->key);
+			struct tree_node * tn_old = opaque->key ;
+			bytes_change = tn_bytes - TREE_NODE_BYTES(tn_old) ;
+			tn->referenced = tn_old->referenced ;
+			RingRemove( tn_old, &shard->ring_new ) ;
+			if ( cache.per_entry_expiry ) {
+				WheelRemove( shard, tn_old ) ;
+			}
+			owpool_free(tn_old);
 			opaque->key = tn;
 			state = just_update;
 		} else {
 			state = yes_add;
-			cache.new_ram_size += sizeof(tn);
+			bytes_change = tn_bytes ;
+			++shard->added ;
+		}
+		RingInsert( tn, &shard->ring_new ) ;
+		if ( cache.per_entry_expiry ) {
+			WheelInsert( shard, tn ) ;
 		}
+		shard->new_ram_size += bytes_change ;
 	} else {					// nothing found or added?!? free our memory segment
-		owfree(tn);
+		owpool_free(tn);
 	}
-	CACHE_WUNLOCK;
+	SHARD_WUNLOCK( shard ) ;
 	/* Added or updated, update statistics */
 	switch (state) {
 		case yes_add: // add new entry
 			STATLOCK;
 			AVERAGE_IN(&new_avg);
 			++cache_adds;			/* statistics */
+			cache_bytes += bytes_change ;
 			STATUNLOCK;
 			return gbGOOD;
 		case just_update: // update the time mark and data
 			STATLOCK;
 			AVERAGE_MARK(&new_avg);
 			++cache_adds;			/* statistics */
+			cache_bytes += bytes_change ;
 			STATUNLOCK;
 			return gbGOOD;
+		case no_room:
+			STAT_ADD1(cache_refused);
+			return gbBAD;
 		default: // unable to add
 			return gbBAD;
 	}
 }
 
+/* Evict entries until "needed" more bytes fit in this shard's share of cache_size */
+/* The retired (older) tree goes first, oldest entries first,
+   then a CLOCK sweep of the newer tree gives recently read entries a second chance */
+/* "keep" (the entry being updated, or NULL) is never evicted */
+/* shard must be write locked */
+static void Cache_Make_Room( struct cache_shard * shard, size_t needed, const struct tree_node * keep )
+{
+	size_t budget = Globals.cache_size / cache.shards ;
+	size_t freed = 0 ;
+	UINT evicted_new = 0 ;
+	UINT evicted_old = 0 ;
+
+	while ( shard->old_ram_size + shard->new_ram_size + needed > budget && shard->ring_old != NULL ) {
+		freed += Cache_Evict( shard, shard->ring_old, &shard->temporary_tree_old, &shard->ring_old ) ;
+		++evicted_old ;
+	}
+
+	while ( shard->old_ram_size + shard->new_ram_size + needed > budget && shard->ring_new != NULL ) {
+		struct tree_node * victim = shard->ring_new ;
+		if ( victim == keep ) {
+			if ( victim->ring_next == victim ) {
+				break ; // nothing else left
+			}
+			shard->ring_new = victim->ring_next ;
+			continue ;
+		}
+		if ( victim->referenced ) {
+			// second chance
+			victim->referenced = 0 ;
+			shard->ring_new = victim->ring_next ;
+			continue ;
+		}
+		freed += Cache_Evict( shard, victim, &shard->temporary_tree_new, &shard->ring_new ) ;
+		++evicted_new ;
+	}
+
+	if ( evicted_new + evicted_old > 0 ) {
+		LEVEL_DEBUG("Cache evicted %u entries (%u bytes) to make room", evicted_new + evicted_old, (UINT) freed ) ;
+		STATLOCK;
+		cache_evictions += evicted_new + evicted_old ;
+		cache_bytes -= freed ;
+		new_avg.current -= evicted_new ;
+		old_avg.current -= evicted_old ;
+		STATUNLOCK;
+	}
+}
+
+/* Remove a single node from its tree and ring and free it. Returns bytes released */
+/* shard must be write locked */
+static size_t Cache_Evict( struct cache_shard * shard, struct tree_node * victim, void ** tree, struct tree_node ** ring )
+{
+	size_t bytes = TREE_NODE_BYTES(victim) ;
+
+	RingRemove( victim, ring ) ;
+	tdelete( victim, tree, tree_compare ) ;
+	if ( tree == &shard->temporary_tree_new ) {
+		if ( cache.per_entry_expiry ) {
+			WheelRemove( shard, victim ) ;
+		}
+		shard->new_ram_size -= bytes ;
+		--shard->added ;
+	} else {
+		shard->old_ram_size -= bytes ;
+		--shard->retired ;
+	}
+	owpool_free( victim ) ;
+	return bytes ;
+}
+
+/* Per-entry expiry: walk the timer wheel up to the present, freeing entries whose time has passed */
+/* At most CACHE_REAP_BATCH entries are examined, the next call carries on
+   where this one stopped (even inside a bucket), so the wheel always turns */
+/* Called on inserts and on lookups once a second has passed */
+/* shard must be write locked */
+static void Cache_Reap( struct cache_shard * shard, time_t now )
+{
+	UINT examined = 0 ;
+	UINT reaped = 0 ;
+	size_t freed = 0 ;
+
+	if ( shard->wheel_time < now - CACHE_WHEEL_SLOTS ) {
+		// one full turn of the wheel covers every bucket
+		shard->wheel_time = now - CACHE_WHEEL_SLOTS ;
+		shard->wheel_resume = 0 ;
+	}
+
+	while ( shard->wheel_time < now && examined < CACHE_REAP_BATCH ) {
+		time_t slot_time = shard->wheel_time + 1 ;
+		struct tree_node * tn = shard->wheel_resume ? shard->wheel_cursor : shard->wheel[ slot_time % CACHE_WHEEL_SLOTS ] ;
+
+		shard->wheel_resume = 0 ;
+		while ( tn != NULL ) {
+			struct tree_node * tn_next = tn->wheel_next ;
+			if ( examined == CACHE_REAP_BATCH ) {
+				// rest of the bucket next time
+				shard->wheel_cursor = tn ;
+				shard->wheel_resume = 1 ;
+				break ;
+			}
+			++examined ;
+			if ( tn->expires <= now ) {
+				// entries further in the future wrapped around, they stay
+				freed += Cache_Evict( shard, tn, &shard->temporary_tree_new, &shard->ring_new ) ;
+				++reaped ;
+			}
+			tn = tn_next ;
+		}
+		if ( ! shard->wheel_resume ) {
+			// bucket done
+			shard->wheel_time = slot_time ;
+		}
+	}
+
+	if ( reaped > 0 ) {
+		STATLOCK;
+		cache_reaped += reaped ;
+		cache_bytes -= freed ;
+		new_avg.current -= reaped ;
+		STATUNLOCK;
+	}
+}
+
+/* Expiry buckets are plain doubly linked lists, by expiry second */
+static void WheelInsert( struct cache_shard * shard, struct tree_node * tn )
+{
+	struct tree_node ** bucket = &shard->wheel[ tn->expires % CACHE_WHEEL_SLOTS ] ;
+
+	tn->wheel_prev = NULL ;
+	tn->wheel_next = bucket[0] ;
+	if ( bucket[0] != NULL ) {
+		bucket[0]->wheel_prev = tn ;
+	}
+	bucket[0] = tn ;
+}
+
+static void WheelRemove( struct cache_shard * shard, struct tree_node * tn )
+{
+	if ( shard->wheel_resume && shard->wheel_cursor == tn ) {
+		// reaper resumes at the next one
+		shard->wheel_cursor = tn->wheel_next ;
+	}
+	if ( tn->wheel_prev == NULL ) {
+		shard->wheel[ tn->expires % CACHE_WHEEL_SLOTS ] = tn->wheel_next ;
+	} else {
+		tn->wheel_prev->wheel_next = tn->wheel_next ;
+	}
+	if ( tn->wheel_next != NULL ) {
+		tn->wheel_next->wheel_prev = tn->wheel_prev ;
+	}
+}
+
+/* Eviction rings are circular doubly linked lists
+   *ring points to the next candidate (clock hand) so insertion just behind it
+   makes the newest entry the last one considered */
+static void RingInsert( struct tree_node * tn, struct tree_node ** ring )
+{
+	struct tree_node * hand = ring[0] ;
+	if ( hand == NULL ) {
+		tn->ring_next = tn->ring_prev = tn ;
+		ring[0] = tn ;
+	} else {
+		tn->ring_next = hand ;
+		tn->ring_prev = hand->ring_prev ;
+		hand->ring_prev->ring_next = tn ;
+		hand->ring_prev = tn ;
+	}
+}
+
+static void RingRemove( struct tree_node * tn, struct tree_node ** ring )
+{
+	if ( tn->ring_next == tn ) {
+		ring[0] = NULL ;
+	} else {
+		tn->ring_prev->ring_next = tn->ring_next ;
+		tn->ring_next->ring_prev = tn->ring_prev ;
+		if ( ring[0] == tn ) {
+			ring[0] = tn->ring_next ;
+		}
+	}
+}
+
 /* Add an item to the cache */
 /* retire the cache (flip) if too old, and start a new one (keep the old one for a while) */
 /* return 0 if good, 1 if not */
@@ -688,14 +1081,14 @@ static GOOD_OR_BAD Cache_Add_Persistent(struct tree_node *tn)
 	if ( opaque != NULL ) {
 		//printf("CACHE ADD pointer=%p, key=%p\n",tn,opaque->key);
 		if (tn != opaque->key) {
-			owfree(opaque->key);
+			owpool_free(opaque->key);
 			opaque->key = tn;
 			state = just_update;
 		} else {
 			state = yes_add;
 		}
 	} else {					// nothing found or added?!? free our memory segment
-		owfree(tn);
+		owpool_free(tn);
 	}
 	PERSISTENT_WUNLOCK;
 
@@ -853,32 +1246,56 @@ GOOD_OR_BAD Cache_Get_Dir(struct dirblob *db, const struct parsedname *pn)
 	LEVEL_DEBUG("Looking for directory "SNformat, SNvar(pn->sn));
 	FS_LoadDirectoryOnly(&pn_directory, pn);
 	LoadTK( pn_directory.sn, Directory_Marker, pn->selected_connection->index, &tn) ;
-	return Get_Stat(&cache_dir, Cache_Get_Common_Dir(db, &duration, &tn));
+	return Get_Stat(&cache_dir, Cache_Get_Common_Dir(db, NULL, NULL, &duration, &tn));
+}
+
+/* Look for a device in the cached directory, without copying it out */
+/* 0=directory found and valid (device_index INDEX_BAD if not listed), 1=not or uncachable in the first place */
+GOOD_OR_BAD Cache_Get_Dir_Search(int * device_index, const BYTE * sn, const struct parsedname *pn)
+{
+	time_t duration = TimeOut(fc_directory);
+	struct tree_node tn;
+	struct parsedname pn_directory;
+	if (duration <= 0) {
+		return gbBAD;
+	}
+
+	LEVEL_DEBUG("Looking for " SNformat " in directory "SNformat, SNvar(sn), SNvar(pn->sn));
+	FS_LoadDirectoryOnly(&pn_directory, pn);
+	LoadTK( pn_directory.sn, Directory_Marker, pn->selected_connection->index, &tn) ;
+	return Get_Stat(&cache_dir, Cache_Get_Common_Dir(NULL, sn, device_index, &duration, &tn));
 }
 
 /* Look in caches, 0=found and valid, 1=not or uncachable in the first place */
-static enum cache_task_return Cache_Get_Common_Dir(struct dirblob *db, time_t * duration, const struct tree_node *tn)
+/* Copies the directory into db, or (db NULL) looks for sn in place */
+static enum cache_task_return Cache_Get_Common_Dir(struct dirblob *db, const BYTE * sn, int * device_index, time_t * duration, const struct tree_node *tn)
 {
 	enum cache_task_return ctr_ret;
-	time_t now = NOW_TIME;
+	time_t now = CACHE_NOW;
 	size_t size;
 	struct tree_opaque *opaque;
+	struct cache_shard * shard = ShardOf( tn ) ;
 	LEVEL_DEBUG("Get from cache sn " SNformat " pointer=%p extension=%d", SNvar(tn->tk.sn), tn->tk.p, tn->tk.extension);
-	CACHE_RLOCK;
-	opaque = tfind(tn, &cache.temporary_tree_new, tree_compare) ;
+	SHARD_RLOCK( shard ) ;
+	opaque = tfind(tn, &shard->temporary_tree_new, tree_compare) ;
 	if ( opaque == NULL ) {
 		// not found in new tree
-		if ( cache.time_retired + duration[0] > now ) {
+		if ( shard->time_retired + duration[0] > now ) {
 			// old tree could be new enough
-			opaque = tfind(tn, &cache.temporary_tree_old, tree_compare) ;
+			opaque = tfind(tn, &shard->temporary_tree_old, tree_compare) ;
 		}
 	}
 	if ( opaque != NULL ) {
 		duration[0] = opaque->key->expires - now ;
 		if (duration[0] >= 0) {
 			LEVEL_DEBUG("Dir found in cache");
+			// CLOCK bit, only the read lock is held here
+			__atomic_store_n( &(opaque->key->referenced), 1, __ATOMIC_RELAXED ) ;
 			size = opaque->key->dsize;
-			if (DirblobRecreate(TREE_DATA(opaque->key), size, db) == 0) {
+			if ( db == NULL ) {
+				device_index[0] = DirblobSearchPacked(sn, TREE_DATA(opaque->key), size) ;
+				ctr_ret = ctr_ok;
+			} else if (DirblobUnpack(TREE_DATA(opaque->key), size, db) == 0) {
 				//printf("Cache: snlist=%p, devices=%lu, size=%lu\n",*snlist,devices[0],size) ;
 				ctr_ret = ctr_ok;
 			} else {
@@ -895,7 +1312,7 @@ static enum cache_task_return Cache_Get_Common_Dir(struct dirblob *db, time_t *
 		LEVEL_DEBUG("Dir not found in cache");
 		ctr_ret = ctr_not_found;
 	}
-	CACHE_RUNLOCK;
+	SHARD_RUNLOCK( shard ) ;
 	return ctr_ret;
 }
 
@@ -956,10 +1373,8 @@ Else return the cached value and true (0)
 GOOD_OR_BAD Cache_Get_Simul_Time(const struct internal_prop *ip, time_t * dwell_time, const struct parsedname * pn)
 {
 	// valid cached primary data -- see if a simultaneous conversion should be used instead
-	struct tree_node tn;
+	struct timeval start ;
 	time_t duration ;
-	size_t dsize_simul = 0 ;
-	struct parsedname pn_directory ;
 
 	duration = TimeOut(ip->change); // time allocated this conversion
 	if ( duration <= 0) {
@@ -969,9 +1384,7 @@ GOOD_OR_BAD Cache_Get_Simul_Time(const struct internal_prop *ip, time_t * dwell_
 
 	LEVEL_DEBUG("Looking for conversion time "SNformat, SNvar(pn->sn));
 	
-	FS_LoadDirectoryOnly(&pn_directory, pn);
-	LoadTK(pn_directory.sn, ip->name, 0, &tn ) ;
-	if ( Get_Stat(&cache_int, Cache_Get_Common(NULL, &dsize_simul, &duration, &tn)) ) {
+	if ( BAD( Cache_Get_Simul_Common( ip, &start, &duration, pn ) ) ) {
 		return gbBAD ;
 	}
 	// duration_simul is time left
@@ -981,6 +1394,35 @@ GOOD_OR_BAD Cache_Get_Simul_Time(const struct internal_prop *ip, time_t * dwell_
 	return gbGOOD ;
 }
 
+/* Start of a simultaneous conversion, to the microsecond */
+GOOD_OR_BAD Cache_Get_Simul_Start(const struct internal_prop *ip, struct timeval * start, const struct parsedname * pn)
+{
+	time_t duration = TimeOut(ip->change);
+
+	if ( duration <= 0) {
+		// uncachable
+		return gbBAD;
+	}
+	return Cache_Get_Simul_Common( ip, start, &duration, pn ) ;
+}
+
+static GOOD_OR_BAD Cache_Get_Simul_Common(const struct internal_prop *ip, struct timeval * start, time_t * duration, const struct parsedname * pn)
+{
+	struct tree_node tn;
+	size_t dsize_simul = sizeof(struct timeval) ;
+	struct parsedname pn_directory ;
+
+	FS_LoadDirectoryOnly(&pn_directory, pn);
+	LoadTK(pn_directory.sn, ip->name, 0, &tn ) ;
+	if ( Get_Stat(&cache_int, Cache_Get_Common(start, &dsize_simul, duration, &tn)) ) {
+		return gbBAD ;
+	}
+	if ( dsize_simul != sizeof(struct timeval) ) {
+		return gbBAD ;
+	}
+	return gbGOOD ;
+}
+
 /* Test for a simultaneous property
  * return true if simultaneous is the prefered method
  * bad if no simultaneous, or it's not the best
@@ -1056,6 +1498,46 @@ ASCII * Cache_Get_Alias(const BYTE * sn)
 	return alias_name ;
 }
 
+/* When the cached value for pn was stored and when it expires
+ * Nothing is read, the value stays the same as long as the entry does (owhttpd ETag) */
+GOOD_OR_BAD Cache_Get_Expiry(time_t * stored, time_t * expires, const struct parsedname *pn)
+{
+	time_t duration;
+	time_t now = CACHE_NOW;
+	struct tree_node tn;
+	struct tree_opaque *opaque;
+	struct cache_shard * shard ;
+
+	if (pn->selected_filetype == NO_FILETYPE || IsUncachedDir(pn) || IsAlarmDir(pn) || IsThisPersistent(pn)) {
+		return gbBAD;
+	}
+	duration = TimeOut(pn->selected_filetype->change);
+	if (duration <= 0) {
+		return gbBAD;
+	}
+
+	LoadTK( pn->sn, pn->selected_filetype, pn->extension, &tn );
+	shard = ShardOf( &tn ) ;
+	SHARD_RLOCK( shard ) ;
+	opaque = tfind(&tn, &shard->temporary_tree_new, tree_compare) ;
+	if ( opaque == NULL && shard->time_retired + duration > now ) {
+		opaque = tfind(&tn, &shard->temporary_tree_old, tree_compare) ;
+	}
+	if ( opaque != NULL ) {
+		expires[0] = opaque->key->expires ;
+	}
+	SHARD_RUNLOCK( shard ) ;
+
+	if ( opaque == NULL || expires[0] <= now ) {
+		return gbBAD ;
+	}
+	stored[0] = expires[0] - duration ;
+	if ( stored[0] > now ) {
+		stored[0] = now ;
+	}
+	return gbGOOD ;
+}
+
 /* Look in caches */
 /* duration is time left */
 /* inputs: dsize, duration, tn
@@ -1064,19 +1546,21 @@ ASCII * Cache_Get_Alias(const BYTE * sn)
 static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_t * duration, const struct tree_node *tn)
 {
 	enum cache_task_return ctr_ret;
-	time_t now = NOW_TIME;
+	time_t now = CACHE_NOW;
 	struct tree_opaque *opaque;
+	struct cache_shard * shard = ShardOf( tn ) ;
+	int behind ;
 	
 	LEVEL_DEBUG("Search in cache sn " SNformat " pointer=%p index=%d size=%d", SNvar(tn->tk.sn), tn->tk.p, tn->tk.extension, (int) dsize[0]);
 	//node_show(tn);
 	//new_tree();
-	CACHE_RLOCK;
-	opaque = tfind(tn, &cache.temporary_tree_new, tree_compare) ;
+	SHARD_RLOCK( shard ) ;
+	opaque = tfind(tn, &shard->temporary_tree_new, tree_compare) ;
 	if ( opaque == NULL ) {
 		// not found in new tree
-		if ( cache.time_retired + duration[0] > now ) {
+		if ( shard->time_retired + duration[0] > now ) {
 			// retired time isn't too old for this data item
-			opaque = tfind(tn, &cache.temporary_tree_old, tree_compare) ;
+			opaque = tfind(tn, &shard->temporary_tree_old, tree_compare) ;
 		}
 	}
 	if ( opaque != NULL ) {
@@ -1089,12 +1573,14 @@ static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_
 			if ( dsize[0] >= opaque->key->dsize) {
 				// lower data size if stored value is shorter
 				dsize[0] = opaque->key->dsize;
+				// CLOCK bit, only the read lock is held here
+				__atomic_store_n( &(opaque->key->referenced), 1, __ATOMIC_RELAXED ) ;
 				//tree_show(opaque,leaf,0);
 				if (dsize[0] > 0) {
 					memcpy(data, TREE_DATA(opaque->key), dsize[0]);
 				}
 				ctr_ret = ctr_ok;
-				//twalk(cache.temporary_tree_new,tree_show) ;
+				//twalk(shard->temporary_tree_new,tree_show) ;
 			} else {
 				ctr_ret = ctr_size_mismatch;
 			}
@@ -1106,7 +1592,14 @@ static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_
 		LEVEL_DEBUG("Value not found in cache");
 		ctr_ret = ctr_not_found;
 	}
-	CACHE_RUNLOCK;
+	behind = cache.per_entry_expiry && ( shard->wheel_time < now ) ;
+	SHARD_RUNLOCK( shard ) ;
+	if ( behind ) {
+		// lookups keep the wheel turning between inserts
+		SHARD_WLOCK( shard ) ;
+		Cache_Reap( shard, now ) ;
+		SHARD_WUNLOCK( shard ) ;
+	}
 	return ctr_ret;
 }
 
@@ -1202,9 +1695,9 @@ void Cache_Del_Alias(const BYTE * sn)
 
 	LEVEL_DEBUG("Deleting alias %s from "SNformat, alias_name, SNvar(sn)) ;
 	size = strlen( alias_name ) ;
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + size + 1 );
+	tn = (struct tree_node *) owpool_alloc(sizeof(struct tree_node) + size + 1 );
 	if ( tn != NULL ) {
-		tn->expires = NOW_TIME;
+		tn->expires = CACHE_NOW;
 		tn->dsize = size;
 		memcpy((ASCII *)TREE_DATA(tn), alias_name, size+1); // includes NULL
 		LoadTK( sn, Alias_Marker, 0, tn ) ;
@@ -1343,7 +1836,7 @@ void Cache_Del_Internal(const struct internal_prop *ip, const struct parsedname
 		return;				/* in case timeout set to 0 */
 	}
 
-	LoadTK(pn->sn, ip->name, 0, &tn);
+	LoadTK(pn->sn, ip->name, EXTENSION_INTERNAL, &tn);
 	switch (ip->change) {
 	case fc_persistent:
 		Del_Stat(&cache_pst, Cache_Del_Persistent(&tn));
@@ -1357,24 +1850,35 @@ void Cache_Del_Internal(const struct internal_prop *ip, const struct parsedname
 static GOOD_OR_BAD Cache_Del_Common(const struct tree_node *tn)
 {
 	struct tree_opaque *opaque;
-	time_t now = NOW_TIME;
+	struct cache_shard * shard = ShardOf( tn ) ;
+	time_t now = CACHE_NOW;
 	GOOD_OR_BAD ret = gbBAD;
 	LEVEL_DEBUG("Delete from cache sn " SNformat " in=%p index=%d", SNvar(tn->tk.sn), tn->tk.p, tn->tk.extension);
 
-	CACHE_WLOCK;
-	opaque = tfind(tn, &cache.temporary_tree_new, tree_compare) ;
+	SHARD_WLOCK( shard ) ;
+	opaque = tfind(tn, &shard->temporary_tree_new, tree_compare) ;
+	if ( opaque != NULL && cache.per_entry_expiry ) {
+		// no generations to age it out -- free it now
+		size_t freed = Cache_Evict( shard, opaque->key, &shard->temporary_tree_new, &shard->ring_new ) ;
+		SHARD_WUNLOCK( shard ) ;
+		STATLOCK;
+		cache_bytes -= freed ;
+		AVERAGE_OUT(&new_avg);
+		STATUNLOCK;
+		return gbGOOD ;
+	}
 	if ( opaque == NULL ) {
 		// not in new tree
-		if ( cache.time_to_kill > now ) {
+		if ( shard->time_to_kill > now ) {
 			// old tree still alive
-			opaque = tfind(tn, &cache.temporary_tree_old, tree_compare) ;
+			opaque = tfind(tn, &shard->temporary_tree_old, tree_compare) ;
 		}
 	}
 	if ( opaque != NULL ) {
 		opaque->key->expires = now - 1;
 		ret = gbGOOD;
 	}
-	CACHE_WUNLOCK;
+	SHARD_WUNLOCK( shard ) ;
 
 	return ret;
 }
@@ -1396,7 +1900,7 @@ static GOOD_OR_BAD Cache_Del_Persistent(const struct tree_node *tn)
 		return gbBAD;
 	}
 
-	owfree(tn_found);
+	owpool_free(tn_found);
 	STATLOCK;
 	AVERAGE_OUT(&store_avg);
 	STATUNLOCK;
@@ -1463,7 +1967,7 @@ void Cache_Add_Alias_Bus(const ASCII * alias_name, INDEX_OR_ERROR bus)
 {
 	// allocate space for the node and data
 	size_t datasize = strlen(alias_name) ;
-	struct alias_tree_node *atn = (struct alias_tree_node *) owmalloc(sizeof(struct alias_tree_node) + datasize + 1 );
+	struct alias_tree_node *atn = (struct alias_tree_node *) owpool_alloc(sizeof(struct alias_tree_node) + datasize + 1 );
 	time_t duration = TimeOut(fc_presence);
 
 	if (atn==NULL) {
@@ -1471,12 +1975,12 @@ void Cache_Add_Alias_Bus(const ASCII * alias_name, INDEX_OR_ERROR bus)
 	}
 
 	if (datasize==0) {
-		owfree(atn) ;
+		owpool_free(atn) ;
 		return ;
 	}
 
 	// populate the node structure with data
-	atn->expires = duration + NOW_TIME;
+	atn->expires = duration + CACHE_NOW;
 	atn->size = datasize ;
 	atn->bus = bus ;
 	memcpy( ALIAS_TREE_DATA(atn), alias_name, datasize + 1 ) ;
@@ -1489,26 +1993,34 @@ void Cache_Add_Alias_Bus(const ASCII * alias_name, INDEX_OR_ERROR bus)
 static void Cache_Add_Alias_Common(struct alias_tree_node *atn)
 {
 	struct tree_opaque *opaque;
+	size_t atn_bytes = ALIAS_TREE_NODE_BYTES(atn) ;
+	ssize_t bytes_change = 0 ;
 
 	CACHE_WLOCK;
-	if (cache.time_to_kill < NOW_TIME) {	// old database has timed out
-		FlipTree() ;
+	if (cache.alias_time_to_kill < CACHE_NOW) {	// old database has timed out
+		FlipAliasTree() ;
 	}
-	if (Globals.cache_size && (cache.old_ram_size + cache.new_ram_size > Globals.cache_size)) {
+	if (Globals.cache_size && (cache.alias_old_ram_size + cache.alias_new_ram_size + atn_bytes > Globals.cache_size)) {
 		// failed size test
-		owfree(atn);
+		owpool_free(atn);
 	} else if ((opaque = tsearch(atn, &cache.temporary_alias_tree_new, alias_tree_compare))) {
 		if ( (void *)atn != (void *) (opaque->key) ) {
-			cache.new_ram_size += sizeof(atn) - sizeof(opaque->key);
-			owfree(opaque->key);
+			bytes_change = atn_bytes - ALIAS_TREE_NODE_BYTES((struct alias_tree_node *) opaque->key);
+			owpool_free(opaque->key);
 			opaque->key = (void *) atn;
 		} else {
-			cache.new_ram_size += sizeof(atn);
+			bytes_change = atn_bytes ;
 		}
+		cache.alias_new_ram_size += bytes_change ;
 	} else {					// nothing found or added?!? free our memory segment
-		owfree(atn);
+		owpool_free(atn);
 	}
 	CACHE_WUNLOCK;
+	if ( bytes_change != 0 ) {
+		STATLOCK;
+		cache_bytes += bytes_change ;
+		STATUNLOCK;
+	}
 }
 
 /* Add an alias/sn to the persistent database of name->sn */
@@ -1517,19 +2029,19 @@ static void Cache_Add_Alias_SN(const ASCII * alias_name, const BYTE * sn)
 {
 	// allocate space for the node and data
 	size_t datasize = strlen(alias_name) ;
-	struct alias_tree_node *atn = (struct alias_tree_node *) owmalloc(sizeof(struct alias_tree_node) + datasize + 1);
+	struct alias_tree_node *atn = (struct alias_tree_node *) owpool_alloc(sizeof(struct alias_tree_node) + datasize + 1);
 
 	if (atn==NULL) {
 		return ;
 	}
 
 	if (datasize==0) {
-		owfree(atn) ;
+		owpool_free(atn) ;
 		return ;
 	}
 
 	// populate the node structure with data
-	atn->expires = NOW_TIME;
+	atn->expires = CACHE_NOW;
 	atn->size = datasize;
 	memcpy( atn->sn, sn, SERIAL_NUMBER_SIZE ) ;
 	memcpy( ALIAS_TREE_DATA(atn), alias_name, datasize+1 ) ;
@@ -1545,11 +2057,11 @@ static void Cache_Add_Alias_Persistent(struct alias_tree_node *atn)
 	opaque = tsearch(atn, &cache.persistent_alias_tree, alias_tree_compare) ;
 	if ( opaque != NULL ) {
 		if ( (void *) atn != (void *) (opaque->key) ) {
-			owfree(opaque->key);
+			owpool_free(opaque->key);
 			opaque->key = (void *) atn;
 		}
 	} else {					// nothing found or added?!? free our memory segment
-		owfree(atn);
+		owpool_free(atn);
 	}
 	PERSISTENT_WUNLOCK;
 }
@@ -1560,14 +2072,14 @@ INDEX_OR_ERROR Cache_Get_Alias_Bus(const ASCII * alias_name)
 {
 	// allocate space for the node and data
 	size_t datasize = strlen(alias_name) ;
-	struct alias_tree_node *atn = (struct alias_tree_node *) owmalloc(sizeof(struct alias_tree_node) + datasize + 1);
+	struct alias_tree_node *atn = (struct alias_tree_node *) owpool_alloc(sizeof(struct alias_tree_node) + datasize + 1);
 
 	if (atn==NULL) {
 		return INDEX_BAD ;
 	}
 
 	if (datasize==0) {
-		owfree(atn) ;
+		owpool_free(atn) ;
 		return INDEX_BAD ;
 	}
 
@@ -1581,7 +2093,7 @@ INDEX_OR_ERROR Cache_Get_Alias_Bus(const ASCII * alias_name)
 static INDEX_OR_ERROR Cache_Get_Alias_Common( struct alias_tree_node * atn)
 {
 	INDEX_OR_ERROR bus = INDEX_BAD;
-	time_t now = NOW_TIME;
+	time_t now = CACHE_NOW;
 	struct tree_opaque *opaque;
 	
 	CACHE_RLOCK;
@@ -1599,7 +2111,7 @@ static INDEX_OR_ERROR Cache_Get_Alias_Common( struct alias_tree_node * atn)
 	}
 	CACHE_RUNLOCK;
 	LEVEL_DEBUG("Finding %s unsuccessful",ALIAS_TREE_DATA(atn)) ;
-	owfree(atn) ;
+	owpool_free(atn) ;
 	return bus;
 }
 
@@ -1615,7 +2127,7 @@ GOOD_OR_BAD Cache_Get_Alias_SN(const ASCII * alias_name, BYTE * sn )
 		return gbBAD ;
 	}
 
-	atn = (struct alias_tree_node *) owmalloc(sizeof(struct alias_tree_node) + datasize+1);
+	atn = (struct alias_tree_node *) owpool_alloc(sizeof(struct alias_tree_node) + datasize+1);
 	if (atn==NULL) {
 		return gbBAD ;
 	}
@@ -1643,7 +2155,7 @@ static GOOD_OR_BAD Cache_Get_Alias_Persistent( BYTE * sn, struct alias_tree_node
 		LEVEL_DEBUG("Lookup of %s unsuccessful",CONST_ALIAS_TREE_DATA(atn)) ;
 	}
 	PERSISTENT_RUNLOCK;
-	owfree(atn) ;
+	owpool_free(atn) ;
 	return ret;
 }
 
@@ -1652,14 +2164,14 @@ static void Cache_Del_Alias_SN(const ASCII * alias_name)
 {
 	// allocate space for the node and data
 	size_t datasize = strlen(alias_name) ;
-	struct alias_tree_node *atn = (struct alias_tree_node *) owmalloc(sizeof(struct alias_tree_node) + datasize + 1);
+	struct alias_tree_node *atn = (struct alias_tree_node *) owpool_alloc(sizeof(struct alias_tree_node) + datasize + 1);
 
 	if (atn==NULL) {
 		return ;
 	}
 
 	// populate the node structure with data
-	atn->expires = NOW_TIME;
+	atn->expires = CACHE_NOW;
 	atn->size = datasize;
 	memcpy( ALIAS_TREE_DATA(atn), alias_name, datasize+1 ) ;
 	
@@ -1678,7 +2190,7 @@ static void Cache_Del_Alias_Persistent( struct alias_tree_node * atn)
 		atn_found = (struct alias_tree_node *) (opaque->key);
 	}
 	PERSISTENT_RUNLOCK;
-	owfree(atn_found) ;
+	owpool_free(atn_found) ;
 }
 
 /* Delete bus from alias name */
@@ -120,7 +120,7 @@ static struct bitfield mDI001_loop_shorted   = { "shorted", 1, 0, } ;
 static struct bitfield mDI001_loop_open      = { "open", 1, 0, } ;
 
 /* Digital Input Sensor */
-static struct aggregate mDI001_state = { 4, ag_numbers, ag_aggregate, }; // 4 inputs
+static struct aggregate mDI001_state = { 4, ag_numbers, ag_aggregate, NO_BULK_READ, }; // 4 inputs
 static struct filetype mDI001[] = {
 	F_STANDARD,
 	{"reading", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_volatile, FS_r_data, NO_WRITE_FUNCTION, INVISIBLE, NO_FILETYPE_DATA, },
@@ -115,6 +115,8 @@ static struct connection_in *AllocIn(const struct connection_in *old_in)
 		new_in->branch.branch = eBranch_bad ;
 		/* Arbitrary guess at root directory size for allocating cache blob */
 		new_in->last_root_devs = 10;
+		/* No listing yet to check a search against */
+		DirblobInit( &(new_in->search_seed) ) ;
 		new_in->AnyDevices = anydevices_unknown ;
 
 		++Inbound_Control.active ;
@@ -148,6 +150,7 @@ struct port_in * AllocPort( const struct port_in * old_pin )
 		
 		// never copy file_descriptor (it's unique to port)
 		new_pin->file_descriptor = FILE_DESCRIPTOR_BAD ;
+		new_pin->worker = NULL ;
 		new_pin->type = ct_unknown ;
 		new_pin->state = cs_virgin ;
 
@@ -241,10 +244,14 @@ void RemoveIn( struct connection_in * conn )
 		Inbound_Control.next_index-- ;
 	}
 
+	/* Parsed paths may point to this connection */
+	ParseCache_Flush() ;
+
 	/* Now free up thread-sync resources */
 	_MUTEX_DESTROY(conn->bus_mutex);
 	_MUTEX_DESTROY(conn->dev_mutex);
 	SAFETDESTROY( conn->dev_db, owfree_func);
+	DirblobClear( &(conn->search_seed) ) ;
 
 	/* Free port */
 	COM_free( conn ) ;
@@ -263,6 +270,9 @@ void RemovePort( struct port_in * pin )
 		return ;
 	}
 
+	/* No more jobs for this port */
+	PortWorker_stop( pin ) ;
+
 	/* First delete connections */
 	while ( pin->first != NO_CONNECTION ) {
 		RemoveIn( pin->first ) ;
@@ -0,0 +1,128 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+#include "ow_counters.h"
+#include "ow_connection.h"
+
+/* Conversions on powered slaves (DS18x20 temperature)
+ * A powered slave converts on its own, the bus is only needed to start
+ * the conversion and later to read the result. Rather than hold the bus
+ * for up to a second, the conversion is started and the bus released
+ * so other requests on this channel can go ahead.
+ *
+ * While nobody else has used the channel, the slave is still listening
+ * and reads 0 bits until done, so it is polled (as before) and an early
+ * finish is noticed. Once other traffic has gone over the bus that
+ * status is lost and the full conversion time is waited out.
+ *
+ * Reads of the same slave are already serialized by the device lock,
+ * so a second reader waits for this one, not for the bus.
+ *
+ * The same wait serves a conversion of the whole bus (SKIP ROM), then
+ * the poll answers 0 until the slowest slave is done.
+ */
+
+/* Polling interval, same as the old poll (first check sooner) */
+#define CONVERT_FIRST_POLL	10
+#define CONVERT_POLL		50
+
+/* Bus locks taken on this channel so far */
+UINT Convert_Bus_Locks( struct connection_in * in )
+{
+	UINT locks ;
+
+	STATLOCK ;
+	locks = in->bus_stat[e_bus_locks] ;
+	STATUNLOCK ;
+	return locks ;
+}
+
+/* Start the conversion with start (a transaction that addresses the slave and
+ * sends the convert command) and return when it is done or delay msec have passed */
+GOOD_OR_BAD Convert_Powered( const struct transaction_log * start, UINT delay, const struct parsedname * pn )
+{
+	UINT locks ;
+	GOOD_OR_BAD ret ;
+
+	BUSLOCK(pn);
+	ret = BUS_transaction_nolock(start, pn) ;
+	locks = Convert_Bus_Locks( pn->selected_connection ) ;
+	BUSUNLOCK(pn);
+	RETURN_BAD_IF_BAD( ret ) ;
+
+	STAT_ADD1( convert_released ) ;
+	return Convert_Wait( locks, delay, pn ) ;
+}
+
+/* Wait for a conversion started with the bus lock count at locks
+ * The bus is not held, only taken briefly to poll */
+GOOD_OR_BAD Convert_Wait( UINT locks, UINT delay, const struct parsedname * pn )
+{
+	struct connection_in * in = pn->selected_connection ;
+	struct timeval deadline ;
+	struct timeval now ;
+	UINT poll = CONVERT_FIRST_POLL ;
+	int polling = 1 ;
+
+	timernow( &deadline ) ;
+	deadline.tv_sec += delay / 1000 ;
+	deadline.tv_usec += ( delay % 1000 ) * 1000 ;
+	if ( deadline.tv_usec >= 1000000 ) {
+		deadline.tv_usec -= 1000000 ;
+		++deadline.tv_sec ;
+	}
+
+	while ( 1 ) {
+		struct timeval remaining ;
+		UINT remaining_ms ;
+
+		timernow( &now ) ;
+		if ( ! timercmp( &now, &deadline, < ) ) {
+			break ;
+		}
+		timersub( &deadline, &now, &remaining ) ;
+		remaining_ms = remaining.tv_sec * 1000 + ( remaining.tv_usec + 999 ) / 1000 ;
+
+		if ( ! polling ) {
+			UT_delay( remaining_ms ) ;
+			break ;
+		}
+
+		UT_delay( poll < remaining_ms ? poll : remaining_ms ) ;
+		poll = CONVERT_POLL ;
+
+		BUSLOCK(pn);
+		if ( Convert_Bus_Locks( in ) == locks + 1 ) {
+			// Only our own lock since the convert -- still talking to the slave
+			BYTE p[1] ;
+			struct transaction_log tpoll[] = {
+				TRXN_READ1(p),
+				TRXN_END,
+			};
+
+			if ( GOOD( BUS_transaction_nolock(tpoll, pn) ) && p[0] != 0 ) {
+				BUSUNLOCK(pn);
+				LEVEL_DEBUG("Conversion done by polling");
+				return gbGOOD ;
+			}
+			locks = Convert_Bus_Locks( in ) ;
+		} else {
+			// Other traffic, slave no longer answers with its status
+			LEVEL_DEBUG("Bus used during conversion, wait out the full %d msec", (int) delay);
+			polling = 0 ;
+		}
+		BUSUNLOCK(pn);
+	}
+
+	return gbGOOD ;
+}
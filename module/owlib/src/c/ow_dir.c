@@ -24,6 +24,7 @@ static enum search_status PossiblyLockedBusCall( enum search_status (* first_nex
 static ZERO_OR_ERROR FS_dir_both(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_directory, uint32_t * flags);
 static ZERO_OR_ERROR FS_dir_all_connections(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_directory, uint32_t * flags);
 static ZERO_OR_ERROR FS_devdir(void (*dirfunc) (void *, const struct parsedname * const), void *v, const struct parsedname *pn2);
+static ZERO_OR_ERROR FS_devdir_parsed(void (*dirfunc) (void *, const struct parsedname * const), void *v, const struct parsedname *pn_device_directory);
 static ZERO_OR_ERROR FS_structdevdir(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_device_directory);
 static ZERO_OR_ERROR FS_alarmdir(void (*dirfunc) (void *, const struct parsedname * const), void *v, const struct parsedname *pn2);
 static ZERO_OR_ERROR FS_typedir(void (*dirfunc) (void *, const struct parsedname * const), void *v, const struct parsedname *pn_type_directory);
@@ -246,6 +247,126 @@ static void FS_simultaneous_entry(void (*dirfunc) (void *, const struct parsedna
 /* path is the path which "pn_directory" parses */
 /* FS_dir_all_connections produces the data that can vary: device lists, etc. */
 
+/* Serial numbers already listed, when several buses are listed at once
+ * (a device can be seen through more than one bus master or owserver).
+ * Open addressing with linear probing, grown at half full. An empty slot
+ * is all zeros, not a serial number a device can have (no family 00).
+ * Only used from dirfunc, and all dirfunc calls are serialized by DIRLOCK.
+ */
+struct dir_seen {
+	BYTE * slots ;		// size serial numbers
+	size_t size ;		// power of 2
+	size_t count ;
+} ;
+
+/* Entries of all the buses go through here on the way to the caller's dirfunc */
+struct dir_unique_struct {
+	void (*dirfunc) (void *, const struct parsedname *);
+	void *v;
+	struct dir_seen seen ;
+} ;
+
+static size_t dir_seen_hash( const BYTE * sn )
+{
+	size_t hash = 0 ;
+	int i ;
+
+	for ( i = 0 ; i < SERIAL_NUMBER_SIZE ; ++i ) {
+		hash = hash * 31 + sn[i] ;
+	}
+	return hash ;
+}
+
+static void dir_seen_init( struct dir_seen * seen, size_t expected )
+{
+	seen->size = 64 ;
+	while ( seen->size < 2 * expected ) {
+		seen->size <<= 1 ;
+	}
+	seen->count = 0 ;
+	seen->slots = owcalloc( seen->size, SERIAL_NUMBER_SIZE ) ;
+	if ( seen->slots == NULL ) {
+		seen->size = 0 ;
+	}
+}
+
+/* Slot of sn, or the empty slot where it would go */
+static BYTE * dir_seen_slot( BYTE * slots, size_t size, const BYTE * sn )
+{
+	size_t index = dir_seen_hash( sn ) & ( size - 1 ) ;
+	BYTE empty[SERIAL_NUMBER_SIZE] = { 0, } ;
+
+	while ( 1 ) {
+		BYTE * slot = &slots[index * SERIAL_NUMBER_SIZE] ;
+		if ( memcmp( slot, sn, SERIAL_NUMBER_SIZE ) == 0 || memcmp( slot, empty, SERIAL_NUMBER_SIZE ) == 0 ) {
+			return slot ;
+		}
+		index = ( index + 1 ) & ( size - 1 ) ;
+	}
+}
+
+static void dir_seen_grow( struct dir_seen * seen )
+{
+	size_t size = seen->size << 1 ;
+	BYTE * slots = owcalloc( size, SERIAL_NUMBER_SIZE ) ;
+	BYTE empty[SERIAL_NUMBER_SIZE] = { 0, } ;
+	size_t index ;
+
+	if ( slots == NULL ) {
+		return ; // keep going fuller
+	}
+	for ( index = 0 ; index < seen->size ; ++index ) {
+		BYTE * slot = &seen->slots[index * SERIAL_NUMBER_SIZE] ;
+		if ( memcmp( slot, empty, SERIAL_NUMBER_SIZE ) != 0 ) {
+			memcpy( dir_seen_slot( slots, size, slot ), slot, SERIAL_NUMBER_SIZE ) ;
+		}
+	}
+	owfree( seen->slots ) ;
+	seen->slots = slots ;
+	seen->size = size ;
+}
+
+/* Add sn, gbBAD if it was already there */
+static GOOD_OR_BAD dir_seen_add( struct dir_seen * seen, const BYTE * sn )
+{
+	BYTE * slot ;
+
+	if ( seen->size == 0 ) {
+		return gbGOOD ; // no memory, list everything
+	}
+	slot = dir_seen_slot( seen->slots, seen->size, sn ) ;
+	if ( memcmp( slot, sn, SERIAL_NUMBER_SIZE ) == 0 ) {
+		return gbBAD ;
+	}
+	if ( seen->count + 2 > seen->size ) {
+		return gbGOOD ; // couldn't grow, keep an empty slot to end the probes
+	}
+	memcpy( slot, sn, SERIAL_NUMBER_SIZE ) ;
+	++seen->count ;
+	if ( 2 * seen->count >= seen->size ) {
+		dir_seen_grow( seen ) ;
+	}
+	return gbGOOD ;
+}
+
+/* dirfunc for the buses: pass each device on the first time it's seen */
+static void FS_dir_unique( void * v, const struct parsedname * pn_entry )
+{
+	struct dir_unique_struct * dus = v ;
+	BYTE empty[SERIAL_NUMBER_SIZE] = { 0, } ;
+
+	if ( pn_entry->selected_device != NO_DEVICE
+		&& pn_entry->selected_filetype == NO_FILETYPE
+		&& pn_entry->type == ePN_real
+		&& get_busmode( pn_entry->selected_connection ) != bus_external // named, not numbered
+		&& memcmp( pn_entry->sn, empty, SERIAL_NUMBER_SIZE ) != 0
+		&& BAD( dir_seen_add( &(dus->seen), pn_entry->sn ) ) ) {
+		STAT_ADD1(dir_duplicates);
+		return ;
+	}
+	dus->dirfunc( dus->v, pn_entry ) ;
+}
+
 struct dir_all_connections_struct {
 	struct port_in * pin ;
 	struct connection_in * cin ;
@@ -254,6 +375,7 @@ struct dir_all_connections_struct {
 	void *v;
 	uint32_t flags;
 	ZERO_OR_ERROR ret;
+	struct port_job job;
 };
 
 /* Embedded function */
@@ -283,75 +405,233 @@ static void FS_dir_all_connections_callback_conn( struct dir_all_connections_str
 	FS_dir_all_connections_callback_conn( dacs ) ;
 }
 
-/* Callback (thread) once per port */
+/* Callback (port worker job) once per port */
 /* Will need  to probe each connection (channel) on this port */
-static void *FS_dir_all_connections_callback_port(void *v)
+static void FS_dir_all_connections_callback_port(void *v)
 {
 	struct dir_all_connections_struct *dacs = v;
-	struct dir_all_connections_struct dacs_next ;
-	pthread_t thread;
-	int threadbad = 0;
-	
-	if ( dacs->pin == NULL ) {
-		return VOID_RETURN;
+
+	// First channel
+	dacs->cin = dacs->pin->first ;
+	FS_dir_all_connections_callback_conn( dacs ) ;
+}
+
+/* Ports are listed at the same time by their worker threads,
+ * the first one by this thread */
+/* Entries reach dirfunc as each bus finds them, devices seen on more than
+ * one bus only the first time */
+static ZERO_OR_ERROR
+FS_dir_all_connections(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_directory, uint32_t * flags)
+{
+	struct port_in * pin ;
+	struct dir_all_connections_struct * dacs ;
+	struct dir_unique_struct dus ;
+	struct port_batch batch ;
+	ZERO_OR_ERROR ret ;
+	int ports = 0 ;
+	int connections = 0 ;
+	size_t expected = 0 ;
+	int i ;
+
+	*flags = 0 ;
+	for ( pin = Inbound_Control.head_port ; pin != NULL ; pin = pin->next ) {
+		struct connection_in * cin ;
+		++ports ;
+		for ( cin = pin->first ; cin != NO_CONNECTION ; cin = cin->next ) {
+			++connections ;
+			expected += cin->last_root_devs ;
+		}
+	}
+	if ( ports == 0 ) {
+		return 0 ;
 	}
 
-	// set up structure
-	dacs_next.pin = dacs->pin->next ;
+	dacs = owcalloc( ports, sizeof(struct dir_all_connections_struct) ) ;
+	if ( dacs == NULL ) {
+		return -ENOMEM ;
+	}
 
-	if ( dacs_next.pin == NULL ) {
-		threadbad = 1 ;
-	} else {
-		dacs_next.dirfunc = dacs->dirfunc ;
-		memcpy( &(dacs_next.pn_directory), &(dacs->pn_directory), sizeof(struct parsedname));	// shallow copy
-		dacs_next.v = dacs->v ;
-		dacs_next.flags = dacs->flags ;
-		dacs_next.ret = dacs->ret ;
-		threadbad = pthread_create(&thread, DEFAULT_THREAD_ATTR, FS_dir_all_connections_callback_port, (void *) (&dacs_next));
+	if ( connections > 1 ) {
+		dus.dirfunc = dirfunc ;
+		dus.v = v ;
+		dir_seen_init( &(dus.seen), expected ) ;
+		dirfunc = FS_dir_unique ;
+		v = &dus ;
 	}
 
-	// First channel
-	dacs->cin = dacs->pin->first ;
-	FS_dir_all_connections_callback_conn( v ) ;
-		
-	//printf("FS_dir_all_connections4 pid=%ld adapter=%d ret=%d\n",pthread_self(), dacs->pn_directory->selected_connection->index,ret);
-	/* See if next bus was also queried */
-	if (threadbad == 0) {		/* was a thread created? */
-		if (pthread_join(thread, NULL)!= 0) {
-			return VOID_RETURN ;			/* cannot join, so return only this result */
+	// set up structures
+	PortBatch_init( &batch ) ;
+	for ( i = 0, pin = Inbound_Control.head_port ; pin != NULL ; ++i, pin = pin->next ) {
+		dacs[i].pin = pin ;
+		dacs[i].dirfunc = dirfunc ;
+		memcpy( &(dacs[i].pn_directory), pn_directory, sizeof(struct parsedname));	// shallow copy
+		dacs[i].v = v ;
+		dacs[i].flags = 0 ;
+		dacs[i].ret = 0 ;
+		if ( i > 0 ) {
+			PortWorker_dispatch( pin, &(dacs[i].job), FS_dir_all_connections_callback_port, &dacs[i], &batch ) ;
 		}
-		if (dacs_next.ret >= 0) {
-			dacs->ret = dacs_next.ret;	/* is it an error return? Then return this one */
+	}
+	FS_dir_all_connections_callback_port( &dacs[0] ) ;
+	PortBatch_wait( &batch ) ;
+
+	/* Combine, last port first, the way the chain of threads did */
+	for ( i = ports - 1 ; i > 0 ; --i ) {
+		if (dacs[i].ret >= 0) {
+			dacs[i-1].ret = dacs[i].ret;	/* is it an error return? Then return this one */
 		} else {
-			dacs->flags |= dacs_next.flags ;
-		}		
+			dacs[i-1].flags |= dacs[i].flags ;
+		}
 	}
-	return VOID_RETURN;
-}
 
-static ZERO_OR_ERROR
-FS_dir_all_connections(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_directory, uint32_t * flags)
-{
-	struct dir_all_connections_struct dacs ;
-		
-	// set up structure
-	dacs.pin = Inbound_Control.head_port ; 
-	dacs.dirfunc = dirfunc ;
-	memcpy( &(dacs.pn_directory), pn_directory, sizeof(struct parsedname));	// shallow copy
-	dacs.v = v ;
-	dacs.flags = 0 ;
-	dacs.ret = 0 ;
-	
-	// Start iterating through buses
-	FS_dir_all_connections_callback_port(  (void *) (& dacs) ) ;
-	
-	*flags = dacs.flags ;	
-	return dacs.ret ;
+	*flags = dacs[0].flags ;
+	ret = dacs[0].ret ;
+	owfree( dacs ) ;
+	if ( connections > 1 ) {
+		SAFEFREE( dus.seen.slots ) ;
+	}
+	return ret ;
 }
 
 /* Device directory (i.e. show the properties) -- all from memory */
 /* Respect the Visibility status and also show only the correct subdir level */
+/* Uses the listing made at startup (DeviceSort), each entry is the directory's
+   parsedname with the property put in place -- no parsing */
 static ZERO_OR_ERROR FS_devdir(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_device_directory)
+{
+	struct device_directory * dd = pn_device_directory->selected_device->directory ;
+	struct device_directory_level * level = NULL ;
+	struct parsedname s_pn_file_entry;
+	struct parsedname *pn_file_entry = &s_pn_file_entry;
+	size_t path_length ;
+	size_t server_length ;
+	int bitmap_size ;
+	int index ;
+
+	STAT_ADD1(dir_dev.calls);
+
+	if ( dd != NULL ) {
+		for ( index = 0 ; index < dd->levels ; ++index ) {
+			if ( dd->level[index].subdir == pn_device_directory->subdir ) {
+				level = &(dd->level[index]) ;
+				break ;
+			}
+		}
+	}
+	if ( level != NULL ) {
+		// visibility tests can resize an array (BAE eeprom pages)
+		for ( index = level->first ; index < level->first + level->count ; ++index ) {
+			struct device_directory_entry * entry = &(dd->entry[index]) ;
+			if ( entry->ft->ag != NON_AGGREGATE && entry->ft->ag->elements != entry->elements ) {
+				level = NULL ;
+				break ;
+			}
+		}
+	}
+	if ( level == NULL ) {
+		return FS_devdir_parsed(dirfunc, v, pn_device_directory) ;
+	}
+
+	// Entry names go after the directory path
+	memcpy( pn_file_entry, pn_device_directory, sizeof(struct parsedname) ) ;
+	path_length = strlen( pn_file_entry->path ) ;
+	if ( path_length == 0 || pn_file_entry->path[path_length-1] != '/' ) {
+		pn_file_entry->path[path_length++] = '/' ;
+	}
+	server_length = strlen( pn_file_entry->path_to_server ) ;
+	if ( server_length == 0 || pn_file_entry->path_to_server[server_length-1] != '/' ) {
+		pn_file_entry->path_to_server[server_length++] = '/' ;
+	}
+	if ( pn_device_directory->subdir == NO_SUBDIR ) {
+		pn_file_entry->dirlength = path_length ;
+	} // else the subdir's own dirlength, as a parse would leave it
+	pn_file_entry->sparse_name = NULL ;
+	if ( pn_device_directory->device_name != NULL ) {
+		// external device, name is in the path
+		pn_file_entry->device_name = pn_file_entry->path + ( pn_device_directory->device_name - pn_device_directory->path ) ;
+	}
+
+	// visibility known from earlier listings of this device
+	bitmap_size = dd->conditional ? ( dd->entries + 7 ) / 8 : 0 ;
+	{
+		BYTE bitmaps[2 * bitmap_size + 1] ;
+		BYTE * asked = bitmaps ;
+		BYTE * shown = &bitmaps[bitmap_size] ;
+		// only real devices are told apart by serial number
+		int cached = ( bitmap_size > 0 ) && ( pn_device_directory->type == ePN_real ) ;
+		int changed = 0 ;
+
+		if ( cached && ( IsUncachedDir( pn_device_directory ) || BAD( GetDirectoryVisibilityCache( bitmaps, 2 * bitmap_size, pn_device_directory ) ) ) ) {
+			memset( bitmaps, 0, 2 * bitmap_size ) ;
+		}
+
+		for ( index = level->first ; index < level->first + level->count ; ++index ) {
+			struct device_directory_entry * entry = &(dd->entry[index]) ;
+			struct parsedname * pn_shown = pn_file_entry ;
+			struct parsedname s_pn_parsed_entry ;
+
+			if ( entry->parse ) {
+				if ( FS_ParsedNamePlus(pn_device_directory->path, entry->name, &s_pn_parsed_entry) != 0 ) {
+					continue ;
+				}
+				pn_shown = &s_pn_parsed_entry ;
+				if ( entry->extension == EXTENSION_UNKNOWN ) {
+					pn_shown->extension = EXTENSION_UNKNOWN ; // unspecified (for owhttpd)
+				}
+			} else {
+				if ( path_length + strlen( entry->name ) > PATH_MAX ) {
+					continue ; // a parse would refuse it too
+				}
+				strcpy( &(pn_file_entry->path[path_length]), entry->name ) ;
+				strcpy( &(pn_file_entry->path_to_server[server_length]), entry->name ) ;
+				if ( entry->ft->format == ft_subdir ) {
+					pn_file_entry->selected_filetype = NO_FILETYPE ;
+					pn_file_entry->subdir = entry->ft ;
+				} else {
+					pn_file_entry->selected_filetype = entry->ft ;
+					pn_file_entry->subdir = pn_device_directory->subdir ;
+				}
+				pn_file_entry->extension = entry->extension ;
+			}
+
+			if ( entry->conditional ) {
+				// hide hidden properties
+				if ( ! cached || UT_getbit( asked, index ) == 0 ) {
+					switch ( FS_visible(pn_shown) ) {
+						case visible_now :
+						case visible_always:
+							UT_setbit( shown, index, 1 ) ;
+							break ;
+						default:
+							UT_setbit( shown, index, 0 ) ;
+							break ;
+					}
+					UT_setbit( asked, index, 1 ) ;
+					changed = 1 ;
+				}
+				if ( UT_getbit( shown, index ) ) {
+					FS_dir_entry_aliased( dirfunc, v, pn_shown ) ;
+					STAT_ADD1(dir_dev.entries);
+				}
+			} else {
+				FS_dir_entry_aliased( dirfunc, v, pn_shown ) ;
+				STAT_ADD1(dir_dev.entries);
+			}
+
+			if ( entry->parse ) {
+				FS_ParsedName_destroy( pn_shown ) ;
+			}
+		}
+
+		if ( cached && changed ) {
+			SetDirectoryVisibilityCache( bitmaps, 2 * bitmap_size, pn_device_directory ) ;
+		}
+	}
+	return 0;
+}
+
+/* Device directory, parsing each entry -- devices without a prepared listing */
+static ZERO_OR_ERROR FS_devdir_parsed(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_device_directory)
 {
 	struct device * dev = pn_device_directory->selected_device ;
 	struct filetype *lastft = &(dev->filetype_array[dev->count_of_filetypes]);	/* last filetype struct */
@@ -360,8 +640,6 @@ static ZERO_OR_ERROR FS_devdir(void (*dirfunc) (void *, const struct parsedname
 	size_t subdir_len;
 	uint32_t ignoreflag = 0;
 
-	STAT_ADD1(dir_dev.calls);
-
 	// Add subdir to name (SubDirectory is within a device, but an extra layer of grouping of properties)
 	if (pn_device_directory->subdir == NO_SUBDIR) {
 		// not sub directory
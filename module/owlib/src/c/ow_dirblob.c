@@ -35,6 +35,20 @@
 
 #define DIRBLOB_ELEMENT_LENGTH  8
 #define DIRBLOB_ALLOCATION_INCREMENT 10
+/* Shorter lists are searched in order, an index doesn't pay off */
+#define DIRBLOB_INDEX_MINIMUM 8
+
+/* Layout of a dirblob in the cache: this, the serial numbers, the index (if any) */
+struct dirblob_packed {
+	int devices ;
+	int index_size ;
+} ;
+
+static int DirblobIndexSize( int devices ) ;
+static int DirblobIndexSlot( const BYTE * sn, const BYTE * snlist, const int * index, int index_size ) ;
+static void DirblobIndexFill( const BYTE * snlist, int devices, int * index, int index_size ) ;
+static void DirblobIndexBuild( struct dirblob *db ) ;
+static void DirblobIndexClear( struct dirblob *db ) ;
 
 /*
     A "dirblob" is a structure holding a list of 1-wire serial numbers
@@ -43,11 +57,20 @@
     It is used for directory caches, and some "all at once" adapters types
 
     Most interestingly, it allocates memory dynamically.
+
+    Searches of longer lists go through an open-addressing hash index.
+    It's built at the first search, kept up to date by DirblobAdd, and
+    stored in the cache with the list (DirblobPack/DirblobUnpack), so a
+    cached directory is searched without building it again.
 */
 
 void DirblobClear(struct dirblob *db)
 {
-	SAFEFREE(db->snlist) ;
+	if ( db->snlist != NULL ) {
+		owpool_free( db->snlist ) ;
+		db->snlist = NULL ;
+	}
+	DirblobIndexClear( db ) ;
 	db->allocated = db->devices;
 	db->devices = 0;
 	db->troubled = 0;
@@ -59,6 +82,8 @@ void DirblobInit(struct dirblob *db)
 	db->allocated = 0;
 	db->snlist = 0;
 	db->troubled = 0;
+	db->index = NULL;
+	db->index_size = 0;
 }
 
 int DirblobPure(const struct dirblob *db)
@@ -82,9 +107,10 @@ int DirblobAdd(const BYTE * sn, struct dirblob *db)
 		return -EINVAL ;
 	}
 	// make more room? -- blocks of 10 devices (80byte)
+	// pooled, so growing within a size class costs nothing
 	if ((db->devices >= db->allocated) || (db->snlist == NULL)) {
 		int newalloc = db->allocated + DIRBLOB_ALLOCATION_INCREMENT;
-		BYTE *try_bigger_block = owrealloc(db->snlist, DIRBLOB_ELEMENT_LENGTH * newalloc);
+		BYTE *try_bigger_block = owpool_realloc(db->snlist, DIRBLOB_ELEMENT_LENGTH * newalloc);
 		if (try_bigger_block != NULL) {
 			db->allocated = newalloc;
 			db->snlist = try_bigger_block;
@@ -96,6 +122,18 @@ int DirblobAdd(const BYTE * sn, struct dirblob *db)
 	// add the device and increment the counter
 	memcpy(&(db->snlist[DIRBLOB_ELEMENT_LENGTH * db->devices]), sn, DIRBLOB_ELEMENT_LENGTH);
 	++db->devices;
+
+	// keep the index, or drop it to be rebuilt larger at the next search
+	if ( db->index != NULL ) {
+		if ( 2 * db->devices > db->index_size ) {
+			DirblobIndexClear( db ) ;
+		} else {
+			int slot = DirblobIndexSlot( sn, db->snlist, db->index, db->index_size ) ;
+			if ( db->index[slot] == 0 ) {
+				db->index[slot] = db->devices ;
+			}
+		}
+	}
 	return 0;
 }
 
@@ -112,12 +150,20 @@ int DirblobGet(int device_index, BYTE * sn, const struct dirblob *db)
    return position (>=0) on match
    return -1 on no match or error
  */
-int DirblobSearch(BYTE * sn, const struct dirblob *db)
+int DirblobSearch(const BYTE * sn, struct dirblob *db)
 {
 	int device_index;
 	if (db == NULL || db->devices < 1) {
 		return INDEX_BAD;
 	}
+	if ( db->index == NULL && db->devices >= DIRBLOB_INDEX_MINIMUM ) {
+		DirblobIndexBuild( db ) ;
+	}
+	if ( db->index != NULL ) {
+		int entry = db->index[ DirblobIndexSlot( sn, db->snlist, db->index, db->index_size ) ] ;
+		return ( entry > 0 ) ? entry - 1 : INDEX_BAD ;
+	}
+	// no index (short list or no memory) -- in order
 	for (device_index = 0; device_index < db->devices; ++device_index) {
 		if (memcmp(sn, &(db->snlist[DIRBLOB_ELEMENT_LENGTH * device_index]), DIRBLOB_ELEMENT_LENGTH) == 0) {
 			return device_index;
@@ -135,7 +181,7 @@ int DirblobRecreate( BYTE * snlist, int size, struct dirblob *db)
 		return 0 ;
 	}
 
-	db->snlist = (BYTE *) owmalloc(size) ;
+	db->snlist = (BYTE *) owpool_alloc(size) ;
 
 	if ( db->snlist == NULL ) {
 		db->troubled = 1 ;
@@ -147,3 +193,165 @@ int DirblobRecreate( BYTE * snlist, int size, struct dirblob *db)
 	return 0 ;
 }
 
+
+/* Room needed to pack this dirblob for the cache */
+size_t DirblobPackedSize(const struct dirblob *db)
+{
+	return sizeof(struct dirblob_packed)
+		+ DIRBLOB_ELEMENT_LENGTH * db->devices
+		+ sizeof(int) * DirblobIndexSize( db->devices ) ;
+}
+
+/* Pack for the cache: the list and a fresh index of it */
+void DirblobPack(BYTE * data, const struct dirblob *db)
+{
+	struct dirblob_packed header = { db->devices, DirblobIndexSize( db->devices ), } ;
+	BYTE * snlist = data + sizeof(struct dirblob_packed) ;
+
+	memcpy( data, &header, sizeof(struct dirblob_packed) ) ;
+	if ( header.devices == 0 ) {
+		return ;
+	}
+	memcpy( snlist, db->snlist, DIRBLOB_ELEMENT_LENGTH * header.devices ) ;
+	if ( header.index_size > 0 ) {
+		// the list length keeps the index aligned
+		DirblobIndexFill( snlist, header.devices, (int *) ( snlist + DIRBLOB_ELEMENT_LENGTH * header.devices ), header.index_size ) ;
+	}
+}
+
+/* Unpack from the cache, index included */
+int DirblobUnpack(const BYTE * data, size_t size, struct dirblob *db)
+{
+	struct dirblob_packed header ;
+	const BYTE * snlist = data + sizeof(struct dirblob_packed) ;
+	size_t list_size ;
+
+	DirblobInit( db ) ;
+	if ( size < sizeof(struct dirblob_packed) ) {
+		return -EINVAL ;
+	}
+	memcpy( &header, data, sizeof(struct dirblob_packed) ) ;
+	list_size = DIRBLOB_ELEMENT_LENGTH * header.devices ;
+	if ( size != sizeof(struct dirblob_packed) + list_size + sizeof(int) * header.index_size ) {
+		return -EINVAL ;
+	}
+	if ( header.devices == 0 ) {
+		return 0 ;
+	}
+
+	db->snlist = (BYTE *) owpool_alloc(list_size) ;
+	if ( db->snlist == NULL ) {
+		db->troubled = 1 ;
+		return -ENOMEM ;
+	}
+	memcpy(db->snlist, snlist, list_size);
+	db->allocated = db->devices = header.devices;
+
+	if ( header.index_size > 0 ) {
+		// without it, searches just build their own
+		db->index = (int *) owpool_alloc( sizeof(int) * header.index_size ) ;
+		if ( db->index != NULL ) {
+			memcpy( db->index, snlist + list_size, sizeof(int) * header.index_size ) ;
+			db->index_size = header.index_size ;
+		}
+	}
+	return 0 ;
+}
+
+/* Search a packed dirblob in place (in the cache, without a copy)
+   return position (>=0) on match
+   return -1 on no match or error
+ */
+int DirblobSearchPacked(const BYTE * sn, const BYTE * data, size_t size)
+{
+	struct dirblob_packed header ;
+	const BYTE * snlist = data + sizeof(struct dirblob_packed) ;
+	int device_index ;
+
+	if ( size < sizeof(struct dirblob_packed) ) {
+		return INDEX_BAD ;
+	}
+	memcpy( &header, data, sizeof(struct dirblob_packed) ) ;
+	if ( size != sizeof(struct dirblob_packed) + DIRBLOB_ELEMENT_LENGTH * header.devices + sizeof(int) * header.index_size ) {
+		return INDEX_BAD ;
+	}
+	if ( header.index_size > 0 ) {
+		const int * index = (const int *) ( snlist + DIRBLOB_ELEMENT_LENGTH * header.devices ) ;
+		int entry = index[ DirblobIndexSlot( sn, snlist, index, header.index_size ) ] ;
+		return ( entry > 0 ) ? entry - 1 : INDEX_BAD ;
+	}
+	for (device_index = 0; device_index < header.devices; ++device_index) {
+		if (memcmp(sn, &snlist[DIRBLOB_ELEMENT_LENGTH * device_index], DIRBLOB_ELEMENT_LENGTH) == 0) {
+			return device_index;
+		}
+	}
+	return INDEX_BAD;
+}
+
+/* Index slots for a list, at most half full (0 for no index) */
+static int DirblobIndexSize( int devices )
+{
+	int index_size = 16 ;
+
+	if ( devices < DIRBLOB_INDEX_MINIMUM ) {
+		return 0 ;
+	}
+	while ( index_size < 2 * devices ) {
+		index_size <<= 1 ;
+	}
+	return index_size ;
+}
+
+/* Slot of sn, or the empty slot where it would go */
+static int DirblobIndexSlot( const BYTE * sn, const BYTE * snlist, const int * index, int index_size )
+{
+	UINT hash = 0 ;
+	int slot ;
+	int i ;
+
+	for ( i = 0 ; i < DIRBLOB_ELEMENT_LENGTH ; ++i ) {
+		hash = hash * 31 + sn[i] ;
+	}
+	for ( slot = hash & ( index_size - 1 ) ; index[slot] != 0 ; slot = ( slot + 1 ) & ( index_size - 1 ) ) {
+		if ( memcmp( sn, &snlist[DIRBLOB_ELEMENT_LENGTH * ( index[slot] - 1 )], DIRBLOB_ELEMENT_LENGTH ) == 0 ) {
+			break ;
+		}
+	}
+	return slot ;
+}
+
+/* First of any repeated serial number wins, as in an ordered search */
+static void DirblobIndexFill( const BYTE * snlist, int devices, int * index, int index_size )
+{
+	int device_index ;
+
+	memset( index, 0, sizeof(int) * index_size ) ;
+	for ( device_index = 0 ; device_index < devices ; ++device_index ) {
+		const BYTE * sn = &snlist[DIRBLOB_ELEMENT_LENGTH * device_index] ;
+		int slot = DirblobIndexSlot( sn, snlist, index, index_size ) ;
+		if ( index[slot] == 0 ) {
+			index[slot] = device_index + 1 ;
+		}
+	}
+}
+
+static void DirblobIndexBuild( struct dirblob *db )
+{
+	int index_size = DirblobIndexSize( db->devices ) ;
+
+	db->index = (int *) owpool_alloc( sizeof(int) * index_size ) ;
+	if ( db->index == NULL ) {
+		return ; // search in order
+	}
+	db->index_size = index_size ;
+	DirblobIndexFill( db->snlist, db->devices, db->index, db->index_size ) ;
+}
+
+static void DirblobIndexClear( struct dirblob *db )
+{
+	if ( db->index != NULL ) {
+		owpool_free( db->index ) ;
+		db->index = NULL ;
+	}
+	db->index_size = 0 ;
+}
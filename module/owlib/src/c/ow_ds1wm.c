@@ -88,6 +88,7 @@ static void DS1WM_setroutines(struct connection_in *in)
     in->iroutines.sendback_bits = DS1WM_sendback_bits;
 	in->iroutines.select = NO_SELECT_ROUTINE;
 	in->iroutines.select_and_sendback = NO_SELECTANDSENDBACK_ROUTINE;
+	in->iroutines.select_and_power = NO_SELECTANDPOWER_ROUTINE;
 	in->iroutines.set_config = NO_SET_CONFIG_ROUTINE;
 	in->iroutines.get_config = NO_GET_CONFIG_ROUTINE;
 	in->iroutines.reconnect = DS1WM_reconnect ;
@@ -57,7 +57,12 @@ static GOOD_OR_BAD DS2482_detect_dir( int any, enum ds2482_address chip_num, str
 static GOOD_OR_BAD DS2482_detect_single(int lowindex, int highindex, char * i2c_device, struct port_in *pin) ;
 static enum search_status DS2482_next_both(struct device_search *ds, const struct parsedname *pn);
 static GOOD_OR_BAD DS2482_triple(BYTE * bits, int direction, FILE_DESCRIPTOR_OR_ERROR file_descriptor);
-static GOOD_OR_BAD DS2482_send_and_get(FILE_DESCRIPTOR_OR_ERROR file_descriptor, const BYTE wr, BYTE * rd);
+static GOOD_OR_BAD DS2482_send_and_get(struct connection_in * in, const BYTE wr, BYTE * rd);
+static GOOD_OR_BAD DS2482_send_and_get_smbus(FILE_DESCRIPTOR_OR_ERROR file_descriptor, const BYTE wr, BYTE * rd);
+static GOOD_OR_BAD DS2482_send_and_get_rdwr(struct connection_in * in, const BYTE wr, BYTE * rd, unsigned long int min_usec, unsigned long int max_usec);
+static GOOD_OR_BAD DS2482_rdwr(struct i2c_msg * msgs, int nmsgs, struct connection_in * in);
+static GOOD_OR_BAD DS2482_command_and_read(BYTE command, BYTE param, BYTE * read_back, struct connection_in * in);
+static int DS2482_rdwr_capable(FILE_DESCRIPTOR_OR_ERROR file_descriptor);
 static RESET_TYPE DS2482_reset(const struct parsedname *pn);
 static GOOD_OR_BAD DS2482_sendback_data(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
 static GOOD_OR_BAD DS2483_test(FILE_DESCRIPTOR_OR_ERROR file_descriptor);
@@ -125,6 +130,9 @@ static GOOD_OR_BAD DS2482_PowerByte(const BYTE byte, BYTE * resp, const UINT del
 #define DS2482_1wire_write_usec   530, 585
 #define DS2482_1wire_triplet_usec   198, 219
 
+/* Status polls before giving up on a busy 1-wire */
+#define DS2482_status_tries	4
+
 /* Defines for making messages more explicit */
 #define I2Cformat "I2C bus %s, channel %d/%d"
 #define I2Cvar(in)  DEVICENAME(in), (in)->master.i2c.index, (in)->master.i2c.channels
@@ -141,6 +149,7 @@ static void DS2482_setroutines(struct connection_in *in)
 	in->iroutines.sendback_bits = NO_SENDBACKBITS_ROUTINE;
 	in->iroutines.select = NO_SELECT_ROUTINE;
 	in->iroutines.select_and_sendback = NO_SELECTANDSENDBACK_ROUTINE;
+	in->iroutines.select_and_power = NO_SELECTANDPOWER_ROUTINE;
 	in->iroutines.set_config = NO_SET_CONFIG_ROUTINE;
 	in->iroutines.get_config = NO_GET_CONFIG_ROUTINE;
 	in->iroutines.reconnect = DS2482_redetect;
@@ -425,6 +434,7 @@ static GOOD_OR_BAD DS2482_detect_single(int lowindex, int highindex, char * i2c_
 			}
 			LEVEL_CONNECT("i2c device at %s address %.2X appears to be DS2482-x00", i2c_device, trial_address);
 			in->master.i2c.configchip = 0x00;	// default configuration register after RESET
+			in->master.i2c.rdwr = DS2482_rdwr_capable(file_descriptor) ;
 			// Note, only the lower nibble of the device config stored
 			
 			// Create name
@@ -516,7 +526,7 @@ static GOOD_OR_BAD DS2482_readstatus(BYTE * c, FILE_DESCRIPTOR_OR_ERROR file_des
 			LEVEL_DEBUG("ok");
 			return gbGOOD;
 		}
-		if (i++ == 3) {
+		if (++i == DS2482_status_tries) {
 			LEVEL_DEBUG("still busy min=%lu max=%lu i=%d ret=%d", min_usec, max_usec, i, ret);
 			return gbBAD;
 		}
@@ -624,7 +634,6 @@ static RESET_TYPE DS2482_reset(const struct parsedname *pn)
 static GOOD_OR_BAD DS2482_sendback_data(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn)
 {
 	struct connection_in * in = pn->selected_connection ;
-	FILE_DESCRIPTOR_OR_ERROR file_descriptor = in->pown->file_descriptor;
 	size_t i;
 
 	/* Make sure we're using the correct channel */
@@ -632,14 +641,24 @@ static GOOD_OR_BAD DS2482_sendback_data(const BYTE * data, BYTE * resp, const si
 
 	TrafficOut( "write", data, len, in ) ;
 	for (i = 0; i < len; ++i) {
-		RETURN_BAD_IF_BAD(DS2482_send_and_get(file_descriptor, data[i], &resp[i])) ;
+		RETURN_BAD_IF_BAD(DS2482_send_and_get(in, data[i], &resp[i])) ;
 	}
 	TrafficOut( "response", resp, len, in ) ;
 	return gbGOOD;
 }
 
 /* Single byte -- assumes channel selection already done */
-static GOOD_OR_BAD DS2482_send_and_get(FILE_DESCRIPTOR_OR_ERROR file_descriptor, const BYTE wr, BYTE * rd)
+static GOOD_OR_BAD DS2482_send_and_get(struct connection_in * in, const BYTE wr, BYTE * rd)
+{
+	if ( in->master.i2c.head->master.i2c.rdwr ) {
+		return DS2482_send_and_get_rdwr( in, wr, rd, DS2482_1wire_write_usec ) ;
+	}
+	return DS2482_send_and_get_smbus( in->pown->file_descriptor, wr, rd ) ;
+}
+
+/* Single byte, one SMBus call per i2c transfer:
+ * write byte, status poll(s), data pointer, data read */
+static GOOD_OR_BAD DS2482_send_and_get_smbus(FILE_DESCRIPTOR_OR_ERROR file_descriptor, const BYTE wr, BYTE * rd)
 {
 	int read_back;
 	BYTE c;
@@ -668,6 +687,110 @@ static GOOD_OR_BAD DS2482_send_and_get(FILE_DESCRIPTOR_OR_ERROR file_descriptor,
 	return gbGOOD;
 }
 
+/* Single byte, status poll and data read combined:
+ * The write byte command leaves the read pointer on the status register,
+ * so after the write time one I2C_RDWR reads the status, moves the pointer
+ * to the data register and reads the data. If the 1-wire was still busy
+ * the data is discarded and the pointer moved back to status first.
+ * 2 system calls per byte instead of 4 or more. */
+static GOOD_OR_BAD DS2482_send_and_get_rdwr(struct connection_in * in, const BYTE wr, BYTE * rd, unsigned long int min_usec, unsigned long int max_usec)
+{
+	struct connection_in *head = in->master.i2c.head;
+	__u16 address = head->master.i2c.i2c_address ;
+	BYTE write_byte[2] = { DS2482_CMD_1WIRE_WRITE_BYTE, wr, } ;
+	BYTE status_pointer[2] = { DS2482_CMD_SET_READ_PTR, DS2482_STATUS_REGISTER, } ;
+	BYTE data_pointer[2] = { DS2482_CMD_SET_READ_PTR, DS2482_READ_DATA_REGISTER, } ;
+	BYTE status ;
+	BYTE data ;
+	struct i2c_msg start[] = {
+		{ address, 0, 2, (char *) write_byte, },
+	} ;
+	struct i2c_msg finish[] = {
+		{ address, 0, 2, (char *) status_pointer, },
+		{ address, I2C_M_RD, 1, (char *) &status, },
+		{ address, 0, 2, (char *) data_pointer, },
+		{ address, I2C_M_RD, 1, (char *) &data, },
+	} ;
+	unsigned long int delta_usec = (max_usec - min_usec + 1) / 2;
+	int tries ;
+
+	/* Write data byte */
+	RETURN_BAD_IF_BAD( DS2482_rdwr( start, 1, in ) ) ;
+
+	UT_delay_us( min_usec ) ;		// at least get minimum out of the way
+	for ( tries = 0 ; tries < DS2482_status_tries ; ++tries ) {
+		/* first time the read pointer is already on status */
+		if ( tries == 0 ) {
+			RETURN_BAD_IF_BAD( DS2482_rdwr( &finish[1], 3, in ) ) ;
+		} else {
+			UT_delay_us( delta_usec ) ;
+			RETURN_BAD_IF_BAD( DS2482_rdwr( finish, 4, in ) ) ;
+		}
+		if ( (status & DS2482_REG_STS_1WB) == 0x00 ) {
+			rd[0] = data ;
+			return gbGOOD ;
+		}
+	}
+	LEVEL_DEBUG("still busy i=%d status=%.2X", tries, status);
+	return gbBAD ;
+}
+
+/* One combined i2c transfer (repeated starts, one stop) */
+static GOOD_OR_BAD DS2482_rdwr(struct i2c_msg * msgs, int nmsgs, struct connection_in * in)
+{
+	struct i2c_rdwr_ioctl_data rdwr = { msgs, nmsgs, } ;
+
+	if ( ioctl( in->pown->file_descriptor, I2C_RDWR, &rdwr ) < 0 ) {
+		LEVEL_DEBUG("I2C_RDWR transfer of %d messages failed "I2Cformat" ", nmsgs, I2Cvar(in));
+		return gbBAD ;
+	}
+	return gbGOOD ;
+}
+
+/* Command with parameter, then read back a byte (read pointer set by the command) */
+static GOOD_OR_BAD DS2482_command_and_read(BYTE command, BYTE param, BYTE * read_back, struct connection_in * in)
+{
+	struct connection_in *head = in->master.i2c.head;
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor = in->pown->file_descriptor;
+	int ret ;
+
+	if ( head->master.i2c.rdwr ) {
+		BYTE command_param[2] = { command, param, } ;
+		struct i2c_msg msgs[] = {
+			{ head->master.i2c.i2c_address, 0, 2, (char *) command_param, },
+			{ head->master.i2c.i2c_address, I2C_M_RD, 1, (char *) read_back, },
+		} ;
+		return DS2482_rdwr( msgs, 2, in ) ;
+	}
+
+	if (i2c_smbus_write_byte_data(file_descriptor, command, param) < 0) {
+		return gbBAD;
+	}
+	ret = i2c_smbus_read_byte(file_descriptor) ;
+	if ( ret < 0 ) {
+		return gbBAD;
+	}
+	read_back[0] = (BYTE) ret ;
+	return gbGOOD;
+}
+
+/* Does the i2c adapter do plain i2c (and so I2C_RDWR), not just SMBus? */
+static int DS2482_rdwr_capable(FILE_DESCRIPTOR_OR_ERROR file_descriptor)
+{
+	unsigned long funcs = 0 ;
+
+	if ( ioctl( file_descriptor, I2C_FUNCS, &funcs ) < 0 ) {
+		LEVEL_CONNECT("Cannot query i2c adapter functions, will use SMBus calls");
+		return 0 ;
+	}
+	if ( (funcs & I2C_FUNC_I2C) == 0 ) {
+		LEVEL_CONNECT("i2c adapter is SMBus only");
+		return 0 ;
+	}
+	LEVEL_CONNECT("i2c adapter takes combined transfers");
+	return 1 ;
+}
+
 /* Is this a DS2483? Try to set to new register */
 static GOOD_OR_BAD DS2483_test(FILE_DESCRIPTOR_OR_ERROR file_descriptor)
 {
@@ -778,21 +901,14 @@ static GOOD_OR_BAD DS2482_channel_select(struct connection_in * in)
 	/* Already properly selected? */
 	/* All `100 (1 channel) will be caught here */
 	if (chan != head->master.i2c.current) {
-		int read_back;
-
-		/* Select command */
-		if (i2c_smbus_write_byte_data(file_descriptor, DS2482_CMD_CHANNEL_SELECT, W_chan[chan]) < 0) {
-			LEVEL_DEBUG("Channel select set error");
-			return gbBAD;
-		}
+		BYTE read_back;
 
-		/* Read back and confirm */
-		read_back = i2c_smbus_read_byte(file_descriptor);
-		if (read_back < 0) {
-			LEVEL_DEBUG("Channel select get error");
+		/* Select command, read back and confirm */
+		if ( BAD( DS2482_command_and_read(DS2482_CMD_CHANNEL_SELECT, W_chan[chan], &read_back, in) ) ) {
+			LEVEL_DEBUG("Channel select error");
 			return gbBAD; // flag for DS2482-100 vs -800 detection
 		}
-		if (((BYTE) read_back) != R_chan[chan]) {
+		if (read_back != R_chan[chan]) {
 			LEVEL_DEBUG("Channel selected doesn't match");
 			return gbBAD; // flag for DS2482-100 vs -800 detection
 		}
@@ -815,13 +931,12 @@ static GOOD_OR_BAD DS2482_channel_select(struct connection_in * in)
 static GOOD_OR_BAD SetConfiguration(BYTE c, struct connection_in *in)
 {
 	struct connection_in *head = in->master.i2c.head;
-	FILE_DESCRIPTOR_OR_ERROR file_descriptor = in->pown->file_descriptor;
-	int read_back;
+	BYTE read_back;
 
 	/* Write, readback, and compare configuration register */
 	/* Logic error fix from Uli Raich */
-	if (i2c_smbus_write_byte_data(file_descriptor, DS2482_CMD_WRITE_CONFIG, c | ((~c) << 4))
-		|| (read_back = i2c_smbus_read_byte(file_descriptor)) < 0 || ((BYTE) read_back != c)
+	if ( BAD( DS2482_command_and_read(DS2482_CMD_WRITE_CONFIG, BYTE_MASK(c | ((~c) << 4)), &read_back, in) )
+		|| (read_back != c)
 		) {
 		head->master.i2c.configchip = 0xFF;	// bad value to trigger retry
 		LEVEL_CONNECT("Trouble changing DS2482 configuration register "I2Cformat" ",I2Cvar(in));
@@ -844,7 +959,7 @@ static GOOD_OR_BAD DS2482_PowerByte(const BYTE byte, BYTE * resp, const UINT del
 	RETURN_BAD_IF_BAD(SetConfiguration(  in->master.i2c.configreg | DS2482_REG_CFG_SPU, in)) ;
 
 	/* send and get byte (and trigger strong pull-up */
-	RETURN_BAD_IF_BAD(DS2482_send_and_get( in->pown->file_descriptor, byte, resp)) ;
+	RETURN_BAD_IF_BAD(DS2482_send_and_get( in, byte, resp)) ;
 	TrafficOut("power response", resp, 1, in ) ;
 
 	UT_delay(delay);
@@ -209,6 +209,7 @@
 #include "ow.h"
 #include "ow_counters.h"
 #include "ow_connection.h"
+#include "ow_codes.h"
 
 static RESET_TYPE DS2480_reset(const struct parsedname *pn);
 static enum search_status DS2480_next_both(struct device_search *ds, const struct parsedname *pn);
@@ -217,6 +218,8 @@ static GOOD_OR_BAD DS2480_PowerBit(const BYTE byte, BYTE * resp, const UINT dela
 static GOOD_OR_BAD DS2480_ProgramPulse(const struct parsedname *pn);
 static GOOD_OR_BAD DS2480_sendback_data(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
 static GOOD_OR_BAD DS2480_sendback_bits(const BYTE * databits, BYTE * respbits, const size_t len, const struct parsedname * pn);
+static GOOD_OR_BAD DS2480_select_and_sendback(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
+static GOOD_OR_BAD DS2480_select_and_power(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
 static GOOD_OR_BAD DS2480_reconnect(const struct parsedname * pn);
 static void DS2480_close(struct connection_in *in) ;
 
@@ -237,6 +240,10 @@ static GOOD_OR_BAD DS2480_configuration_write(BYTE parameter_code, BYTE value_co
 static GOOD_OR_BAD DS2480_configuration_read(BYTE parameter_code, BYTE value_code, struct connection_in * in);
 static GOOD_OR_BAD DS2480_stop_pulse(BYTE * response, struct connection_in * in);
 static RESET_TYPE DS2480_reset_once(struct connection_in * in) ;
+static RESET_TYPE DS2480_reset_response(BYTE reset_response, struct connection_in * in) ;
+static void DS2480_pulse_end(struct connection_in * in) ;
+static void DS2480_power_bits(BYTE byte, BYTE * cmd, struct connection_in * in) ;
+static BYTE DS2480_power_response(const BYTE * respbits) ;
 static GOOD_OR_BAD DS2480_set_baud(struct connection_in * in) ;
 static void DS2480_set_baud_control(struct connection_in * in) ;
 static BYTE DS2480b_speed_byte( struct connection_in * in ) ;
@@ -255,13 +262,14 @@ static void DS2480_setroutines(struct connection_in *in)
 	in->iroutines.sendback_data = DS2480_sendback_data;
     in->iroutines.sendback_bits = DS2480_sendback_bits;
 	in->iroutines.select = NO_SELECT_ROUTINE;
-	in->iroutines.select_and_sendback = NO_SELECTANDSENDBACK_ROUTINE;
+	in->iroutines.select_and_sendback = DS2480_select_and_sendback;
+	in->iroutines.select_and_power = DS2480_select_and_power;
 	in->iroutines.set_config = NO_SET_CONFIG_ROUTINE;
 	in->iroutines.get_config = NO_GET_CONFIG_ROUTINE;
 	in->iroutines.reconnect = DS2480_reconnect ;
 	in->iroutines.close = DS2480_close;
 	in->iroutines.verify = NO_VERIFY_ROUTINE ;
-	in->iroutines.flags = ADAP_FLAG_default;
+	in->iroutines.flags = ADAP_FLAG_bundle;
 	in->bundling_length = UART_FIFO_SIZE;
 }
 
@@ -750,6 +758,8 @@ static RESET_TYPE DS2480_reset(const struct parsedname *pn) {
 
 static RESET_TYPE DS2480_reset_in(struct connection_in * in)
 {
+	DS2480_pulse_end(in) ;
+
 	if ( in->changed_bus_settings != 0) {
 		in->changed_bus_settings = 0 ;
 		DS2480_set_baud_control(in);	// reset paramters
@@ -780,6 +790,7 @@ static RESET_TYPE DS2480_reset_once(struct connection_in * in)
 {
 	BYTE reset_byte = (BYTE) ( CMD_COMM | FUNCTSEL_RESET | DS2480b_speed_byte(in) );
 	BYTE reset_response ;
+	RESET_TYPE ret ;
 
 	// flush the buffers
 	DS2480_flush(in);
@@ -790,6 +801,16 @@ static RESET_TYPE DS2480_reset_once(struct connection_in * in)
 		return BUS_RESET_ERROR;
 	}
 
+	ret = DS2480_reset_response( reset_response, in ) ;
+	if ( ret == BUS_RESET_OK && in->AnyDevices == anydevices_yes ) {
+		DS2480_flush(in);
+	}
+	return ret ;
+}
+
+// Interpret the reset response byte (also from a bundled select)
+static RESET_TYPE DS2480_reset_response(BYTE reset_response, struct connection_in * in)
+{
 	/* The adapter type is encoded in this response byte */
 	/* The known values correspond to the types in enum adapter_type */
 	/* Other values are assigned for adapters that don't have this hardcoded value */
@@ -806,7 +827,6 @@ static RESET_TYPE DS2480_reset_once(struct connection_in * in)
 		in->AnyDevices = anydevices_yes ;
 		// check if programming voltage available
 		in->ProgramAvailable = ((reset_response & PARMSEL_12VPULSE) == PARMSEL_12VPULSE);
-		DS2480_flush(in);
 		return BUS_RESET_OK;
 	default:
 		return BUS_RESET_ERROR; // should never happen
@@ -933,28 +953,13 @@ static GOOD_OR_BAD DS2480_PowerByte(const BYTE byte, BYTE * resp, const UINT del
 {
 	GOOD_OR_BAD ret;
 	struct connection_in * in = pn->selected_connection ;
-	BYTE bits = CMD_COMM | FUNCTSEL_BIT | DS2480b_speed_byte(in) ;
-	BYTE cmd[] = {
-		// bit 1
-		((byte & 0x01) ? BITPOL_ONE : BITPOL_ZERO) | bits | PRIME5V_FALSE,
-		// bit 2
-		((byte & 0x02) ? BITPOL_ONE : BITPOL_ZERO) | bits | PRIME5V_FALSE,
-		// bit 3
-		((byte & 0x04) ? BITPOL_ONE : BITPOL_ZERO) | bits | PRIME5V_FALSE,
-		// bit 4
-		((byte & 0x08) ? BITPOL_ONE : BITPOL_ZERO) | bits | PRIME5V_FALSE,
-		// bit 5
-		((byte & 0x10) ? BITPOL_ONE : BITPOL_ZERO) | bits | PRIME5V_FALSE,
-		// bit 6
-		((byte & 0x20) ? BITPOL_ONE : BITPOL_ZERO) | bits | PRIME5V_FALSE,
-		// bit 7
-		((byte & 0x40) ? BITPOL_ONE : BITPOL_ZERO) | bits | PRIME5V_FALSE,
-		// bit 8
-		((byte & 0x80) ? BITPOL_ONE : BITPOL_ZERO) | bits | PRIME5V_TRUE,
-	};
+	BYTE cmd[8];
 	BYTE respbits[8];
 	BYTE response[1];
 
+	DS2480_pulse_end(in) ;
+	DS2480_power_bits(byte, cmd, in) ;
+
 	// flush the buffers
 	DS2480_flush(in);
 
@@ -967,7 +972,26 @@ static GOOD_OR_BAD DS2480_PowerByte(const BYTE byte, BYTE * resp, const UINT del
 	// return to normal level
 	DS2480_stop_pulse(response, in);
 
-	resp[0] = ((respbits[7] & 1) << 7)
+	resp[0] = DS2480_power_response(respbits) ;
+
+	return ret ;
+}
+
+// The 8 single bit commands for a byte, 5V pulse primed on the last bit
+static void DS2480_power_bits(BYTE byte, BYTE * cmd, struct connection_in * in)
+{
+	BYTE bits = CMD_COMM | FUNCTSEL_BIT | DS2480b_speed_byte(in) ;
+	int i ;
+
+	for ( i = 0 ; i < 8 ; ++i ) {
+		cmd[i] = ((byte & (1<<i)) ? BITPOL_ONE : BITPOL_ZERO) | bits | ( (i==7) ? PRIME5V_TRUE : PRIME5V_FALSE ) ;
+	}
+}
+
+// The byte read back from the 8 single bit responses
+static BYTE DS2480_power_response(const BYTE * respbits)
+{
+	return ((respbits[7] & 1) << 7)
 		| ((respbits[6] & 1) << 6)
 		| ((respbits[5] & 1) << 5)
 		| ((respbits[4] & 1) << 4)
@@ -975,8 +999,6 @@ static GOOD_OR_BAD DS2480_PowerByte(const BYTE byte, BYTE * resp, const UINT del
 		| ((respbits[2] & 1) << 2)
 		| ((respbits[1] & 1) << 1)
 		| ((respbits[0] & 1));
-
-	return ret ;
 }
 
 //--------------------------------------------------------------------------
@@ -998,6 +1020,8 @@ static GOOD_OR_BAD DS2480_PowerBit(const BYTE byte, BYTE * resp, const UINT dela
 	BYTE respbits[1];
 	BYTE response[1];
 
+	DS2480_pulse_end(in) ;
+
 	// flush the buffers
 	DS2480_flush(in);
 
@@ -1028,6 +1052,8 @@ static GOOD_OR_BAD DS2480_sendback_bits(const BYTE * databits, BYTE * respbits,
 	BYTE bits = CMD_COMM | FUNCTSEL_BIT | DS2480b_speed_byte(in) | PRIME5V_FALSE;
 	size_t counter ;
 
+	DS2480_pulse_end(in) ;
+
 	for ( counter=0 ; counter < len ; ++counter ) {
 		BYTE cmd[] = { ((databits[counter] & 0x01) ? BITPOL_ONE : BITPOL_ZERO) | bits, };
 
@@ -1055,6 +1081,17 @@ static GOOD_OR_BAD DS2480_stop_pulse(BYTE * response, struct connection_in * in)
 	return DS2480_sendback_cmd(cmd, response, 1, in);
 }
 
+// A bundled power byte leaves the strong pull-up on (for the delay after it)
+// Stop it before anything else goes on the bus
+static void DS2480_pulse_end(struct connection_in * in)
+{
+	if ( in->master.serial.pulse ) {
+		BYTE response[1] ;
+		in->master.serial.pulse = 0 ;
+		DS2480_stop_pulse(response, in) ;
+	}
+}
+
 /* Send a 12v 480usec pulse on the 1wire bus to program the EPROM */
 // returns 0 if good
 static GOOD_OR_BAD DS2480_ProgramPulse(const struct parsedname *pn)
@@ -1066,6 +1103,7 @@ static GOOD_OR_BAD DS2480_ProgramPulse(const struct parsedname *pn)
 	BYTE command_resp[1];
 	BYTE stop_pulse[1] ;
 
+	DS2480_pulse_end(in) ;
 	DS2480_flush(in);
 
 	// send the packet
@@ -1178,6 +1216,8 @@ static GOOD_OR_BAD DS2480_sendback_data(const BYTE * data, BYTE * resp, const si
 		return gbGOOD ;
 	}
 
+	DS2480_pulse_end(in) ;
+
 	// switch mode if needed
 	if (in->master.serial.mode != ds2480b_data_mode) {
 		// this is one of the "reserved commands" that does not generate a resonse byte
@@ -1214,6 +1254,194 @@ static GOOD_OR_BAD DS2480_sendback_data(const BYTE * data, BYTE * resp, const si
 	return gbGOOD ;
 }
 
+/* Bundled transactions
+ * The reset, match ROM, data bytes and an optional powered last byte are
+ * queued as one command stream (mode switches included) and go to the
+ * DS2480B in a single write, all responses come back in a single read.
+ * Longer streams are still cut at MAX_SEND_SIZE.
+ */
+struct ds2480_stream {
+	struct connection_in * in ;
+	BYTE out[MAX_SEND_SIZE] ;
+	size_t out_length ;
+	BYTE * response ;			// room for every response byte
+	size_t responses ;			// expected so far
+	size_t responses_read ;
+} ;
+
+// write what is queued and read back its responses
+static GOOD_OR_BAD DS2480_stream_flush(struct ds2480_stream * stream)
+{
+	if ( stream->out_length > 0 ) {
+		RETURN_BAD_IF_BAD( DS2480_write(stream->out, stream->out_length, stream->in) ) ;
+		stream->out_length = 0 ;
+	}
+	if ( stream->responses > stream->responses_read ) {
+		RETURN_BAD_IF_BAD( DS2480_read(&stream->response[stream->responses_read], stream->responses - stream->responses_read, stream->in) ) ;
+		stream->responses_read = stream->responses ;
+	}
+	return gbGOOD ;
+}
+
+// command mode byte, with or without a response
+static GOOD_OR_BAD DS2480_stream_command(BYTE cmd, int responds, struct ds2480_stream * stream)
+{
+	// room for a mode switch and the command
+	if ( stream->out_length + 2 > MAX_SEND_SIZE ) {
+		RETURN_BAD_IF_BAD( DS2480_stream_flush(stream) ) ;
+	}
+	if ( stream->in->master.serial.mode != ds2480b_command_mode ) {
+		// no response for the mode switch
+		stream->out[stream->out_length++] = MODE_COMMAND ;
+		stream->in->master.serial.mode = ds2480b_command_mode ;
+	}
+	stream->out[stream->out_length++] = cmd ;
+	if ( responds ) {
+		++stream->responses ;
+	}
+	return gbGOOD ;
+}
+
+// data mode byte, read back from the 1-wire bus
+static GOOD_OR_BAD DS2480_stream_data(BYTE data, struct ds2480_stream * stream)
+{
+	// room for a mode switch and a doubled byte
+	if ( stream->out_length + 3 > MAX_SEND_SIZE ) {
+		RETURN_BAD_IF_BAD( DS2480_stream_flush(stream) ) ;
+	}
+	if ( stream->in->master.serial.mode != ds2480b_data_mode ) {
+		// no response for the mode switch
+		stream->out[stream->out_length++] = MODE_DATA ;
+		stream->in->master.serial.mode = ds2480b_data_mode ;
+	}
+	stream->out[stream->out_length++] = data ;
+	if ( data == MODE_COMMAND ) {
+		stream->out[stream->out_length++] = data ;
+	}
+	++stream->responses ;
+	return gbGOOD ;
+}
+
+// Just a plain match ROM from a cleared root branch? Otherwise use BUS_select
+static int DS2480_select_bundles(const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+
+	if ( Globals.one_device || !RootNotBranch(pn) || in->branch.branch != eBranch_cleared ) {
+		return 0 ;
+	}
+	if ( (pn->selected_device == NO_DEVICE) || (pn->selected_device == DeviceThermostat) ) {
+		return 0 ;
+	}
+	// baud change pending, or DS2404 reset quirks
+	if ( in->changed_bus_settings != 0 || in->ds2404_found ) {
+		return 0 ;
+	}
+	return 1 ;
+}
+
+static GOOD_OR_BAD DS2480_select_stream(const BYTE * data, BYTE * resp, const size_t len, int power, const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+	int bundled = DS2480_select_bundles(pn) ;
+	size_t data_length = power ? len - 1 : len ;
+	// pulse stop, reset, match ROM, data, power bits
+	BYTE response[1 + 1 + 1 + SERIAL_NUMBER_SIZE + len + 8] ;
+	BYTE select[1 + SERIAL_NUMBER_SIZE] ;
+	BYTE power_cmd[8] ;
+	size_t reset_index = 0 ;
+	size_t select_index = 0 ;
+	size_t data_index ;
+	size_t i ;
+	struct ds2480_stream stream = {
+		.in = in,
+		.out_length = 0,
+		.response = response,
+		.responses = 0,
+		.responses_read = 0,
+	} ;
+
+	if ( power && len == 0 ) {
+		return gbBAD ;
+	}
+
+	if ( ! bundled ) {
+		// branches and such the usual way, just the data is streamed
+		RETURN_BAD_IF_BAD( BUS_select(pn) ) ;
+	}
+
+	DS2480_flush(in);
+
+	if ( in->master.serial.pulse ) {
+		in->master.serial.pulse = 0 ;
+		RETURN_BAD_IF_BAD( DS2480_stream_command( MODE_STOP_PULSE, 1, &stream ) ) ;
+	}
+
+	if ( bundled ) {
+		reset_index = stream.responses ;
+		RETURN_BAD_IF_BAD( DS2480_stream_command( (BYTE) ( CMD_COMM | FUNCTSEL_RESET | DS2480b_speed_byte(in) ), 1, &stream ) ) ;
+		select_index = stream.responses ;
+		select[0] = in->overdrive ? _1W_OVERDRIVE_MATCH_ROM : _1W_MATCH_ROM ;
+		memcpy( &select[1], pn->sn, SERIAL_NUMBER_SIZE ) ;
+		for ( i = 0 ; i < 1 + SERIAL_NUMBER_SIZE ; ++i ) {
+			RETURN_BAD_IF_BAD( DS2480_stream_data( select[i], &stream ) ) ;
+		}
+	}
+
+	data_index = stream.responses ;
+	for ( i = 0 ; i < data_length ; ++i ) {
+		RETURN_BAD_IF_BAD( DS2480_stream_data( data[i], &stream ) ) ;
+	}
+
+	if ( power ) {
+		DS2480_power_bits( data[data_length], power_cmd, in ) ;
+		for ( i = 0 ; i < 8 ; ++i ) {
+			RETURN_BAD_IF_BAD( DS2480_stream_command( power_cmd[i], 1, &stream ) ) ;
+		}
+	}
+
+	if ( BAD( DS2480_stream_flush( &stream ) ) ) {
+		if ( bundled ) {
+			BUS_reset_bundled( BUS_RESET_ERROR, pn ) ;
+		}
+		return gbBAD ;
+	}
+
+	if ( power ) {
+		// on until the next command
+		in->master.serial.pulse = 1 ;
+	}
+
+	if ( bundled ) {
+		if ( BUS_reset_bundled( DS2480_reset_response( response[reset_index], in ), pn ) != BUS_RESET_OK ) {
+			return gbBAD ;
+		}
+		if ( memcmp( select, &response[select_index], 1 + SERIAL_NUMBER_SIZE ) != 0 ) {
+			STAT_ADD1_BUS(e_bus_select_errors, in);
+			LEVEL_CONNECT("Select error for %s on bus %s", pn->selected_device->readable_name, DEVICENAME(in));
+			return gbBAD ;
+		}
+	}
+
+	memcpy( resp, &response[data_index], data_length ) ;
+	if ( power ) {
+		resp[data_length] = DS2480_power_response( &response[data_index + data_length] ) ;
+	}
+	return gbGOOD ;
+}
+
+// select (reset and match ROM) and data in one write
+static GOOD_OR_BAD DS2480_select_and_sendback(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn)
+{
+	return DS2480_select_stream(data, resp, len, 0, pn) ;
+}
+
+// same, the last byte sent as single bits with the strong pull-up primed
+static GOOD_OR_BAD DS2480_select_and_power(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn)
+{
+	return DS2480_select_stream(data, resp, len, 1, pn) ;
+}
+
 static void DS2480_close(struct connection_in *in)
 {
 	// the standard COM_free cleans up the connection
@@ -70,6 +70,7 @@ static void DS9490_setroutines(struct connection_in *in)
 	in->iroutines.sendback_bits = NO_SENDBACKBITS_ROUTINE;
 	in->iroutines.select = NO_SELECT_ROUTINE;
 	in->iroutines.select_and_sendback = NO_SELECTANDSENDBACK_ROUTINE;
+	in->iroutines.select_and_power = NO_SELECTANDPOWER_ROUTINE;
 	in->iroutines.set_config = NO_SET_CONFIG_ROUTINE;
 	in->iroutines.get_config = NO_GET_CONFIG_ROUTINE;
 	in->iroutines.reconnect = DS9490_reconnect;
@@ -852,11 +853,22 @@ static GOOD_OR_BAD DS9490_open_and_name( libusb_device * dev, struct connection_
 
 static GOOD_OR_BAD DS9490_sendback_data(const BYTE * const_data, BYTE * resp, size_t len, const struct parsedname *pn)
 {
-	size_t location = 0 ;
 	BYTE data[len] ; // to avoid const problem
 
 	memcpy( data, const_data, len ) ;
 
+	if ( Globals.usb_async ) {
+		// COMM_BLOCK_IO | COMM_IM | COMM_F == 0x0075
+		return DS9490_sendback_async( data, resp, len, COMM_BLOCK_IO | COMM_IM | COMM_F, pn ) ;
+	}
+	return DS9490_sendback_sync( data, resp, len, pn ) ;
+}
+
+/* One USB_FIFO_EACH block at a time: write, start, poll status until done, read */
+GOOD_OR_BAD DS9490_sendback_sync(BYTE * data, BYTE * resp, size_t len, const struct parsedname *pn)
+{
+	size_t location = 0 ;
+
 	while ( location < len ) {
 		BYTE buffer[ DS9490_getstatus_BUFFER_LENGTH + 1 ];
 		int readlen ;
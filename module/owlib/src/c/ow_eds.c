@@ -297,16 +297,16 @@ static struct bitfield eds0090_led_function  = 	{ "EDS0090/relay_function", 2, 2
 
 /* ------- Structures ----------- */
 
-static struct aggregate AEDS = { _EDS_PAGES, ag_numbers, ag_separate, };
-static struct aggregate AEDS_8X = { _EDS_8X_PAGES, ag_numbers, ag_separate, };
-static struct aggregate AEDS_82_data = { 8, ag_numbers, ag_separate, }; // 8 voltages
-static struct aggregate AEDS_82_limit = { 8*2, ag_numbers, ag_separate, }; // 8 voltages hi/lo
-static struct aggregate AEDS_82_state = { 8, ag_numbers, ag_aggregate, }; // 8 states
-static struct aggregate AEDS_85_data = { 4, ag_numbers, ag_separate, }; // 4 voltages
-static struct aggregate AEDS_85_limit = { 4*2, ag_numbers, ag_separate, }; // 4 voltages hi/lo
-static struct aggregate AEDS_85_state = { 4, ag_numbers, ag_aggregate, }; // 4 states
-static struct aggregate AEDS_90_state = { 8, ag_numbers, ag_aggregate, }; // 8 bits
-static struct aggregate AEDS_90_inputs = { 8, ag_numbers, ag_separate, }; // 8 inputs
+static struct aggregate AEDS = { _EDS_PAGES, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate AEDS_8X = { _EDS_8X_PAGES, ag_numbers, ag_separate, NO_BULK_READ, };
+static struct aggregate AEDS_82_data = { 8, ag_numbers, ag_separate, NO_BULK_READ, }; // 8 voltages
+static struct aggregate AEDS_82_limit = { 8*2, ag_numbers, ag_separate, NO_BULK_READ, }; // 8 voltages hi/lo
+static struct aggregate AEDS_82_state = { 8, ag_numbers, ag_aggregate, NO_BULK_READ, }; // 8 states
+static struct aggregate AEDS_85_data = { 4, ag_numbers, ag_separate, NO_BULK_READ, }; // 4 voltages
+static struct aggregate AEDS_85_limit = { 4*2, ag_numbers, ag_separate, NO_BULK_READ, }; // 4 voltages hi/lo
+static struct aggregate AEDS_85_state = { 4, ag_numbers, ag_aggregate, NO_BULK_READ, }; // 4 states
+static struct aggregate AEDS_90_state = { 8, ag_numbers, ag_aggregate, NO_BULK_READ, }; // 8 bits
+static struct aggregate AEDS_90_inputs = { 8, ag_numbers, ag_separate, NO_BULK_READ, }; // 8 inputs
 static struct filetype EDS[] = {
 	F_STANDARD,
 	{"memory", _EDS_PAGES * _EDS_PAGESIZE, NON_AGGREGATE, ft_binary, fc_link, FS_r_mem, FS_w_mem, VISIBLE, NO_FILETYPE_DATA, },
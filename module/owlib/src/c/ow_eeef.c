@@ -286,9 +286,9 @@ static struct filetype HobbyBoards_EE[] = {
 
 DeviceEntry(EE, HobbyBoards_EE, NO_GENERIC_READ, NO_GENERIC_WRITE);
 
-static struct aggregate AMOIST = { 4, ag_numbers, ag_aggregate, };
-static struct aggregate AHUB = { 4, ag_numbers, ag_aggregate, };
-static struct aggregate ATMP = { 6, ag_numbers, ag_aggregate, };
+static struct aggregate AMOIST = { 4, ag_numbers, ag_aggregate, NO_BULK_READ, };
+static struct aggregate AHUB = { 4, ag_numbers, ag_aggregate, NO_BULK_READ, };
+static struct aggregate ATMP = { 6, ag_numbers, ag_aggregate, NO_BULK_READ, };
 static struct filetype HobbyBoards_EF[] = {
 	F_STANDARD_NO_TYPE,
 	{"version", _EEEF_version_length, NON_AGGREGATE, ft_ascii, fc_link, FS_version, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
@@ -118,9 +118,9 @@ READ_FUNCTION(FS_r_extension_characters);
  *              An example could be a baud rate or parity setting.
  *              Clearly there is no "ALL" since the range of the extension is essentially unknown and unlimitted.
  */
-static struct aggregate AExample_bits = { 8, ag_numbers, ag_aggregate, };
-static struct aggregate AExample_prime = { 0, ag_numbers, ag_sparse, };
-static struct aggregate AExample_chars = { 0, ag_letters, ag_sparse, };
+static struct aggregate AExample_bits = { 8, ag_numbers, ag_aggregate, NO_BULK_READ, };
+static struct aggregate AExample_prime = { 0, ag_numbers, ag_sparse, NO_BULK_READ, };
+static struct aggregate AExample_chars = { 0, ag_letters, ag_sparse, NO_BULK_READ, };
 static struct filetype Example_slave[] = {
 	F_STANDARD,
 	{"read_number", PROPERTY_LENGTH_INTEGER, NON_AGGREGATE, ft_integer, fc_stable, FS_r_read_number, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
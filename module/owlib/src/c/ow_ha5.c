@@ -56,6 +56,7 @@ static void HA5_setroutines(struct connection_in *in)
 	in->iroutines.sendback_bits = HA5_sendback_bits;
 	in->iroutines.select = HA5_select ;
 	in->iroutines.select_and_sendback = HA5_select_and_sendback;
+	in->iroutines.select_and_power = NO_SELECTANDPOWER_ROUTINE;
 	in->iroutines.set_config = NO_SET_CONFIG_ROUTINE;
 	in->iroutines.get_config = NO_GET_CONFIG_ROUTINE;
 	in->iroutines.reconnect = HA5_reconnect;
@@ -40,6 +40,7 @@ static void HA7E_setroutines(struct connection_in *in)
     in->iroutines.sendback_bits = NO_SENDBACKBITS_ROUTINE;
 	in->iroutines.select = HA7E_select ;
 	in->iroutines.select_and_sendback = NO_SELECTANDSENDBACK_ROUTINE ;
+	in->iroutines.select_and_power = NO_SELECTANDPOWER_ROUTINE ;
 	in->iroutines.set_config = NO_SET_CONFIG_ROUTINE;
 	in->iroutines.get_config = NO_GET_CONFIG_ROUTINE;
 	in->iroutines.reconnect = NO_RECONNECT_ROUTINE;
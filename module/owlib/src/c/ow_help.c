@@ -113,7 +113,10 @@ void ow_help_cache(void)
 	" Caching (temporary storage of data in program memory for efficiency)\n"
 	"  --uncached          Implicit /uncached in all requests\n"
 	"  --cached            Explicit /uncached needed. (Default action)\n"
-	"  --cache_size n   Size in bytes of max cache memory. 0 for no limit.\n"
+	"  --cache_size n   Max cache memory in bytes, cold entries evicted. 0 for no limit.\n"
+	"  --cache_shards n Independently locked cache partitions (power of 2, max 64). Default 1\n"
+	"  --cache_timer_wheel Expire cache entries one at a time instead of in whole generations\n"
+	"  --parse_cache n  Parsed paths kept for reuse. 0 for none. Default 256\n"
 	"\n"
 	" Cache timing         [default] (in seconds)\n"
 	"  --timeout_volatile  [%3d] Expiration time for changing data (e.g. temperature)\n"
@@ -129,6 +132,11 @@ void ow_help_cache(void)
 	"  --timeout_ftp       [%3d] Timeout for FTP session\n"
 	"  --timeout_ha7       [%3d] Timeout for HA7Net bus master\n"
 	"  --timeout_w1        [%3d] Timeout for w1 kernel netlink\n"
+	"  --convert_hold      Keep the bus during powered temperature conversions\n"
+	"  --no_coalesce       Convert each temperature sensor alone, not the whole bus\n"
+	" \n"
+	" Connections to a remote owserver\n"
+	"  --server_connections [%2d] Idle persistent connections kept for reuse\n"
 	, Globals.timeout_volatile
 	, Globals.timeout_stable
 	, Globals.timeout_directory
@@ -140,6 +148,7 @@ void ow_help_cache(void)
 	, Globals.timeout_ftp
 	, Globals.timeout_ha7
 	, Globals.timeout_w1
+	, Globals.server_connections
 		   );
 }
 
@@ -170,12 +179,14 @@ void ow_help_program(void)
 	"\n"
 	" owserver (OWFS server)\n"
 	"  -p --port [ip:]port   TCP address and port number for access\n"
+	"  --server_workers n    Event loop with n worker threads (also owhttpd). Default 0: thread per connection\n"
 	"\n"
 	" Development tests (owserver only)\n"
 	"  --pingcrazy      Add lots of keep-alive messages to the owserver protocol\n"
 	"  --no_dirall      DIRALL fails, drops back to older DIR (individual entries)\n"
 	"  --no_get         GET fails, drops back to DIRALL and READ\n"
 	"  --no_persistence persistent connections refused, drops back to non-persistent\n"
+	"  --no_pipeline    pipelined requests refused, one request at a time per connection\n"
 	"\n"
 	" owftpd (ftp server)\n"
 	"  -p --port [ip:]port   TCP address and port number for access\n"
@@ -225,6 +236,7 @@ void ow_help_device(void)
 	"  --masterhub=/dev/ttyUSB0 Link-USB\n"
 	"  --altUSB        Change some settings for DS9490 bus master (especially for AAG and DS2423)\n"
 	"  --usb_flextime | --usb_regulartime     Needed for Louis Swart's LCD module\n"
+	"  --usb_async     DS9490 block transfers queued ahead, completion from the status endpoint\n"
 	"\n"
 	" Network (address is form [ip:]port, ip DNS name or n.n.n.n, port is port number)\n"
 	"  -s address      owserver\n"
@@ -247,6 +259,7 @@ void ow_help_device(void)
 	"\n"
 	" Linux Kernel Device\n"
 	"  --w1            Scan for kernel-managed bus masters\n"
+	"  --w1_multiplex  Several netlink requests in flight, replies matched by sequence\n"
 	"\n" 
 	" Synthesized (FPGA) based device\n"
 	"  --DS1WM address Synthesizable 1-Wire BusMaster (address is base register location)\n"
@@ -223,7 +223,8 @@ struct device d_interface_settings = {
 	COUNT_OF_FILETYPES(interface_settings), 
 	interface_settings,
 	NO_GENERIC_READ,
-	NO_GENERIC_WRITE
+	NO_GENERIC_WRITE,
+	NO_DEVICE_DIRECTORY
 };
 
 static struct filetype interface_statistics[] = {
@@ -265,7 +266,8 @@ struct device d_interface_statistics = {
 	COUNT_OF_FILETYPES(interface_statistics), 
 	interface_statistics,
 	NO_GENERIC_READ,
-	NO_GENERIC_WRITE
+	NO_GENERIC_WRITE,
+	NO_DEVICE_DIRECTORY
 };
 
 
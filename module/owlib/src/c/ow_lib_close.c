@@ -23,7 +23,9 @@ void LibClose(void)
 	PIDstop();
 	DeviceDestroy();
 	Detail_Close() ;
+	ParseCache_Close() ;
 	ArgFree() ;
+	Pool_Close() ;
 
 	_MUTEX_ATTR_DESTROY(Mutex.mattr);
 
@@ -26,6 +26,7 @@ void LibSetup(enum enum_program_type program_type)
 
 	Globals.program_type = program_type;
 
+	Pool_Open();
 	Cache_Open();
 	Detail_Init();
 
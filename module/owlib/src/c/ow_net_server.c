@@ -18,6 +18,10 @@
 #include "ow_counters.h"
 #include "ow_connection.h"
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif							/* HAVE_SYS_EPOLL_H */
+
 /* Locking for thread work */
 /* Variables only used in this particular file */
 /* i.e. "locally global" */
@@ -27,6 +31,10 @@ int handler_thread_count ;
 int shutdown_in_progress ;
 FILE_DESCRIPTOR_OR_ERROR shutdown_pipe[2] ;
 
+/* Event loop per-request handling, see ServerRequestRoutines */
+static GOOD_OR_BAD (*server_request_routine) (FILE_DESCRIPTOR_OR_ERROR file_descriptor, void ** state) = NULL ;
+static void (*server_release_routine) (void * state) = NULL ;
+
 
 /* Prototypes */
 static GOOD_OR_BAD ServerAddr(const char * default_port, struct connection_out *out);
@@ -39,6 +47,10 @@ static void ProcessListenSocket( struct connection_out * out ) ;
 static void *ProcessAcceptSocket(void *arg) ;
 static void ProcessListenSet( fd_set * listenset ) ;
 static GOOD_OR_BAD ListenCycle( void ) ;
+static void LatencyAdd( struct latency * lat, const struct timeval * start, const struct timeval * end ) ;
+#ifdef HAVE_SYS_EPOLL_H
+static GOOD_OR_BAD EventLoop( void ) ;
+#endif							/* HAVE_SYS_EPOLL_H */
 
 static GOOD_OR_BAD ServerAddr(const char * default_port, struct connection_out *out)
 {
@@ -196,6 +208,8 @@ static GOOD_OR_BAD SetupListenSockets( void (*HandlerRoutine) (FILE_DESCRIPTOR_O
 			ZeroConf_Announce(out);
 		}
 		out-> HandlerRoutine = HandlerRoutine ;
+		out-> RequestRoutine = server_request_routine ;
+		out-> ReleaseRoutine = server_release_routine ;
 	}
 	return any_sockets ;
 }
@@ -313,6 +327,490 @@ static void ProcessListenSocket( struct connection_out * out )
 	// asd does not leak; it is passed to ProcessAcceptSocket in another thread.
 }
 
+/* Fold one stage duration into its latency counter */
+static void LatencyAdd( struct latency * lat, const struct timeval * start, const struct timeval * end )
+{
+	struct timeval delta ;
+
+	timersub( end, start, &delta ) ;
+	STATLOCK ;
+	++lat->count ;
+	timeradd( &lat->total, &delta, &lat->total ) ;
+	if ( timercmp( &delta, &lat->max, > ) ) {
+		timercpy( &lat->max, &delta ) ;
+	}
+	STATUNLOCK ;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/* Event loop alternative (--server_workers n)
+ * One thread waits on all listen and client sockets with epoll.
+ * A connection is handed to a fixed pool of worker threads once the client
+ * has actually sent something, so no thread is created per connection
+ * and a silent client never holds a worker.
+ * With a RequestRoutine the worker answers what has arrived and the
+ * connection goes back to the loop to wait for the next request.
+ * When the queue is full, ready connections wait on a deferred list and
+ * the listen sockets are paused -- the loop itself never blocks.
+ * */
+
+#define SERVER_EVENTS              32
+#define SERVER_QUEUE_PER_WORKER    4
+#define SERVER_TICK_MS             1000
+#define SERVER_DEFER_MS            10
+
+struct server_job {
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor ;
+	struct connection_out * out ;
+	int listening ; // listen socket rather than a client
+	int requests ; // requests answered on this connection
+	void * state ; // kept for the RequestRoutine between requests
+	struct timeval tv_accept ; // connection accepted or last request answered
+	struct timeval tv_ready ; // request waiting, queued for a worker
+	struct server_job * next ;
+	struct server_job * prev ;
+} ;
+
+static struct {
+	FILE_DESCRIPTOR_OR_ERROR epoll_fd ;
+	struct server_job * listeners ; // event loop only
+	struct server_job * waiting ; // watched for a request
+	struct server_job * deferred_head ; // request waiting, queue full (event loop only)
+	struct server_job * deferred_tail ;
+	int listen_paused ;
+	struct server_job * queue_head ;
+	struct server_job * queue_tail ;
+	int queued ;
+	int queue_max ;
+	int stop ;
+	int workers ;
+	pthread_t * worker_thread ;
+	pthread_mutex_t mutex ; // queue and waiting list
+	pthread_cond_t work ; // queue not empty (or stop)
+} server_pool ;
+
+static void WaitingAdd( struct server_job * job ) ;
+static void WaitingRemove( struct server_job * job ) ;
+static GOOD_OR_BAD EventWatch( struct server_job * job, int operation ) ;
+
+/* Done with a client connection */
+static void JobClose( struct server_job * job )
+{
+	if ( job->state != NULL && job->out->ReleaseRoutine != NULL ) {
+		job->out->ReleaseRoutine( job->state ) ;
+	}
+	epoll_ctl( server_pool.epoll_fd, EPOLL_CTL_DEL, job->file_descriptor, NULL ) ;
+	Test_and_Close( &(job->file_descriptor) ) ;
+	owfree( job ) ;
+}
+
+/* Request answered, connection kept -- back to the loop for the next one */
+static void JobRewatch( struct server_job * job )
+{
+	GOOD_OR_BAD watched ;
+
+	++job->requests ;
+	gettimeofday( &(job->tv_accept), NULL ) ;
+	// on the list before it is armed, the loop may see it at once
+	_MUTEX_LOCK( server_pool.mutex ) ;
+	WaitingAdd( job ) ;
+	watched = EventWatch( job, EPOLL_CTL_MOD ) ;
+	if ( BAD( watched ) ) {
+		WaitingRemove( job ) ;
+	}
+	_MUTEX_UNLOCK( server_pool.mutex ) ;
+	if ( BAD( watched ) ) {
+		JobClose( job ) ;
+	}
+}
+
+static void *ServerWorker( void * v )
+{
+	(void) v ;
+	while (1) {
+		struct server_job * job ;
+		struct timeval tv_start, tv_end ;
+		int keep = 0 ;
+
+		_MUTEX_LOCK( server_pool.mutex ) ;
+		while ( server_pool.queue_head == NULL && ! server_pool.stop ) {
+			my_pthread_cond_wait( &server_pool.work, &server_pool.mutex ) ;
+		}
+		job = server_pool.queue_head ;
+		if ( job == NULL ) {
+			// stopped and drained
+			_MUTEX_UNLOCK( server_pool.mutex ) ;
+			break ;
+		}
+		server_pool.queue_head = job->next ;
+		if ( server_pool.queue_head == NULL ) {
+			server_pool.queue_tail = NULL ;
+		}
+		--server_pool.queued ;
+		_MUTEX_UNLOCK( server_pool.mutex ) ;
+
+		gettimeofday( &tv_start, NULL ) ;
+		LatencyAdd( &server_queue_latency, &job->tv_ready, &tv_start ) ;
+
+		// Do the actual work
+		if ( job->out->RequestRoutine != NULL ) {
+			keep = GOOD( job->out->RequestRoutine( job->file_descriptor, &(job->state) ) ) ;
+		} else {
+			job->out->HandlerRoutine( job->file_descriptor ) ;
+		}
+
+		gettimeofday( &tv_end, NULL ) ;
+		LatencyAdd( &server_handler_latency, &tv_start, &tv_end ) ;
+
+		if ( keep ) {
+			JobRewatch( job ) ;
+		} else {
+			JobClose( job ) ;
+		}
+	}
+	return VOID_RETURN ;
+}
+
+/* Queue a connection for the workers, gbBAD if the queue is full */
+static GOOD_OR_BAD ServerQueue( struct server_job * job )
+{
+	_MUTEX_LOCK( server_pool.mutex ) ;
+	if ( server_pool.queued >= server_pool.queue_max ) {
+		_MUTEX_UNLOCK( server_pool.mutex ) ;
+		return gbBAD ;
+	}
+	job->next = NULL ;
+	if ( server_pool.queue_tail == NULL ) {
+		server_pool.queue_head = job ;
+	} else {
+		server_pool.queue_tail->next = job ;
+	}
+	server_pool.queue_tail = job ;
+	++server_pool.queued ;
+	my_pthread_cond_signal( &server_pool.work ) ;
+	_MUTEX_UNLOCK( server_pool.mutex ) ;
+	return gbGOOD ;
+}
+
+/* The waiting list is shared with the workers, hold the mutex */
+static void WaitingAdd( struct server_job * job )
+{
+	job->prev = NULL ;
+	job->next = server_pool.waiting ;
+	if ( job->next != NULL ) {
+		job->next->prev = job ;
+	}
+	server_pool.waiting = job ;
+}
+
+static void WaitingRemove( struct server_job * job )
+{
+	if ( job->prev == NULL ) {
+		server_pool.waiting = job->next ;
+	} else {
+		job->prev->next = job->next ;
+	}
+	if ( job->next != NULL ) {
+		job->next->prev = job->prev ;
+	}
+}
+
+/* Clients are armed for one event at a time, a worker re-arms after each request */
+static GOOD_OR_BAD EventWatch( struct server_job * job, int operation )
+{
+	struct epoll_event ev ;
+
+	memset( &ev, 0, sizeof(struct epoll_event) ) ;
+	ev.events = job->listening ? EPOLLIN : ( EPOLLIN | EPOLLONESHOT ) ;
+	ev.data.ptr = job ;
+	if ( epoll_ctl( server_pool.epoll_fd, operation, job->file_descriptor, &ev ) != 0 ) {
+		ERROR_CONNECT("Cannot watch socket %d", job->file_descriptor ) ;
+		return gbBAD ;
+	}
+	return gbGOOD ;
+}
+
+/* Stop (or resume) accepting while requests wait for room in the queue.
+ * New connections stay in the listen backlog meanwhile. */
+static void ListenPause( int pause )
+{
+	struct server_job * job ;
+
+	if ( pause == server_pool.listen_paused ) {
+		return ;
+	}
+	server_pool.listen_paused = pause ;
+	for ( job = server_pool.listeners ; job != NULL ; job = job->next ) {
+		struct epoll_event ev ;
+		memset( &ev, 0, sizeof(struct epoll_event) ) ;
+		ev.events = pause ? 0 : EPOLLIN ;
+		ev.data.ptr = job ;
+		epoll_ctl( server_pool.epoll_fd, EPOLL_CTL_MOD, job->file_descriptor, &ev ) ;
+	}
+}
+
+static void EventAccept( struct server_job * listen_job )
+{
+	struct server_job * job ;
+	FILE_DESCRIPTOR_OR_ERROR acceptfd = accept( listen_job->file_descriptor, NULL, NULL ) ;
+
+	if ( FILE_DESCRIPTOR_NOT_VALID( acceptfd ) ) {
+		STAT_ADD1( NET_accept_errors ) ;
+		return ;
+	}
+
+	job = owmalloc( sizeof(struct server_job) ) ;
+	if ( job == NULL ) {
+		LEVEL_DEBUG("Could not allocate memory to handle this request");
+		close( acceptfd ) ;
+		return ;
+	}
+	memset( job, 0, sizeof(struct server_job) ) ;
+	job->file_descriptor = acceptfd ;
+	job->out = listen_job->out ;
+	gettimeofday( &(job->tv_accept), NULL ) ;
+
+	_MUTEX_LOCK( server_pool.mutex ) ;
+	WaitingAdd( job ) ;
+	if ( BAD( EventWatch( job, EPOLL_CTL_ADD ) ) ) {
+		WaitingRemove( job ) ;
+		_MUTEX_UNLOCK( server_pool.mutex ) ;
+		Test_and_Close( &(job->file_descriptor) ) ;
+		owfree( job ) ;
+		return ;
+	}
+	_MUTEX_UNLOCK( server_pool.mutex ) ;
+}
+
+static void DeferredAdd( struct server_job * job )
+{
+	STAT_ADD1( server_deferred ) ;
+	job->next = NULL ;
+	if ( server_pool.deferred_tail == NULL ) {
+		server_pool.deferred_head = job ;
+	} else {
+		server_pool.deferred_tail->next = job ;
+	}
+	server_pool.deferred_tail = job ;
+}
+
+/* Move what was deferred to the queue, oldest first, as far as there is room */
+static void EventDeferred( void )
+{
+	while ( server_pool.deferred_head != NULL ) {
+		struct server_job * job = server_pool.deferred_head ;
+		struct server_job * next = job->next ;
+		if ( BAD( ServerQueue( job ) ) ) {
+			break ;
+		}
+		server_pool.deferred_head = next ;
+		if ( next == NULL ) {
+			server_pool.deferred_tail = NULL ;
+		}
+	}
+	ListenPause( server_pool.deferred_head != NULL ) ;
+}
+
+/* Client has sent its request -- off to a worker */
+static void EventReady( struct server_job * job )
+{
+	// the event disarmed it (EPOLLONESHOT), it stays registered
+	_MUTEX_LOCK( server_pool.mutex ) ;
+	WaitingRemove( job ) ;
+	_MUTEX_UNLOCK( server_pool.mutex ) ;
+	gettimeofday( &(job->tv_ready), NULL ) ;
+	if ( job->requests == 0 ) {
+		LatencyAdd( &server_accept_latency, &job->tv_accept, &job->tv_ready ) ;
+	}
+	// keep the order, nothing jumps ahead of deferred requests
+	if ( server_pool.deferred_head != NULL || BAD( ServerQueue( job ) ) ) {
+		DeferredAdd( job ) ;
+	}
+}
+
+/* Drop idle connections: no first request within timeout_server,
+ * or nothing more on a kept connection within timeout_persistent_high
+ * (waiting costs no thread here, so the lower limit doesn't apply) */
+static void EventExpire( void )
+{
+	struct timeval now ;
+	struct server_job * job ;
+	struct server_job * expired = NULL ;
+
+	gettimeofday( &now, NULL ) ;
+	_MUTEX_LOCK( server_pool.mutex ) ;
+	job = server_pool.waiting ;
+	while ( job != NULL ) {
+		struct server_job * next = job->next ;
+		int timeout = ( job->requests > 0 ) ? Globals.timeout_persistent_high : Globals.timeout_server ;
+		if ( now.tv_sec - job->tv_accept.tv_sec > timeout ) {
+			WaitingRemove( job ) ;
+			job->next = expired ;
+			expired = job ;
+		}
+		job = next ;
+	}
+	_MUTEX_UNLOCK( server_pool.mutex ) ;
+
+	while ( expired != NULL ) {
+		job = expired ;
+		expired = job->next ;
+		LEVEL_DEBUG("Idle connection dropped");
+		JobClose( job ) ;
+	}
+}
+
+static GOOD_OR_BAD EventLoopSetup( void )
+{
+	struct connection_out * out ;
+	int worker ;
+
+	memset( &server_pool, 0, sizeof(server_pool) ) ;
+	_MUTEX_INIT( server_pool.mutex ) ;
+	my_pthread_cond_init( &server_pool.work, NULL ) ;
+	server_pool.epoll_fd = epoll_create( SERVER_EVENTS ) ;
+	if ( FILE_DESCRIPTOR_NOT_VALID( server_pool.epoll_fd ) ) {
+		ERROR_DEFAULT("Cannot create epoll descriptor");
+		return gbBAD ;
+	}
+
+	for (out = Outbound_Control.head; out; out = out->next) {
+		struct server_job * job ;
+		if ( FILE_DESCRIPTOR_NOT_VALID( out->file_descriptor ) ) {
+			continue ;
+		}
+		job = owcalloc( 1, sizeof(struct server_job) ) ;
+		if ( job == NULL ) {
+			continue ;
+		}
+		job->file_descriptor = out->file_descriptor ;
+		job->out = out ;
+		job->listening = 1 ;
+		if ( BAD( EventWatch( job, EPOLL_CTL_ADD ) ) ) {
+			owfree( job ) ;
+			continue ;
+		}
+		job->next = server_pool.listeners ;
+		server_pool.listeners = job ;
+	}
+
+	server_pool.queue_max = Globals.server_workers * SERVER_QUEUE_PER_WORKER ;
+	server_pool.worker_thread = owcalloc( Globals.server_workers, sizeof(pthread_t) ) ;
+	if ( server_pool.worker_thread == NULL ) {
+		return gbBAD ;
+	}
+	for ( worker = 0 ; worker < Globals.server_workers ; ++worker ) {
+		if ( pthread_create( &server_pool.worker_thread[worker], DEFAULT_THREAD_ATTR, ServerWorker, NULL ) != 0 ) {
+			ERROR_DEFAULT("Could only start %d server worker threads", worker);
+			break ;
+		}
+		++server_pool.workers ;
+	}
+	return server_pool.workers > 0 ? gbGOOD : gbBAD ;
+}
+
+static void EventLoopCleanup( void )
+{
+	int worker ;
+
+	// workers finish what is queued, then leave
+	_MUTEX_LOCK( server_pool.mutex ) ;
+	server_pool.stop = 1 ;
+	my_pthread_cond_broadcast( &server_pool.work ) ;
+	_MUTEX_UNLOCK( server_pool.mutex ) ;
+	for ( worker = 0 ; worker < server_pool.workers ; ++worker ) {
+		pthread_join( server_pool.worker_thread[worker], NULL ) ;
+	}
+	SAFEFREE( server_pool.worker_thread ) ;
+
+	// only this thread is left
+	while ( server_pool.deferred_head != NULL ) {
+		struct server_job * job = server_pool.deferred_head ;
+		server_pool.deferred_head = job->next ;
+		JobClose( job ) ;
+	}
+	while ( server_pool.waiting != NULL ) {
+		struct server_job * job = server_pool.waiting ;
+		WaitingRemove( job ) ;
+		JobClose( job ) ;
+	}
+	while ( server_pool.listeners != NULL ) {
+		// listen sockets are closed with the connection_out
+		struct server_job * job = server_pool.listeners ;
+		server_pool.listeners = job->next ;
+		owfree( job ) ;
+	}
+
+	my_pthread_cond_destroy( &server_pool.work ) ;
+	_MUTEX_DESTROY( server_pool.mutex ) ;
+	Test_and_Close( &(server_pool.epoll_fd) ) ;
+}
+
+/* Main loop for --server_workers. Returns gbBAD only if it couldn't start at all */
+static GOOD_OR_BAD EventLoop( void )
+{
+	struct epoll_event events[SERVER_EVENTS] ;
+
+	if ( BAD( EventLoopSetup() ) ) {
+		EventLoopCleanup() ;
+		return gbBAD ;
+	}
+	LEVEL_DEBUG("Event loop with %d worker threads", server_pool.workers ) ;
+
+	while ( 1 ) {
+		int stop ;
+		int nevents ;
+		int ievent ;
+
+		RWLOCK_RLOCK( shutdown_mutex_rw ) ;
+		stop = shutdown_in_progress ;
+		RWLOCK_RUNLOCK( shutdown_mutex_rw ) ;
+		// exit signal (the select loop sees it as an interrupted select)
+		if ( stop || StateInfo.shutting_down ) {
+			break ;
+		}
+
+		// look back soon for room in the queue if anything is deferred
+		nevents = epoll_wait( server_pool.epoll_fd, events, SERVER_EVENTS, server_pool.deferred_head == NULL ? SERVER_TICK_MS : SERVER_DEFER_MS ) ;
+		if ( nevents < 0 ) {
+			if ( errno == EINTR ) {
+				continue ;
+			}
+			ERROR_DEBUG("Epoll wait problem") ;
+			break ;
+		}
+		EventDeferred() ;
+		for ( ievent = 0 ; ievent < nevents ; ++ievent ) {
+			struct server_job * job = events[ievent].data.ptr ;
+			if ( job->listening ) {
+				if ( ! server_pool.listen_paused ) {
+					EventAccept( job ) ;
+				}
+			} else {
+				EventReady( job ) ;
+			}
+		}
+		ListenPause( server_pool.deferred_head != NULL ) ;
+		EventExpire() ;
+	}
+
+	EventLoopCleanup() ;
+	return gbGOOD ;
+}
+#endif							/* HAVE_SYS_EPOLL_H */
+
+/* Event loop only: answer one request at a time (RequestRoutine) so a
+ * kept connection waits in the loop between requests, not in a worker.
+ * RequestRoutine returns gbGOOD to keep the connection, *state starts
+ * NULL and is handed to ReleaseRoutine when the connection is closed.
+ * Call before ServerProcess. Without it the HandlerRoutine serves the
+ * whole connection. */
+void ServerRequestRoutines( GOOD_OR_BAD (*RequestRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descriptor, void ** state), void (*ReleaseRoutine) (void * state) )
+{
+	server_request_routine = RequestRoutine ;
+	server_release_routine = ReleaseRoutine ;
+}
+
 /* Setup Servers -- select on each port */
 /* Not only sets up, we start a loop for new connections and processes them,
  * basically, this is the main loop of the owserver and owhttpd program
@@ -336,7 +834,18 @@ void ServerProcess(void (*HandlerRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descrip
 		
 	if ( GOOD( SetupListenSockets( HandlerRoutine ) ) ) {
 		Announce_Systemd() ; // systemd mode -- ready for business
-		while (	GOOD( ListenCycle() ) ) {
+#ifdef HAVE_SYS_EPOLL_H
+		if ( Globals.server_workers > 0 && BAD( EventLoop() ) ) {
+			LEVEL_DEFAULT("Event loop could not start, using a thread per connection") ;
+			Globals.server_workers = 0 ;
+		}
+#else							/* HAVE_SYS_EPOLL_H */
+		if ( Globals.server_workers > 0 ) {
+			LEVEL_DEFAULT("No epoll on this system, using a thread per connection") ;
+			Globals.server_workers = 0 ;
+		}
+#endif							/* HAVE_SYS_EPOLL_H */
+		while (	Globals.server_workers == 0 && GOOD( ListenCycle() ) ) {
 		}
 
 		// Make sure all the handler threads are complete before closing down
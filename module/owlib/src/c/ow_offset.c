@@ -59,3 +59,39 @@ ZERO_OR_ERROR COMMON_offset_process( ZERO_OR_ERROR (*func) (struct one_wire_quer
 
 	return func_return_value ;
 }
+
+/* Whole array of memory pages (pages/page.ALL) in one read
+ * Reads all the pages as the memory from offset 0 with func (a "memory" read
+ * that isn't page-limited), then marks each page's length.
+ * Meant as the bulk_read of a separate page aggregate.
+ * func sets the length, which shares the value union with the array pointer.
+ */
+
+ZERO_OR_ERROR COMMON_pages_process( ZERO_OR_ERROR (*func) (struct one_wire_query *), struct one_wire_query * owq_all, size_t pagesize)
+{
+	size_t pages = PN(owq_all)->selected_filetype->ag->elements ;
+	size_t size = OWQ_size(owq_all) ;
+	off_t offset = OWQ_offset(owq_all) ;
+	union value_object * array = OWQ_array(owq_all) ;
+	size_t page ;
+	ZERO_OR_ERROR func_return_value ;
+
+	if ( size < pages * pagesize ) {
+		return -EMSGSIZE ;
+	}
+
+	OWQ_size(owq_all) = pages * pagesize ;
+	OWQ_offset(owq_all) = 0 ;
+	func_return_value = func(owq_all) ;
+	OWQ_size(owq_all) = size ;
+	OWQ_offset(owq_all) = offset ;
+	OWQ_array(owq_all) = array ;
+
+	if ( func_return_value < 0 ) {
+		return func_return_value ;
+	}
+	for ( page = 0 ; page < pages ; ++page ) {
+		OWQ_array_length(owq_all, page) = pagesize ;
+	}
+	return 0 ;
+}
@@ -114,6 +114,15 @@ const struct option owopts_long[] = {
 	{"cache_size", required_argument, NO_LINKED_VAR, e_cache_size},	/* max cache size */
 	{"cache-size", required_argument, NO_LINKED_VAR, e_cache_size},	/* max cache size */
 	{"cachesize", required_argument, NO_LINKED_VAR, e_cache_size},	/* max cache size */
+	{"cache_shards", required_argument, NO_LINKED_VAR, e_cache_shards},	/* cache partitions */
+	{"cache-shards", required_argument, NO_LINKED_VAR, e_cache_shards},	/* cache partitions */
+	{"cacheshards", required_argument, NO_LINKED_VAR, e_cache_shards},	/* cache partitions */
+	{"parse_cache", required_argument, NO_LINKED_VAR, e_parse_cache},	/* parsed paths kept */
+	{"parse-cache", required_argument, NO_LINKED_VAR, e_parse_cache},	/* parsed paths kept */
+	{"parsecache", required_argument, NO_LINKED_VAR, e_parse_cache},	/* parsed paths kept */
+	{"cache_timer_wheel", no_argument, &Globals.cache_timer_wheel, 1},	/* per-entry cache expiry */
+	{"cache-timer-wheel", no_argument, &Globals.cache_timer_wheel, 1},	/* per-entry cache expiry */
+	{"no_cache_timer_wheel", no_argument, &Globals.cache_timer_wheel, 0},	/* generation cache expiry */
 	{"fuse_opt", required_argument, NO_LINKED_VAR, e_fuse_opt},	/* owfs, fuse mount option */
 	{"fuse-opt", required_argument, NO_LINKED_VAR, e_fuse_opt},	/* owfs, fuse mount option */
 	{"fuseopt", required_argument, NO_LINKED_VAR, e_fuse_opt},	/* owfs, fuse mount option */
@@ -184,6 +193,8 @@ const struct option owopts_long[] = {
 	{"browse", no_argument, NO_LINKED_VAR, e_browse},
 	{"w1", no_argument, NO_LINKED_VAR, e_w1_monitor},
 	{"W1", no_argument, NO_LINKED_VAR, e_w1_monitor},
+	{"w1_multiplex", no_argument, &Globals.w1_multiplex, 1},
+	{"W1_multiplex", no_argument, &Globals.w1_multiplex, 1},
 	{"masterhub", required_argument, NO_LINKED_VAR, e_masterhub},
 	{"Masterhub", required_argument, NO_LINKED_VAR, e_masterhub},
 	{"MasterHub", required_argument, NO_LINKED_VAR, e_masterhub},
@@ -197,6 +208,8 @@ const struct option owopts_long[] = {
 	{"USB_flextime", no_argument, &Globals.usb_flextime, 1},
 	{"usb_regulartime", no_argument, &Globals.usb_flextime, 0},
 	{"USB_regulartime", no_argument, &Globals.usb_flextime, 0},
+	{"usb_async", no_argument, &Globals.usb_async, 1},
+	{"USB_async", no_argument, &Globals.usb_async, 1},
 	{"serial_flex", no_argument, &Globals.serial_flextime, 1},
 	{"serial_flextime", no_argument, &Globals.serial_flextime, 1},
 	{"serial_regulartime", no_argument, &Globals.serial_flextime, 0},
@@ -257,6 +270,13 @@ const struct option owopts_long[] = {
 	{"no_dirall", no_argument, &Globals.no_dirall, 1},
 	{"no_get", no_argument, &Globals.no_get, 1},
 	{"no_persistence", no_argument, &Globals.no_persistence, 1},
+	{"no_pipeline", no_argument, &Globals.no_pipeline, 1},
+	{"convert_hold", no_argument, &Globals.convert_hold, 1},
+	{"no_coalesce", no_argument, &Globals.no_coalesce, 1},
+	{"server_workers", required_argument, NO_LINKED_VAR, e_server_workers},	/* event loop and worker pool */
+	{"server-workers", required_argument, NO_LINKED_VAR, e_server_workers},	/* event loop and worker pool */
+	{"server_connections", required_argument, NO_LINKED_VAR, e_server_connections},	/* idle connections kept per owserver */
+	{"server-connections", required_argument, NO_LINKED_VAR, e_server_connections},	/* idle connections kept per owserver */
 	{"8bit", no_argument, &Globals.eightbit_serial, 1},
 	{"6bit", no_argument, &Globals.eightbit_serial, 0},
 	{"ActivePullUp", no_argument, &Globals.i2c_APU, 1},
@@ -753,6 +773,34 @@ GOOD_OR_BAD owopt(const int option_char, const char *arg)
 		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
 		Globals.cache_size = (size_t) arg_to_integer;
 		break;
+	case e_cache_shards:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.cache_shards = (int) arg_to_integer;
+		break;
+	case e_parse_cache:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		if ( arg_to_integer < 0 ) {
+			LEVEL_DEFAULT("Parse cache must be 0 (none) or more entries");
+			return gbBAD ;
+		}
+		Globals.parse_cache = (int) arg_to_integer;
+		break;
+	case e_server_workers:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		if ( arg_to_integer < 0 ) {
+			LEVEL_DEFAULT("Server workers must be 0 (thread per connection) or more");
+			return gbBAD ;
+		}
+		Globals.server_workers = (int) arg_to_integer;
+		break;
+	case e_server_connections:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		if ( arg_to_integer < 0 ) {
+			LEVEL_DEFAULT("Server connections must be 0 (no persistent connections kept) or more");
+			return gbBAD ;
+		}
+		Globals.server_connections = (int) arg_to_integer;
+		break;
 	case e_fuse_opt:			/* fuse_opt, handled in owfs.c */
 		break;
 	case e_fuse_open_opt:		/* fuse_open_opt, handled in owfs.c */
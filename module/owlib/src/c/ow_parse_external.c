@@ -547,6 +547,7 @@ static struct family_node * create_family_node( char * s_family )
 	s->dev.flags = 0 ;
 	s->dev.g_read = NULL ;
 	s->dev.g_write = NULL ;
+	s->dev.directory = NULL ; // built with the tree
 
 	return s ;
 }
@@ -615,6 +616,7 @@ static struct property_node * create_property_node( char * s_property, char * s_
 	s->ag.elements = s_array ;
 	s->ag.letters = s_index_type ;
 	s->ag.combined = s_combined ;
+	s->ag.bulk_read = NO_BULK_READ ;
 
 	// Flag scalars
 	if ( s_array == 1 ) {
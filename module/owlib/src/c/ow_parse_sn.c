@@ -14,54 +14,67 @@
 #include "owfs_config.h"
 #include "ow.h"
 
-static regex_t rx_sn_parse;
-
-static void regex_fini(void)
-{
-	regfree(&rx_sn_parse);
-}
-
-static pthread_once_t regex_init_once = PTHREAD_ONCE_INIT;
-
-static void regex_init(void)
+/* count of hex digits at the start of s, up to max */
+static int hex_digits( const char * s, int max )
 {
-	ow_regcomp(&rx_sn_parse, "^([[:xdigit:]]{2})\\.?([[:xdigit:]]{12})\\.?([[:xdigit:]]{2}){0,1}$", 0);
-
-	atexit(regex_fini);
+	int digits ;
+	for ( digits = 0 ; digits < max && isxdigit( (int) s[digits] ) ; ++digits ) {
+	}
+	return digits ;
 }
 
 /* Fill get serikal number from a character string */ 
+/* Form is family.id.crc with both dots and the crc optional: ff.iiiiiiiiiiii.cc */
 enum parse_serialnumber Parse_SerialNumber(char *sn_char, BYTE * sn)
 {
-	pthread_once(&regex_init_once,regex_init);
+	const char * family ;
+	const char * id ;
+	const char * crc = NULL ;
+	const char * next ;
 
-	struct ow_regmatch orm ;
-	orm.number = 3 ;
-	
 	if ( sn_char == NULL ) {
 		return sn_null ;
 	}
 
-	if ( ow_regexec( &rx_sn_parse, sn_char, &orm ) != 0 ) {
+	family = sn_char ;
+	if ( hex_digits( family, 2 ) != 2 ) {
 		return sn_not_sn ;
 	}
-		
-	sn[0] = string2num(orm.match[1]);
-	sn[1] = string2num(&orm.match[2][0]);
-	sn[2] = string2num(&orm.match[2][2]);
-	sn[3] = string2num(&orm.match[2][4]);
-	sn[4] = string2num(&orm.match[2][6]);
-	sn[5] = string2num(&orm.match[2][8]);
-	sn[6] = string2num(&orm.match[2][10]);
+	next = family + 2 ;
+	if ( *next == '.' ) {
+		++next ;
+	}
+
+	id = next ;
+	if ( hex_digits( id, 12 ) != 12 ) {
+		return sn_not_sn ;
+	}
+	next = id + 12 ;
+	if ( *next == '.' ) {
+		++next ;
+	}
+
+	if ( *next != '\0' ) {
+		if ( hex_digits( next, 2 ) != 2 || next[2] != '\0' ) {
+			return sn_not_sn ;
+		}
+		crc = next ;
+	}
+
+	sn[0] = string2num(family);
+	sn[1] = string2num(&id[0]);
+	sn[2] = string2num(&id[2]);
+	sn[3] = string2num(&id[4]);
+	sn[4] = string2num(&id[6]);
+	sn[5] = string2num(&id[8]);
+	sn[6] = string2num(&id[10]);
 	sn[7] = CRC8compute(sn, SERIAL_NUMBER_SIZE-1, 0);
-	if (orm.match[3] != NULL) {
+	if (crc != NULL) {
 		// CRC given
-		if ( string2num(orm.match[3]) != sn[7] ) {
-			ow_regexec_free( &orm ) ;
+		if ( string2num(crc) != sn[7] ) {
 			return sn_invalid;
 		}
 	}
-	ow_regexec_free( &orm ) ;
 	return sn_valid ;
 }
 
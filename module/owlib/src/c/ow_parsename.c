@@ -49,77 +49,124 @@ static void ReplaceAliasInPath( char * filename, struct parsedname * pn);
 static ZERO_OR_ERROR FS_ParsedName_anywhere(const char *path, enum parse_pass remote_status, struct parsedname *pn);
 static ZERO_OR_ERROR FS_ParsedName_setup(struct parsedname_pointers *pp, const char *path, struct parsedname *pn);
 static char * find_segment_in_path( char * segment, char * path ) ;
+static enum parse_enum ParseCache_Get( enum parse_pass remote_status, struct parsedname * pn, UINT * generation ) ;
+static void ParseCache_Add( enum parse_pass remote_status, enum ePS_state setup_state, const struct parsedname * pn, UINT generation ) ;
 
 #define BRANCH_INCR (9)
 
-static regex_t rx_bus;
-static regex_t rx_set;
-static regex_t rx_sta;
-static regex_t rx_str;
-static regex_t rx_sys;
-static regex_t rx_int;
-static regex_t rx_tex;
-static regex_t rx_jso;
-static regex_t rx_unc;
-static regex_t rx_una;
-static regex_t rx_ala;
-static regex_t rx_sim;
-static regex_t rx_the;
-static regex_t rx_p_bus;
-static regex_t rx_extension;
-static regex_t rx_all;
-static regex_t rx_byte;
-static regex_t rx_number;
-static regex_t rx_letter;
-
-static void regex_fini(void)
-{
-	regfree(&rx_bus);
-	regfree(&rx_set);
-	regfree(&rx_sta);
-	regfree(&rx_str);
-	regfree(&rx_sys);
-	regfree(&rx_int);
-	regfree(&rx_tex);
-	regfree(&rx_jso);
-	regfree(&rx_unc);
-	regfree(&rx_una);
-	regfree(&rx_ala);
-	regfree(&rx_sim);
-	regfree(&rx_the);
-	regfree(&rx_p_bus);
-	regfree(&rx_extension);
-	regfree(&rx_all);
-	regfree(&rx_byte);
-	regfree(&rx_number);
-	regfree(&rx_letter);
-}
-
-static pthread_once_t regex_init_once = PTHREAD_ONCE_INIT;
-
-static void regex_init(void)
-{
-	ow_regcomp(&rx_bus, "^bus\\.([[:digit:]]+)/?", REG_ICASE);
-	ow_regcomp(&rx_set, "^settings/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_sta, "^statistics/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_str, "^structure/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_sys, "^system/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_int, "^interface/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_tex, "^text/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_jso, "^json/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_unc, "^uncached/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_una, "^unaliased/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_ala, "^alarm\?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_sim, "^simultaneous/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_the, "^thermostat/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_p_bus, "^/bus\\.[[:digit:]]+/?", REG_ICASE);
-	ow_regcomp(&rx_extension, "\\.", 0);
-	ow_regcomp(&rx_all, "\\.all$", REG_ICASE);
-	ow_regcomp(&rx_byte, "\\.byte$", REG_ICASE);
-	ow_regcomp(&rx_number, "\\.[[:digit:]]+$", 0);
-	ow_regcomp(&rx_letter, "\\.[[:alpha:]]$", REG_ICASE);
-
-	atexit(regex_fini);
+/* Fixed path keywords (settings, uncached, bus.n ...)
+ * A segment is dispatched on its first letter and only compared with the
+ * few keywords starting with it. Matching is a prefix match in any case,
+ * same as the regular expressions this replaced, but without regexec and
+ * its allocations for every path segment. */
+enum parse_keyword {
+	kw_none,
+	kw_alarm,
+	kw_bus,
+	kw_interface,
+	kw_json,
+	kw_settings,
+	kw_simultaneous,
+	kw_statistics,
+	kw_structure,
+	kw_system,
+	kw_text,
+	kw_thermostat,
+	kw_unaliased,
+	kw_uncached,
+};
+
+#define KEYWORD_PREFIX( segment, word, keyword ) \
+	if ( strncasecmp( (segment), (word), sizeof(word)-1 ) == 0 ) { \
+		return (keyword) ; \
+	}
+
+static enum parse_keyword Parse_Keyword( const char * segment )
+{
+	switch ( segment[0] ) {
+		case 'a':
+		case 'A':
+			// the old pattern was "^alarm?" -- an optional 'm'
+			KEYWORD_PREFIX( segment, "alar", kw_alarm ) ;
+			break ;
+		case 'b':
+		case 'B':
+			// bus.n needs at least one digit
+			if ( strncasecmp( segment, "bus.", 4 ) == 0 && isdigit( (int) segment[4] ) ) {
+				return kw_bus ;
+			}
+			break ;
+		case 'i':
+		case 'I':
+			KEYWORD_PREFIX( segment, "interface", kw_interface ) ;
+			break ;
+		case 'j':
+		case 'J':
+			KEYWORD_PREFIX( segment, "json", kw_json ) ;
+			break ;
+		case 's':
+		case 'S':
+			KEYWORD_PREFIX( segment, "settings", kw_settings ) ;
+			KEYWORD_PREFIX( segment, "simultaneous", kw_simultaneous ) ;
+			KEYWORD_PREFIX( segment, "statistics", kw_statistics ) ;
+			KEYWORD_PREFIX( segment, "structure", kw_structure ) ;
+			KEYWORD_PREFIX( segment, "system", kw_system ) ;
+			break ;
+		case 't':
+		case 'T':
+			KEYWORD_PREFIX( segment, "text", kw_text ) ;
+			KEYWORD_PREFIX( segment, "thermostat", kw_thermostat ) ;
+			break ;
+		case 'u':
+		case 'U':
+			KEYWORD_PREFIX( segment, "unaliased", kw_unaliased ) ;
+			KEYWORD_PREFIX( segment, "uncached", kw_uncached ) ;
+			break ;
+		default:
+			break ;
+	}
+	return kw_none ;
+}
+
+/* Extension suffixes of a property name (the part after the first '.') */
+
+// ".nnn" at the end, number returned
+static GOOD_OR_BAD Parse_Extension_Number( const char * filename, int * number )
+{
+	const char * dot = strrchr( filename, '.' ) ;
+	const char * digit ;
+
+	if ( dot == NULL || dot[1] == '\0' ) {
+		return gbBAD ;
+	}
+	for ( digit = &dot[1] ; *digit != '\0' ; ++digit ) {
+		if ( ! isdigit( (int) *digit ) ) {
+			return gbBAD ;
+		}
+	}
+	*number = atoi( &dot[1] ) ;
+	return gbGOOD ;
+}
+
+// ".x" single letter at the end, index from 'A' returned
+static GOOD_OR_BAD Parse_Extension_Letter( const char * filename, int * number )
+{
+	size_t length = strlen( filename ) ;
+
+	if ( length < 2 || filename[length-2] != '.' || ! isalpha( (int) filename[length-1] ) ) {
+		return gbBAD ;
+	}
+	*number = toupper( (int) filename[length-1] ) - 'A' ;
+	return gbGOOD ;
+}
+
+// exact (any case) suffix like ".all" or ".byte"
+static int Parse_Extension_Is( const char * filename, const char * suffix )
+{
+	size_t length = strlen( filename ) ;
+	size_t suffix_length = strlen( suffix ) ;
+
+	return length >= suffix_length && strcasecmp( &filename[length-suffix_length], suffix ) == 0 ;
 }
 
 /* ---------------------------------------------- */
@@ -165,7 +212,10 @@ static ZERO_OR_ERROR FS_ParsedName_anywhere(const char *path, enum parse_pass re
 	struct parsedname_pointers s_pp;
 	struct parsedname_pointers *pp = &s_pp;
 	ZERO_OR_ERROR parse_error_status = 0;
-	enum parse_enum pe = parse_first;
+	enum parse_enum pe ;
+	enum ePS_state setup_state ;
+	UINT cache_generation ;
+	int from_cache ;
 
 	// To make the debug output useful it's cleared here.
 	// Even on normal glibc, errno isn't cleared on good system calls
@@ -179,6 +229,14 @@ static ZERO_OR_ERROR FS_ParsedName_anywhere(const char *path, enum parse_pass re
 		RETURN_CODE_RETURN( 0 ) ; // success (by default)
 	}
 
+	// parsed before?
+	setup_state = pn->state ;
+	pe = ParseCache_Get( remote_status, pn, &cache_generation ) ;
+	from_cache = ( pe != parse_first ) ;
+	if ( from_cache ) {
+		pp->pathnext = NULL ; // nothing left to parse
+	}
+
 	while (1) {
 		// Check for extreme conditions (done, error)
 		switch (pe) {
@@ -197,6 +255,10 @@ static ZERO_OR_ERROR FS_ParsedName_anywhere(const char *path, enum parse_pass re
 				pe = parse_done;
 				continue;				
 			}
+
+			if ( ! from_cache ) {
+				ParseCache_Add( remote_status, setup_state, pn, cache_generation ) ;
+			}
 			
 			//printf("%s: Parse %s before corrections: %.4X -- state = %d\n",(back_from_remote)?"BACK":"FORE",pn->path,pn->state,pn->type) ;
 			// Play with remote levels
@@ -411,51 +473,47 @@ static enum parse_enum set_type( enum ePN_type epntype, struct parsedname * pn )
 // Early parsing -- only bus entries, uncached and text may have preceeded
 static enum parse_enum Parse_Unspecified(char *pathnow, enum parse_pass remote_status, struct parsedname *pn)
 {
-	pthread_once(&regex_init_once, regex_init);
-
-	struct ow_regmatch orm ;
-	orm.number = 1 ; // for bus
+	switch ( Parse_Keyword( pathnow ) ) {
+		case kw_bus:
+			return Parse_Bus( (INDEX_OR_ERROR) atoi( &pathnow[4] ), pn);
 
-	if ( ow_regexec( &rx_bus, pathnow, &orm ) == 0) {
-		INDEX_OR_ERROR bus_number = (INDEX_OR_ERROR) atoi(orm.match[1]) ;
-		ow_regexec_free( &orm ) ;
-		return Parse_Bus( bus_number, pn);
+		case kw_settings:
+			return set_type( ePN_settings, pn ) ;
 
-	} else if (ow_regexec( &rx_set, pathnow, NULL ) == 0) {
-		return set_type( ePN_settings, pn ) ;
+		case kw_statistics:
+			return set_type( ePN_statistics, pn ) ;
 
-	} else if (ow_regexec( &rx_sta, pathnow, NULL ) == 0) {
-		return set_type( ePN_statistics, pn ) ;
+		case kw_structure:
+			return set_type( ePN_structure, pn ) ;
 
-	} else if (ow_regexec( &rx_str, pathnow, NULL ) == 0) {
-		return set_type( ePN_structure, pn ) ;
+		case kw_system:
+			return set_type( ePN_system, pn ) ;
 
-	} else if (ow_regexec( &rx_sys, pathnow, NULL ) == 0) {
-		return set_type( ePN_system, pn ) ;
-
-	} else if (ow_regexec( &rx_int, pathnow, NULL ) == 0) {
-		if (!SpecifiedBus(pn)) {
-			return parse_error;
-		}
-		pn->type = ePN_interface;
-		return parse_nonreal;
+		case kw_interface:
+			if (!SpecifiedBus(pn)) {
+				return parse_error;
+			}
+			pn->type = ePN_interface;
+			return parse_nonreal;
 
-	} else if (ow_regexec( &rx_tex, pathnow, NULL ) == 0) {
-		pn->state |= ePS_text;
-		return parse_first;
+		case kw_text:
+			pn->state |= ePS_text;
+			return parse_first;
 
-	} else if (ow_regexec( &rx_jso, pathnow, NULL ) == 0) {
-		pn->state |= ePS_json;
-		return parse_first;
+		case kw_json:
+			pn->state |= ePS_json;
+			return parse_first;
 
-	} else if (ow_regexec( &rx_unc, pathnow, NULL ) == 0) {
-		pn->state |= ePS_uncached;
-		return parse_first;
+		case kw_uncached:
+			pn->state |= ePS_uncached;
+			return parse_first;
 
-	} else if (ow_regexec( &rx_una, pathnow, NULL ) == 0) {
-		pn->state |= ePS_unaliased;
-		return parse_first;
+		case kw_unaliased:
+			pn->state |= ePS_unaliased;
+			return parse_first;
 
+		default:
+			break ;
 	}
 
 	pn->type = ePN_real;
@@ -464,9 +522,7 @@ static enum parse_enum Parse_Unspecified(char *pathnow, enum parse_pass remote_s
 
 static enum parse_enum Parse_Branch(char *pathnow, enum parse_pass remote_status, struct parsedname *pn)
 {
-	pthread_once(&regex_init_once, regex_init);
-
-	if (ow_regexec( &rx_ala, pathnow, NULL ) == 0) {
+	if ( Parse_Keyword( pathnow ) == kw_alarm ) {
 		pn->state |= ePS_alarm;
 		pn->type = ePN_real;
 		return parse_real;
@@ -476,72 +532,63 @@ static enum parse_enum Parse_Branch(char *pathnow, enum parse_pass remote_status
 
 static enum parse_enum Parse_Real(char *pathnow, enum parse_pass remote_status, struct parsedname *pn)
 {
-	pthread_once(&regex_init_once, regex_init);
+	switch ( Parse_Keyword( pathnow ) ) {
+		case kw_simultaneous:
+			pn->selected_device = DeviceSimultaneous;
+			return parse_prop;
 
-	if (ow_regexec( &rx_sim, pathnow, NULL ) == 0) {
-		pn->selected_device = DeviceSimultaneous;
-		return parse_prop;
-
-	} else if (ow_regexec( &rx_tex, pathnow, NULL ) == 0) {
-		pn->state |= ePS_text;
-		return parse_real;
+		case kw_text:
+			pn->state |= ePS_text;
+			return parse_real;
 
-	} else if (ow_regexec( &rx_jso, pathnow, NULL ) == 0) {
-		pn->state |= ePS_json;
-		return parse_real;
+		case kw_json:
+			pn->state |= ePS_json;
+			return parse_real;
 
-	} else if (ow_regexec( &rx_the, pathnow, NULL ) == 0) {
-		pn->selected_device = DeviceThermostat;
-		return parse_prop;
+		case kw_thermostat:
+			pn->selected_device = DeviceThermostat;
+			return parse_prop;
 
-	} else if (ow_regexec( &rx_unc, pathnow, NULL ) == 0) {
-		pn->state |= ePS_uncached;
-		return parse_real;
+		case kw_uncached:
+			pn->state |= ePS_uncached;
+			return parse_real;
 
-	} else if (ow_regexec( &rx_una, pathnow, NULL ) == 0) {
-		pn->state |= ePS_unaliased;
-		return parse_real;
+		case kw_unaliased:
+			pn->state |= ePS_unaliased;
+			return parse_real;
 
-	} else {
-		return Parse_RealDevice(pathnow, remote_status, pn);
+		default:
+			return Parse_RealDevice(pathnow, remote_status, pn);
 	}
 }
 
 static enum parse_enum Parse_NonReal(char *pathnow, struct parsedname *pn)
 {
-	pthread_once(&regex_init_once, regex_init);
+	switch ( Parse_Keyword( pathnow ) ) {
+		case kw_text:
+			pn->state |= ePS_text;
+			return parse_nonreal;
 
-	if (ow_regexec( &rx_tex, pathnow, NULL )  == 0) {
-		pn->state |= ePS_text;
-		return parse_nonreal;
+		case kw_json:
+			pn->state |= ePS_json;
+			return parse_nonreal;
 
-	} else if (ow_regexec( &rx_jso, pathnow, NULL )  == 0) {
-		pn->state |= ePS_json;
-		return parse_nonreal;
-
-	} else if (ow_regexec( &rx_unc, pathnow, NULL )  == 0) {
-		pn->state |= ePS_uncached;
-		return parse_nonreal;
+		case kw_uncached:
+			pn->state |= ePS_uncached;
+			return parse_nonreal;
 
-	} else if (ow_regexec( &rx_una, pathnow, NULL )  == 0) {
-		pn->state |= ePS_unaliased;
-		return parse_nonreal;
+		case kw_unaliased:
+			pn->state |= ePS_unaliased;
+			return parse_nonreal;
 
-	} else {
-		return Parse_NonRealDevice(pathnow, pn);
+		default:
+			return Parse_NonRealDevice(pathnow, pn);
 	}
-
-	return parse_error;
 }
 
 /* We've reached a /bus.n entry */
 static enum parse_enum Parse_Bus( INDEX_OR_ERROR bus_number, struct parsedname *pn)
 {
-	pthread_once(&regex_init_once, regex_init);
-
-	struct ow_regmatch orm ;
-	orm.number = 0 ;
-
 	/* Processing for bus.X directories -- eventually will make this more generic */
 	if ( INDEX_NOT_VALID(bus_number) ) {
 		return parse_error;
@@ -572,11 +619,16 @@ static enum parse_enum Parse_Bus( INDEX_OR_ERROR bus_number, struct parsedname *
 	}
 
 	/* Create the path without the "bus.x" part in pn->path_to_server */
-	if ( ow_regexec( &rx_p_bus, pn->path, &orm ) == 0 ) {
-		strcpy( pn->path_to_server, orm.pre[0] ) ;
-		strcat( pn->path_to_server, "/" ) ;
-		strcat( pn->path_to_server, orm.post[0] ) ;
-		ow_regexec_free( &orm ) ;
+	if ( strncasecmp( pn->path, "/bus.", 5 ) == 0 && isdigit( (int) pn->path[5] ) ) {
+		const char * post = &pn->path[5] ;
+		while ( isdigit( (int) *post ) ) {
+			++post ;
+		}
+		if ( *post == '/' ) {
+			++post ;
+		}
+		strcpy( pn->path_to_server, "/" ) ;
+		strcat( pn->path_to_server, post ) ;
 	}
 	return parse_first;
 }
@@ -755,15 +807,10 @@ static enum parse_enum Parse_NonRealDevice(char *filename, struct parsedname *pn
 
 static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 {
-	pthread_once(&regex_init_once, regex_init);
-
 	struct device * pdev = pn->selected_device ;
 	struct filetype * ft ;
-	
-	int extension_given ;
-
-	struct ow_regmatch orm ;
-	orm.number = 0 ;
+	char * dot ;
+	int extension ;
 
 	//printf("FilePart: %s %s\n", filename, pn->path);
 
@@ -774,17 +821,19 @@ static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 	}
 
 	// separate filename.dot
-//	filename = strsep(&dot, ".");
-	if ( ow_regexec( &rx_extension, filename, &orm ) == 0 ) {
+	dot = strchr( filename, '.' ) ;
+	if ( dot != NULL ) {
 		// extension given
-		extension_given = 1 ;
+		int name_length = dot - filename ;
+		char name[ name_length + 1 ] ;
+
+		memcpy( name, filename, name_length ) ;
+		name[name_length] = '\0' ;
 		ft =
-			 bsearch(orm.pre[0], pdev->filetype_array,
+			 bsearch(name, pdev->filetype_array,
 					 (size_t) pdev->count_of_filetypes, sizeof(struct filetype), filetype_cmp) ;
-		ow_regexec_free( &orm ) ;
 	} else {
 		// no extension given
-		extension_given = 0 ;
 		ft =
 			 bsearch(filename, pdev->filetype_array,
 					 (size_t) pdev->count_of_filetypes, sizeof(struct filetype), filetype_cmp) ;
@@ -798,7 +847,7 @@ static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 		
 	//printf("FP known filetype %s\n",pn->selected_filetype->name) ;
 	/* Filetype found, now process extension */
-	if (extension_given==0) {	/* no extension */
+	if (dot == NULL) {	/* no extension */
 		if (ft->ag != NON_AGGREGATE) {
 			return parse_error;	/* aggregate filetypes need an extension */
 		}
@@ -812,14 +861,11 @@ static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 	} else if (ft->ag->combined==ag_sparse)  { /* Sparse */
 		if (ft->ag->letters == ag_letters) {	/* text string */
 			pn->extension = 0;	/* text extension, not number */
-			ow_regexec( &rx_extension, filename, &orm ) ; // don't need to test -- already succesful
-			pn->sparse_name = owstrdup(orm.post[0]) ;
-			ow_regexec_free( &orm ) ;
+			pn->sparse_name = owstrdup( &dot[1] ) ;
 			LEVEL_DEBUG("Sparse alpha extension found: <%s>",pn->sparse_name);
 		} else {			/* Numbers */
-			if ( ow_regexec( &rx_number, filename, &orm ) == 0 ) { 
-				pn->extension = atoi( &orm.match[0][1] );	/* Number conversion */
-				ow_regexec_free( &orm ) ;
+			if ( GOOD( Parse_Extension_Number( filename, &extension ) ) ) {
+				pn->extension = extension;	/* Number conversion */
 				LEVEL_DEBUG("Sparse numeric extension found: <%ld>",(long int) pn->extension);
 			} else {
 				LEVEL_DEBUG("Non numeric extension for %s",filename ) ;
@@ -828,12 +874,12 @@ static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 		}
 
 	// Non-sparse "ALL"
-	} else if (ow_regexec( &rx_all, filename, NULL ) == 0) {
+	} else if ( Parse_Extension_Is( filename, ".all" ) ) {
 		//printf("FP ALL\n");
 		pn->extension = EXTENSION_ALL;	/* ALL */
 	
 	// Non-sparse "BYTE"
-	} else if (ft->format == ft_bitfield && ow_regexec( &rx_byte, filename, NULL) == 0) {
+	} else if (ft->format == ft_bitfield && Parse_Extension_Is( filename, ".byte" ) ) {
 		pn->extension = EXTENSION_BYTE;	/* BYTE */
 		//printf("FP BYTE\n") ;
 
@@ -841,16 +887,14 @@ static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 	} else {				/* specific extension */
 		if (ft->ag->letters == ag_letters) {	/* Letters */
 			//printf("FP letters\n") ;
-			if ( ow_regexec( &rx_letter, filename, &orm ) == 0 ) {
-				pn->extension = toupper(orm.match[0][1]) - 'A';	/* Letter extension */
-				ow_regexec_free( &orm ) ;
+			if ( GOOD( Parse_Extension_Letter( filename, &extension ) ) ) {
+				pn->extension = extension;	/* Letter extension */
 			} else {
 				return parse_error;
 			}
 		} else {			/* Numbers */
-			if ( ow_regexec( &rx_number, filename, &orm ) == 0 ) { 
-				pn->extension = atoi( &orm.match[0][1] );	/* Number conversion */
-				ow_regexec_free( &orm ) ;
+			if ( GOOD( Parse_Extension_Number( filename, &extension ) ) ) {
+				pn->extension = extension;	/* Number conversion */
 			} else {
 				return parse_error;
 			}
@@ -982,3 +1026,341 @@ void FS_ParsedName_Placeholder( struct parsedname * pn )
 {
 	FS_ParsedName( NULL, pn ) ; // minimal parsename -- no destroy needed
 }
+
+/* ---------------------------------------------- */
+/* Cache of parsed paths                          */
+/* ---------------------------------------------- */
+/* The same few paths are parsed over and over (every owfs getattr, every
+ * owserver request). The result of a successful parse is kept, keyed by
+ * the path, in a small LRU table (--parse_cache entries).
+ *
+ * Only results that can't go stale are kept:
+ *   no DS2409 branches, no aliases, no external or remote devices.
+ * Device location is not kept -- a real device is found again on every
+ * use (CheckPresence, normally from the device cache), exactly as the full
+ * parse does. Buses named in the path are kept, so the cache is flushed
+ * whenever a bus master is removed.
+ * */
+
+struct parse_cache_entry {
+	struct parse_cache_entry * hash_next ;	// same bucket
+	struct parse_cache_entry * newer ;		// LRU list
+	struct parse_cache_entry * older ;
+	UINT hash ;
+
+	// key
+	char * path ;
+	enum parse_pass remote_status ;
+	enum ePS_state setup_state ;	// --uncached --unaliased
+
+	// parse results (before the final remote level corrections)
+	enum ePN_type type ;
+	enum ePS_state state ;
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	int device_name ;				// offset in path, or -1
+	int check_presence ;			// real device, locate it on each use
+	struct connection_in * known_bus ;
+	struct connection_in * selected_connection ;
+	struct device * selected_device ;
+	struct filetype * selected_filetype ;
+	struct filetype * subdir ;
+	int extension ;
+	int dirlength ;
+	uint32_t bus_list ;				// SHOULD_RETURN_BUS_LIST still set
+	char * path_to_server ;
+	char * sparse_name ;
+} ;
+
+static struct {
+	struct parse_cache_entry ** bucket ;
+	UINT buckets ;					// power of 2
+	int size ;						// max entries
+	int count ;
+	UINT generation ;				// changed by every flush
+	struct parse_cache_entry * newest ;
+	struct parse_cache_entry * oldest ;
+} parse_cache = { NULL, 0, 0, 0, 0, NULL, NULL, } ;
+
+/* FNV-1a, as for the cache shards */
+static UINT ParseCache_hash( const char * path )
+{
+	UINT hash = 2166136261U ;
+
+	while ( *path != '\0' ) {
+		hash ^= (BYTE) *path++ ;
+		hash *= 16777619U ;
+	}
+	return hash ;
+}
+
+/* Take out of bucket and LRU list, and free. Called with PARSECACHELOCK */
+static void ParseCache_remove( struct parse_cache_entry * entry )
+{
+	struct parse_cache_entry ** link = &parse_cache.bucket[ entry->hash & (parse_cache.buckets-1) ] ;
+
+	while ( *link != entry ) {
+		link = &((*link)->hash_next) ;
+	}
+	*link = entry->hash_next ;
+
+	if ( entry->newer == NULL ) {
+		parse_cache.newest = entry->older ;
+	} else {
+		entry->newer->older = entry->older ;
+	}
+	if ( entry->older == NULL ) {
+		parse_cache.oldest = entry->newer ;
+	} else {
+		entry->older->newer = entry->newer ;
+	}
+	--parse_cache.count ;
+	owfree( entry ) ;
+}
+
+/* Move to the head of the LRU list. Called with PARSECACHELOCK */
+static void ParseCache_touch( struct parse_cache_entry * entry )
+{
+	if ( entry->newer == NULL ) {
+		return ; // already newest
+	}
+	entry->newer->older = entry->older ;
+	if ( entry->older == NULL ) {
+		parse_cache.oldest = entry->newer ;
+	} else {
+		entry->older->newer = entry->newer ;
+	}
+	entry->older = parse_cache.newest ;
+	entry->newer = NULL ;
+	parse_cache.newest->newer = entry ;
+	parse_cache.newest = entry ;
+}
+
+static void ParseCache_empty( void )
+{
+	while ( parse_cache.oldest != NULL ) {
+		ParseCache_remove( parse_cache.oldest ) ;
+	}
+	++parse_cache.generation ;
+}
+
+/* Size the table from --parse_cache, dropping anything already kept */
+void ParseCache_Configure( void )
+{
+	UINT buckets = 1 ;
+
+	PARSECACHELOCK ;
+	ParseCache_empty() ;
+	SAFEFREE( parse_cache.bucket ) ;
+	parse_cache.buckets = 0 ;
+	parse_cache.size = 0 ;
+	if ( Globals.parse_cache > 0 ) {
+		while ( buckets < (UINT) Globals.parse_cache ) {
+			buckets <<= 1 ;
+		}
+		parse_cache.bucket = owcalloc( buckets, sizeof( struct parse_cache_entry * ) ) ;
+		if ( parse_cache.bucket != NULL ) {
+			parse_cache.buckets = buckets ;
+			parse_cache.size = Globals.parse_cache ;
+		}
+	}
+	PARSECACHEUNLOCK ;
+}
+
+/* Bus masters changed -- kept bus pointers may be stale */
+void ParseCache_Flush( void )
+{
+	PARSECACHELOCK ;
+	ParseCache_empty() ;
+	PARSECACHEUNLOCK ;
+}
+
+void ParseCache_Close( void )
+{
+	PARSECACHELOCK ;
+	ParseCache_empty() ;
+	SAFEFREE( parse_cache.bucket ) ;
+	parse_cache.buckets = 0 ;
+	parse_cache.size = 0 ;
+	PARSECACHEUNLOCK ;
+}
+
+/* Fill pn (already set up) from a kept parse.
+ * returns parse_done (found), parse_error (device gone) or parse_first (not kept, parse it) */
+static enum parse_enum ParseCache_Get( enum parse_pass remote_status, struct parsedname * pn, UINT * generation )
+{
+	struct parse_cache_entry * entry ;
+	UINT hash = ParseCache_hash( pn->path ) ;
+	int check_presence ;
+
+	PARSECACHELOCK ;
+	*generation = parse_cache.generation ;
+	if ( parse_cache.size == 0 ) {
+		PARSECACHEUNLOCK ;
+		return parse_first ;
+	}
+	for ( entry = parse_cache.bucket[ hash & (parse_cache.buckets-1) ] ; entry != NULL ; entry = entry->hash_next ) {
+		if ( entry->hash == hash
+			&& entry->remote_status == remote_status
+			&& entry->setup_state == pn->state
+			&& strcmp( entry->path, pn->path ) == 0 ) {
+			break ;
+		}
+	}
+	if ( entry == NULL ) {
+		PARSECACHEUNLOCK ;
+		STAT_ADD1( parse_cache_misses ) ;
+		return parse_first ;
+	}
+
+	ParseCache_touch( entry ) ;
+	pn->type = entry->type ;
+	pn->state = entry->state ;
+	memcpy( pn->sn, entry->sn, SERIAL_NUMBER_SIZE ) ;
+	pn->device_name = ( entry->device_name < 0 ) ? NULL : &pn->path[ entry->device_name ] ;
+	pn->known_bus = entry->known_bus ;
+	pn->selected_connection = entry->selected_connection ;
+	pn->selected_device = entry->selected_device ;
+	pn->selected_filetype = entry->selected_filetype ;
+	pn->subdir = entry->subdir ;
+	pn->extension = entry->extension ;
+	pn->dirlength = entry->dirlength ;
+	if ( entry->bus_list == 0 ) {
+		pn->control_flags &= ~SHOULD_RETURN_BUS_LIST ;
+	}
+	strcpy( pn->path_to_server, entry->path_to_server ) ;
+	if ( entry->sparse_name != NULL ) {
+		pn->sparse_name = owstrdup( entry->sparse_name ) ;
+	}
+	check_presence = entry->check_presence ;
+	PARSECACHEUNLOCK ;
+
+	STAT_ADD1( parse_cache_hits ) ;
+
+	if ( check_presence ) {
+		// Same as when the device segment is parsed
+		return Parse_RealDeviceSN( remote_status, pn ) == parse_error ? parse_error : parse_done ;
+	}
+	return parse_done ;
+}
+
+/* Keep a successful parse (pn as it is before the remote level corrections) */
+static void ParseCache_Add( enum parse_pass remote_status, enum ePS_state setup_state, const struct parsedname * pn, UINT generation )
+{
+	struct parse_cache_entry * entry ;
+	UINT hash ;
+	int check_presence = 0 ;
+	size_t path_length, path_to_server_length, sparse_length ;
+
+	if ( parse_cache.size == 0 ) {
+		// unlocked peek, just to skip the work
+		return ;
+	}
+
+	if ( pn->ds2409_depth > 0 || pn->selected_device == &RemoteDevice ) {
+		return ;
+	}
+	if ( pn->type == ePN_real && pn->device_name != NULL ) {
+		// Only devices named by serial number, not aliases or external sensors
+		char device[ strlen( pn->device_name ) + 1 ] ;
+		BYTE sn[SERIAL_NUMBER_SIZE] ;
+
+		char * slash ;
+
+		strcpy( device, pn->device_name ) ;
+		slash = strchr( device, '/' ) ;
+		if ( slash != NULL ) {
+			*slash = '\0' ;
+		}
+		if ( Parse_SerialNumber( device, sn ) != sn_valid ) {
+			return ;
+		}
+		check_presence = 1 ;
+	} else if ( KnownBus(pn) && ! SpecifiedBus(pn) ) {
+		// located some other way
+		return ;
+	}
+
+	path_length = strlen( pn->path ) + 1 ;
+	path_to_server_length = strlen( pn->path_to_server ) + 1 ;
+	sparse_length = ( pn->sparse_name == NULL ) ? 0 : strlen( pn->sparse_name ) + 1 ;
+
+	// entry and its strings in one allocation
+	entry = owmalloc( sizeof( struct parse_cache_entry ) + path_length + path_to_server_length + sparse_length ) ;
+	if ( entry == NULL ) {
+		return ;
+	}
+	entry->hash = hash = ParseCache_hash( pn->path ) ;
+	entry->path = (char *) ( entry + 1 ) ;
+	memcpy( entry->path, pn->path, path_length ) ;
+	entry->path_to_server = entry->path + path_length ;
+	memcpy( entry->path_to_server, pn->path_to_server, path_to_server_length ) ;
+	if ( pn->sparse_name == NULL ) {
+		entry->sparse_name = NULL ;
+	} else {
+		entry->sparse_name = entry->path_to_server + path_to_server_length ;
+		memcpy( entry->sparse_name, pn->sparse_name, sparse_length ) ;
+	}
+	entry->remote_status = remote_status ;
+	entry->setup_state = setup_state ;
+	entry->type = pn->type ;
+	entry->state = pn->state ;
+	memcpy( entry->sn, pn->sn, SERIAL_NUMBER_SIZE ) ;
+	entry->device_name = ( pn->device_name == NULL ) ? -1 : pn->device_name - pn->path ;
+	entry->check_presence = check_presence ;
+	if ( check_presence && ! SpecifiedBus(pn) ) {
+		// location is looked up again on each use
+		entry->state &= ~ePS_bus ;
+		entry->known_bus = NULL ;
+		entry->selected_connection = NO_CONNECTION ;
+	} else {
+		entry->known_bus = pn->known_bus ;
+		entry->selected_connection = pn->selected_connection ;
+	}
+	entry->selected_device = pn->selected_device ;
+	entry->selected_filetype = pn->selected_filetype ;
+	entry->subdir = pn->subdir ;
+	entry->extension = pn->extension ;
+	entry->dirlength = pn->dirlength ;
+	entry->bus_list = pn->control_flags & SHOULD_RETURN_BUS_LIST ;
+
+	PARSECACHELOCK ;
+	if ( parse_cache.size == 0 || generation != parse_cache.generation ) {
+		// flushed (or resized) while parsing
+		PARSECACHEUNLOCK ;
+		owfree( entry ) ;
+		return ;
+	}
+	{
+		struct parse_cache_entry * existing ;
+		struct parse_cache_entry ** bucket = &parse_cache.bucket[ hash & (parse_cache.buckets-1) ] ;
+
+		for ( existing = *bucket ; existing != NULL ; existing = existing->hash_next ) {
+			if ( existing->hash == hash
+				&& existing->remote_status == remote_status
+				&& existing->setup_state == setup_state
+				&& strcmp( existing->path, entry->path ) == 0 ) {
+				// another thread got here first
+				PARSECACHEUNLOCK ;
+				owfree( entry ) ;
+				return ;
+			}
+		}
+
+		if ( parse_cache.count >= parse_cache.size ) {
+			ParseCache_remove( parse_cache.oldest ) ;
+		}
+
+		entry->hash_next = *bucket ;
+		*bucket = entry ;
+		entry->newer = NULL ;
+		entry->older = parse_cache.newest ;
+		if ( parse_cache.newest == NULL ) {
+			parse_cache.oldest = entry ;
+		} else {
+			parse_cache.newest->newer = entry ;
+		}
+		parse_cache.newest = entry ;
+		++parse_cache.count ;
+	}
+	PARSECACHEUNLOCK ;
+}
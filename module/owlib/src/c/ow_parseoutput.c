@@ -27,6 +27,8 @@ static SIZE_OR_ERROR OWQ_parse_output_array_no_commas(struct one_wire_query *owq
 static SIZE_OR_ERROR OWQ_parse_output_ascii_array(struct one_wire_query *owq);
 static SIZE_OR_ERROR OWQ_parse_output_offset_and_size_z(const char *string, struct one_wire_query *owq) ;
 static SIZE_OR_ERROR OWQ_parse_output_offset_and_size(const char *string, size_t length, struct one_wire_query *owq) ;
+static char * OWQ_parse_output_target(char *scratch, size_t scratch_size, struct one_wire_query *owq) ;
+static SIZE_OR_ERROR OWQ_parse_output_formatted(const char *target, size_t length, struct one_wire_query *owq) ;
 
 /*
 Change in strategy 6/2006:
@@ -110,7 +112,8 @@ static SIZE_OR_ERROR OWQ_parse_output_integer(struct one_wire_query *owq)
 	/* should only need suglen+1, but uClibc's snprintf()
 	   seem to trash 'len' if not increased */
 	int len;
-	char c[PROPERTY_LENGTH_INTEGER + 2];
+	char scratch[PROPERTY_LENGTH_INTEGER + 2];
+	char *c = OWQ_parse_output_target(scratch, sizeof(scratch), owq);
 
 	UCLIBCLOCK;
 	if ( ShouldTrim(PN(owq)) ) {
@@ -122,7 +125,7 @@ static SIZE_OR_ERROR OWQ_parse_output_integer(struct one_wire_query *owq)
 	if ((len < 0) || ((size_t) len > PROPERTY_LENGTH_INTEGER)) {
 		return -EMSGSIZE;
 	}
-	return OWQ_parse_output_offset_and_size(c, len, owq);
+	return OWQ_parse_output_formatted(c, len, owq);
 }
 
 static SIZE_OR_ERROR OWQ_parse_output_unsigned(struct one_wire_query *owq)
@@ -130,7 +133,8 @@ static SIZE_OR_ERROR OWQ_parse_output_unsigned(struct one_wire_query *owq)
 	/* should only need suglen+1, but uClibc's snprintf()
 	   seem to trash 'len' if not increased */
 	int len;
-	char c[PROPERTY_LENGTH_UNSIGNED + 2];
+	char scratch[PROPERTY_LENGTH_UNSIGNED + 2];
+	char *c = OWQ_parse_output_target(scratch, sizeof(scratch), owq);
 
 	UCLIBCLOCK;
 	if ( ShouldTrim(PN(owq)) ) {
@@ -142,7 +146,7 @@ static SIZE_OR_ERROR OWQ_parse_output_unsigned(struct one_wire_query *owq)
 	if ((len < 0) || ((size_t) len > PROPERTY_LENGTH_UNSIGNED)) {
 		return -EMSGSIZE;
 	}
-	return OWQ_parse_output_offset_and_size(c, len, owq);
+	return OWQ_parse_output_formatted(c, len, owq);
 }
 
 static SIZE_OR_ERROR OWQ_parse_output_float(struct one_wire_query *owq)
@@ -150,7 +154,8 @@ static SIZE_OR_ERROR OWQ_parse_output_float(struct one_wire_query *owq)
 	/* should only need suglen+1, but uClibc's snprintf()
 	   seem to trash 'len' if not increased */
 	int len;
-	char c[PROPERTY_LENGTH_FLOAT + 2];
+	char scratch[PROPERTY_LENGTH_FLOAT + 2];
+	char *c = OWQ_parse_output_target(scratch, sizeof(scratch), owq);
 	_FLOAT F;
 
 	switch (OWQ_pn(owq).selected_filetype->format) {
@@ -178,17 +183,20 @@ static SIZE_OR_ERROR OWQ_parse_output_float(struct one_wire_query *owq)
 	if ((len < 0) || ((size_t) len > PROPERTY_LENGTH_FLOAT)) {
 		return -EMSGSIZE;
 	}
-	return OWQ_parse_output_offset_and_size(c, len, owq);
+	return OWQ_parse_output_formatted(c, len, owq);
 }
 
 static SIZE_OR_ERROR OWQ_parse_output_date(struct one_wire_query *owq)
 {
-	char c[PROPERTY_LENGTH_DATE + 2];
+	char scratch[PROPERTY_LENGTH_DATE + 2];
+	char *c;
 	if (OWQ_size(owq) < PROPERTY_LENGTH_DATE) {
 		return -EMSGSIZE;
 	}
+	// ctime_r adds a newline and the terminator
+	c = OWQ_parse_output_target(scratch, sizeof(scratch), owq);
 	ctime_r(&OWQ_D(owq), c);
-	return OWQ_parse_output_offset_and_size(c, PROPERTY_LENGTH_DATE, owq);
+	return OWQ_parse_output_formatted(c, PROPERTY_LENGTH_DATE, owq);
 }
 
 static SIZE_OR_ERROR OWQ_parse_output_yesno(struct one_wire_query *owq)
@@ -247,6 +255,9 @@ static SIZE_OR_ERROR OWQ_parse_output_offset_and_size(const char *string, size_t
 
 	/* and copy */
 	memcpy(OWQ_buffer(owq), &string[offset], copy_length);
+	STATLOCK;
+	read_copybytes += copy_length;	/* statistics */
+	STATUNLOCK;
 	
 	// Warning, this will overwrite the I U or DATA value, 
 	// but that shouldn't matter since it's only called on ascii values
@@ -256,6 +267,29 @@ static SIZE_OR_ERROR OWQ_parse_output_offset_and_size(const char *string, size_t
 	return copy_length;
 }
 
+/* Numbers and dates are formatted straight into the caller's buffer
+   when the read starts at the beginning and it has all the room the
+   scratch buffer has (longest value plus 2, see uClibc above).
+   Otherwise into scratch, and copied from there */
+static char * OWQ_parse_output_target(char *scratch, size_t scratch_size, struct one_wire_query *owq)
+{
+	if (OWQ_offset(owq) == 0 && OWQ_size(owq) >= scratch_size) {
+		return OWQ_buffer(owq);
+	}
+	return scratch;
+}
+
+static SIZE_OR_ERROR OWQ_parse_output_formatted(const char *target, size_t length, struct one_wire_query *owq)
+{
+	if (target != OWQ_buffer(owq)) {
+		return OWQ_parse_output_offset_and_size(target, length, owq);
+	}
+	Debug_Bytes("OWQ_parse_output_formatted", (const BYTE *) target, length);
+	// same as the copy would leave it
+	OWQ_length(owq) = length;
+	return length;
+}
+
 static SIZE_OR_ERROR OWQ_parse_output_ascii(struct one_wire_query *owq)
 {
 	Debug_OWQ(owq);
@@ -307,6 +341,7 @@ static SIZE_OR_ERROR OWQ_parse_output_ascii_array(struct one_wire_query *owq)
 	size_t elements = OWQ_pn(owq).selected_filetype->ag->elements;
 	size_t total_length = 0;
 	size_t current_offset = OWQ_array_length(owq, 0);
+	size_t moved_length = 0;
 
 	for (extension = 0; extension < elements; ++extension) {
 		total_length += OWQ_array_length(owq, extension);
@@ -314,10 +349,14 @@ static SIZE_OR_ERROR OWQ_parse_output_ascii_array(struct one_wire_query *owq)
 
 	for (extension = 1; extension < elements; ++extension) {
 		memmove(&OWQ_buffer(owq)[current_offset + 1], &OWQ_buffer(owq)[current_offset], total_length - current_offset);
+		moved_length += total_length - current_offset;
 		OWQ_buffer(owq)[current_offset] = ',';
 		++total_length;
 		current_offset += 1 + OWQ_array_length(owq, extension);
 	}
+	STATLOCK;
+	read_copybytes += moved_length;	/* statistics */
+	STATUNLOCK;
 
 	return total_length;
 }
@@ -0,0 +1,231 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+#include "ow_connection.h"
+
+/* Persistent worker threads for each port
+ * Work that fans out over all the buses (presence checks, directories,
+ * batched reads) is queued to the port's workers instead of starting a
+ * thread per bus per call.
+ * A port has one worker, its bus is used by one request at a time anyway.
+ * A port to an owserver gets up to one per pooled connection, so as many
+ * requests go out at once as before.
+ * The workers are started on first use (after any daemon fork)
+ * and stopped when the port is removed.
+ * A job that fans out again runs its dispatches itself: a worker never
+ * waits on another worker (or itself).
+ */
+
+#define PORT_WORKER_THREADS 16
+
+struct port_worker {
+	pthread_t thread[PORT_WORKER_THREADS] ;
+	int threads ; // started
+	int limit ; // most threads for this port
+	int idle ; // threads waiting for a job
+	int queued ; // jobs not taken yet
+	pthread_mutex_t mutex ;
+	pthread_cond_t cond ;
+	struct port_job * head ;
+	struct port_job * tail ;
+	int quit ;
+} ;
+
+/* Set in every worker thread */
+static pthread_key_t port_worker_key ;
+static pthread_once_t port_worker_once = PTHREAD_ONCE_INIT ;
+
+static void PortWorker_key( void )
+{
+	pthread_key_create( &port_worker_key, NULL ) ;
+}
+
+static void PortJob_done( struct port_job * job )
+{
+	struct port_batch * batch = job->batch ;
+
+	_MUTEX_LOCK(batch->mutex) ;
+	if ( --batch->pending == 0 ) {
+		pthread_cond_signal(&batch->cond) ;
+	}
+	_MUTEX_UNLOCK(batch->mutex) ;
+}
+
+static void * PortWorker_thread( void * v )
+{
+	struct port_worker * pw = v ;
+
+	pthread_setspecific( port_worker_key, pw ) ;
+	while ( 1 ) {
+		struct port_job * job ;
+
+		_MUTEX_LOCK(pw->mutex) ;
+		while ( pw->head == NULL && ! pw->quit ) {
+			++pw->idle ;
+			pthread_cond_wait(&pw->cond, &pw->mutex) ;
+			--pw->idle ;
+		}
+		job = pw->head ;
+		if ( job == NULL ) {
+			// quit and nothing left to do
+			_MUTEX_UNLOCK(pw->mutex) ;
+			break ;
+		}
+		pw->head = job->next ;
+		--pw->queued ;
+		if ( pw->head == NULL ) {
+			pw->tail = NULL ;
+		}
+		_MUTEX_UNLOCK(pw->mutex) ;
+
+		job->func( job->data ) ;
+		PortJob_done( job ) ;
+	}
+	return VOID_RETURN ;
+}
+
+/* Start another thread if none is free for one more job and there is room
+ * Called with pw->mutex held. Bad only if the port has none at all */
+static GOOD_OR_BAD PortWorker_grow( struct port_worker * pw )
+{
+	if ( pw->queued < pw->idle || pw->threads >= pw->limit ) {
+		return gbGOOD ;
+	}
+	if ( pthread_create( &(pw->thread[pw->threads]), DEFAULT_THREAD_ATTR, PortWorker_thread, pw ) != 0 ) {
+		LEVEL_DEBUG("Cannot start port worker thread");
+		return pw->threads > 0 ? gbGOOD : gbBAD ;
+	}
+	++pw->threads ;
+	return gbGOOD ;
+}
+
+/* Workers for this port (none started yet). NULL if out of memory
+ * Called with WORKERLOCK held, which keeps pw until the job is queued */
+static struct port_worker * PortWorker_get( struct port_in * pin )
+{
+	struct port_worker * pw = pin->worker ;
+
+	if ( pw == NULL ) {
+		pw = owcalloc( 1, sizeof(struct port_worker) ) ;
+		if ( pw != NULL ) {
+			_MUTEX_INIT(pw->mutex) ;
+			pthread_cond_init(&pw->cond, NULL) ;
+			pw->limit = 1 ;
+			if ( BusIsServer( pin->first ) && Globals.server_connections > 1 ) {
+				pw->limit = Globals.server_connections < PORT_WORKER_THREADS ? Globals.server_connections : PORT_WORKER_THREADS ;
+			}
+			pin->worker = pw ;
+		}
+	}
+	return pw ;
+}
+
+void PortBatch_init( struct port_batch * batch )
+{
+	_MUTEX_INIT(batch->mutex) ;
+	pthread_cond_init(&batch->cond, NULL) ;
+	batch->pending = 0 ;
+}
+
+/* Wait for all the batch's jobs to finish */
+void PortBatch_wait( struct port_batch * batch )
+{
+	_MUTEX_LOCK(batch->mutex) ;
+	while ( batch->pending > 0 ) {
+		pthread_cond_wait(&batch->cond, &batch->mutex) ;
+	}
+	_MUTEX_UNLOCK(batch->mutex) ;
+	pthread_cond_destroy(&batch->cond) ;
+	_MUTEX_DESTROY(batch->mutex) ;
+}
+
+/* Queue func(data) on the port's workers as part of batch
+ * job is caller storage that must last until PortBatch_wait.
+ * Runs right here if there is no worker or we are a worker (of any port) */
+void PortWorker_dispatch( struct port_in * pin, struct port_job * job, void (*func) (void *), void * data, struct port_batch * batch )
+{
+	struct port_worker * pw ;
+
+	pthread_once( &port_worker_once, PortWorker_key ) ;
+	if ( pthread_getspecific( port_worker_key ) != NULL ) {
+		func( data ) ;
+		return ;
+	}
+
+	// PortWorker_stop can't take pw away until the job is on its queue
+	WORKERLOCK ;
+	pw = PortWorker_get( pin ) ;
+	if ( pw == NULL ) {
+		WORKERUNLOCK ;
+		func( data ) ;
+		return ;
+	}
+
+	job->func = func ;
+	job->data = data ;
+	job->batch = batch ;
+	job->next = NULL ;
+
+	_MUTEX_LOCK(pw->mutex) ;
+	if ( BAD( PortWorker_grow( pw ) ) ) {
+		_MUTEX_UNLOCK(pw->mutex) ;
+		WORKERUNLOCK ;
+		func( data ) ;
+		return ;
+	}
+
+	_MUTEX_LOCK(batch->mutex) ;
+	++batch->pending ;
+	_MUTEX_UNLOCK(batch->mutex) ;
+
+	if ( pw->tail == NULL ) {
+		pw->head = job ;
+	} else {
+		pw->tail->next = job ;
+	}
+	pw->tail = job ;
+	++pw->queued ;
+	pthread_cond_signal(&pw->cond) ;
+	_MUTEX_UNLOCK(pw->mutex) ;
+	WORKERUNLOCK ;
+	STAT_ADD1(port_jobs) ;
+}
+
+/* Stop the port's workers, finishing queued jobs first
+ * Once off the port (under WORKERLOCK) nothing more can be queued */
+void PortWorker_stop( struct port_in * pin )
+{
+	struct port_worker * pw ;
+	int thread ;
+
+	WORKERLOCK ;
+	pw = pin->worker ;
+	pin->worker = NULL ;
+	WORKERUNLOCK ;
+
+	if ( pw == NULL ) {
+		return ;
+	}
+
+	_MUTEX_LOCK(pw->mutex) ;
+	pw->quit = 1 ;
+	pthread_cond_broadcast(&pw->cond) ;
+	_MUTEX_UNLOCK(pw->mutex) ;
+
+	for ( thread = 0 ; thread < pw->threads ; ++thread ) {
+		pthread_join( pw->thread[thread], NULL ) ;
+	}
+	pthread_cond_destroy(&pw->cond) ;
+	_MUTEX_DESTROY(pw->mutex) ;
+	owfree(pw) ;
+}
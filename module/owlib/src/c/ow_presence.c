@@ -126,80 +126,67 @@ INDEX_OR_ERROR ReCheckPresence(struct parsedname *pn)
 /* lower level, cycle through the devices */
 struct checkpresence_struct {
 	struct port_in * pin;
-	struct connection_in * cin;
 	struct parsedname *pn;
 	INDEX_OR_ERROR bus_nr;
+	struct port_job job;
 };
 
-static void * CheckPresence_callback_conn(void * v)
+/* All the channels of one port, in turn (they share the port) */
+static void CheckPresence_port(void * v)
 {
 	struct checkpresence_struct * cps = (struct checkpresence_struct *) v ;
-	struct checkpresence_struct cps_next ;
-	pthread_t thread;
-	int threadbad = 0 ;
-	
-	cps_next.cin = cps->cin->next ;
-	if ( cps_next.cin == NO_CONNECTION ) {
-		threadbad = 1 ;
-	} else {
-		cps_next.pin = cps->pin ;
-		cps_next.pn = cps->pn ;
-		cps_next.bus_nr = INDEX_BAD ;
-		threadbad = pthread_create(&thread, DEFAULT_THREAD_ATTR, CheckPresence_callback_conn, (void *) (&cps_next)) ;
-	}
-	
-	cps->bus_nr = CheckThisConnection( cps->cin->index, cps->pn ) ;
-	
-	if (threadbad == 0) {		/* was a thread created? */
-		if (pthread_join(thread, NULL)==0) {
-			if ( INDEX_VALID(cps_next.bus_nr) ) {
-				cps->bus_nr = cps_next.bus_nr ;
-			}
+	struct connection_in * cin ;
+
+	for ( cin = cps->pin->first ; cin != NO_CONNECTION ; cin = cin->next ) {
+		INDEX_OR_ERROR bus_nr = CheckThisConnection( cin->index, cps->pn ) ;
+		if ( INDEX_VALID(bus_nr) ) {
+			cps->bus_nr = bus_nr ;
 		}
 	}
-	return VOID_RETURN ;
 }
 
-static void * CheckPresence_callback_port(void * v)
+/* Ports are checked at the same time by their worker threads,
+ * the first one by this thread */
+static INDEX_OR_ERROR CheckPresence_low(struct parsedname *pn)
 {
-	struct checkpresence_struct * cps = (struct checkpresence_struct *) v ;
-	struct checkpresence_struct cps_next ;
-	pthread_t thread;
-	int threadbad = 0 ;
-	
-	cps_next.pin = cps->pin->next ;
-	if ( cps_next.pin == NULL ) {
-		threadbad = 1 ;
-	} else {
-		cps_next.pn = cps->pn ;
-		cps_next.bus_nr = INDEX_BAD ;
-		threadbad = pthread_create(&thread, DEFAULT_THREAD_ATTR, CheckPresence_callback_port, (void *) (&cps_next)) ;
+	struct port_in * pin ;
+	struct checkpresence_struct * cps ;
+	struct port_batch batch ;
+	INDEX_OR_ERROR bus_nr = INDEX_BAD ;
+	int ports = 0 ;
+	int i ;
+
+	for ( pin = Inbound_Control.head_port ; pin != NULL ; pin = pin->next ) {
+		++ports ;
 	}
-	
-	cps->cin = cps->pin->first ;
-	if ( cps->cin != NO_CONNECTION ) {
-		CheckPresence_callback_conn(v) ;
+	if ( ports == 0 ) {
+		return INDEX_BAD ;
 	}
-			
-	if (threadbad == 0) {		/* was a thread created? */
-		if (pthread_join(thread, NULL)==0) {
-			if ( INDEX_VALID(cps_next.bus_nr) ) {
-				cps->bus_nr = cps_next.bus_nr ;
-			}
-		}
+
+	cps = owcalloc( ports, sizeof(struct checkpresence_struct) ) ;
+	if ( cps == NULL ) {
+		return INDEX_BAD ;
 	}
-	return VOID_RETURN ;
-}
 
-static INDEX_OR_ERROR CheckPresence_low(struct parsedname *pn)
-{
-	struct checkpresence_struct cps = { Inbound_Control.head_port, NULL, pn, INDEX_BAD };
-		
-	if ( cps.pin != NULL ) {
-		CheckPresence_callback_port( (void *) (&cps) ) ;
+	PortBatch_init( &batch ) ;
+	for ( i = 0, pin = Inbound_Control.head_port ; pin != NULL ; ++i, pin = pin->next ) {
+		cps[i].pin = pin ;
+		cps[i].pn = pn ;
+		cps[i].bus_nr = INDEX_BAD ;
+		if ( i > 0 ) {
+			PortWorker_dispatch( pin, &(cps[i].job), CheckPresence_port, &cps[i], &batch ) ;
+		}
 	}
+	CheckPresence_port( &cps[0] ) ;
+	PortBatch_wait( &batch ) ;
 
-	return cps.bus_nr;
+	for ( i = 0 ; i < ports ; ++i ) {
+		if ( INDEX_VALID(cps[i].bus_nr) ) {
+			bus_nr = cps[i].bus_nr ;
+		}
+	}
+	owfree( cps ) ;
+	return bus_nr;
 }
 
 ZERO_OR_ERROR FS_present(struct one_wire_query *owq)
@@ -279,12 +266,10 @@ static INDEX_OR_ERROR CheckThisConnection(int bus_nr, struct parsedname *pn)
 
 static GOOD_OR_BAD PresenceFromDirblob( struct parsedname * pn )
 {
-	struct dirblob db;	// cached dirblob
-	if ( GOOD( Cache_Get_Dir( &db , pn ) ) ) {
-		// Use the dirblob from the cache
-		GOOD_OR_BAD ret = ( DirblobSearch(pn->sn, &db ) >= 0 ) ? gbGOOD : gbBAD ;
-		DirblobClear( &db ) ;
-		return ret ;
+	int device_index ;
+	if ( GOOD( Cache_Get_Dir_Search( &device_index, pn->sn, pn ) ) ) {
+		// Use the dirblob in the cache
+		return ( device_index >= 0 ) ? gbGOOD : gbBAD ;
 	} else {
 		// look through actual directory
 		struct device_search ds ;
@@ -28,7 +28,9 @@ static void adjust_file_size(struct one_wire_query *owq) ;
 static SIZE_OR_ERROR FS_read_distribute(struct one_wire_query *owq) ;
 static ZERO_OR_ERROR FS_read_all( struct one_wire_query *owq_all ); 
 static ZERO_OR_ERROR FS_read_a_part( struct one_wire_query *owq_part );
-static ZERO_OR_ERROR FS_read_in_parts( struct one_wire_query *owq_all );
+static ZERO_OR_ERROR FS_read_in_parts( struct one_wire_query *owq_all, int bulk_failed );
+static ZERO_OR_ERROR FS_read_part( struct one_wire_query *owq_part, int bulk_failed );
+static ZERO_OR_ERROR FS_read_in_bulk( struct one_wire_query *owq_all );
 
 /*
 Change in strategy 6/2006:
@@ -248,11 +250,13 @@ static SIZE_OR_ERROR FS_r_given_bus(struct one_wire_query *owq)
 	} else {
 		STAT_ADD1(read_calls);	/* statistics */
 		if (DeviceLockGet(pn) == 0) {
+			size_t buffer_size = OWQ_size(owq) ; // FS_r_local trims it to the file length
 			read_or_error = FS_r_local(owq);	// this returns status
 			DeviceLockRelease(pn);
 			LEVEL_DEBUG("return=%d", read_or_error);
 			if (read_or_error >= 0) {
-				// local success -- now format in buffer
+				// local success -- now format in buffer (all of it, room to format in place)
+				OWQ_size(owq) = buffer_size ;
 				read_or_error = OWQ_parse_output(owq);	// this returns nr. bytes
 			}
 		} else {
@@ -272,6 +276,7 @@ static SIZE_OR_ERROR FS_r_virtual(struct one_wire_query *owq)
 {
 	struct parsedname *pn = PN(owq);
 	SIZE_OR_ERROR read_status = 0;
+	size_t buffer_size = OWQ_size(owq) ; // FS_r_local trims it to the file length
 
 	if (SpecifiedRemoteBus(pn)) {
 		/* The bus is not local... use a network connection instead */
@@ -303,7 +308,8 @@ static SIZE_OR_ERROR FS_r_virtual(struct one_wire_query *owq)
 			read_status = FS_r_local(owq);	// this returns status
 		}
 		if (read_status >= 0) {
-			// local success -- now format in buffer
+			// local success -- now format in buffer (all of it, room to format in place)
+			OWQ_size(owq) = buffer_size ;
 			read_status = OWQ_parse_output(owq);	// this returns nr. bytes
 		}
 	}
@@ -430,7 +436,7 @@ static SIZE_OR_ERROR FS_r_local(struct one_wire_query *owq)
 					return FS_read_all_bits(owq);
 				case EXTENSION_ALL:
 					LEVEL_DEBUG("Read a separate .ALL %s",pn->path);
-					return FS_read_in_parts(owq);
+					return FS_read_in_parts(owq, 0);
 				default:
 					LEVEL_DEBUG("Read a separate element %s",pn->path);
 					return FS_read_owq(owq);
@@ -629,8 +635,10 @@ static ZERO_OR_ERROR FS_read_owq(struct one_wire_query *owq)
 }
 
 /* Read each array element independently, but return as one long string */
+/* If the array has a bulk_read, the first element not in the cache gets all of them in one read instead */
+/* Should that fail, every element is read by itself (bulk_failed), with the tries it would get alone */
 // Handles: ALL
-static ZERO_OR_ERROR FS_read_in_parts( struct one_wire_query *owq_all )
+static ZERO_OR_ERROR FS_read_in_parts( struct one_wire_query *owq_all, int bulk_failed )
 {
 	struct parsedname *pn = PN(owq_all);
 	struct filetype * ft = pn->selected_filetype ;
@@ -639,6 +647,7 @@ static ZERO_OR_ERROR FS_read_in_parts( struct one_wire_query *owq_all )
 	size_t extension;
 	char * buffer_pointer = OWQ_buffer(owq_all) ;
 	size_t buffer_left = OWQ_size(owq_all) ;
+	char * part_buffer = NULL ; // for parts read where the longest wouldn't fit
 	
 	// single for BYTE or iteration 
 	owq_part = OWQ_create_separate( 0, owq_all ) ;
@@ -660,38 +669,84 @@ static ZERO_OR_ERROR FS_read_in_parts( struct one_wire_query *owq_all )
 		return 0 ;
 	}
 
-	if ( BAD( OWQ_allocate_read_buffer( owq_part )) ) {
-		LEVEL_DEBUG("Can't allocate buffer space");
-		OWQ_destroy( owq_part ) ;
-		return -EMSGSIZE ;
+	switch ( ft->format ) {
+		case ft_ascii:
+		case ft_vascii:
+		case ft_alias:
+		case ft_binary:
+			// parts are read straight into place, see below
+			break ;
+		default:
+			if ( BAD( OWQ_allocate_read_buffer( owq_part )) ) {
+				LEVEL_DEBUG("Can't allocate buffer space");
+				OWQ_destroy( owq_part ) ;
+				return -EMSGSIZE ;
+			}
+			break ;
 	}
 
 	/* Loop through get data */
 	for (extension = 0; extension < elements; ++extension) {
 		size_t part_length ;
 		OWQ_pn(owq_part).extension = extension;
-		if ( FS_read_owq(owq_part) < 0 ) {
-			OWQ_destroy( owq_part ) ;
-			return -EINVAL ;
-		}
-		
+
 		// Check that there is enough space for the combined message
 		switch ( ft->format ) {
 			case ft_ascii:
 			case ft_vascii:
 			case ft_alias:
 			case ft_binary:
+				part_length = FullFileLength( PN(owq_part) ) ;
+				if ( buffer_left >= part_length ) {
+					// each part goes right after the one before
+					OWQ_assign_read_buffer( buffer_pointer, part_length, 0, owq_part ) ;
+				} else {
+					// a shorter part may still fit, read it aside first
+					if ( part_buffer == NULL ) {
+						part_buffer = owmalloc( part_length + 1 ) ;
+						if ( part_buffer == NULL ) {
+							LEVEL_DEBUG("Can't allocate buffer space");
+							OWQ_destroy( owq_part ) ;
+							return -EMSGSIZE ;
+						}
+					}
+					OWQ_assign_read_buffer( part_buffer, part_length, 0, owq_part ) ;
+				}
+				if ( ! bulk_failed && ft->ag->bulk_read != NO_BULK_READ && BAD( OWQ_Cache_Get(owq_part) ) ) {
+					OWQ_destroy( owq_part ) ;
+					SAFEFREE( part_buffer ) ;
+					return FS_read_in_bulk( owq_all ) ;
+				}
+				if ( FS_read_part( owq_part, bulk_failed ) < 0 ) {
+					OWQ_destroy( owq_part ) ;
+					SAFEFREE( part_buffer ) ;
+					return -EINVAL ;
+				}
 				part_length = OWQ_length(owq_part) ;
 				if ( buffer_left < part_length ) {
 					OWQ_destroy( owq_part ) ;
+					SAFEFREE( part_buffer ) ;
 					return -EMSGSIZE ;
 				}
-				memcpy( buffer_pointer, OWQ_buffer(owq_part), part_length ) ;
+				if ( OWQ_buffer(owq_part) != buffer_pointer ) {
+					memcpy( buffer_pointer, OWQ_buffer(owq_part), part_length ) ;
+					STATLOCK;
+					read_copybytes += part_length;	/* statistics */
+					STATUNLOCK;
+				}
 				OWQ_array_length(owq_all,extension) = part_length ;
 				buffer_pointer += part_length ;
 				buffer_left -= part_length ;
 				break ;
 			default:
+				if ( ! bulk_failed && ft->ag->bulk_read != NO_BULK_READ && BAD( OWQ_Cache_Get(owq_part) ) ) {
+					OWQ_destroy( owq_part ) ;
+					return FS_read_in_bulk( owq_all ) ;
+				}
+				if ( FS_read_part( owq_part, bulk_failed ) < 0 ) {
+					OWQ_destroy( owq_part ) ;
+					return -EINVAL ;
+				}
 				// copy object (single to mixed array)
 				memcpy(&OWQ_array(owq_all)[extension], &OWQ_val(owq_part), sizeof(union value_object));
 				break;
@@ -699,9 +754,75 @@ static ZERO_OR_ERROR FS_read_in_parts( struct one_wire_query *owq_all )
 	}
 
 	OWQ_destroy( owq_part ) ;
+	SAFEFREE( part_buffer ) ;
 	return 0;
 }
 
+/* Read the whole array with the aggregate's bulk_read (one bus transaction rather than one per element) */
+/* then cache the elements as if read separately */
+// Handles: ALL
+static ZERO_OR_ERROR FS_read_in_bulk( struct one_wire_query *owq_all )
+{
+	struct parsedname *pn = PN(owq_all);
+	struct filetype * ft = pn->selected_filetype ;
+	struct one_wire_query * owq_part ;
+	size_t elements = ft->ag->elements;
+	size_t extension;
+	char * buffer_pointer = OWQ_buffer(owq_all) ;
+	ZERO_OR_ERROR read_error = (ft->ag->bulk_read) (owq_all) ;
+
+	LEVEL_DEBUG("Bulk read %s gives result %d",pn->path,read_error);
+	if ( read_error < 0 ) {
+		// it may have left anything in the buffer, start over from the first element
+		LEVEL_DEBUG("Bulk read failed, read %s element by element",pn->path);
+		return FS_read_in_parts( owq_all, 1 ) ;
+	}
+	STAT_ADD1(read_bulk);
+
+	owq_part = OWQ_create_separate( 0, owq_all ) ;
+	if ( owq_part == NO_ONE_WIRE_QUERY ) {
+		// read is fine, just not cached
+		return 0 ;
+	}
+	for (extension = 0; extension < elements; ++extension) {
+		OWQ_pn(owq_part).extension = extension;
+		switch ( ft->format ) {
+			case ft_ascii:
+			case ft_vascii:
+			case ft_alias:
+			case ft_binary:
+				// parts are back to back in the buffer
+				OWQ_assign_read_buffer( buffer_pointer, OWQ_array_length(owq_all,extension), 0, owq_part ) ;
+				OWQ_length(owq_part) = OWQ_array_length(owq_all,extension) ;
+				buffer_pointer += OWQ_array_length(owq_all,extension) ;
+				break ;
+			default:
+				memcpy(&OWQ_val(owq_part), &OWQ_array(owq_all)[extension], sizeof(union value_object));
+				break ;
+		}
+		OWQ_Cache_Add(owq_part);
+	}
+	OWQ_destroy( owq_part ) ;
+	return 0 ;
+}
+
+/* One element of FS_read_in_parts. After a failed bulk read the bus may
+ * be shaky: three tries, as the element read by itself gets in FS_read_real */
+static ZERO_OR_ERROR FS_read_part( struct one_wire_query *owq_part, int bulk_failed )
+{
+	ZERO_OR_ERROR read_error = FS_read_owq(owq_part) ;
+
+	if ( read_error < 0 && bulk_failed ) {
+		STAT_ADD1(read_tries[1]);
+		read_error = FS_read_owq(owq_part) ;
+		if ( read_error < 0 ) {
+			STAT_ADD1(read_tries[2]);
+			read_error = FS_read_owq(owq_part) ;
+		}
+	}
+	return read_error ;
+}
+
 /* read a BYTE using bits */
 // Handles: BYTE
 static ZERO_OR_ERROR FS_read_all_bits(struct one_wire_query *owq_byte)
@@ -796,6 +917,9 @@ static ZERO_OR_ERROR FS_read_a_part( struct one_wire_query *owq_part )
 			// now move current element's buffer to location
 			OWQ_length(owq_part) = OWQ_array_length(owq_all, extension) ;
 			memmove( OWQ_buffer(owq_part), buffer_pointer, OWQ_length(owq_part));
+			STATLOCK;
+			read_copybytes += OWQ_length(owq_part);	/* statistics */
+			STATUNLOCK;
 			break;
 		}
 	default:
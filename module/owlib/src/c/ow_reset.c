@@ -55,3 +55,29 @@ RESET_TYPE BUS_reset(const struct parsedname *pn)
 		return BUS_RESET_ERROR ;
 	}
 }
+
+// Reset already sent by the adapter as the start of a longer command stream
+// (bundled select). Same bookkeeping as above, but no retry or extra delay:
+// the rest of the stream went out with it, adapters only bundle when no DS2404 was seen.
+RESET_TYPE BUS_reset_bundled(RESET_TYPE reset, const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+	STAT_ADD1_BUS(e_bus_resets, in);
+
+	switch ( reset ) {
+	case BUS_RESET_OK:
+		in->reconnect_state = reconnect_ok;	// Flag as good!
+		return BUS_RESET_OK ;
+	case BUS_RESET_SHORT:
+		in->AnyDevices = anydevices_unknown;
+		LEVEL_CONNECT("1-wire bus short circuit.");
+		STAT_ADD1_BUS(e_bus_short_errors, in);
+		return BUS_RESET_SHORT;
+	case BUS_RESET_ERROR:
+	default:
+		in->reconnect_state++;	// Flag for eventual reconnection
+		LEVEL_DEBUG("Reset error. Reconnection %d/%d",in->reconnect_state,reconnect_error); 
+		STAT_ADD1_BUS(e_bus_reset_errors, in);
+		return BUS_RESET_ERROR ;
+	}
+}
@@ -17,6 +17,11 @@
 
 static void BUS_first_both(struct device_search *ds);
 static enum search_status BUS_next_3try(struct device_search *ds, const struct parsedname *pn) ;
+static int BUS_seed_usable(const struct parsedname *pn) ;
+static GOOD_OR_BAD BUS_seed_verify(struct device_search *ds, const struct parsedname *pn) ;
+static GOOD_OR_BAD BUS_seed_verify_one(const BYTE * sn, const struct dirblob *seed, const struct parsedname *pn) ;
+static enum search_status BUS_seed_next(struct device_search *ds) ;
+static void BUS_seed_keep(struct device_search *ds, const struct parsedname *pn) ;
 
 //--------------------------------------------------------------------------
 /** The 'owFirst' doesn't find the first device on the 1-Wire Net.
@@ -32,6 +37,15 @@ enum search_status BUS_first(struct device_search *ds, const struct parsedname *
 	// reset the search state
 	BUS_first_both(ds);
 	ds->search = _1W_SEARCH_ROM;
+	if ( BUS_seed_usable(pn) ) {
+		// check the last listing first, search in full only if it changed
+		if ( GOOD( BUS_seed_verify(ds, pn) ) ) {
+			STAT_ADD1(dir_verified);
+			ds->seed = seed_verified ;
+		} else {
+			ds->seed = seed_record ;
+		}
+	}
 	return BUS_next(ds, pn);
 }
 
@@ -51,6 +65,7 @@ static void BUS_first_both(struct device_search *ds)
 	ds->LastDiscrepancy = -1;
 	ds->LastDevice = 0;
 	ds->index = -1;				// true place in dirblob
+	ds->seed = seed_none;
 
 	/* Initialize dir-at-once structure */
 	DirblobInit(&(ds->gulp));
@@ -67,13 +82,21 @@ static void BUS_first_both(struct device_search *ds)
 */
 enum search_status BUS_next(struct device_search *ds, const struct parsedname *pn)
 {
-	switch ( BUS_next_3try(ds, pn) ) {
+	enum search_status next = ( ds->seed == seed_verified ) ? BUS_seed_next(ds) : BUS_next_3try(ds, pn) ;
+
+	switch ( next ) {
 		case search_good:
 			// found a device in a directory search, add to "presence" cache
 			LEVEL_DEBUG("Device found: " SNformat, SNvar(ds->sn));
 			Cache_Add_Device(pn->selected_connection->index,ds->sn) ;
+			if ( ds->seed == seed_record ) {
+				DirblobAdd(ds->sn, &(ds->gulp));
+			}
 			return search_good ;
 		case search_done:
+			if ( ds->seed == seed_record ) {
+				BUS_seed_keep(ds, pn);
+			}
 			BUS_next_cleanup(ds);
 			return search_done;
 		case search_error:
@@ -132,6 +155,7 @@ enum search_status BUS_next_both(struct device_search *ds, const struct parsedna
 {
 	enum search_status next_both ;
 	if ( pn->selected_connection->iroutines.next_both != NO_NEXT_BOTH_ROUTINE ) {
+		STAT_ADD1(dir_passes);
 		next_both = (pn->selected_connection->iroutines.next_both) (ds, pn);
 	} else {
 		next_both = BUS_next_both_bitbang( ds, pn ) ;
@@ -172,6 +196,8 @@ enum search_status BUS_next_both_bitbang(struct device_search *ds, const struct
 			return search_error ;
 		}
 
+		STAT_ADD1(dir_passes);
+
 		// Need data from a reset for AnyDevices -- obtained from BUS_data_send above
 		if (pn->selected_connection->AnyDevices == anydevices_no) {
 			ds->LastDevice = 1;
@@ -241,3 +267,122 @@ enum search_status BUS_next_both_bitbang(struct device_search *ds, const struct
 		return search_good;
 	}
 }
+
+/* Seeded root search for bit-banging masters
+ *
+ * A full search costs one pass per device, each pass 64 separate
+ * read-read-write exchanges with the master. The last root listing of the
+ * bus (in->search_seed) tells in advance what every exchange should answer,
+ * so each known device is checked with one pass sent as a single block of
+ * bits: both read slots come back 0,0 where another known device branches
+ * off, otherwise the device's bit and its complement. Any other answer is a
+ * device added, removed or replaced, and the listing is searched in full
+ * (and kept as the next seed).
+ *
+ * Adapters with their own search routine (next_both) don't benefit -- the
+ * adapter already runs the pass itself.
+ */
+static int BUS_seed_usable(const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+
+	return RootNotBranch(pn)
+		&& ( in->iroutines.next_both == NO_NEXT_BOTH_ROUTINE )
+		&& ( in->iroutines.sendback_bits != NO_SENDBACKBITS_ROUTINE ) ;
+}
+
+static GOOD_OR_BAD BUS_seed_verify(struct device_search *ds, const struct parsedname *pn)
+{
+	struct dirblob * seed = &(pn->selected_connection->search_seed) ;
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	int device_index ;
+
+	if ( DirblobElements(seed) == 0 ) {
+		// nothing to check against yet
+		return gbBAD ;
+	}
+	for ( device_index = 0 ; DirblobGet(device_index, sn, seed) == 0 ; ++device_index ) {
+		if ( BAD( BUS_seed_verify_one(sn, seed, pn) ) ) {
+			LEVEL_DEBUG("Bus listing changed at " SNformat ", full search", SNvar(sn));
+			DirblobClear(seed);
+			return gbBAD ;
+		}
+	}
+
+	// serve the listing from a copy, the seed may change between BUS_next calls
+	if ( DirblobRecreate(seed->snlist, SERIAL_NUMBER_SIZE * DirblobElements(seed), &(ds->gulp)) != 0 ) {
+		return gbBAD ;
+	}
+	return gbGOOD ;
+}
+
+static GOOD_OR_BAD BUS_seed_verify_one(const BYTE * sn, const struct dirblob *seed, const struct parsedname *pn)
+{
+	BYTE branch[64] ;
+	BYTE bits[3 * 64] ;
+	BYTE expect[3 * 64] ;
+	BYTE other[SERIAL_NUMBER_SIZE] ;
+	BYTE search = _1W_SEARCH_ROM ;
+	int other_index ;
+	int bit_number ;
+	size_t sent ;
+
+	// where other known devices leave this one's path
+	memset(branch, 0, sizeof(branch));
+	for ( other_index = 0 ; DirblobGet(other_index, other, seed) == 0 ; ++other_index ) {
+		for ( bit_number = 0 ; bit_number < 64 ; ++bit_number ) {
+			if ( UT_getbit(other, bit_number) != UT_getbit(sn, bit_number) ) {
+				branch[bit_number] = 1 ;
+				break ;
+			}
+		}
+	}
+
+	// read, read complement, write -- for each bit of the serial number
+	for ( bit_number = 0 ; bit_number < 64 ; ++bit_number ) {
+		BYTE bit = UT_getbit(sn, bit_number) ;
+		bits[3 * bit_number] = bits[3 * bit_number + 1] = 0xFF ;
+		bits[3 * bit_number + 2] = bit ? 0xFF : 0x00 ;
+		expect[3 * bit_number] = branch[bit_number] ? 0 : bit ;
+		expect[3 * bit_number + 1] = branch[bit_number] ? 0 : !bit ;
+		expect[3 * bit_number + 2] = bit ;
+	}
+
+	RETURN_BAD_IF_BAD( BUS_select(pn) ) ;
+	RETURN_BAD_IF_BAD( BUS_send_data(&search, 1, pn) ) ;
+	STAT_ADD1(dir_passes);
+	if (pn->selected_connection->AnyDevices == anydevices_no) {
+		return gbBAD ;
+	}
+
+	// as few exchanges as the master's buffer allows
+	for ( sent = 0 ; sent < sizeof(bits) ; sent += MAX_FIFO_SIZE ) {
+		size_t length = sizeof(bits) - sent ;
+		if ( length > MAX_FIFO_SIZE ) {
+			length = MAX_FIFO_SIZE ;
+		}
+		RETURN_BAD_IF_BAD( BUS_sendback_bits(&bits[sent], &bits[sent], length, pn) ) ;
+	}
+	return BUS_compare_bits(expect, bits, sizeof(bits)) ;
+}
+
+/* Listing confirmed, hand out the copy */
+static enum search_status BUS_seed_next(struct device_search *ds)
+{
+	if ( DirblobGet(++ds->index, ds->sn, &(ds->gulp)) == 0 ) {
+		return search_good ;
+	}
+	return search_done ;
+}
+
+/* Full search finished, its listing is the next seed */
+static void BUS_seed_keep(struct device_search *ds, const struct parsedname *pn)
+{
+	struct dirblob * seed = &(pn->selected_connection->search_seed) ;
+
+	DirblobClear(seed);
+	if ( DirblobPure(&(ds->gulp)) ) {
+		memcpy(seed, &(ds->gulp), sizeof(struct dirblob));
+		DirblobInit(&(ds->gulp));
+	}
+}
@@ -23,6 +23,33 @@ struct server_connection_state {
 	struct connection_in * in ;
 } ;
 
+/* Pipelined connection to an owserver, one per connection_in
+ * Reads from many threads share it: each request is tagged with an id,
+ * a reader thread hands each response to the waiting request */
+struct server_pipeline {
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor ;
+	enum pipeline_state { pipeline_unknown, pipeline_negotiating, pipeline_active, pipeline_refused, pipeline_closing, } state ;
+	uint32_t next_id ;
+	struct pipeline_request * pending ;
+	pthread_t reader ;
+	int reader_joinable ; // reader started and not yet joined
+	pthread_mutex_t mutex ; // state and pending list
+	pthread_mutex_t write_mutex ; // requests are written whole, taken before mutex
+	pthread_cond_t cond ; // a response arrived (or the reader stopped)
+} ;
+
+struct pipeline_request {
+	uint32_t id ;
+	struct client_msg * cm ;
+	char * msg ;
+	size_t size ;
+	SIZE_OR_ERROR result ;
+	int claimed ; // reader is filling msg, waiter must not leave
+	int done ;
+	struct timeval heard ; // last response or ping
+	struct pipeline_request * next ;
+} ;
+
 struct directory_element_structure {
 	const struct parsedname * pn_whole_directory ;
 	struct dirblob db ;
@@ -43,7 +70,9 @@ static void Close_Persistent( struct server_connection_state * scs) ;
 static void Release_Persistent( struct server_connection_state * scs, int granted ) ;
 
 static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct server_msg * sm, struct serverpackage *sp) ;
-static SIZE_OR_ERROR WriteToServer(int file_descriptor, struct server_msg *sm, struct serverpackage *sp);
+static SIZE_OR_ERROR WriteToServer(int file_descriptor, struct server_msg *sm, struct serverpackage *sp, const uint32_t * request_id);
+
+static SIZE_OR_ERROR Pipeline_Read( struct connection_in * in, struct server_msg * sm, struct serverpackage *sp, struct client_msg *cm, char *msg, size_t size) ;
 
 static SIZE_OR_ERROR From_Server( struct server_connection_state * scs, struct client_msg *cm, char *msg, size_t size) ;
 static void *From_ServerAlloc(struct server_connection_state * scs, struct client_msg *cm) ;
@@ -78,6 +107,18 @@ SIZE_OR_ERROR ServerRead(struct one_wire_query *owq)
 
 	// Send to owserver
 	sm.control_flags = SetupControlFlags(pn_file_entry);
+
+	// Concurrent reads share a pipelined connection when the owserver allows it
+	switch ( Pipeline_Read( scs.in, &sm, &sp, &cm, OWQ_buffer(owq), OWQ_size(owq)) ) {
+		case -ENOTCONN:
+			// no pipeline, the usual way
+			break ;
+		case -EIO:
+			return -EIO ;
+		default:
+			return cm.ret ;
+	}
+
 	if ( BAD( To_Server( &scs, &sm, &sp) ) ) {
 		Release_Persistent( &scs, 0);
 		return -EIO ;
@@ -512,152 +553,139 @@ static SIZE_OR_ERROR From_Server( struct server_connection_state * scs, struct c
 	return cm->payload;
 }
 
-static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct server_msg * sm, struct serverpackage *sp)
+/* Take an idle persistent connection from the bus's pool
+ * Connections idle longer than SERVER_PROBE_IDLE seconds are checked first
+ * (the owserver may have timed them out), recently used ones are trusted
+ * and a failed write still falls back to a new connection */
+#define SERVER_PROBE_IDLE 1
+
+static FILE_DESCRIPTOR_OR_ERROR Pool_Take( struct connection_in * in )
 {
-	struct connection_in * in = scs->in ; // for convenience
-	struct port_in * pin = in->pown ;
-	BYTE test_read[1] ;
-	int old_flags ;
-	ssize_t rcv_value ;
-	int saved_errno ;
-	
-	// initialize the variables
-	scs->file_descriptor = FILE_DESCRIPTOR_BAD ;
-	scs->persistence = Globals.no_persistence ? persistent_no : persistent_yes ;
+	struct master_server * ms = &(in->master.server) ;
+
+	while ( 1 ) {
+		struct server_connection sc ;
+		struct timeval now ;
+		BYTE test_read[1] ;
+		ssize_t rcv_value ;
 
-	// First set up the file descriptor based on persistent state
-	if (scs->persistence == persistent_no) {		
-		// no persistence wanted
-		scs->file_descriptor = ClientConnect(in);
-	} else {
-		// Persistence desired
 		BUSLOCKIN(in);
-		switch ( pin->file_descriptor ) {
-			case FILE_DESCRIPTOR_PERSISTENT_IN_USE:
-				// Currently in use, so make new non-persistent connection
-				scs->file_descriptor = ClientConnect(in);
-				scs->persistence = persistent_no ;
-				break ;
-			case FILE_DESCRIPTOR_BAD:
-				// no conection currently, so make a new one
-				scs->file_descriptor = ClientConnect(in);
-				if ( FILE_DESCRIPTOR_VALID( scs->file_descriptor ) ) {
-					pin->file_descriptor = FILE_DESCRIPTOR_PERSISTENT_IN_USE ;
-				}	
-				break ;
-			default:
-				// persistent connection idle and waiting for use
-				// connection_in is locked so this is safe
-				scs->file_descriptor = pin->file_descriptor;
-				pin->file_descriptor = FILE_DESCRIPTOR_PERSISTENT_IN_USE;
-			break ;
+		if ( ms->idle_count == 0 ) {
+			BUSUNLOCKIN(in);
+			return FILE_DESCRIPTOR_BAD ;
 		}
+		// most recently used first, it's the least likely to be stale
+		--ms->idle_count ;
+		sc = ms->idle[ms->idle_count] ;
 		BUSUNLOCKIN(in);
-	}
-	
-	// Check if the server closed the connection
-	// This is contributed by Jacob Joseph to fix a timeout problem.
-	// http://permalink.gmane.org/gmane.comp.file-systems.owfs.devel/7306
-	//rcv_value = recv(scs->file_descriptor, test_read, 1, MSG_DONTWAIT | MSG_PEEK) ;
-	old_flags = fcntl( scs->file_descriptor, F_GETFL, 0 ) ; // save socket flags
-	if ( old_flags == -1 ) {
-		rcv_value = -2 ;
-	} else if ( fcntl( scs->file_descriptor, F_SETFL, old_flags | O_NONBLOCK ) == -1 ) { // set non-blocking
-		rcv_value = -2 ;
-	} else {
-		rcv_value = recv(scs->file_descriptor, test_read, 1, MSG_PEEK) ; // test read the socket to see if closed
-		saved_errno = errno ;
-		if ( fcntl( scs->file_descriptor, F_SETFL, old_flags ) == -1 ) { // restore  socket flags
-			rcv_value = -2 ;
+
+		timernow( &now ) ;
+		if ( now.tv_sec - sc.last_used.tv_sec < SERVER_PROBE_IDLE ) {
+			return sc.file_descriptor ;
 		}
-	}
 
-	switch ( rcv_value ) {
-		case -1:
-			if ( saved_errno==EAGAIN || saved_errno==EWOULDBLOCK ) {
-				// No data to be read -- so connection healthy
-				break ;
-			}
-			// real error, fall through to close connection case
-			__attribute__ ((fallthrough));
-		case -2:
-			// fnctl error, fall through again
-			;
-			__attribute__ ((fallthrough));
-		case 0:
-			LEVEL_DEBUG("Server connection was closed.  Reconnecting.");
-			Close_Persistent( scs);
-			scs->file_descriptor = ClientConnect(in);
-			if ( FILE_DESCRIPTOR_VALID( scs->file_descriptor ) ) {
-				in->pown->file_descriptor = FILE_DESCRIPTOR_PERSISTENT_IN_USE ;
-			}
-			break ;
-		default:
-			// data to be read, so a good connection
-			break ;
+		// Check if the server closed the connection
+		// This is contributed by Jacob Joseph to fix a timeout problem.
+		// http://permalink.gmane.org/gmane.comp.file-systems.owfs.devel/7306
+		rcv_value = recv(sc.file_descriptor, test_read, 1, MSG_DONTWAIT | MSG_PEEK) ;
+		if ( rcv_value < 0 && (errno==EAGAIN || errno==EWOULDBLOCK) ) {
+			// No data to be read -- so connection healthy
+			return sc.file_descriptor ;
+		}
+		// closed (0), error, or unexpected data -- discard and try the next
+		LEVEL_DEBUG("Server connection was closed.  Reconnecting.");
+		STAT_ADD1(in->reconnect_state);
+		Test_and_Close( &(sc.file_descriptor) ) ;
 	}
+}
 
-	// Now test
-	if ( FILE_DESCRIPTOR_NOT_VALID( scs->file_descriptor ) ) {
-		STAT_ADD1(in->reconnect_state);
-		Close_Persistent( scs ) ;
-		return gbBAD ;
+/* Return a connection to the pool, or close it if the pool is full */
+static void Pool_Give( struct connection_in * in, FILE_DESCRIPTOR_OR_ERROR file_descriptor )
+{
+	struct master_server * ms = &(in->master.server) ;
+
+	BUSLOCKIN(in);
+	if ( ms->idle != NULL && ms->idle_count < Globals.server_connections ) {
+		ms->idle[ms->idle_count].file_descriptor = file_descriptor ;
+		timernow( &(ms->idle[ms->idle_count].last_used) ) ;
+		++ms->idle_count ;
+		file_descriptor = FILE_DESCRIPTOR_BAD ;
 	}
+	BUSUNLOCKIN(in);
+	Test_and_Close( &file_descriptor ) ;
+}
 
-	// Do the real work
-	if (WriteToServer(scs->file_descriptor, sm, sp) >= 0) {
-		// successful message
-		return gbGOOD;
+void ServerPoolInit(struct connection_in *in)
+{
+	in->master.server.idle_count = 0 ;
+	in->master.server.idle = NULL ;
+	if ( Globals.server_connections > 0 ) {
+		in->master.server.idle = owcalloc( Globals.server_connections, sizeof(struct server_connection) ) ;
 	}
+}
 
-	// This is where it gets a bit tricky. For non-persistent conections we're done'
-	if ( scs->persistence == persistent_no ) {
-		// not persistent, so no reconnection needed
-		Close_Persistent( scs ) ;
-		return gbBAD ;
+void ServerPoolClose(struct connection_in *in)
+{
+	struct master_server * ms = &(in->master.server) ;
+
+	while ( ms->idle_count > 0 ) {
+		--ms->idle_count ;
+		Test_and_Close( &(ms->idle[ms->idle_count].file_descriptor) ) ;
 	}
+	SAFEFREE( ms->idle ) ;
+}
+
+static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct server_msg * sm, struct serverpackage *sp)
+{
+	struct connection_in * in = scs->in ; // for convenience
 	
-	// perhaps the persistent connection is stale?
-	// Make a new one
-	scs->file_descriptor = ClientConnect(in) ;
+	// initialize the variables
+	scs->file_descriptor = FILE_DESCRIPTOR_BAD ;
+	scs->persistence = Globals.no_persistence ? persistent_no : persistent_yes ;
+
+	// First set up the file descriptor based on persistent state
+	if (scs->persistence == persistent_yes) {
+		// Persistence desired -- reuse an idle connection if there is one
+		scs->file_descriptor = Pool_Take(in) ;
+		if ( FILE_DESCRIPTOR_VALID( scs->file_descriptor ) ) {
+			// Do the real work
+			if (WriteToServer(scs->file_descriptor, sm, sp, NULL) >= 0) {
+				// successful message
+				return gbGOOD;
+			}
+			// perhaps the persistent connection is stale?
+			Test_and_Close( &(scs->file_descriptor) ) ;
+		}
+	}
 
-	// Now retest
+	// Make a new one
+	scs->file_descriptor = ClientConnect(in);
 	if ( FILE_DESCRIPTOR_NOT_VALID( scs->file_descriptor ) ) {
-		// couldn't make that new connection -- free everything
 		STAT_ADD1(in->reconnect_state);
 		Close_Persistent( scs ) ;
 		return gbBAD ;
 	}
-	
-	// Leave in->file_descriptor = FILE_DESCRIPTOR_PERSISTENT_IN_USE
 
-	// Second attempt at the write, now with new connection
-	if (WriteToServer(scs->file_descriptor, sm, sp) >= 0) {
+	// Do the real work
+	if (WriteToServer(scs->file_descriptor, sm, sp, NULL) >= 0) {
 		// successful message
 		return gbGOOD;
 	}
 
-	// bad write the second time -- clear everything
+	// bad write on a fresh connection -- clear everything
 	Close_Persistent( scs ) ;
 	return gbBAD ;
 }
 
 static void Close_Persistent( struct server_connection_state * scs)
 {
-	// First set up the file descriptor based on persistent state
-	if (scs->persistence == persistent_yes) {
-		// no persistence wanted
-		BUSLOCKIN(scs->in);
-			scs->in->pown->file_descriptor = FILE_DESCRIPTOR_BAD ;
-		BUSUNLOCKIN(scs->in);
-	}
-	
 	scs->persistence = persistent_no ;
 	Test_and_Close( &(scs->file_descriptor) ) ;
 }
 
 // should be const char * data but iovec has problems with const arguments
-static SIZE_OR_ERROR WriteToServer(int file_descriptor, struct server_msg *sm, struct serverpackage *sp)
+// request_id is only sent on pipelined connections (NULL otherwise)
+static SIZE_OR_ERROR WriteToServer(int file_descriptor, struct server_msg *sm, struct serverpackage *sp, const uint32_t * request_id)
 {
 	int payload = 0;
 	int tokens = 0;
@@ -665,9 +693,11 @@ static SIZE_OR_ERROR WriteToServer(int file_descriptor, struct server_msg *sm, s
 
 	// We use vector write -- several ranges
 	int nio = 0;
-	struct iovec io[5] = { {NULL, 0}, {NULL, 0}, {NULL, 0}, {NULL, 0}, {NULL, 0}, };
+	struct iovec io[6] = { {NULL, 0}, {NULL, 0}, {NULL, 0}, {NULL, 0}, {NULL, 0}, {NULL, 0}, };
 
 	struct server_msg net_sm ;
+	uint32_t net_id ;
+	size_t id_size = 0 ;
 
 	// Set the version
 	sm->version = MakeServerprotocol(OWSERVER_PROTOCOL_VERSION);
@@ -676,6 +706,15 @@ static SIZE_OR_ERROR WriteToServer(int file_descriptor, struct server_msg *sm, s
 	// We'll do this last since the header values (e.g. payload) change
 	nio++;
 
+	// Pipelined: the request id follows the header
+	if ( request_id != NULL ) {
+		net_id = htonl( *request_id ) ;
+		id_size = sizeof(uint32_t) ;
+		io[nio].iov_base = &net_id ;
+		io[nio].iov_len = id_size ;
+		nio++;
+	}
+
 	// Next block, the path
 	if (sp->path != 0) {	// send path (if not null)
 		// writev should take const data pointers, but I can't fix the library
@@ -750,6 +789,10 @@ static SIZE_OR_ERROR WriteToServer(int file_descriptor, struct server_msg *sm, s
 		int traffic_counter ;
 		traffic_counter = 0 ;
 		TrafficOutFD("write header" ,io[traffic_counter].iov_base,io[traffic_counter].iov_len,file_descriptor);
+		if ( request_id != NULL ) {
+			++traffic_counter;
+			TrafficOutFD("write request id" ,io[traffic_counter].iov_base,io[traffic_counter].iov_len,file_descriptor);
+		}
 		++traffic_counter;
 		TrafficOutFD("write path"  ,io[traffic_counter].iov_base,io[traffic_counter].iov_len,file_descriptor);
 		if ((sp->datasize>0) && (sp->data!=NULL)) {	// send data only for writes (if datasize not zero)
@@ -768,7 +811,7 @@ static SIZE_OR_ERROR WriteToServer(int file_descriptor, struct server_msg *sm, s
 	// End traffic display code
 
 	// Actual write of data to owserver
-	return writev(file_descriptor, io, nio) != (ssize_t) (payload + sizeof(struct server_msg) + tokens * sizeof(struct antiloop));
+	return writev(file_descriptor, io, nio) != (ssize_t) (payload + sizeof(struct server_msg) + id_size + tokens * sizeof(struct antiloop));
 }
 
 /* flag the sg for "virtual root" -- the remote bus was specifically requested */
@@ -784,6 +827,9 @@ static uint32_t SetupControlFlags(const struct parsedname *pn)
 	/* from owlib to owserver never wants alias */
 	control_flags &= ~ALIAS_REQUEST ;
 
+	/* pipelining is per connection, only asked for when opening one */
+	control_flags &= ~(PIPELINE_REQUEST | PIPELINE_GRANTED) ;
+
 	control_flags &= ~SHOULD_RETURN_BUS_LIST;
 	if (SpecifiedBus(pn)) {
 		control_flags |= SHOULD_RETURN_BUS_LIST;
@@ -793,7 +839,7 @@ static uint32_t SetupControlFlags(const struct parsedname *pn)
 }
 
 /* Clean up at end of routine,
-   either leave connection open and persistent flag available,
+   either return the connection to the pool,
    or close
 */
 static void Release_Persistent( struct server_connection_state * scs, int granted )
@@ -815,9 +861,348 @@ static void Release_Persistent( struct server_connection_state * scs, int grante
 	}
 
 	// mark as available
-	BUSLOCKIN(scs->in);
-	scs->in->pown->file_descriptor = scs->file_descriptor;
-	BUSUNLOCKIN(scs->in);
+	Pool_Give( scs->in, scs->file_descriptor ) ;
 	scs->persistence = persistent_no ; // we no longer own this connection
 	scs->file_descriptor = FILE_DESCRIPTOR_BAD ;
 }
+
+/* Pipelined reads
+ * The first read on a new connection asks for PIPELINE_REQUEST.
+ * An owserver that grants it answers with PIPELINE_GRANTED and from then on
+ * every request and response header is followed by a 32 bit request id.
+ * Older servers simply echo no grant and the connection is used the usual way.
+ */
+
+void ServerPipelineInit(struct connection_in *in)
+{
+	struct server_pipeline * pl = owcalloc(1, sizeof(struct server_pipeline)) ;
+
+	in->master.server.pipeline = pl ;
+	if ( pl == NULL ) {
+		return ;
+	}
+	pl->file_descriptor = FILE_DESCRIPTOR_BAD ;
+	pl->state = pipeline_unknown ;
+	_MUTEX_INIT(pl->mutex) ;
+	_MUTEX_INIT(pl->write_mutex) ;
+	pthread_cond_init(&pl->cond, NULL) ;
+}
+
+void ServerPipelineClose(struct connection_in *in)
+{
+	struct server_pipeline * pl = in->master.server.pipeline ;
+
+	if ( pl == NULL ) {
+		return ;
+	}
+	in->master.server.pipeline = NULL ;
+
+	_MUTEX_LOCK(pl->mutex) ;
+	pl->state = pipeline_closing ;
+	if ( FILE_DESCRIPTOR_VALID(pl->file_descriptor) ) {
+		// wakes the reader thread
+		shutdown(pl->file_descriptor, SHUT_RDWR) ;
+	}
+	_MUTEX_UNLOCK(pl->mutex) ;
+
+	// the reader uses the locks until its very end
+	if ( pl->reader_joinable ) {
+		pthread_join(pl->reader, NULL) ;
+		pl->reader_joinable = 0 ;
+	}
+
+	Test_and_Close( &(pl->file_descriptor) ) ;
+	pthread_cond_destroy(&pl->cond) ;
+	_MUTEX_DESTROY(pl->write_mutex) ;
+	_MUTEX_DESTROY(pl->mutex) ;
+	owfree(pl) ;
+}
+
+/* Read the rest of a response nobody is waiting for */
+static GOOD_OR_BAD Pipeline_Discard( FILE_DESCRIPTOR_OR_ERROR file_descriptor, size_t length )
+{
+	BYTE discard[256] ;
+	struct timeval tv = { Globals.timeout_network + 1, 0, };
+	size_t actual_read ;
+
+	while ( length > 0 ) {
+		size_t chunk = length < sizeof(discard) ? length : sizeof(discard) ;
+		tcp_read(file_descriptor, discard, chunk, &tv, &actual_read) ;
+		if ( actual_read != chunk ) {
+			return gbBAD ;
+		}
+		length -= chunk ;
+	}
+	return gbGOOD ;
+}
+
+/* Reads responses off the pipelined connection and hands them out by request id */
+static void * Pipeline_Reader( void * v )
+{
+	struct server_pipeline * pl = v ;
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor = pl->file_descriptor ;
+	struct pipeline_request * pr ;
+
+	while ( 1 ) {
+		struct client_msg cm ;
+		uint32_t network_order_id ;
+		uint32_t id ;
+		size_t actual_read ;
+		size_t rtry ;
+		struct timeval tv = { Globals.timeout_network + 1, 0, };
+
+		// wait in short steps so an idle connection still notices closing
+		if ( BAD( tcp_wait(file_descriptor, &tv) ) ) {
+			int stop ;
+			_MUTEX_LOCK(pl->mutex) ;
+			stop = (pl->state == pipeline_closing) ;
+			_MUTEX_UNLOCK(pl->mutex) ;
+			if ( stop ) {
+				break ;
+			}
+			continue ;
+		}
+
+		tcp_read(file_descriptor, (BYTE *) &cm, sizeof(struct client_msg), &tv, &actual_read) ;
+		if ( actual_read != sizeof(struct client_msg) ) {
+			break ;
+		}
+		tcp_read(file_descriptor, (BYTE *) &network_order_id, sizeof(uint32_t), &tv, &actual_read) ;
+		if ( actual_read != sizeof(uint32_t) ) {
+			break ;
+		}
+		cm.payload = ntohl(cm.payload);
+		cm.size = ntohl(cm.size);
+		cm.ret = ntohl(cm.ret);
+		cm.control_flags = ntohl(cm.control_flags);
+		cm.offset = ntohl(cm.offset);
+		id = ntohl(network_order_id) ;
+
+		_MUTEX_LOCK(pl->mutex) ;
+		for ( pr = pl->pending ; pr != NULL ; pr = pr->next ) {
+			if ( pr->id == id ) {
+				break ;
+			}
+		}
+
+		if ( cm.payload < 0 ) {
+			// delay message, the owserver is still working on it
+			if ( pr != NULL ) {
+				gettimeofday( &(pr->heard), NULL ) ;
+			}
+			_MUTEX_UNLOCK(pl->mutex) ;
+			continue ;
+		}
+
+		if ( cm.payload > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE ) {
+			_MUTEX_UNLOCK(pl->mutex) ;
+			break ;
+		}
+
+		if ( pr == NULL ) {
+			// waiter already gave up
+			_MUTEX_UNLOCK(pl->mutex) ;
+			LEVEL_DEBUG("Response for unknown pipelined request %u", (unsigned int) id) ;
+			if ( BAD( Pipeline_Discard(file_descriptor, cm.payload) ) ) {
+				break ;
+			}
+			continue ;
+		}
+
+		// The waiter sleeps until done is set, so its buffer is safe to fill
+		pr->claimed = 1 ;
+		_MUTEX_UNLOCK(pl->mutex) ;
+		rtry = cm.payload < (ssize_t) pr->size ? (size_t) cm.payload : pr->size ;
+		tcp_read(file_descriptor, (BYTE *) pr->msg, rtry, &tv, &actual_read) ;
+		if ( actual_read != rtry || BAD( Pipeline_Discard(file_descriptor, cm.payload - rtry) ) ) {
+			break ;
+		}
+
+		_MUTEX_LOCK(pl->mutex) ;
+		memcpy( pr->cm, &cm, sizeof(struct client_msg) ) ;
+		pr->result = (cm.payload == 0) ? 0 : (SIZE_OR_ERROR) rtry ;
+		pr->done = 1 ;
+		pthread_cond_broadcast(&pl->cond) ;
+		_MUTEX_UNLOCK(pl->mutex) ;
+	}
+
+	// Connection lost or closing: fail whatever is still waiting
+	_MUTEX_LOCK(pl->write_mutex) ;
+	_MUTEX_LOCK(pl->mutex) ;
+	for ( pr = pl->pending ; pr != NULL ; pr = pr->next ) {
+		if ( ! pr->done ) {
+			pr->result = -EIO ;
+			pr->done = 1 ;
+		}
+	}
+	if ( pl->state != pipeline_closing ) {
+		LEVEL_DEBUG("Pipelined owserver connection closed") ;
+		pl->state = pipeline_unknown ;
+		Test_and_Close( &(pl->file_descriptor) ) ;
+	}
+	pthread_cond_broadcast(&pl->cond) ;
+	_MUTEX_UNLOCK(pl->mutex) ;
+	_MUTEX_UNLOCK(pl->write_mutex) ;
+	return VOID_RETURN ;
+}
+
+/* Open a connection and send this read asking for pipelining.
+ * The read is answered the usual way either way.
+ * returns -ENOTCONN if the connection couldn't be made (try the usual way)
+ */
+static SIZE_OR_ERROR Pipeline_Negotiate( struct server_pipeline * pl, struct connection_in * in, struct server_msg * sm, struct serverpackage *sp, struct client_msg *cm, char *msg, size_t size)
+{
+	struct server_connection_state scs = { FILE_DESCRIPTOR_BAD, persistent_no, in, } ;
+	struct server_msg sm_request ;
+	SIZE_OR_ERROR result ;
+
+	memcpy( &sm_request, sm, sizeof(struct server_msg) ) ;
+	sm_request.control_flags |= PERSISTENT_MASK | PIPELINE_REQUEST ;
+
+	// a reader from a lost connection is finishing, only this thread starts another
+	if ( pl->reader_joinable ) {
+		pthread_join(pl->reader, NULL) ;
+		pl->reader_joinable = 0 ;
+	}
+
+	scs.file_descriptor = ClientConnect(in) ;
+	if ( FILE_DESCRIPTOR_NOT_VALID( scs.file_descriptor ) || WriteToServer(scs.file_descriptor, &sm_request, sp, NULL) < 0 ) {
+		Test_and_Close( &(scs.file_descriptor) ) ;
+		_MUTEX_LOCK(pl->mutex) ;
+		pl->state = pipeline_unknown ;
+		_MUTEX_UNLOCK(pl->mutex) ;
+		return -ENOTCONN ;
+	}
+
+	result = From_Server( &scs, cm, msg, size ) ;
+	if ( result < 0 || FILE_DESCRIPTOR_NOT_VALID( scs.file_descriptor ) ) {
+		// closed by From_Server if the answer was oversized
+		Test_and_Close( &(scs.file_descriptor) ) ;
+		_MUTEX_LOCK(pl->mutex) ;
+		pl->state = pipeline_unknown ;
+		_MUTEX_UNLOCK(pl->mutex) ;
+		return result < 0 ? -EIO : result ;
+	}
+
+	_MUTEX_LOCK(pl->mutex) ;
+	if ( pl->state == pipeline_negotiating && (cm->control_flags & PIPELINE_GRANTED) && (cm->control_flags & PERSISTENT_MASK) ) {
+		pl->file_descriptor = scs.file_descriptor ;
+		if ( pthread_create(&(pl->reader), DEFAULT_THREAD_ATTR, Pipeline_Reader, pl) == 0 ) {
+			LEVEL_DEBUG("Pipelined connection to owserver %s", SAFESTRING(DEVICENAME(in))) ;
+			pl->reader_joinable = 1 ;
+			pl->state = pipeline_active ;
+			scs.file_descriptor = FILE_DESCRIPTOR_BAD ;
+		} else {
+			pl->file_descriptor = FILE_DESCRIPTOR_BAD ;
+			pl->state = pipeline_refused ;
+		}
+	} else if ( pl->state == pipeline_negotiating ) {
+		LEVEL_DEBUG("owserver %s doesn't pipeline", SAFESTRING(DEVICENAME(in))) ;
+		pl->state = pipeline_refused ;
+	}
+	_MUTEX_UNLOCK(pl->mutex) ;
+
+	Test_and_Close( &(scs.file_descriptor) ) ;
+	return result ;
+}
+
+/* Send a read over the shared pipelined connection.
+ * returns -ENOTCONN when there is no such connection (use the usual way)
+ */
+static SIZE_OR_ERROR Pipeline_Read( struct connection_in * in, struct server_msg * sm, struct serverpackage *sp, struct client_msg *cm, char *msg, size_t size)
+{
+	struct server_pipeline * pl = in->master.server.pipeline ;
+	struct pipeline_request pr ;
+	struct pipeline_request ** prev ;
+	uint32_t id ;
+	int active ;
+	int write_ok ;
+
+	if ( pl == NULL || Globals.no_pipeline || Globals.no_persistence ) {
+		return -ENOTCONN ;
+	}
+
+	_MUTEX_LOCK(pl->mutex) ;
+	switch ( pl->state ) {
+		case pipeline_unknown:
+			// this thread finds out
+			pl->state = pipeline_negotiating ;
+			_MUTEX_UNLOCK(pl->mutex) ;
+			return Pipeline_Negotiate( pl, in, sm, sp, cm, msg, size ) ;
+		case pipeline_active:
+			break ;
+		default:
+			_MUTEX_UNLOCK(pl->mutex) ;
+			return -ENOTCONN ;
+	}
+
+	id = pl->next_id++ ;
+	memset( &pr, 0, sizeof(struct pipeline_request) ) ;
+	pr.id = id ;
+	pr.cm = cm ;
+	pr.msg = msg ;
+	pr.size = size ;
+	gettimeofday( &(pr.heard), NULL ) ;
+	pr.next = pl->pending ;
+	pl->pending = &pr ;
+	_MUTEX_UNLOCK(pl->mutex) ;
+
+	// the reader closes the socket only while holding write_mutex
+	_MUTEX_LOCK(pl->write_mutex) ;
+	_MUTEX_LOCK(pl->mutex) ;
+	active = (pl->state == pipeline_active) ;
+	_MUTEX_UNLOCK(pl->mutex) ;
+	write_ok = active && WriteToServer(pl->file_descriptor, sm, sp, &id) >= 0 ;
+	if ( active && ! write_ok ) {
+		// stream is out of step now, the reader will fail everything pending
+		shutdown(pl->file_descriptor, SHUT_RDWR) ;
+	}
+	_MUTEX_UNLOCK(pl->write_mutex) ;
+
+	_MUTEX_LOCK(pl->mutex) ;
+	if ( ! active ) {
+		// connection went away before our turn, nothing sent
+		pr.result = -ENOTCONN ;
+	} else if ( write_ok ) {
+		while ( ! pr.done ) {
+			struct timeval tv_deadline ;
+			struct timeval tv_wait = { Globals.timeout_network + 1, 0, } ;
+			struct timespec ts_deadline ;
+
+			// the deadline moves along with ping messages
+			timeradd( &(pr.heard), &tv_wait, &tv_deadline ) ;
+			ts_deadline.tv_sec = tv_deadline.tv_sec ;
+			ts_deadline.tv_nsec = tv_deadline.tv_usec * 1000 ;
+			if ( pthread_cond_timedwait(&pl->cond, &pl->mutex, &ts_deadline) == ETIMEDOUT ) {
+				struct timeval tv_now ;
+				gettimeofday( &tv_now, NULL ) ;
+				timeradd( &(pr.heard), &tv_wait, &tv_deadline ) ;
+				if ( ! pr.done && ! pr.claimed && timercmp( &tv_now, &tv_deadline, >= ) ) {
+					LEVEL_DEBUG("Pipelined request %u timed out", (unsigned int) id) ;
+					pr.result = -EIO ;
+					break ;
+				}
+			}
+		}
+	} else {
+		pr.result = -EIO ;
+	}
+
+	// unlink
+	for ( prev = &(pl->pending) ; *prev != NULL ; prev = &((*prev)->next) ) {
+		if ( *prev == &pr ) {
+			*prev = pr.next ;
+			break ;
+		}
+	}
+	_MUTEX_UNLOCK(pl->mutex) ;
+
+	if ( pr.result == -ENOTCONN ) {
+		return -ENOTCONN ;
+	}
+	if ( pr.result < 0 ) {
+		cm->ret = -EIO ;
+		return -EIO ;
+	}
+	return pr.result ;
+}
@@ -47,7 +47,7 @@ static struct filetype set_timeout[] = {
 	{"uncached", PROPERTY_LENGTH_YESNO, NON_AGGREGATE, ft_yesno, fc_static, FS_r_yesno, FS_w_yesno, VISIBLE, {.v=&Globals.uncached}, },
 };
 struct device d_set_timeout = { "timeout", "timeout", ePN_settings, COUNT_OF_FILETYPES(set_timeout),
-	set_timeout, NO_GENERIC_READ, NO_GENERIC_WRITE
+	set_timeout, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY
 };
 
 static struct filetype set_units[] = {
@@ -55,7 +55,7 @@ static struct filetype set_units[] = {
  	{"pressure_scale", 12, NON_AGGREGATE, ft_ascii, fc_static, FS_r_PS, FS_w_PS, VISIBLE, NO_FILETYPE_DATA, },
 };
 struct device d_set_units = { "units", "units", ePN_settings, COUNT_OF_FILETYPES(set_units),
-	set_units, NO_GENERIC_READ, NO_GENERIC_WRITE
+	set_units, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY
 };
 
 static struct filetype set_alias[] = {
@@ -63,16 +63,16 @@ static struct filetype set_alias[] = {
 	{"unaliased", PROPERTY_LENGTH_YESNO, NON_AGGREGATE, ft_yesno, fc_static, FS_r_yesno, FS_w_yesno, VISIBLE, {.v=&Globals.unaliased}, },
 };
 struct device d_set_alias = { "alias", "alias", ePN_settings, COUNT_OF_FILETYPES(set_alias),
-	set_alias, NO_GENERIC_READ, NO_GENERIC_WRITE
+	set_alias, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY
 };
 
-static struct aggregate Areturn_code = { N_RETURN_CODES, ag_numbers, ag_separate, };
+static struct aggregate Areturn_code = { N_RETURN_CODES, ag_numbers, ag_separate, NO_BULK_READ, };
 static struct filetype set_return_code[] = {
 	{"text", 128, &Areturn_code, ft_ascii, fc_static, FS_return_code, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
 };
 
 struct device d_set_return_code = { "return_codes", "return_codes", 0, COUNT_OF_FILETYPES(set_return_code),
-	set_return_code, NO_GENERIC_READ, NO_GENERIC_WRITE
+	set_return_code, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY
 };
 
 
@@ -59,6 +59,7 @@ READ_FUNCTION(FS_r_single);
 Make_SlaveSpecificTag_exportable(S_T, fc_volatile);	// simultaneous temperature
 Make_SlaveSpecificTag_exportable(S_V, fc_volatile);	// simultaneous voltage
 Make_SlaveSpecificTag_exportable(S_I, fc_volatile);	// simultaneous iButtonLink conversion
+Make_SlaveSpecificTag(S_C, fc_volatile);	// temperature conversion shared by reads
 
 /* -------- Structures ---------- */
 static struct filetype simultaneous[] = {
@@ -82,17 +83,25 @@ DeviceEntry(simultaneous, simultaneous, NO_GENERIC_READ, NO_GENERIC_WRITE);
 
 GOOD_OR_BAD FS_Test_Simultaneous( const struct internal_prop *ip, UINT delay, const struct parsedname * pn)
 {
-	time_t dwell_time ;
-	time_t remaining_delay ;
+	struct timeval start ;
+	struct timeval now ;
+	struct timeval dwell ;
+	long int remaining_delay ;
 
 	//LEVEL_DEBUG("TEST Simultaneous valid?");
-	if( BAD( Cache_Get_Simul_Time( ip, &dwell_time, pn)) ) {
+	if( BAD( Cache_Get_Simul_Start( ip, &start, pn)) ) {
 		LEVEL_DEBUG("No simultaneous conversion currently valid");
 		return gbBAD ; // No simultaneous valid
 	}
 
-	remaining_delay = delay - 1000 * dwell_time ;
-	LEVEL_DEBUG("TEST remaining delay=%ld, delay=%ld, 1000*dwelltime=%ld",(long int)remaining_delay,(long int)delay, (long int)(1000*dwell_time));
+	timernow( &now ) ;
+	timersub( &now, &start, &dwell ) ;
+	remaining_delay = delay - ( dwell.tv_sec * 1000 + dwell.tv_usec / 1000 ) ;
+	if ( remaining_delay > (long int) delay ) {
+		// clock went backwards
+		remaining_delay = delay ;
+	}
+	LEVEL_DEBUG("TEST remaining delay=%ld, delay=%ld",remaining_delay,(long int)delay);
 	if ( remaining_delay > 0 ) {
 		LEVEL_DEBUG("Simultaneous conversion requires %d msec delay",(int) remaining_delay);
 		UT_delay(remaining_delay) ;
@@ -102,19 +111,17 @@ GOOD_OR_BAD FS_Test_Simultaneous( const struct internal_prop *ip, UINT delay, co
 	return gbGOOD ;
 }
 
-static ZERO_OR_ERROR FS_w_convert_temp(struct one_wire_query *owq)
+/* Temperature conversion of every device on the bus (SKIP ROM)
+ * Bus already locked.
+ * powered_only refuses (gbBAD) if any device is parasite powered */
+static GOOD_OR_BAD OW_convert_temp_all( int powered_only, const struct internal_prop *ip, const struct parsedname * pn_directory )
 {
-	struct parsedname *pn = PN(owq);
-	struct parsedname s_pn_directory;
-	struct parsedname * pn_directory = &s_pn_directory ;
-	struct connection_in * in = pn->selected_connection ;
-
 	const BYTE cmd_temp[] = { _1W_SKIP_ROM, _1W_CONVERT_T };
-	const BYTE cmd_powermode[] = { _1W_READ_POWERMODE, };
+	const BYTE cmd_powermode[] = { _1W_SKIP_ROM, _1W_READ_POWERMODE, };
 	BYTE pow[1] ;
 	struct transaction_log tpower[] = {
 		TRXN_START,
-		TRXN_WRITE1(cmd_powermode),
+		TRXN_WRITE2(cmd_powermode),
 		TRXN_READ1(pow),
 		TRXN_END,
 	};
@@ -130,6 +137,105 @@ static ZERO_OR_ERROR FS_w_convert_temp(struct one_wire_query *owq)
 		TRXN_END,
 	};
 
+	// Get Power status
+	LEVEL_DEBUG("TEST if bus powered");
+	RETURN_BAD_IF_BAD(BUS_transaction_nolock(tpower, pn_directory)) ;
+
+	if ( pow[0] != 0 ) {
+		// powered
+		// Send the conversion and let the timing work out when the actual
+		// temperature reading is requested
+		Cache_Add_Simul(ip, pn_directory);	// Mark start time
+		if ( GOOD(BUS_transaction_nolock(t_powered_convert, pn_directory) ) ) {
+			return gbGOOD ;
+		}
+	} else if ( powered_only ) {
+		LEVEL_DEBUG("Parasite powered device on %s",pn_directory->path);
+		return gbBAD ;
+	} else {
+		// Unpowered prohibits other bus traffic.
+		// This is at the port level, so could be all channels of the DS2482-800, etc
+		Cache_Add_Simul(ip, pn_directory);	// Mark start time
+		if ( GOOD(BUS_transaction_nolock(t_unpowered_convert, pn_directory) )) {
+			return gbGOOD ;
+		}
+	}
+
+	Cache_Del_Simul(ip, pn_directory);	// Clear start time
+	return gbBAD ;
+}
+
+/* Is a shared conversion started less than delay msec ago? */
+static GOOD_OR_BAD FS_Coalesce_Running( UINT delay, const struct parsedname * pn )
+{
+	struct timeval start ;
+	struct timeval now ;
+	struct timeval dwell ;
+
+	RETURN_BAD_IF_BAD( Cache_Get_Simul_Start( SlaveSpecificTag(S_C), &start, pn ) ) ;
+	timernow( &now ) ;
+	timersub( &now, &start, &dwell ) ;
+	if ( dwell.tv_sec < 0 ) {
+		// clock went backwards
+		return gbBAD ;
+	}
+	return ( dwell.tv_sec * 1000 + dwell.tv_usec / 1000 < (long int) delay ) ? gbGOOD : gbBAD ;
+}
+
+/* A temperature read that needs a conversion on a powered bus
+ * Rather than convert just this device, convert the whole bus so that
+ * reads of other sensors arriving during the conversion delay share it.
+ * Once the delay is over the next read starts a new one: the shared
+ * conversion is kept apart (S_C) from one written to /simultaneous, which
+ * stands for timeout_volatile.
+ * Returns gbBAD if not possible (parasite devices, no caching, an uncached
+ * read), the caller then converts the single device */
+GOOD_OR_BAD FS_Coalesce_Simultaneous( UINT delay, const struct parsedname * pn)
+{
+	struct parsedname s_pn_directory;
+	struct parsedname * pn_directory = &s_pn_directory ;
+	UINT locks ;
+	int leader = 0 ;
+	GOOD_OR_BAD ret = gbGOOD ;
+
+	if ( Globals.no_coalesce || Globals.timeout_volatile <= 0 ) {
+		return gbBAD ;
+	}
+	if ( IsUncachedDir(pn) ) {
+		// wants a conversion of its own
+		return gbBAD ;
+	}
+
+	FS_LoadDirectoryOnly(pn_directory, pn);
+
+	// Only one conversion started, later readers find it under the bus lock
+	BUSLOCK(pn);
+	if ( BAD( FS_Coalesce_Running( delay, pn ) ) ) {
+		LEVEL_DEBUG("Start a shared conversion on %s",pn_directory->path);
+		ret = OW_convert_temp_all( 1, SlaveSpecificTag(S_C), pn_directory ) ;
+		locks = Convert_Bus_Locks( pn->selected_connection ) ;
+		leader = 1 ;
+	} else {
+		STAT_ADD1( convert_coalesced ) ;
+	}
+	BUSUNLOCK(pn);
+	RETURN_BAD_IF_BAD( ret ) ;
+
+	if ( leader ) {
+		// started it, so can poll while nothing else uses the bus
+		return Convert_Wait( locks, delay, pn ) ;
+	}
+	return FS_Test_Simultaneous( SlaveSpecificTag(S_C), delay, pn ) ;
+}
+
+static ZERO_OR_ERROR FS_w_convert_temp(struct one_wire_query *owq)
+{
+	struct parsedname *pn = PN(owq);
+	struct parsedname s_pn_directory;
+	struct parsedname * pn_directory = &s_pn_directory ;
+	struct connection_in * in = pn->selected_connection ;
+	GOOD_OR_BAD ret ;
+
 	if (OWQ_Y(owq) == 0) {
 		return 0;				// don't send convert
 	}
@@ -152,27 +258,13 @@ static ZERO_OR_ERROR FS_w_convert_temp(struct one_wire_query *owq)
 
 	FS_LoadDirectoryOnly(pn_directory, pn); // setup up for full directory message
 
-	// Get Power status
-	LEVEL_DEBUG("TEST if bus powered");
-	RETURN_BAD_IF_BAD(BUS_transaction(tpower, pn_directory)) ;
-	
-	Cache_Add_Simul(pn->selected_filetype->data.v, pn_directory);	// Mark start time
-	if ( pow[0] != 0 ) {
-		// powered
-		// Send the conversion and let the timing work out when the actual
-		// temperature reading is requested
-		if ( GOOD(BUS_transaction(t_powered_convert, pn_directory) ) ) {
-			return 0 ;
-		}
-	} else {
-		// Unpowered prohibits other bus traffic.
-		// This is at the port level, so could be all channels of the DS2482-800, etc
-		if ( GOOD(BUS_transaction(t_unpowered_convert, pn_directory) )) {
-			return 0 ;
-		}
-	}
+	BUSLOCK(pn);
+	ret = OW_convert_temp_all( 0, SlaveSpecificTag(S_T), pn_directory ) ;
+	BUSUNLOCK(pn);
 
-	Cache_Del_Simul(pn->selected_filetype->data.v, pn_directory);	// Clear start time
+	if ( GOOD( ret ) ) {
+		return 0 ;
+	}
 	LEVEL_DEBUG("Trouble setting simultaneous for %s",pn_directory->path);
 	return -EINVAL ;
 }
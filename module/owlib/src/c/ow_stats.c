@@ -51,6 +51,14 @@
 /* ----------------- */
 UINT cache_flips = 0;
 UINT cache_adds = 0;
+size_t cache_bytes = 0;
+UINT cache_evictions = 0;
+UINT cache_refused = 0;
+UINT cache_reaped = 0;
+UINT pool_hits = 0;
+UINT pool_misses = 0;
+UINT parse_cache_hits = 0;
+UINT parse_cache_misses = 0;
 struct average old_avg = { 0L, 0L, 0L, 0L, };
 struct average new_avg = { 0L, 0L, 0L, 0L, };
 struct average store_avg = { 0L, 0L, 0L, 0L, };
@@ -64,7 +72,9 @@ UINT read_calls = 0;
 UINT read_cache = 0;
 UINT read_bytes = 0;
 UINT read_cachebytes = 0;
+UINT read_copybytes = 0;
 UINT read_array = 0;
+UINT read_bulk = 0;
 UINT read_tries[3] = { 0, 0, 0, };
 UINT read_success = 0;
 struct average read_avg = { 0L, 0L, 0L, 0L, };
@@ -78,12 +88,28 @@ struct average write_avg = { 0L, 0L, 0L, 0L, };
 
 struct directory dir_main = { 0L, 0L, };
 struct directory dir_dev = { 0L, 0L, };
+UINT dir_duplicates = 0;
+UINT dir_passes = 0;
+UINT dir_verified = 0;
 UINT dir_depth = 0;
+
+// ow_port_worker.c
+UINT port_jobs = 0;
+
+// ow_convert.c
+UINT convert_released = 0;
+UINT convert_coalesced = 0;
 struct average dir_avg = { 0L, 0L, 0L, 0L, };
 
 /* max delay between a write and when reading first char */
 struct timeval max_delay = { 0, 0, };
 
+// ow_net_server.c
+struct latency server_accept_latency = { 0, { 0, 0, }, { 0, 0, }, };
+struct latency server_queue_latency = { 0, { 0, 0, }, { 0, 0, }, };
+struct latency server_handler_latency = { 0, { 0, 0, }, { 0, 0, }, };
+UINT server_deferred = 0;
+
 // ow_locks.c
 UINT total_bus_locks = 0;
 UINT total_bus_unlocks = 0;
@@ -125,6 +151,7 @@ struct average all_avg = { 0L, 0L, 0L, 0L, };
 /* ------- Prototypes ----------- */
 /* Statistics reporting */
 READ_FUNCTION(FS_stat);
+READ_FUNCTION(FS_stat_size);
 READ_FUNCTION(FS_time);
 READ_FUNCTION(FS_return_code);
 
@@ -132,6 +159,14 @@ READ_FUNCTION(FS_return_code);
 static struct filetype stats_cache[] = {
 	{"flips", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_flips}, },
 	{"additions", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_adds}, },
+	{"bytes", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_stat_size, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_bytes}, },
+	{"evictions", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_evictions}, },
+	{"refused", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_refused}, },
+	{"reaped", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_reaped}, },
+	{"pool_hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&pool_hits}, },
+	{"pool_misses", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&pool_misses}, },
+	{"parse_hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&parse_cache_hits}, },
+	{"parse_misses", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&parse_cache_misses}, },
 
 	{"primary", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
 	{"primary/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&new_avg.current}, },
@@ -180,21 +215,23 @@ static struct filetype stats_cache[] = {
 	{"device/deleted", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dev.deletes,}, },
 };
 
-struct device d_stats_cache = { "cache", "cache", 0, COUNT_OF_FILETYPES(stats_cache), stats_cache, NO_GENERIC_READ, NO_GENERIC_WRITE };
+struct device d_stats_cache = { "cache", "cache", 0, COUNT_OF_FILETYPES(stats_cache), stats_cache, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY };
 
 	// Note, the store hit rate and deletions are not shown -- too much information!
 
-static struct aggregate Aread = { 3, ag_numbers, ag_separate, };
+static struct aggregate Aread = { 3, ag_numbers, ag_separate, NO_BULK_READ, };
 static struct filetype stats_read[] = {
 	{"calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_calls}, },
 	{"cachesuccess", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_cache}, },
 	{"cachebytes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_cachebytes}, },
+	{"copybytes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_copybytes}, },
+	{"bulk", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_bulk}, },
 	{"success", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_success}, },
 	{"bytes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_bytes}, },
 	{"tries", PROPERTY_LENGTH_UNSIGNED, &Aread, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_tries}, },
 };
 
-struct device d_stats_read = { "read", "read", 0, COUNT_OF_FILETYPES(stats_read), stats_read, NO_GENERIC_READ, NO_GENERIC_WRITE };
+struct device d_stats_read = { "read", "read", 0, COUNT_OF_FILETYPES(stats_read), stats_read, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY };
 
 static struct filetype stats_write[] = {
 	{"calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&write_calls}, },
@@ -203,7 +240,7 @@ static struct filetype stats_write[] = {
 	{"tries", PROPERTY_LENGTH_UNSIGNED, &Aread, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&write_tries}, },
 };
 
-struct device d_stats_write = { "write", "write", 0, COUNT_OF_FILETYPES(stats_write), stats_write, NO_GENERIC_READ, NO_GENERIC_WRITE };
+struct device d_stats_write = { "write", "write", 0, COUNT_OF_FILETYPES(stats_write), stats_write, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY };
 
 static struct filetype stats_directory[] = {
 	{"maxdepth", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_depth}, },
@@ -211,6 +248,9 @@ static struct filetype stats_directory[] = {
 	{"bus", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
 	{"bus/calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_main.calls}, },
 	{"bus/entries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_main.entries}, },
+	{"bus/duplicates", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_duplicates}, },
+	{"bus/passes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_passes}, },
+	{"bus/verified", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_verified}, },
 
 	{"device", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
 	{"device/calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_dev.calls}, },
@@ -219,7 +259,7 @@ static struct filetype stats_directory[] = {
 
 ;
 struct device d_stats_directory = { "directory", "directory", 0, COUNT_OF_FILETYPES(stats_directory),
-	stats_directory, NO_GENERIC_READ, NO_GENERIC_WRITE
+	stats_directory, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY
 };
 
 static struct filetype stats_thread[] = {
@@ -235,6 +275,10 @@ static struct filetype stats_thread[] = {
 	{"overall/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&all_avg.count}, },
 	{"overall/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&all_avg.max}, },
 
+	{"port_jobs", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&port_jobs}, },
+	{"convert_released", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&convert_released}, },
+	{"convert_coalesced", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&convert_coalesced}, },
+
 	{"read", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
 	{"read/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_avg.current}, },
 	{"read/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_avg.sum}, },
@@ -249,16 +293,40 @@ static struct filetype stats_thread[] = {
 };
 
 struct device d_stats_thread = { "threads", "threads", 0, COUNT_OF_FILETYPES(stats_thread),
-	stats_thread, NO_GENERIC_READ, NO_GENERIC_WRITE
+	stats_thread, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY
+};
+
+/* Event loop stages (--server_workers), times in seconds */
+static struct filetype stats_server[] = {
+	{"accept", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"accept/count", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_accept_latency.count}, },
+	{"accept/total", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_time, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_accept_latency.total}, },
+	{"accept/max", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_time, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_accept_latency.max}, },
+
+	{"queue", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"queue/count", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_queue_latency.count}, },
+	{"queue/total", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_time, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_queue_latency.total}, },
+	{"queue/max", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_time, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_queue_latency.max}, },
+
+	{"handler", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"handler/count", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_handler_latency.count}, },
+	{"handler/total", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_time, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_handler_latency.total}, },
+	{"handler/max", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_time, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_handler_latency.max}, },
+
+	{"deferred", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_deferred}, },
 };
 
-static struct aggregate Areturn_code = { N_RETURN_CODES, ag_numbers, ag_separate, };
+struct device d_stats_server = { "server", "server", 0, COUNT_OF_FILETYPES(stats_server),
+	stats_server, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY
+};
+
+static struct aggregate Areturn_code = { N_RETURN_CODES, ag_numbers, ag_separate, NO_BULK_READ, };
 static struct filetype stats_return_code[] = {
 	{"responses", PROPERTY_LENGTH_UNSIGNED, &Areturn_code, ft_unsigned, fc_statistic, FS_return_code, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
 };
 
 struct device d_stats_return_code = { "return_codes", "return_codes", 0, COUNT_OF_FILETYPES(stats_return_code),
-	stats_return_code, NO_GENERIC_READ, NO_GENERIC_WRITE
+	stats_return_code, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY
 };
 
 #define FS_stat_ROW(var) {"" #var "",PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE  , ft_unsigned, fc_statistic,   FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v= & var,}, }
@@ -305,7 +373,8 @@ struct device d_stats_errors = {
 	COUNT_OF_FILETYPES(stats_errors),
 	stats_errors,
 	NO_GENERIC_READ,
-	NO_GENERIC_WRITE
+	NO_GENERIC_WRITE,
+	NO_DEVICE_DIRECTORY
 };
 
 
@@ -330,6 +399,22 @@ static ZERO_OR_ERROR FS_stat(struct one_wire_query *owq)
 	return 0;
 }
 
+/* size_t counters (memory) can pass what a UINT holds */
+static ZERO_OR_ERROR FS_stat_size(struct one_wire_query *owq)
+{
+	struct parsedname *pn = PN(owq);
+	if (pn->selected_filetype == NO_FILETYPE) {
+		return -ENOENT;
+	}
+	if (pn->selected_filetype->data.v == NULL) {
+		return -ENOENT;
+	}
+	STATLOCK;
+	OWQ_F(owq) = (_FLOAT) ((size_t *) pn->selected_filetype->data.v)[0];
+	STATUNLOCK;
+	return 0;
+}
+
 static ZERO_OR_ERROR FS_time(struct one_wire_query *owq)
 {
 	struct parsedname *pn = PN(owq);
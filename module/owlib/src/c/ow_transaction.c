@@ -27,6 +27,8 @@ struct transaction_bundle {
 	size_t max_size;
 	struct memblob mb;
 	int select_first;
+	int select_and_power;	// adapter can end a selected bundle with a powered byte
+	int power;				// last byte is powered, nothing more on the bus
 };
 
 // static int BUS_transaction_length( const struct transaction_log * tl, const struct parsedname * pn ) ;
@@ -234,6 +236,7 @@ static void Bundle_init(struct transaction_bundle *tb, const struct parsedname *
 	memset(tb, 0, sizeof(struct transaction_bundle));
 	MemblobInit(&tb->mb, TRANSACTION_INCREMENT);
 	tb->max_size = pn->selected_connection->bundling_length;
+	tb->select_and_power = ( pn->selected_connection->iroutines.select_and_power != NO_SELECTANDPOWER_ROUTINE ) ;
 }
 
 static GOOD_OR_BAD Bundle_pack(const struct transaction_log *tl, const struct parsedname *pn)
@@ -280,6 +283,7 @@ static GOOD_OR_BAD Bundle_ship(struct transaction_bundle *tb, const struct parse
 		MemblobClear(&tb->mb);
 		tb->packets = 0;
 		tb->select_first = 0;
+		tb->power = 0;
 		return gbBAD;
 	}
 
@@ -289,7 +293,10 @@ static GOOD_OR_BAD Bundle_ship(struct transaction_bundle *tb, const struct parse
 // Execute a bundle transaction (actual bytes on 1-wire bus)
 static GOOD_OR_BAD Bundle_enroute(struct transaction_bundle *tb, const struct parsedname *pn)
 {
-	if (tb->select_first) {
+	if (tb->power) {
+		// only packed after a select
+		return BUS_select_and_power(MemblobData(&(tb->mb)), MemblobData(&(tb->mb)), MemblobLength(&(tb->mb)), pn);
+	} else if (tb->select_first) {
 		return BUS_select_and_sendback(MemblobData(&(tb->mb)), MemblobData(&(tb->mb)), MemblobLength(&(tb->mb)), pn);
 	} else {
 		return BUS_sendback_data(MemblobData(&(tb->mb)), MemblobData(&(tb->mb)), MemblobLength(&(tb->mb)), pn);
@@ -305,6 +312,36 @@ static GOOD_OR_BAD Pack_item(const struct transaction_log *tl, struct transactio
 {
 	GOOD_OR_BAD ret = 0;				//default return value for good packets;
 	//printf("PACK_ITEM used=%d size=%d max=%d\n",MemblobLength(&(tl>mb)),tl->size,tb->max_size);
+	if (tb->select_and_power) {
+		switch (tl->type) {
+		case trxn_bitread:
+		case trxn_bitmatch:
+		case trxn_bitmodify:
+		case trxn_bitpower:
+		case trxn_program:
+			// bit and pulse commands are the adapter's own
+			return gbBAD;
+		default:
+			break;
+		}
+	}
+	if (tb->power) {
+		// powered byte ends the bus traffic, only checks and delays can follow
+		switch (tl->type) {
+		case trxn_compare:
+		case trxn_bitcompare:
+		case trxn_crc8:
+		case trxn_crc8seeded:
+		case trxn_crc16:
+		case trxn_crc16seeded:
+		case trxn_delay:
+		case trxn_udelay:
+		case trxn_nop:
+			break;
+		default:
+			return gbOTHER;
+		}
+	}
 	switch (tl->type) {
 	case trxn_select:			// select a 1-wire device (by unique ID)
 		LEVEL_DEBUG("pack=SELECT");
@@ -356,9 +393,13 @@ static GOOD_OR_BAD Pack_item(const struct transaction_log *tl, struct transactio
 		if (1 + MemblobLength(&(tb->mb)) > tb->max_size) {
 			return gbOTHER;		// too big for this partial bundle
 		}
+		if (tb->select_and_power && !tb->select_first) {
+			return gbBAD;		// not selected here, use the adapter's power byte
+		}
 		if (MemblobAdd(tl->out, 1, &tb->mb)) {
 			return gbBAD;
 		}
+		tb->power = tb->select_and_power;
 		ret = gbGOOD;			// needs delay
 		break;
 	case trxn_crc8:
@@ -501,6 +542,7 @@ static GOOD_OR_BAD Bundle_unpack(struct transaction_bundle *tb)
 	MemblobClear(&tb->mb);
 	tb->packets = 0;
 	tb->select_first = 0;
+	tb->power = 0;
 
 	return ret;
 }
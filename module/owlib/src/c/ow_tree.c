@@ -16,7 +16,8 @@
 
 static int device_compare(const void *a, const void *b);
 static int file_compare(const void *a, const void *b);
-static void Device2Tree(const struct device *d, enum ePN_type type);
+static void Device2Tree(struct device *d, enum ePN_type type);
+static void DeviceDirectory_build(struct device *d);
 static void External_Process(void);
 
 struct device *DeviceSimultaneous;
@@ -35,8 +36,176 @@ static int file_compare(const void *a, const void *b)
 void *Tree[ePN_max_type];
 
 
+/* Directory listing of each device, in the order FS_devdir lists it.
+   Built in two passes over the sorted filetypes, first counting (dd NULL)
+   then filling in a single allocation */
+struct device_directory_build {
+	struct device_directory * dd ;
+	int levels ;
+	int entries ;
+	size_t names_length ;
+	char * names ;
+} ;
+
+static void DeviceDirectory_add( struct device_directory_build * ddb, struct filetype * ft, int extension, const char * namepart, const char * suffix, int parse )
+{
+	char name[OW_FULLNAME_MAX+1] ;
+	size_t length ;
+
+	UCLIBCLOCK;
+	if ( suffix == NULL ) {
+		snprintf( name, sizeof(name), "%s", namepart ) ;
+	} else {
+		snprintf( name, sizeof(name), "%s.%s", namepart, suffix ) ;
+	}
+	UCLIBCUNLOCK;
+	length = strlen( name ) + 1 ;
+
+	if ( ddb->dd != NULL ) {
+		struct device_directory_entry * entry = &(ddb->dd->entry[ddb->entries]) ;
+		entry->ft = ft ;
+		entry->extension = extension ;
+		entry->elements = ( ft->ag == NON_AGGREGATE ) ? 0 : ft->ag->elements ;
+		entry->name = ddb->names ;
+		entry->parse = parse ;
+		entry->conditional = ( ft->visible != AlwaysVisible ) ;
+		if ( entry->conditional ) {
+			ddb->dd->conditional = 1 ;
+		}
+		memcpy( ddb->names, name, length ) ;
+		ddb->names += length ;
+	}
+	++ ddb->entries ;
+	ddb->names_length += length ;
+}
+
+// Properties directly in subdir (or the device directory itself)
+static void DeviceDirectory_level( struct device_directory_build * ddb, struct device * d, struct filetype * subdir )
+{
+	struct filetype *lastft = &(d->filetype_array[d->count_of_filetypes]);	/* last filetype struct */
+	struct filetype *ft_pointer;
+	char subdir_name[OW_FULLNAME_MAX + 1];
+	size_t subdir_len;
+	int first = ddb->entries ;
+
+	if (subdir == NO_SUBDIR) {
+		subdir_name[0] = '\0' ;
+		subdir_len = 0;
+		ft_pointer = d->filetype_array;
+	} else {
+		// sorted, so the subdir's properties follow it
+		strncpy(subdir_name, subdir->name, OW_FULLNAME_MAX);
+		subdir_name[OW_FULLNAME_MAX] = '\0' ;
+		strcat(subdir_name, "/");
+		subdir_len = strlen(subdir_name);
+		ft_pointer = subdir + 1;
+	}
+
+	for (; ft_pointer < lastft; ++ft_pointer) {
+		char *namepart ;
+
+		if (strncmp(ft_pointer->name, subdir_name, subdir_len) != 0) {
+			// end of subdir
+			break;
+		}
+
+		namepart = &ft_pointer->name[subdir_len];
+		if ( strchr( namepart, '/') != NULL) {
+			// in a deeper subdir
+			continue;
+		}
+
+		if (ft_pointer->ag==NON_AGGREGATE) {
+			DeviceDirectory_add( ddb, ft_pointer, 0, namepart, NULL, ft_pointer->format==ft_directory ) ;
+		} else if (ft_pointer->ag->combined==ag_sparse) {
+			DeviceDirectory_add( ddb, ft_pointer, EXTENSION_UNKNOWN, namepart, (ft_pointer->ag->letters==ag_letters) ? "xxx" : "000", 1 ) ;
+		} else {
+			int extension;
+			int first_extension = (ft_pointer->format == ft_bitfield) ? EXTENSION_BYTE : EXTENSION_ALL;
+			for (extension = first_extension; extension < ft_pointer->ag->elements; ++extension) {
+				char number[12] ;
+				const char * suffix ;
+				if (extension == EXTENSION_BYTE ) {
+					suffix = "BYTE" ;
+				} else if (extension == EXTENSION_ALL ) {
+					suffix = "ALL" ;
+				} else if (ft_pointer->ag->letters == ag_letters) {
+					number[0] = 'A' + extension ;
+					number[1] = '\0' ;
+					suffix = number ;
+				} else {
+					UCLIBCLOCK;
+					snprintf( number, sizeof(number), "%d", extension ) ;
+					UCLIBCUNLOCK;
+					suffix = number ;
+				}
+				DeviceDirectory_add( ddb, ft_pointer, extension, namepart, suffix, 0 ) ;
+			}
+		}
+	}
+
+	if ( ddb->dd != NULL ) {
+		struct device_directory_level * level = &(ddb->dd->level[ddb->levels]) ;
+		level->subdir = subdir ;
+		level->first = first ;
+		level->count = ddb->entries - first ;
+	}
+	++ ddb->levels ;
+}
+
+static void DeviceDirectory_walk( struct device_directory_build * ddb, struct device * d )
+{
+	int i ;
+
+	ddb->levels = 0 ;
+	ddb->entries = 0 ;
+	ddb->names_length = 0 ;
+	DeviceDirectory_level( ddb, d, NO_SUBDIR ) ;
+	for ( i = 0 ; i < d->count_of_filetypes ; ++i ) {
+		if ( d->filetype_array[i].format == ft_subdir ) {
+			DeviceDirectory_level( ddb, d, &(d->filetype_array[i]) ) ;
+		}
+	}
+}
+
+// Needs the filetypes sorted
+static void DeviceDirectory_build(struct device *d)
+{
+	struct device_directory_build ddb ;
+	struct device_directory * dd ;
+
+	if ( d->filetype_array == NULL || d->directory != NULL ) {
+		return ;
+	}
+
+	// count
+	ddb.dd = NULL ;
+	DeviceDirectory_walk( &ddb, d ) ;
+
+	dd = owmalloc( sizeof(struct device_directory)
+		+ ddb.levels * sizeof(struct device_directory_level)
+		+ ddb.entries * sizeof(struct device_directory_entry)
+		+ ddb.names_length ) ;
+	if ( dd == NULL ) {
+		// FS_devdir parses each entry instead
+		return ;
+	}
+	dd->levels = ddb.levels ;
+	dd->level = (struct device_directory_level *) &dd[1] ;
+	dd->entries = ddb.entries ;
+	dd->entry = (struct device_directory_entry *) &(dd->level[ddb.levels]) ;
+	dd->conditional = 0 ;
+
+	// fill in
+	ddb.dd = dd ;
+	ddb.names = (char *) &(dd->entry[ddb.entries]) ;
+	DeviceDirectory_walk( &ddb, d ) ;
+
+	d->directory = dd ;
+}
+
 #ifdef __FreeBSD__
-static void Device2Tree(const struct device *d, enum ePN_type type)
+static void Device2Tree(struct device *d, enum ePN_type type)
 {
 	// FreeBSD fix from Robert Nilsson
 	/*  In order for DeviceDestroy to work on FreeBSD we must copy the keys.
@@ -56,9 +225,10 @@ static void Device2Tree(const struct device *d, enum ePN_type type)
 	if (d_copy->filetype_array != NULL) {
 		qsort(d_copy->filetype_array, (size_t) d_copy->count_of_filetypes, sizeof(struct filetype), file_compare);
 	}
+	DeviceDirectory_build(d_copy);
 }
 #else    /* not FreeBSD */
-static void Device2Tree(const struct device *d, enum ePN_type type)
+static void Device2Tree(struct device *d, enum ePN_type type)
 {
 	// Add in the device into the appropriate red/black tree
 	tsearch(d, &Tree[type], device_compare);
@@ -66,26 +236,23 @@ static void Device2Tree(const struct device *d, enum ePN_type type)
 	if (d->filetype_array != NULL) {
 		qsort(d->filetype_array, (size_t) d->count_of_filetypes, sizeof(struct filetype), file_compare);
 	}
+	DeviceDirectory_build(d);
 }
 #endif							/* __FreeBSD__ */
 
 static void free_node(void *nodep)
 {
-	(void) nodep;
-	/* nothing to free */
-	return;
+	/* static device, only its directory listing to free */
+	struct device * d = nodep ;
+	SAFEFREE( d->directory ) ;
 }
 
 void DeviceDestroy(void)
 {
 	UINT i;
 
-	// clear external trees
-	tdestroy( sensor_tree, owfree_func ) ;
-	tdestroy( family_tree, owfree_func ) ;
-	tdestroy( property_tree, owfree_func ) ;
-
 	// clear these trees -- have static data
+	// (external devices too, before their family nodes go)
 	for (i = 0; i < (sizeof(Tree) / sizeof(void *)); i++) {
 		/* ePN_structure is just a duplicate of ePN_real */
 		if (i != ePN_structure) {
@@ -95,6 +262,13 @@ void DeviceDestroy(void)
 			Tree[i] = NULL;
 		}
 	}
+
+	// clear external trees
+	tdestroy( sensor_tree, owfree_func ) ;
+	tdestroy( family_tree, owfree_func ) ;
+	tdestroy( property_tree, owfree_func ) ;
+
+	SAFEFREE( UnknownDevice.directory ) ;
 }
 
 void DeviceSort(void)
@@ -103,6 +277,7 @@ void DeviceSort(void)
 
 	/* Sort the filetypes for the unrecognized device */
 	qsort(UnknownDevice.filetype_array, (size_t) UnknownDevice.count_of_filetypes, sizeof(struct filetype), file_compare);
+	DeviceDirectory_build( & UnknownDevice ) ;
 
 	Device2Tree( & d_Example_slave,  ePN_real);
 
@@ -178,6 +353,7 @@ void DeviceSort(void)
 	Device2Tree( & d_stats_errors,         ePN_statistics);
 	Device2Tree( & d_stats_read,           ePN_statistics);
 	Device2Tree( & d_stats_thread,         ePN_statistics);
+	Device2Tree( & d_stats_server,         ePN_statistics);
 	Device2Tree( & d_stats_write,          ePN_statistics);
 	Device2Tree( & d_stats_return_code,    ePN_statistics);
 
@@ -218,7 +394,7 @@ void DeviceSort(void)
 struct device * FS_devicefindhex(BYTE f, struct parsedname *pn)
 {
 	char ID[] = "XX";
-	const struct device d = { ID, NULL, 0, 0, NULL, NO_GENERIC_READ, NO_GENERIC_WRITE };
+	const struct device d = { ID, NULL, 0, 0, NULL, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY };
 	struct device_opaque *p;
 
 	num2string(ID, f);
@@ -235,7 +411,7 @@ struct device * FS_devicefindhex(BYTE f, struct parsedname *pn)
 
 void FS_devicefind(const char *code, struct parsedname *pn)
 {
-	const struct device d = { code, NULL, 0, 0, NULL, NO_GENERIC_READ, NO_GENERIC_WRITE };
+	const struct device d = { code, NULL, 0, 0, NULL, NO_GENERIC_READ, NO_GENERIC_WRITE, NO_DEVICE_DIRECTORY };
 	struct device_opaque *p = tfind(&d, &Tree[pn->type], device_compare);
 	if (p) {
 		pn->selected_device = p->key;
@@ -318,7 +494,7 @@ static void External_family_action(const void *nodep, const VISIT which, const i
 		twalk( property_tree, External_propertycopy_action);
 
 		// Finally add to tree
-		Device2Tree( & (p->dev), ePN_real);
+		Device2Tree( & (non_const_f->dev), ePN_real);
 		break ;
 	case preorder:
 	case endorder:
@@ -0,0 +1,375 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+/* DS9490R-W USB 1-Wire master
+
+   Block I/O with the libusb asynchronous API (--usb_async)
+
+   The synchronous path (DS9490_sendback_sync) handles one USB_FIFO_EACH
+   block at a time: bulk write, BLOCK_IO control message, poll the status
+   endpoint with a sleep between polls until the bytes are there, bulk read.
+
+   Here the same steps are transfers whose callbacks queue the next step:
+     the next block is written to the EP2 FIFO while the one before is still
+       on the 1-wire bus (the FIFOs hold USB_FIFO_SIZE, two blocks)
+     an interrupt transfer on EP1 stays queued, the DS2490 answers it with
+       a status packet, so there is no sleep between polls
+     the bulk read of a block is queued as soon as the status shows its bytes
+
+   The callbacks run inside libusb_handle_events_timeout_completed, in this
+   thread or in another one handling events on the same libusb context.
+*/
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+#include "ow_counters.h"
+#include "ow_connection.h"
+#include "ow_usb_msg.h"
+
+#if OW_USB						/* conditional inclusion of USB */
+
+/* Status packets to wait for one block, as the synchronous loop */
+#define USB_ASYNC_STATUS_LIMIT	100
+
+/* Event handling errors before the transfers are given up on */
+#define USB_ASYNC_HANDLE_ERRORS	10
+
+struct usb_async {
+	struct connection_in * in ;
+	libusb_device_handle * usb ;
+	BYTE * data ;
+	BYTE * resp ;
+	size_t len ;
+	UINT block_io ;
+	unsigned int timeout ;
+
+	size_t written ;	// bytes in the EP2 FIFO (or already sent)
+	size_t started ;	// bytes with a BLOCK_IO command given
+	size_t available ;	// bytes in the EP3 FIFO, from the last status
+	size_t read ;		// bytes read back into resp
+
+	struct libusb_transfer * write ;
+	struct libusb_transfer * control ;
+	struct libusb_transfer * status ;
+	struct libusb_transfer * input ;
+	int writing ;
+	int starting ;
+	int polling ;
+	int reading ;
+	int in_flight ;		// submitted, callback not run yet
+
+	int status_count ;	// status packets since the last read
+	int reset_device ;	// adapter never got the bytes, reset after
+	int failed ;
+	int finished ;		// failed or done, and nothing in flight
+
+	BYTE setup[LIBUSB_CONTROL_SETUP_SIZE] ;
+	BYTE status_buffer[DS9490_getstatus_BUFFER_LENGTH] ;
+};
+
+static void usb_async_queue( struct usb_async * ua ) ;
+static void usb_async_fail( struct usb_async * ua ) ;
+static void usb_async_cancel( struct usb_async * ua ) ;
+static void usb_async_settle( struct usb_async * ua ) ;
+static size_t usb_async_block( size_t location, size_t len ) ;
+static void LIBUSB_CALL usb_async_write_callback( struct libusb_transfer * transfer ) ;
+static void LIBUSB_CALL usb_async_control_callback( struct libusb_transfer * transfer ) ;
+static void LIBUSB_CALL usb_async_status_callback( struct libusb_transfer * transfer ) ;
+static void LIBUSB_CALL usb_async_read_callback( struct libusb_transfer * transfer ) ;
+
+GOOD_OR_BAD DS9490_sendback_async(BYTE * data, BYTE * resp, size_t len, UINT block_io, const struct parsedname *pn)
+{
+	struct usb_async ua ;
+	int handle_errors = 0 ;
+
+	memset( &ua, 0, sizeof(struct usb_async) ) ;
+	ua.in = pn->selected_connection ;
+	ua.usb = ua.in->master.usb.lusb_handle ;
+	ua.data = data ;
+	ua.resp = resp ;
+	ua.len = len ;
+	ua.block_io = block_io ;
+	ua.timeout = ua.in->master.usb.timeout ;
+
+	if ( ua.usb == NULL ) {
+		return gbBAD ;
+	}
+	if ( len == 0 ) {
+		return gbGOOD ;
+	}
+
+	ua.write = libusb_alloc_transfer(0) ;
+	ua.control = libusb_alloc_transfer(0) ;
+	ua.status = libusb_alloc_transfer(0) ;
+	ua.input = libusb_alloc_transfer(0) ;
+	if ( ua.write == NULL || ua.control == NULL || ua.status == NULL || ua.input == NULL ) {
+		LEVEL_DEBUG("Cannot allocate USB transfers") ;
+		ua.failed = 1 ;
+	} else {
+		usb_async_queue( &ua ) ;
+	}
+	usb_async_settle( &ua ) ;
+
+	while ( ! ua.finished ) {
+		struct timeval tv = { 1, 0, } ;
+		int ret = libusb_handle_events_timeout_completed( Globals.luc, &tv, &ua.finished ) ;
+		if ( ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED ) {
+			LEVEL_DEBUG("<%s> USB event handling problem", libusb_error_name(ret)) ;
+			usb_async_fail( &ua ) ;
+			if ( ++handle_errors > USB_ASYNC_HANDLE_ERRORS ) {
+				// the transfers point at ua (and the caller's buffers) until
+				// their callbacks have run, so keep cancelling and waiting
+				if ( handle_errors == USB_ASYNC_HANDLE_ERRORS + 1 ) {
+					LEVEL_DEFAULT("USB transfers on %s abandoned, waiting for them to be cancelled", DEVICENAME(ua.in)) ;
+				}
+				usb_async_cancel( &ua ) ;
+				UT_delay( 100 ) ;
+			}
+		}
+	}
+
+	if ( ua.write != NULL ) {
+		libusb_free_transfer( ua.write ) ;
+	}
+	if ( ua.control != NULL ) {
+		libusb_free_transfer( ua.control ) ;
+	}
+	if ( ua.status != NULL ) {
+		libusb_free_transfer( ua.status ) ;
+	}
+	if ( ua.input != NULL ) {
+		libusb_free_transfer( ua.input ) ;
+	}
+
+	if ( ua.reset_device ) {
+		// as the synchronous path, the adapter never got idle
+		USB_Control_Msg(CONTROL_CMD, CTL_RESET_DEVICE, 0x0000, pn) ;
+	}
+	return ua.failed ? gbBAD : gbGOOD ;
+}
+
+static size_t usb_async_block( size_t location, size_t len )
+{
+	size_t block = len - location ;
+	return block > USB_FIFO_EACH ? USB_FIFO_EACH : block ;
+}
+
+/* Submit whatever can go now */
+static void usb_async_queue( struct usb_async * ua )
+{
+	int ret ;
+
+	if ( ua->failed ) {
+		return ;
+	}
+
+	// next block into the EP2 FIFO, if it fits with what is not read back yet
+	if ( ! ua->writing && ua->written < ua->len ) {
+		size_t block = usb_async_block( ua->written, ua->len ) ;
+		if ( ua->written + block - ua->read <= USB_FIFO_SIZE ) {
+			libusb_fill_bulk_transfer( ua->write, ua->usb, DS2490_EP2, &ua->data[ua->written], block, usb_async_write_callback, ua, ua->timeout ) ;
+			if ( (ret=libusb_submit_transfer( ua->write )) != 0 ) {
+				LEVEL_DATA("<%s> USB async bulk write problem", libusb_error_name(ret));
+				STAT_ADD1_BUS(e_bus_write_errors, ua->in);
+				usb_async_fail( ua ) ;
+				return ;
+			}
+			ua->writing = 1 ;
+			++ua->in_flight ;
+		}
+	}
+
+	// 1-wire transfer of a block already in the FIFO
+	if ( ! ua->starting && ua->started < ua->written ) {
+		size_t block = usb_async_block( ua->started, ua->len ) ;
+		libusb_fill_control_setup( ua->setup, CONTROL_REQUEST_TYPE, COMM_CMD, ua->block_io, block, 0 ) ;
+		libusb_fill_control_transfer( ua->control, ua->usb, ua->setup, usb_async_control_callback, ua, ua->timeout ) ;
+		if ( (ret=libusb_submit_transfer( ua->control )) != 0 ) {
+			LEVEL_DATA("<%s> USB async control problem", libusb_error_name(ret));
+			STAT_ADD1_BUS(e_bus_errors, ua->in);
+			usb_async_fail( ua ) ;
+			return ;
+		}
+		ua->starting = 1 ;
+		++ua->in_flight ;
+	}
+
+	// read back a finished block, or ask the status endpoint
+	if ( ! ua->reading && ! ua->polling && ua->read < ua->started ) {
+		size_t block = usb_async_block( ua->read, ua->len ) ;
+		if ( ua->available >= block ) {
+			libusb_fill_bulk_transfer( ua->input, ua->usb, DS2490_EP3, &ua->resp[ua->read], block, usb_async_read_callback, ua, ua->timeout ) ;
+			if ( (ret=libusb_submit_transfer( ua->input )) != 0 ) {
+				LEVEL_DATA("<%s> USB async bulk read problem", libusb_error_name(ret));
+				STAT_ADD1_BUS(e_bus_read_errors, ua->in);
+				usb_async_fail( ua ) ;
+				return ;
+			}
+			ua->reading = 1 ;
+		} else {
+			memset( ua->status_buffer, 0, DS9490_getstatus_BUFFER_LENGTH ) ;
+			libusb_fill_interrupt_transfer( ua->status, ua->usb, DS2490_EP1, ua->status_buffer, DS9490_getstatus_BUFFER_LENGTH, usb_async_status_callback, ua, ua->timeout ) ;
+			if ( (ret=libusb_submit_transfer( ua->status )) != 0 ) {
+				LEVEL_DATA("<%s> USB async status problem", libusb_error_name(ret));
+				STAT_ADD1_BUS(e_bus_status_errors, ua->in);
+				usb_async_fail( ua ) ;
+				return ;
+			}
+			ua->polling = 1 ;
+		}
+		++ua->in_flight ;
+	}
+}
+
+/* Stop: cancel what is in flight, the callbacks still come */
+static void usb_async_fail( struct usb_async * ua )
+{
+	if ( ua->failed ) {
+		return ;
+	}
+	ua->failed = 1 ;
+	usb_async_cancel( ua ) ;
+}
+
+/* Cancel every transfer still in flight (again is harmless) */
+static void usb_async_cancel( struct usb_async * ua )
+{
+	if ( ua->writing ) {
+		libusb_cancel_transfer( ua->write ) ;
+	}
+	if ( ua->starting ) {
+		libusb_cancel_transfer( ua->control ) ;
+	}
+	if ( ua->polling ) {
+		libusb_cancel_transfer( ua->status ) ;
+	}
+	if ( ua->reading ) {
+		libusb_cancel_transfer( ua->input ) ;
+	}
+}
+
+/* Finished when all read back (or failed) and no callback still to come */
+static void usb_async_settle( struct usb_async * ua )
+{
+	if ( ua->in_flight == 0 && ( ua->failed || ua->read >= ua->len ) ) {
+		ua->finished = 1 ;
+	}
+}
+
+static void LIBUSB_CALL usb_async_write_callback( struct libusb_transfer * transfer )
+{
+	struct usb_async * ua = transfer->user_data ;
+
+	ua->writing = 0 ;
+	--ua->in_flight ;
+	if ( ! ua->failed ) {
+		if ( transfer->status != LIBUSB_TRANSFER_COMPLETED || transfer->actual_length < transfer->length ) {
+			LEVEL_DATA("USBsendback bulk write problem");
+			STAT_ADD1_BUS(e_bus_write_errors, ua->in);
+			usb_async_fail( ua ) ;
+		} else {
+			TrafficOut("write", transfer->buffer, transfer->length, ua->in) ;
+			ua->written += transfer->length ;
+			usb_async_queue( ua ) ;
+		}
+	}
+	usb_async_settle( ua ) ;
+}
+
+static void LIBUSB_CALL usb_async_control_callback( struct libusb_transfer * transfer )
+{
+	struct usb_async * ua = transfer->user_data ;
+
+	ua->starting = 0 ;
+	--ua->in_flight ;
+	if ( ! ua->failed ) {
+		if ( transfer->status != LIBUSB_TRANSFER_COMPLETED ) {
+			LEVEL_DATA("USBsendback control error");
+			STAT_ADD1_BUS(e_bus_errors, ua->in);
+			usb_async_fail( ua ) ;
+		} else {
+			ua->started += usb_async_block( ua->started, ua->len ) ;
+			usb_async_queue( ua ) ;
+		}
+	}
+	usb_async_settle( ua ) ;
+}
+
+static void LIBUSB_CALL usb_async_status_callback( struct libusb_transfer * transfer )
+{
+	struct usb_async * ua = transfer->user_data ;
+	BYTE * buffer = ua->status_buffer ;
+	int transferred = transfer->actual_length ;
+
+	ua->polling = 0 ;
+	--ua->in_flight ;
+	if ( ua->failed ) {
+		usb_async_settle( ua ) ;
+		return ;
+	}
+	if ( transfer->status != LIBUSB_TRANSFER_COMPLETED || transferred < DS9490_getstatus_BUFFER ) {
+		LEVEL_DATA("USB async status problem, size=%d", transferred);
+		STAT_ADD1_BUS(e_bus_status_errors, ua->in);
+		usb_async_fail( ua ) ;
+		usb_async_settle( ua ) ;
+		return ;
+	}
+	if ( transferred > DS9490_getstatus_BUFFER ) {
+		// result codes follow the 16 status bytes
+		int i ;
+		for (i = DS9490_getstatus_BUFFER; i < transferred; i++) {
+			if ( buffer[i] & COMMCMDERRORRESULT_SH ) {
+				LEVEL_DATA("short detected");
+				STAT_ADD1_BUS(e_bus_errors, ua->in);
+				usb_async_fail( ua ) ;
+				usb_async_settle( ua ) ;
+				return ;
+			}
+		}
+	}
+	if ( ++ua->status_count > USB_ASYNC_STATUS_LIMIT ) {
+		LEVEL_DATA("never got idle  StatusFlags=%X read=%X", buffer[8], buffer[13]);
+		STAT_ADD1_BUS(e_bus_errors, ua->in);
+		ua->reset_device = 1 ;
+		usb_async_fail( ua ) ;
+		usb_async_settle( ua ) ;
+		return ;
+	}
+	// buffer[13] == (ReadBufferStatus)
+	ua->available = buffer[13] ;
+	usb_async_queue( ua ) ;
+	usb_async_settle( ua ) ;
+}
+
+static void LIBUSB_CALL usb_async_read_callback( struct libusb_transfer * transfer )
+{
+	struct usb_async * ua = transfer->user_data ;
+	size_t transferred = transfer->actual_length ;
+
+	ua->reading = 0 ;
+	--ua->in_flight ;
+	if ( ! ua->failed ) {
+		if ( transfer->status != LIBUSB_TRANSFER_COMPLETED ) {
+			LEVEL_DATA("USBsendback bulk read error");
+			STAT_ADD1_BUS(e_bus_read_errors, ua->in);
+			usb_async_fail( ua ) ;
+		} else {
+			TrafficIn("read", transfer->buffer, transferred, ua->in) ;
+			ua->read += transferred ;
+			ua->available = ( ua->available > transferred ) ? ua->available - transferred : 0 ;
+			ua->status_count = 0 ;
+			usb_async_queue( ua ) ;
+		}
+	}
+	usb_async_settle( ua ) ;
+}
+
+#endif							/* OW_USB */
@@ -27,15 +27,6 @@
 
 #if OW_USB						/* conditional inclusion of USB */
 
-#define CONTROL_REQUEST_TYPE  0x40
-
-/** EP1 -- control read */
-#define DS2490_EP1              0x81
-/** EP2 -- bulk write */
-#define DS2490_EP2              0x02
-/** EP3 -- bulk read */
-#define DS2490_EP3              0x83
-
 char badUSBname[] = "-1:-1";
 
 static int usb_transfer( int (*transfer_function) (struct libusb_device_handle *dev_handle, unsigned char endpoint, BYTE *data, int length, int *transferred, unsigned int timeout),  unsigned char endpoint, BYTE * data, int length, int * transferred, struct connection_in * in ) ;
@@ -58,6 +58,7 @@ enum e_visibility NeverVisible( const struct parsedname * pn )
 
 /* Internal files */
 Make_SlaveSpecificTag(VIS, fc_persistent);	// used for all visibility work
+Make_SlaveSpecificTag(DVS, fc_stable);	// directory listing bitmap
 
 GOOD_OR_BAD GetVisibilityCache( int * visibility_parameter, const struct parsedname * pn ) 
 {
@@ -67,6 +68,20 @@ GOOD_OR_BAD GetVisibilityCache( int * visibility_parameter, const struct parsedn
 void SetVisibilityCache( int visibility_parameter, const struct parsedname * pn ) 
 {
 	Cache_Add_SlaveSpecific( &visibility_parameter, sizeof(int), SlaveSpecificTag(VIS), pn) ;
+	// the listing depended on the old value
+	Cache_Del_Internal( SlaveSpecificTag(DVS), pn ) ;
+}
+
+/* Which entries of the device directory (struct device_directory) are shown
+ * Two bitmaps, one after the other: entries already asked, and entries visible */
+GOOD_OR_BAD GetDirectoryVisibilityCache( BYTE * bitmaps, size_t size, const struct parsedname * pn )
+{
+	return Cache_Get_SlaveSpecific( bitmaps, size, SlaveSpecificTag(DVS), pn) ;
+}
+
+void SetDirectoryVisibilityCache( const BYTE * bitmaps, size_t size, const struct parsedname * pn )
+{
+	Cache_Add_SlaveSpecific( bitmaps, size, SlaveSpecificTag(DVS), pn) ;
 }
 
 enum e_visibility FS_visible( const struct parsedname * pn )
@@ -48,10 +48,12 @@ static void W1_setroutines(struct connection_in *in)
 	in->iroutines.PowerByte = NO_POWERBYTE_ROUTINE;
 	in->iroutines.ProgramPulse = NO_PROGRAMPULSE_ROUTINE;
 	in->iroutines.select_and_sendback = W1_select_and_sendback;
+	in->iroutines.select_and_power = NO_SELECTANDPOWER_ROUTINE;
 	in->iroutines.sendback_data = W1_sendback_data;
 	in->iroutines.sendback_bits = NO_SENDBACKBITS_ROUTINE;
 	in->iroutines.select = NO_SELECT_ROUTINE;
 	in->iroutines.select_and_sendback = NO_SELECTANDSENDBACK_ROUTINE;
+	in->iroutines.select_and_power = NO_SELECTANDPOWER_ROUTINE;
 	in->iroutines.set_config = NO_SET_CONFIG_ROUTINE;
 	in->iroutines.get_config = NO_GET_CONFIG_ROUTINE;
 	in->iroutines.reconnect = NO_RECONNECT_ROUTINE;
@@ -73,7 +75,10 @@ GOOD_OR_BAD W1_detect(struct port_in *pin)
 	W1_setroutines(in);
 	Init_Pipe( in->master.w1.netlink_pipe ) ;
 
-	if ( pipe( in->master.w1.netlink_pipe ) != 0 ) {
+	// replies come through the completion table instead
+	if ( Globals.w1_multiplex ) {
+		LEVEL_DEBUG("w1 netlink requests multiplexed");
+	} else if ( pipe( in->master.w1.netlink_pipe ) != 0 ) {
 		ERROR_CONNECT("W1 pipe creation error");
 		Init_Pipe( in->master.w1.netlink_pipe ) ;
 		return gbBAD ;
@@ -0,0 +1,227 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+	email: paul.alfille@gmail.com
+	Released under the GPL
+	See the header file: ow.h for full attribution
+	1wire/iButton system from Dallas Semiconductor
+*/
+
+/* w1 completion table
+ * With --w1_multiplex the netlink dispatch thread hands each reply from the
+ * kernel straight to the request waiting for it, found by the netlink
+ * sequence number (bus master and per-bus count), instead of writing it to
+ * a pipe per bus master.
+ *
+ * Any number of requests can be in flight, on one bus master or several.
+ * The dispatcher never waits for a slow reader, and replies that nobody
+ * waits for any more (timed out) are dropped rather than queued.
+ *
+ * No locks: a slot is claimed and released with compare-and-swap on its
+ * tag, replies are pushed on the slot's list the same way and the waiter
+ * is woken with a semaphore.
+ */
+
+#include <config.h>
+#include "owfs_config.h"
+
+#if OW_W1
+
+#include "ow_w1.h"
+#include "ow_connection.h"
+#include "sem.h" // netlink is linux only, so the real semaphores with sem_timedwait
+
+#define W1_COMPLETION_SLOTS	64
+
+// slot tag: free, or in use (and maybe being delivered to) for a sequence number
+#define W1_SLOT_FREE		((uint64_t) 0)
+#define W1_SLOT_USED		((uint64_t) 1 << 32)
+#define W1_SLOT_BUSY		((uint64_t) 1 << 33)
+
+struct w1_reply {
+	struct w1_reply * next ;
+	struct nlmsghdr * nlm ;
+} ;
+
+struct w1_completion {
+	uint64_t tag ;
+	struct w1_reply * replies ;	// pushed by the dispatcher, newest first
+	struct w1_reply * pending ;	// taken by the waiter, oldest first
+	sem_t ready ;
+} ;
+
+static struct w1_completion w1_completion[W1_COMPLETION_SLOTS] ;
+static pthread_once_t w1_completion_once = PTHREAD_ONCE_INIT ;
+
+static void W1_Completion_Setup( void ) ;
+static int W1_Completion_Take( struct w1_completion * wc, uint64_t from, uint64_t to ) ;
+static GOOD_OR_BAD W1_Completion_Timeout( struct timespec * deadline ) ;
+
+static void W1_Completion_Setup( void )
+{
+	int slot ;
+	for ( slot = 0 ; slot < W1_COMPLETION_SLOTS ; ++slot ) {
+		sem_init( &w1_completion[slot].ready, 0, 0 ) ;
+	}
+}
+
+static int W1_Completion_Take( struct w1_completion * wc, uint64_t from, uint64_t to )
+{
+	return __atomic_compare_exchange_n( &wc->tag, &from, to, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ;
+}
+
+/* Reserve a slot for the reply to netlink sequence seq (before sending) */
+GOOD_OR_BAD W1_Completion_Claim( uint32_t seq )
+{
+	int probe ;
+
+	pthread_once( &w1_completion_once, W1_Completion_Setup ) ;
+	for ( probe = 0 ; probe < W1_COMPLETION_SLOTS ; ++probe ) {
+		struct w1_completion * wc = &w1_completion[ ( seq + probe ) % W1_COMPLETION_SLOTS ] ;
+		if ( W1_Completion_Take( wc, W1_SLOT_FREE, W1_SLOT_USED | seq ) ) {
+			return gbGOOD ;
+		}
+	}
+	LEVEL_DEBUG("No free w1 completion slot (%d requests in flight)", W1_COMPLETION_SLOTS ) ;
+	return gbBAD ;
+}
+
+static struct w1_completion * W1_Completion_Find( uint32_t seq )
+{
+	int probe ;
+
+	for ( probe = 0 ; probe < W1_COMPLETION_SLOTS ; ++probe ) {
+		struct w1_completion * wc = &w1_completion[ ( seq + probe ) % W1_COMPLETION_SLOTS ] ;
+		if ( ( __atomic_load_n( &wc->tag, __ATOMIC_ACQUIRE ) & ~W1_SLOT_BUSY ) == ( W1_SLOT_USED | seq ) ) {
+			return wc ;
+		}
+	}
+	return NULL ;
+}
+
+/* Dispatcher: give the reply (nlm, owmalloc'ed) to its waiter, which then owns it */
+GOOD_OR_BAD W1_Completion_Deliver( struct nlmsghdr * nlm )
+{
+	uint32_t seq = nlm->nlmsg_seq ;
+	struct w1_completion * wc = W1_Completion_Find( seq ) ;
+	struct w1_reply * reply ;
+
+	// the slot may be released any time until it is marked busy
+	if ( wc == NULL || ! W1_Completion_Take( wc, W1_SLOT_USED | seq, W1_SLOT_USED | W1_SLOT_BUSY | seq ) ) {
+		LEVEL_DEBUG("Nobody waiting for netlink seq=%u|%u", NL_BUS(seq), NL_SEQ(seq) ) ;
+		return gbBAD ;
+	}
+
+	reply = owmalloc( sizeof( struct w1_reply ) ) ;
+	if ( reply != NULL ) {
+		reply->nlm = nlm ;
+		reply->next = __atomic_load_n( &wc->replies, __ATOMIC_RELAXED ) ;
+		while ( ! __atomic_compare_exchange_n( &wc->replies, &reply->next, reply, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED ) ) {
+			// reply->next reloaded
+		}
+		sem_post( &wc->ready ) ;
+	}
+
+	__atomic_store_n( &wc->tag, W1_SLOT_USED | seq, __ATOMIC_RELEASE ) ;
+	return reply == NULL ? gbBAD : gbGOOD ;
+}
+
+// Same rule as the pipe wait: keep waiting while netlink traffic still comes in
+static GOOD_OR_BAD W1_Completion_Timeout( struct timespec * deadline )
+{
+	struct timeval now ;
+	struct timeval diff ;
+
+	timernow( &now );
+	_MUTEX_LOCK(Inbound_Control.w1_monitor->master.w1_monitor.read_mutex) ;
+	timersub( &now, &(Inbound_Control.w1_monitor->master.w1_monitor.last_read), &diff );
+	_MUTEX_UNLOCK(Inbound_Control.w1_monitor->master.w1_monitor.read_mutex) ;
+
+	if ( diff.tv_sec <= Globals.timeout_w1 ) {
+		LEVEL_DEBUG("Completion legal timeout -- try again");
+		deadline->tv_sec += Globals.timeout_w1 ;
+		return gbGOOD ;
+	}
+	LEVEL_DEBUG("Completion wait timeout");
+	return gbBAD ;
+}
+
+/* Waiter: next reply for netlink sequence seq, owmalloc'ed (or NULL on timeout) */
+struct nlmsghdr * W1_Completion_Wait( uint32_t seq )
+{
+	struct w1_completion * wc = W1_Completion_Find( seq ) ;
+	struct timespec deadline ;
+
+	if ( wc == NULL ) {
+		LEVEL_DEBUG("No w1 completion slot for seq=%u|%u", NL_BUS(seq), NL_SEQ(seq) ) ;
+		return NULL ;
+	}
+
+	clock_gettime( CLOCK_REALTIME, &deadline ) ;
+	deadline.tv_sec += Globals.timeout_w1 ;
+
+	while ( wc->pending == NULL ) {
+		struct w1_reply * replies ;
+
+		if ( sem_timedwait( &wc->ready, &deadline ) != 0 ) {
+			if ( errno == EINTR ) {
+				continue ;
+			}
+			if ( errno == ETIMEDOUT && GOOD( W1_Completion_Timeout( &deadline ) ) ) {
+				continue ;
+			}
+			return NULL ;
+		}
+
+		// take all that arrived, and put in order of arrival
+		replies = __atomic_exchange_n( &wc->replies, NULL, __ATOMIC_ACQUIRE ) ;
+		while ( replies != NULL ) {
+			struct w1_reply * next = replies->next ;
+			replies->next = wc->pending ;
+			wc->pending = replies ;
+			replies = next ;
+		}
+	}
+
+	{
+		struct w1_reply * reply = wc->pending ;
+		struct nlmsghdr * nlm = reply->nlm ;
+		wc->pending = reply->next ;
+		owfree( reply ) ;
+		return nlm ;
+	}
+}
+
+static void W1_Completion_Free( struct w1_reply * reply )
+{
+	while ( reply != NULL ) {
+		struct w1_reply * next = reply->next ;
+		owfree( reply->nlm ) ;
+		owfree( reply ) ;
+		reply = next ;
+	}
+}
+
+/* Waiter is done with seq, later replies are dropped */
+void W1_Completion_Release( uint32_t seq )
+{
+	struct w1_completion * wc = W1_Completion_Find( seq ) ;
+
+	if ( wc == NULL ) {
+		return ;
+	}
+	// keep it busy while cleaning up, wait out a delivery in progress
+	while ( ! W1_Completion_Take( wc, W1_SLOT_USED | seq, W1_SLOT_USED | W1_SLOT_BUSY | seq ) ) {
+		sched_yield() ;
+	}
+	W1_Completion_Free( wc->pending ) ;
+	wc->pending = NULL ;
+	W1_Completion_Free( __atomic_exchange_n( &wc->replies, NULL, __ATOMIC_ACQUIRE ) ) ;
+	while ( sem_trywait( &wc->ready ) == 0 ) {
+		// unused wakeups
+	}
+	__atomic_store_n( &wc->tag, W1_SLOT_FREE, __ATOMIC_RELEASE ) ;
+}
+
+#endif /* OW_W1 */
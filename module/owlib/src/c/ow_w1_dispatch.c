@@ -86,6 +86,12 @@ static void Dispatch_Packet( struct netlink_parse * nlp)
 		// root w1 master message -- add and remove
 		LEVEL_DEBUG("Netlink message directed to root W1 master");
 		Dispatch_Packet_root( nlp ) ;
+	} else if ( Globals.w1_multiplex ) {
+		// straight to the waiting request, which takes over the buffer
+		LEVEL_DEBUG("Netlink message directed to W1 bus master %d request %d",bus,NL_SEQ(nlp->nlm->nlmsg_seq));
+		if ( GOOD( W1_Completion_Deliver( nlp->nlm ) ) ) {
+			nlp->nlm = NULL ;
+		}
 	} else {
 		// non-root w1 message -- individual bus master messages
 		LEVEL_DEBUG("Netlink message directed to W1 bus master %d",bus);
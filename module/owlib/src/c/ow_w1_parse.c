@@ -202,6 +202,62 @@ static void Netlink_Parse_Show( struct netlink_parse * nlp )
 	Netlink_Print( nlp->nlm, nlp->cn, nlp->w1m, nlp->w1c, nlp->data, nlp->data_size ) ;
 }
 
+// One reply to the request seq, returns 1 (and the status) when the request is done
+static int W1_Process_Reply( struct netlink_parse * nlp, void (* nrs_callback)( struct netlink_parse * nlp, void * v, const struct parsedname * pn), SEQ_OR_ERROR seq, void * v, const struct parsedname * pn, enum Netlink_Read_Status * status )
+{
+	if ( NL_SEQ(nlp->nlm->nlmsg_seq) != NL_SEQ(seq) ) {
+		LEVEL_DEBUG("Netlink sequence number out of order");
+		return 0 ;
+	}
+	if ( nlp->w1m->status != 0) {
+		*status = nrs_nodev ;
+		return 1 ;
+	}
+	if ( nrs_callback == NULL ) { // bus reset
+		*status = nrs_complete ;
+		return 1 ;
+	}
+
+	LEVEL_DEBUG("About to call nrs_callback");
+	nrs_callback( nlp, v, pn ) ;
+	LEVEL_DEBUG("Called nrs_callback");
+	if ( nlp->cn->seq != nlp->cn->ack ) {
+		if ( nlp->w1m->type == W1_LIST_MASTERS ) {
+			return 0 ; // look for more data
+		}
+		if ( nlp->w1c && (nlp->w1c->cmd==W1_CMD_SEARCH || nlp->w1c->cmd==W1_CMD_ALARM_SEARCH) ) {
+			return 0 ; // look for more data
+		}
+	}
+	*status = nrs_complete ; // status message
+	return 1 ;
+}
+
+// --w1_multiplex: replies handed over by the dispatcher
+static enum Netlink_Read_Status W1_Process_Completion( void (* nrs_callback)( struct netlink_parse * nlp, void * v, const struct parsedname * pn), SEQ_OR_ERROR seq, void * v, const struct parsedname * pn )
+{
+	uint32_t nl_seq = MAKE_NL_SEQ( pn->selected_connection->master.w1.id, seq ) ;
+	enum Netlink_Read_Status status = nrs_timeout ;
+	struct netlink_parse nlp ;
+
+	while ( ( nlp.nlm = W1_Completion_Wait( nl_seq ) ) != NULL ) {
+		int done ;
+
+		if ( GOOD( Netlink_Parse_Buffer( &nlp ) ) ) {
+			done = W1_Process_Reply( &nlp, nrs_callback, seq, v, pn, &status ) ;
+		} else {
+			status = nrs_error ;
+			done = 1 ;
+		}
+		owfree( nlp.nlm ) ;
+		if ( done ) {
+			break ;
+		}
+	}
+	W1_Completion_Release( nl_seq ) ;
+	return status ;
+}
+
 enum Netlink_Read_Status W1_Process_Response( void (* nrs_callback)( struct netlink_parse * nlp, void * v, const struct parsedname * pn), SEQ_OR_ERROR seq, void * v, const struct parsedname * pn )
 {
 	struct connection_in * in = pn->selected_connection ;
@@ -216,6 +272,8 @@ enum Netlink_Read_Status W1_Process_Response( void (* nrs_callback)( struct netl
 		// Send to main netlink rather than a particular bus
 		file_descriptor = FILE_DESCRIPTOR_BAD ;
 		bus = 0 ;
+	} else if ( Globals.w1_multiplex ) {
+		return W1_Process_Completion( nrs_callback, seq, v, pn ) ;
 	} else {
 		// Bus-specifc
 		file_descriptor = in->master.w1.netlink_pipe[fd_pipe_read] ;
@@ -224,6 +282,8 @@ enum Netlink_Read_Status W1_Process_Response( void (* nrs_callback)( struct netl
 
 	while ( GOOD( W1PipeSelect_timeout(file_descriptor)) ) {
 		struct netlink_parse nlp ;
+		enum Netlink_Read_Status status ;
+		int done ;
 		nlp.nlm = NULL ;
 		
 		LEVEL_DEBUG("Loop waiting for netlink piped message");
@@ -232,33 +292,11 @@ enum Netlink_Read_Status W1_Process_Response( void (* nrs_callback)( struct netl
 			// Don't need to free since nlm not set if BAD
 			return nrs_error ;
 		}
-		if ( NL_SEQ(nlp.nlm->nlmsg_seq) != NL_SEQ(seq) ) {
-			LEVEL_DEBUG("Netlink sequence number out of order");
-			owfree(nlp.nlm) ;
-			continue ;
-		}
-		if ( nlp.w1m->status != 0) {
-			owfree(nlp.nlm) ;
-			return nrs_nodev ;
-		}
-		if ( nrs_callback == NULL ) { // bus reset
-			owfree(nlp.nlm) ;
-			return nrs_complete ;
-		}
-
-		LEVEL_DEBUG("About to call nrs_callback");
-		nrs_callback( &nlp, v, pn ) ;
-		LEVEL_DEBUG("Called nrs_callback");
+		done = W1_Process_Reply( &nlp, nrs_callback, seq, v, pn, &status ) ;
 		owfree(nlp.nlm) ;
-		if ( nlp.cn->seq != nlp.cn->ack ) {
-			if ( nlp.w1m->type == W1_LIST_MASTERS ) {
-				continue ; // look for more data
-			}
-			if ( nlp.w1c && (nlp.w1c->cmd==W1_CMD_SEARCH || nlp.w1c->cmd==W1_CMD_ALARM_SEARCH) ) {
-				continue ; // look for more data
-			}
+		if ( done ) {
+			return status ;
 		}
-		return nrs_complete ; // status message
 	}
 	return nrs_timeout ;
 }
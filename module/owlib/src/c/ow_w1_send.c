@@ -64,6 +64,14 @@ SEQ_OR_ERROR W1_send_msg( struct connection_in * in, struct w1_netlink_msg *msg,
 		seq = ++Inbound_Control.w1_monitor->master.w1_monitor.seq ;
 		_MUTEX_UNLOCK(Inbound_Control.w1_monitor->master.w1_monitor.seq_mutex) ;
 		bus = 0 ;
+	} else if ( Globals.w1_multiplex ) {
+		// w1 subsidiary bus, requests may overlap
+		// the reply is routed by sequence number, so claim it before sending
+		seq = __atomic_add_fetch( &in->master.w1.seq, 1, __ATOMIC_RELAXED ) ;
+		bus = in->master.w1.id;
+		if ( BAD( W1_Completion_Claim( MAKE_NL_SEQ( bus, seq ) ) ) ) {
+			return SEQ_BAD ;
+		}
 	} else {
 		// w1 subsidiary bus
 		// this bus is locked
@@ -87,6 +95,9 @@ SEQ_OR_ERROR W1_send_msg( struct connection_in * in, struct w1_netlink_msg *msg,
 	nlm = owmalloc( NLMSG_SPACE(nlm_payload) );
 	if (nlm==NULL) {
 		// memory allocation error
+		if ( in != NO_CONNECTION && Globals.w1_multiplex ) {
+			W1_Completion_Release( MAKE_NL_SEQ( bus, seq ) ) ;
+		}
 		return SEQ_BAD;
 	}
 
@@ -135,6 +146,9 @@ SEQ_OR_ERROR W1_send_msg( struct connection_in * in, struct w1_netlink_msg *msg,
 		//err = COM_write( nlm, nlm_size, Inbound_Control.w1.monitor ) ;
 		owfree(nlm);
 		ERROR_CONNECT("Failed to send w1 netlink message");
+		if ( in != NO_CONNECTION && Globals.w1_multiplex ) {
+			W1_Completion_Release( MAKE_NL_SEQ( bus, seq ) ) ;
+		}
 		return SEQ_BAD ;
 	}
 
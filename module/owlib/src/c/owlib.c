@@ -28,6 +28,10 @@ GOOD_OR_BAD LibStart(void* v)
 	/* Build device and filetype arrays (including externals) */
 	DeviceSort();
 
+	/* Cache layout depends on options */
+	Cache_Configure();
+	ParseCache_Configure();
+
 	Globals.zero = zero_none ;
 #if OW_ZERO
 	if ( OW_Load_dnssd_library() == 0 ) {
@@ -54,6 +54,12 @@
 	char *OWstrdup( const char * file, int line, const char * func, const char *s);
 	void  OWtreefree(void *ptr);
 
+	// Pools are bypassed so every block is tracked
+	#define owpool_alloc(size)       OWmalloc( __FILE__, __LINE__, __func__, size )
+	#define owpool_free(ptr)         OWfree(   __FILE__, __LINE__, __func__, ptr )
+	#define owpool_realloc(ptr,size) OWrealloc(__FILE__, __LINE__, __func__, ptr, size )
+	#define owpool_free_func         OWtreefree
+
 #else  /* OW_ALLOC_DEBUG */
 	// Standard C library definitions
 	#define owmalloc(size)        malloc(size)
@@ -62,8 +68,18 @@
 	#define owrealloc(ptr,size)   realloc(ptr,size)
 	#define owstrdup(s)           strdup(s)
 	#define owfree_func           free
+
+	// Size-class pools for cache nodes and dirblobs
+	// blocks must be released with owpool_free (not owfree)
+	void *owpool_alloc( size_t size ) ;
+	void  owpool_free( void * ptr ) ;
+	void *owpool_realloc( void * ptr, size_t size ) ;
+	#define owpool_free_func      owpool_free
 #endif  /* OW_ALLOC_DEBUG */
 
+void Pool_Open( void ) ;
+void Pool_Close( void ) ;
+
 #define SAFEFREE(p)    do { if ( (p)!= NULL ) { owfree(p) ; p=NULL; } } while (0)
 #define SAFETDESTROY(p,f) do { if ( (p)!=NULL ) { tdestroy(p,f) ; p=NULL; } } while (0)
 
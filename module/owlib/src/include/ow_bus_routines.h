@@ -64,6 +64,8 @@ struct interface_routines {
 	GOOD_OR_BAD (*sendback_data) (const BYTE * data, BYTE * resp, const size_t len, const struct parsedname * pn);
 	/* send and recieve data -- byte at a time */
 	GOOD_OR_BAD (*select_and_sendback) (const BYTE * data, BYTE * resp, const size_t len, const struct parsedname * pn);
+	/* send and recieve data, strong pull-up after the last byte (until next bus use) */
+	GOOD_OR_BAD (*select_and_power) (const BYTE * data, BYTE * resp, const size_t len, const struct parsedname * pn);
 	/* send and recieve data -- bit at a time */
 	GOOD_OR_BAD (*sendback_bits) (const BYTE * databits, BYTE * respbits, const size_t len, const struct parsedname * pn);
 	/* select a device */
@@ -90,6 +92,7 @@ struct interface_routines {
 #define NO_PROGRAMPULSE_ROUTINE			NULL
 #define NO_SENDBACKDATA_ROUTINE			NULL
 #define NO_SELECTANDSENDBACK_ROUTINE	NULL
+#define NO_SELECTANDPOWER_ROUTINE		NULL
 #define NO_SENDBACKBITS_ROUTINE			NULL
 #define NO_SELECT_ROUTINE				NULL
 #define NO_SET_CONFIG_ROUTINE			NULL
@@ -136,9 +139,11 @@ struct interface_routines {
 GOOD_OR_BAD BUS_detect( struct port_in * pin ) ;
 
 RESET_TYPE BUS_reset(const struct parsedname *pn);
+RESET_TYPE BUS_reset_bundled(RESET_TYPE reset, const struct parsedname *pn);
 
 GOOD_OR_BAD BUS_select(const struct parsedname *pn);
 GOOD_OR_BAD BUS_select_and_sendback(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
+GOOD_OR_BAD BUS_select_and_power(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
 
 GOOD_OR_BAD BUS_sendback_bits( const BYTE * databits, BYTE * respbits, const size_t len, const struct parsedname * pn );
 GOOD_OR_BAD BUS_sendback_data(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
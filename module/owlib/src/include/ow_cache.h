@@ -55,8 +55,10 @@ extern struct internal_prop ip_S_V ;
 
 /* Cache  and Storage functions */
 void Cache_Open(void);
+void Cache_Configure(void);
 void Cache_Close(void);
 void Cache_Clear(void);
+void Cache_Set_Clock( time_t (*clock)( time_t * ) );
 
 GOOD_OR_BAD OWQ_Cache_Add(const struct one_wire_query *owq);
 GOOD_OR_BAD Cache_Add_Dir(const struct dirblob *db, const struct parsedname *pn);
@@ -69,10 +71,13 @@ void Cache_Add_Alias_Bus(const ASCII * alias_name, INDEX_OR_ERROR bus);
 GOOD_OR_BAD OWQ_Cache_Get(struct one_wire_query *owq);
 GOOD_OR_BAD Cache_Get(void *data, size_t * dsize, const struct parsedname *pn);
 GOOD_OR_BAD Cache_Get_Dir(struct dirblob *db, const struct parsedname *pn);
+GOOD_OR_BAD Cache_Get_Dir_Search(int * device_index, const BYTE * sn, const struct parsedname *pn);
+GOOD_OR_BAD Cache_Get_Expiry(time_t * stored, time_t * expires, const struct parsedname *pn);
 GOOD_OR_BAD Cache_Get_Device(void *bus_nr, const struct parsedname *pn);
 GOOD_OR_BAD Cache_Get_SlaveSpecific(void *data, size_t dsize, const struct internal_prop *ip, const struct parsedname *pn);
 ASCII * Cache_Get_Alias(const BYTE * sn) ;
 GOOD_OR_BAD Cache_Get_Simul_Time(const struct internal_prop *ip, time_t * dwell_time, const struct parsedname * pn);
+GOOD_OR_BAD Cache_Get_Simul_Start(const struct internal_prop *ip, struct timeval * start, const struct parsedname * pn);
 INDEX_OR_ERROR Cache_Get_Alias_Bus(const ASCII * alias_name) ;
 GOOD_OR_BAD Cache_Get_Alias_SN(const ASCII * alias_name, BYTE * sn );
 
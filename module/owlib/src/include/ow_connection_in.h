@@ -151,6 +151,7 @@ struct connection_in {
 	int ds2404_found;
 	int ProgramAvailable;
 	size_t last_root_devs;
+	struct dirblob search_seed;		// last root listing, checked before a full search
 	struct ds2409_hubs branch;		// ds2409 branch currently selected
 			// or the special eBranch_bad and eBranch_cleared
 
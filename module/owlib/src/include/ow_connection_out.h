@@ -28,6 +28,8 @@
 struct connection_out {
 	struct connection_out *next;
 	void (*HandlerRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descriptor);
+	GOOD_OR_BAD (*RequestRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descriptor, void ** state); // event loop, one request
+	void (*ReleaseRoutine) (void * state); // event loop, connection closed
 	char *name;
 	char *host;
 	char *service;
@@ -75,6 +75,12 @@ struct directory {
 	UINT entries;
 };
 
+struct latency {
+	UINT count;
+	struct timeval total;
+	struct timeval max;
+};
+
 #define AVERAGE_IN(pA)  ++(pA)->current; ++(pA)->count; (pA)->sum+=(pA)->current; if ((pA)->current>(pA)->max)++(pA)->max;
 #define AVERAGE_OUT(pA) --(pA)->current;
 #define AVERAGE_MARK(pA)  ++(pA)->count; (pA)->sum+=(pA)->current;
@@ -82,6 +88,14 @@ struct directory {
 
 extern UINT cache_flips;
 extern UINT cache_adds;
+extern size_t cache_bytes;		// memory held by the temporary cache
+extern UINT cache_evictions;	// entries dropped to honor cache_size
+extern UINT cache_refused;		// entries larger than the cache_size share
+extern UINT cache_reaped;		// expired entries freed individually (timer wheel)
+extern UINT pool_hits;			// cache node / dirblob blocks reused from the pools
+extern UINT pool_misses;		// ... and taken from the heap
+extern UINT parse_cache_hits;	// paths found already parsed
+extern UINT parse_cache_misses;	// ... and parsed in full
 extern struct average new_avg;
 extern struct average old_avg;
 extern struct average store_avg;
@@ -94,8 +108,10 @@ extern struct cache_stats cache_pst;
 extern UINT read_calls;
 extern UINT read_cache;
 extern UINT read_cachebytes;
+extern UINT read_copybytes;
 extern UINT read_bytes;
 extern UINT read_array;
+extern UINT read_bulk;
 extern UINT read_tries[3];
 extern UINT read_success;
 extern struct average read_avg;
@@ -109,13 +125,26 @@ extern struct average write_avg;
 
 extern struct directory dir_main;
 extern struct directory dir_dev;
+extern UINT dir_duplicates;
+extern UINT dir_passes;			// bus search passes, including checks of the last listing
+extern UINT dir_verified;		// root listings confirmed by checking the last one
 extern UINT dir_depth;
+
+extern UINT port_jobs;			// jobs queued to the per-port worker threads
+extern UINT convert_released;	// conversions run with the bus released
+extern UINT convert_coalesced;	// reads that shared another read's bus-wide conversion
 extern struct average dir_avg;
 
 extern struct average all_avg;
 
 extern struct timeval max_delay;
 
+// ow_net_server.c (event loop)
+extern struct latency server_accept_latency;	// connection accepted until request arrives
+extern struct latency server_queue_latency;		// request arrives until a worker takes it
+extern struct latency server_handler_latency;	// worker handling a request (or the connection)
+extern UINT server_deferred;	// requests held back while the worker queue was full
+
 // ow_locks.c
 extern UINT total_bus_locks;	// total number of locks
 extern UINT total_bus_unlocks;	// total number of unlocks
@@ -44,6 +44,7 @@
 /* --------------------------------------------------------- */
 /* Predeclare struct filetype */
 struct filetype;
+struct device_directory;
 
 /* -------------------------------- */
 /* Devices -- types of 1-wire chips */
@@ -82,6 +83,33 @@ struct device {
 	struct filetype *filetype_array;
 	struct generic_read * g_read ;
 	struct generic_write * g_write ;
+	struct device_directory * directory ;	// listing, filled in by DeviceSort
+};
+#define NO_DEVICE_DIRECTORY NULL
+
+/* Directory listing of a device, worked out once at startup
+   so FS_devdir needn't parse every property name */
+struct device_directory_entry {
+	struct filetype * ft ;		// property, or the subdirectory itself
+	int extension ;
+	int elements ;				// of the aggregate when listed (a few devices change it)
+	char * name ;				// with extension, relative to its subdirectory
+	int parse ;					// sparse and DS2409 branches still get a full parse
+	int conditional ;			// visibility has to be asked
+};
+
+struct device_directory_level {
+	struct filetype * subdir ;	// NO_SUBDIR for the device directory itself
+	int first ;					// index of its first entry
+	int count ;
+};
+
+struct device_directory {
+	int levels ;
+	struct device_directory_level * level ;
+	int entries ;
+	struct device_directory_entry * entry ;
+	int conditional ;			// some entries are not always visible
 };
 
 #define DeviceHeader( chip )    extern struct device d_##chip
@@ -91,8 +119,8 @@ struct device {
    filetype arrays aren;t defined at this point */
 #define COUNT_OF_FILETYPES(filetype_array) ((int)(sizeof(filetype_array)/sizeof(struct filetype)))
 
-#define DeviceEntryExtended( code , chip , flags, gread, gwrite )  struct device d_##chip = {#code,#chip,flags,COUNT_OF_FILETYPES(chip),chip,gread,gwrite}
-#define DeviceEntryExtendedSecondary( code , chip , flags, gread, gwrite )  struct device d_##chip##_##code = {#code,#chip,flags,COUNT_OF_FILETYPES(chip),chip,gread,gwrite}
+#define DeviceEntryExtended( code , chip , flags, gread, gwrite )  struct device d_##chip = {#code,#chip,flags,COUNT_OF_FILETYPES(chip),chip,gread,gwrite,NO_DEVICE_DIRECTORY}
+#define DeviceEntryExtendedSecondary( code , chip , flags, gread, gwrite )  struct device d_##chip##_##code = {#code,#chip,flags,COUNT_OF_FILETYPES(chip),chip,gread,gwrite,NO_DEVICE_DIRECTORY}
 
 #define DeviceEntry( code , chip, gread, gwrite )  DeviceEntryExtended( code, chip, 0, gread, gwrite )
 
@@ -37,6 +37,8 @@ struct dirblob {
 	int allocated;
 	int devices;
 	BYTE *snlist;
+	int *index;					// hash of snlist: device+1 per slot, 0 empty
+	int index_size;				// slots, power of 2 (0 no index)
 };
 
 void DirblobClear(struct dirblob *db);
@@ -46,7 +48,11 @@ void DirblobPoison(struct dirblob *db);
 int DirblobElements(const struct dirblob *db);
 int DirblobAdd(const BYTE * sn, struct dirblob *db);
 int DirblobGet(int dev, BYTE * sn, const struct dirblob *db);
-int DirblobSearch(BYTE * sn, const struct dirblob *db);
+int DirblobSearch(const BYTE * sn, struct dirblob *db);
 int DirblobRecreate( BYTE * snlist, int size, struct dirblob *db);
+size_t DirblobPackedSize(const struct dirblob *db);
+void DirblobPack(BYTE * data, const struct dirblob *db);
+int DirblobUnpack(const BYTE * data, size_t size, struct dirblob *db);
+int DirblobSearchPacked(const BYTE * sn, const BYTE * data, size_t size);
 
 #endif							/* OW_DIRBLOB_H */
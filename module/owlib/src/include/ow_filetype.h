@@ -72,12 +72,17 @@ enum ag_combined {
 	ag_sparse,
 	};
 
+/* Predeclare one_wire_query */
+struct one_wire_query;
+
 /* aggregate defines array properties */
 struct aggregate {
 	int elements;				/* Maximum number of elements */
 	enum ag_index letters;		/* name them with letters or numbers */
 	enum ag_combined combined;	/* Combined bitmaps properties, or separately addressed */
+	ZERO_OR_ERROR (*bulk_read) (struct one_wire_query *);	/* Optional: whole separate array (.ALL) in one read */
 };
+#define NO_BULK_READ	NULL
 
 	/* property format, controls web display */
 /* Some explanation of ft_format:
@@ -127,8 +132,6 @@ enum fc_change {
 	fc_subdir,       // really a NOP, but makes code clearer
 };
 
-/* Predeclare one_wire_query */
-struct one_wire_query;
 /* Predeclare parsedname */
 struct parsedname;
 
@@ -69,6 +69,9 @@ ZERO_OR_ERROR FS_ParsedName(const char *fn, struct parsedname *pn);
 ZERO_OR_ERROR FS_ParsedName_BackFromRemote(const char *fn, struct parsedname *pn);
 void FS_ParsedName_destroy(struct parsedname *pn);
 void FS_ParsedName_Placeholder( struct parsedname * pn ) ;
+void ParseCache_Configure( void ) ;
+void ParseCache_Flush( void ) ;
+void ParseCache_Close( void ) ;
 
 size_t FileLength(const struct parsedname *pn);
 size_t FullFileLength(const struct parsedname *pn);
@@ -116,6 +119,7 @@ void Init_Pipe( FILE_DESCRIPTOR_OR_ERROR * pipe_fd ) ;
 void FS_LoadDirectoryOnly(struct parsedname *pn_directory, const struct parsedname *pn_original);
 
 GOOD_OR_BAD FS_Test_Simultaneous( const struct internal_prop *ip, UINT delay, const struct parsedname * pn) ;
+GOOD_OR_BAD FS_Coalesce_Simultaneous( UINT delay, const struct parsedname * pn) ;
 
 // ow_locks.c
 void LockSetup(void);
@@ -136,6 +140,7 @@ FILE_DESCRIPTOR_OR_ERROR ClientConnect(struct connection_in *in);
 void FreeClientAddr(struct connection_in *in);
 
 void ServerProcess(void (*HandlerRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descriptor));
+void ServerRequestRoutines( GOOD_OR_BAD (*RequestRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descriptor, void ** state), void (*ReleaseRoutine) (void * state) ) ;
 GOOD_OR_BAD ServerOutSetup(struct connection_out *out);
 void InterruptListening( void ) ;
 
@@ -155,6 +160,10 @@ INDEX_OR_ERROR ServerPresence( struct parsedname *pn);
 SIZE_OR_ERROR ServerRead(struct one_wire_query *owq);
 ZERO_OR_ERROR ServerWrite(struct one_wire_query *owq);
 ZERO_OR_ERROR ServerDir(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn, uint32_t * flags);
+void ServerPipelineInit(struct connection_in *in);
+void ServerPoolInit(struct connection_in *in);
+void ServerPoolClose(struct connection_in *in);
+void ServerPipelineClose(struct connection_in *in);
 
 /* High-level callback functions */
 ZERO_OR_ERROR FS_dir(void (*dirfunc) (void *, const struct parsedname *), void *v, struct parsedname *pn);
@@ -200,6 +209,7 @@ GOOD_OR_BAD COMMON_read_memory_plus_counter(BYTE * extra, size_t page, size_t pa
 ZERO_OR_ERROR COMMON_write_eprom_mem_owq(struct one_wire_query * owq) ;
 
 ZERO_OR_ERROR COMMON_offset_process( ZERO_OR_ERROR (*func) (struct one_wire_query *), struct one_wire_query * owq, off_t shift_offset) ;
+ZERO_OR_ERROR COMMON_pages_process( ZERO_OR_ERROR (*func) (struct one_wire_query *), struct one_wire_query * owq_all, size_t pagesize) ;
 
 void BUS_lock(const struct parsedname *pn);
 void BUS_unlock(const struct parsedname *pn);
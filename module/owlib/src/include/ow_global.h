@@ -100,10 +100,15 @@ struct global {
 	int readonly;
 	int max_clients;			// for ftp
 	size_t cache_size;			// max cache size (or 0 for no max) ;
+	int cache_shards;			// independently locked cache partitions
+	int cache_timer_wheel;		// per-entry expiry instead of whole tree flips
+	int parse_cache;			// parsed paths kept (0 for none)
 	int one_device;				// Single device, use faster ROM comands
 	/* Special parameter to trigger William Robison <ibutton@n952.dyndns.ws> timings */
 	int altUSB;
 	int usb_flextime;
+	int usb_async; // DS9490 block transfers queued with the libusb asynchronous API
+	int w1_multiplex; // w1 netlink replies through the completion table, several requests in flight
 	int serial_flextime;
 	int serial_reverse; // reverse polarity ?
 	int serial_hardflow ; // hardware flow control
@@ -127,6 +132,11 @@ struct global {
 	int no_dirall;
 	int no_get;
 	int no_persistence;
+	int no_pipeline;
+	int convert_hold; // keep the bus during powered conversions
+	int no_coalesce; // no automatic bus-wide temperature conversion
+	int server_workers; // 0 for a thread per connection
+	int server_connections; // idle persistent connections kept to each remote owserver
 	int eightbit_serial;
 	int trim;
 	enum zero_support zero ;
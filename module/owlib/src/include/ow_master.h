@@ -25,16 +25,26 @@
 
 /* included in ow_connection.h as the bus-master specific portion of the connection_in structure */
 
+// idle persistent connection to an owserver
+struct server_connection {
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor;
+	struct timeval last_used;
+};
+
 struct master_server {
 	char *type;					// for zeroconf
 	char *domain;				// for zeroconf
 	char *name;					// zeroconf name
 	int no_dirall;				// flag that server doesn't support DIRALL
+	struct server_pipeline * pipeline;	// shared connection for concurrent reads
+	struct server_connection * idle;	// pool of --server_connections persistent connections
+	int idle_count;
 } ;
 
 struct master_serial {
 	enum ds2480b_mode { ds2480b_data_mode, ds2480b_command_mode, } mode ;
 	int reverse_polarity ;
+	int pulse ; // strong pull-up left on, the next command ends it
 };
 
 struct master_fake {
@@ -81,6 +91,7 @@ struct master_i2c {
 	BYTE configchip;
 	/* only one per chip, the bus entries for the other 7 channels point to the first one */
 	int current;
+	int rdwr; // i2c adapter takes combined transfers (I2C_RDWR)
 	struct connection_in *head;
 };
 
@@ -39,6 +39,7 @@ enum msg_classification {
 	msg_get,
 	msg_dirallslash,
 	msg_getslash,
+	msg_readmany,				// several paths read in one message
 };
 /* message to owserver */
 struct server_msg {
@@ -70,6 +70,8 @@ extern struct mutexes {
 	pthread_mutex_t externalcount_mutex;
 	pthread_mutex_t timegm_mutex;
 	pthread_mutex_t detail_mutex;
+	pthread_mutex_t worker_mutex;
+	pthread_mutex_t parsecache_mutex;
 	
 	pthread_mutexattr_t mattr; // mutex attribute -- used for all mutexes
 	my_rwlock_t lib;
@@ -168,6 +170,12 @@ extern struct mutexes {
 #define DETAILLOCK   		_MUTEX_LOCK(  Mutex.detail_mutex)
 #define DETAILUNLOCK 		_MUTEX_UNLOCK(Mutex.detail_mutex)
 
+#define WORKERLOCK   		_MUTEX_LOCK(  Mutex.worker_mutex)
+#define WORKERUNLOCK 		_MUTEX_UNLOCK(Mutex.worker_mutex)
+
+#define PARSECACHELOCK   	_MUTEX_LOCK(  Mutex.parsecache_mutex)
+#define PARSECACHEUNLOCK 	_MUTEX_UNLOCK(Mutex.parsecache_mutex)
+
 #define BUSLOCK(pn)       	BUS_lock(pn)
 #define BUSUNLOCK(pn)     	BUS_unlock(pn)
 #define BUSLOCKIN(in)     	BUS_lock_in(in)
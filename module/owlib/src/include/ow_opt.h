@@ -57,7 +57,7 @@ GOOD_OR_BAD owopt_packed(const char *params);
 
 // All these command line arguments are after the printable ascii characters
 enum e_long_option { e_error_print = 257, e_error_level, e_debug,
-	e_cache_size,
+	e_cache_size, e_cache_shards, e_parse_cache, e_server_workers, e_server_connections,
 	e_fuse_opt, e_fuse_open_opt,
 	e_max_clients,
 	e_safemode,
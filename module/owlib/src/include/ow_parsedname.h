@@ -159,6 +159,11 @@ struct parsedname {
 #define UNCACHED                    ( (UINT) 0x00000020 )
 #define TRIM                        ( (UINT) 0x00000040 )
 #define OWNET                       ( (UINT) 0x00000100 )
+/* Client asks for pipelining, owserver answers with PIPELINE_GRANTED
+   (older owservers just echo the request bit). Once granted, headers on
+   that connection are followed by a 32 bit request id */
+#define PIPELINE_REQUEST            ( (UINT) 0x00000200 )
+#define PIPELINE_GRANTED            ( (UINT) 0x00000400 )
 #define TEMPSCALE_MASK              ( (UINT) 0x00030000 )
 #define TEMPSCALE_BIT      16
 #define PRESSURESCALE_MASK          ( (UINT) 0x001C0000 )
@@ -119,8 +119,24 @@ struct port_in {
 	struct timeval timeout ; // for serial or tcp read
 	
 	pthread_mutex_t port_mutex;
+	struct port_worker * worker; // threads for jobs on this port, started on first use
 };
 
+/* A job for a port's worker threads (see ow_port_worker.c) */
+struct port_job {
+	void (*func) (void *) ;
+	void * data ;
+	struct port_batch * batch ;
+	struct port_job * next ;
+} ;
+
+/* Jobs dispatched together and waited for together */
+struct port_batch {
+	pthread_mutex_t mutex ;
+	pthread_cond_t cond ;
+	int pending ;
+} ;
+
 /* This bug-fix/workaround function seem to be fixed now... At least on
  * the platforms I have tested it on... printf() in owserver/src/c/owserver.c
  * returned very strange result on c->busmode before... but not anymore */
@@ -132,4 +148,9 @@ struct port_in *LinkPort(struct port_in *pin) ;
 struct port_in *NewPort(const struct port_in *pin) ;
 struct connection_in * AddtoPort( struct port_in * pin ) ;
 
+void PortBatch_init( struct port_batch * batch ) ;
+void PortBatch_wait( struct port_batch * batch ) ;
+void PortWorker_dispatch( struct port_in * pin, struct port_job * job, void (*func) (void *), void * data, struct port_batch * batch ) ;
+void PortWorker_stop( struct port_in * pin ) ;
+
 #endif							/* OW_PORT_IN_H */
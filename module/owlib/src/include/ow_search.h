@@ -55,12 +55,20 @@
 
 enum search_status { search_good, search_done, search_error } ;
 
+/* Root searches of bit-banging masters, checked against the last listing */
+enum search_seed {
+	seed_none,					// plain search
+	seed_record,				// full search, keep the result as the next seed
+	seed_verified,				// last listing still there, served from gulp
+} ;
+
 struct device_search {
 	int LastDiscrepancy;		// for search
 	int LastDevice;				// for search
 	int index;
 	BYTE sn[SERIAL_NUMBER_SIZE];
 	BYTE search;
+	enum search_seed seed;
 
 	// For adapters that maintain dir-at-once (or dirgulp):
 	struct dirblob gulp;
@@ -23,6 +23,7 @@ DeviceHeader(stats_write);
 DeviceHeader(stats_directory);
 DeviceHeader(stats_errors);
 DeviceHeader(stats_thread);
+DeviceHeader(stats_server);
 DeviceHeader(stats_return_code);
 
 #endif							/* OW_STATS */
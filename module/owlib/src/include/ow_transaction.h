@@ -145,5 +145,8 @@ struct transaction_log {
 
 GOOD_OR_BAD BUS_transaction(const struct transaction_log *tl, const struct parsedname *pn);
 GOOD_OR_BAD BUS_transaction_nolock(const struct transaction_log *tl, const struct parsedname *pn);
+GOOD_OR_BAD Convert_Powered(const struct transaction_log *start, UINT delay, const struct parsedname *pn);
+GOOD_OR_BAD Convert_Wait(UINT locks, UINT delay, const struct parsedname *pn);
+UINT Convert_Bus_Locks(struct connection_in *in);
 
 #endif							/* OW_TRANSACTION_H */
@@ -37,6 +37,9 @@ SIZE_OR_ERROR DS9490_write(BYTE * buf, size_t size, const struct parsedname *pn)
 void DS9490_close(struct connection_in *in);
 void DS9490_port_setup( libusb_device * dev, struct port_in * pin ) ;
 
+GOOD_OR_BAD DS9490_sendback_sync(BYTE * data, BYTE * resp, size_t len, const struct parsedname *pn);
+GOOD_OR_BAD DS9490_sendback_async(BYTE * data, BYTE * resp, size_t len, UINT block_io, const struct parsedname *pn);
+
 // Mode Command Code Constants
 #define ONEWIREDEVICEDETECT               0xA5
 #define COMMCMDERRORRESULT_NRS            0x01
@@ -44,6 +47,15 @@ void DS9490_port_setup( libusb_device * dev, struct port_in * pin ) ;
 
 extern char badUSBname[] ;
 
+#define CONTROL_REQUEST_TYPE  0x40
+
+/** EP1 -- control read */
+#define DS2490_EP1              0x81
+/** EP2 -- bulk write */
+#define DS2490_EP2              0x02
+/** EP3 -- bulk read */
+#define DS2490_EP3              0x83
+
 #define CONTROL_CMD     0x00
 #define COMM_CMD        0x01
 #define MODE_CMD        0x02
@@ -50,6 +50,8 @@ enum e_visibility NeverVisible( const struct parsedname * pn ) ;
 
 GOOD_OR_BAD GetVisibilityCache( int * visibility_parameter, const struct parsedname * pn ) ;
 void SetVisibilityCache( int visibility_parameter, const struct parsedname * pn ) ;
+GOOD_OR_BAD GetDirectoryVisibilityCache( BYTE * bitmaps, size_t size, const struct parsedname * pn ) ;
+void SetDirectoryVisibilityCache( const BYTE * bitmaps, size_t size, const struct parsedname * pn ) ;
 
 enum e_visibility FS_visible( const struct parsedname * pn ) ;
 
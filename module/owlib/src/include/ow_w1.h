@@ -47,6 +47,12 @@ SEQ_OR_ERROR W1_send_msg( struct connection_in * in, struct w1_netlink_msg *msg,
 GOOD_OR_BAD W1PipeSelect_timeout( FILE_DESCRIPTOR_OR_ERROR file_descriptor ) ;
 void * W1_Dispatch( void * v ) ;
 
+// --w1_multiplex replies, by netlink sequence number
+GOOD_OR_BAD W1_Completion_Claim( uint32_t seq ) ;
+GOOD_OR_BAD W1_Completion_Deliver( struct nlmsghdr * nlm ) ;
+struct nlmsghdr * W1_Completion_Wait( uint32_t seq ) ;
+void W1_Completion_Release( uint32_t seq ) ;
+
 SEQ_OR_ERROR w1_list_masters( void ) ;
 
 #define MAKE_NL_SEQ( bus, seq )  ((uint32_t)(( ((bus) & 0xFFFF) << 16 ) | ((seq) & 0xFFFF)))
@@ -0,0 +1,93 @@
+#include "owlib_bench.h"
+
+// Many threads hammering the temporary cache through the device-location entries
+// (same Cache_Add_Common / Cache_Get_Common path as property values)
+// 90% lookups, 10% inserts, over a fixed set of serial numbers
+
+#define CACHE_BENCH_DEVICES	2000
+#define CACHE_BENCH_LOOPS	200000
+
+struct cache_bench_job {
+	int thread_number ;
+	UINT hits ;
+} ;
+
+static void cache_bench_sn( BYTE * sn, int device )
+{
+	memset( sn, 0, SERIAL_NUMBER_SIZE ) ;
+	sn[0] = 0x28 ;
+	sn[1] = BYTE_MASK( device ) ;
+	sn[2] = BYTE_MASK( device >> 8 ) ;
+	sn[7] = CRC8compute( sn, SERIAL_NUMBER_SIZE-1, 0 ) ;
+}
+
+static void * cache_bench_thread( void * v )
+{
+	struct cache_bench_job * job = v ;
+	struct parsedname pn ;
+	unsigned int seed = job->thread_number ;
+	int loop ;
+
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	for ( loop = 0 ; loop < CACHE_BENCH_LOOPS ; ++loop ) {
+		int device = rand_r( &seed ) % CACHE_BENCH_DEVICES ;
+		cache_bench_sn( pn.sn, device ) ;
+		if ( loop % 10 == 0 ) {
+			Cache_Add_Device( device % 8, pn.sn ) ;
+		} else {
+			int bus_nr ;
+			if ( GOOD( Cache_Get_Device( &bus_nr, &pn ) ) ) {
+				++ job->hits ;
+			}
+		}
+	}
+	return VOID_RETURN ;
+}
+
+static void cache_bench_run( int shards, int threads )
+{
+	pthread_t thread[threads] ;
+	struct cache_bench_job job[threads] ;
+	char name[64] ;
+	double start ;
+	int device ;
+	int thread_number ;
+
+	Globals.cache_shards = shards ;
+	Cache_Configure() ;
+
+	// prefill
+	for ( device = 0 ; device < CACHE_BENCH_DEVICES ; ++device ) {
+		BYTE sn[SERIAL_NUMBER_SIZE] ;
+		cache_bench_sn( sn, device ) ;
+		Cache_Add_Device( device % 8, sn ) ;
+	}
+
+	start = owlib_bench_now() ;
+	for ( thread_number = 0 ; thread_number < threads ; ++thread_number ) {
+		job[thread_number].thread_number = thread_number ;
+		job[thread_number].hits = 0 ;
+		pthread_create( &thread[thread_number], DEFAULT_THREAD_ATTR, cache_bench_thread, &job[thread_number] ) ;
+	}
+	for ( thread_number = 0 ; thread_number < threads ; ++thread_number ) {
+		pthread_join( thread[thread_number], NULL ) ;
+	}
+
+	snprintf( name, sizeof(name), "shards=%-2d threads=%-2d", shards, threads ) ;
+	owlib_bench_report( name, threads * CACHE_BENCH_LOOPS, owlib_bench_now() - start ) ;
+}
+
+void ow_cache_bench(void)
+{
+	int shards[] = { 1, 4, 16, 64, } ;
+	int threads[] = { 1, 4, 16, 32, } ;
+	int s, t ;
+
+	for ( s = 0 ; s < (int) (sizeof(shards)/sizeof(int)) ; ++s ) {
+		for ( t = 0 ; t < (int) (sizeof(threads)/sizeof(int)) ; ++t ) {
+			cache_bench_run( shards[s], threads[t] ) ;
+		}
+	}
+	Globals.cache_shards = 1 ;
+	Cache_Configure() ;
+}
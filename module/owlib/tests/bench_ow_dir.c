@@ -0,0 +1,66 @@
+#include "owlib_bench.h"
+
+// Device directory listings (FS_devdir), from the listing made at startup
+// and, for comparison, parsing every entry as before. Devices are taken as
+// present (one_device) so no bus masters are needed.
+
+#define DIR_BENCH_LOOPS	2000
+
+static const char * dir_bench_paths[] = {
+	"/10.67C6697351FF",
+	"/29.0123456789AB",
+	"/1D.0123456789AB",
+	"/23.0123456789AB/pages",
+	"/statistics/read",
+} ;
+
+#define DIR_BENCH_PATHS	( sizeof(dir_bench_paths) / sizeof(dir_bench_paths[0]) )
+
+static void dir_bench_count( void * v, const struct parsedname * pn_entry )
+{
+	(void) pn_entry ;
+	++ *(UINT *) v ;
+}
+
+static void dir_bench_run( const char * path, int parsed )
+{
+	struct parsedname s_pn ;
+	struct parsedname * pn = &s_pn ;
+	struct device_directory * dd ;
+	char name[64] ;
+	UINT entries = 0 ;
+	UINT loop ;
+	double start ;
+
+	if ( FS_ParsedName( path, pn ) != 0 ) {
+		printf( "Cannot parse %s\n", path ) ;
+		return ;
+	}
+	dd = pn->selected_device->directory ;
+	if ( parsed ) {
+		pn->selected_device->directory = NULL ;
+	}
+
+	start = owlib_bench_now() ;
+	for ( loop = 0 ; loop < DIR_BENCH_LOOPS ; ++loop ) {
+		FS_dir( dir_bench_count, &entries, pn ) ;
+	}
+
+	snprintf( name, sizeof(name), "%-24s %s %u", path, parsed ? "parsed" : "listing", entries / DIR_BENCH_LOOPS ) ;
+	owlib_bench_report( name, entries, owlib_bench_now() - start ) ;
+
+	pn->selected_device->directory = dd ;
+	FS_ParsedName_destroy( pn ) ;
+}
+
+void ow_dir_bench(void)
+{
+	size_t path_index ;
+
+	Globals.one_device = 1 ;
+	for ( path_index = 0 ; path_index < DIR_BENCH_PATHS ; ++path_index ) {
+		dir_bench_run( dir_bench_paths[path_index], 1 ) ;
+		dir_bench_run( dir_bench_paths[path_index], 0 ) ;
+	}
+	Globals.one_device = 0 ;
+}
@@ -0,0 +1,109 @@
+#include "owlib_bench.h"
+
+// Presence lookups in a cached bus directory (PresenceFromDirblob), half
+// of them for devices on the bus:
+//   ordered  -- copy of the list searched in order (before the index)
+//   unpacked -- copy of the list and its index, searched by index
+//   in place -- the cached data searched by index, no copy (as now)
+
+#define DIRBLOB_BENCH_LOOKUPS	200000
+
+static const int dirblob_bench_sizes[] = { 4, 16, 64, 256, 1000, } ;
+
+static void dirblob_bench_sn( BYTE * sn, int device )
+{
+	memset( sn, 0, SERIAL_NUMBER_SIZE ) ;
+	sn[0] = 0x28 ;
+	sn[1] = BYTE_MASK( device ) ;
+	sn[2] = BYTE_MASK( device >> 8 ) ;
+	sn[7] = CRC8compute( sn, SERIAL_NUMBER_SIZE-1, 0 ) ;
+}
+
+static int dirblob_bench_ordered( const BYTE * sn, const struct dirblob * db )
+{
+	int device_index ;
+
+	for ( device_index = 0 ; device_index < db->devices ; ++device_index ) {
+		if ( memcmp( sn, &db->snlist[SERIAL_NUMBER_SIZE * device_index], SERIAL_NUMBER_SIZE ) == 0 ) {
+			return device_index ;
+		}
+	}
+	return INDEX_BAD ;
+}
+
+static void dirblob_bench_run( int devices )
+{
+	struct dirblob db ;
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	BYTE * packed ;
+	size_t packed_size ;
+	char name[64] ;
+	UINT found ;
+	UINT loop ;
+	double start ;
+	int device ;
+
+	DirblobInit( &db ) ;
+	for ( device = 0 ; device < devices ; ++device ) {
+		dirblob_bench_sn( sn, device ) ;
+		DirblobAdd( sn, &db ) ;
+	}
+	packed_size = DirblobPackedSize( &db ) ;
+	packed = owmalloc( packed_size ) ;
+	if ( packed == NULL ) {
+		DirblobClear( &db ) ;
+		return ;
+	}
+	DirblobPack( packed, &db ) ;
+
+	found = 0 ;
+	start = owlib_bench_now() ;
+	for ( loop = 0 ; loop < DIRBLOB_BENCH_LOOKUPS ; ++loop ) {
+		struct dirblob cached ;
+		dirblob_bench_sn( sn, loop % ( 2 * devices ) ) ;
+		DirblobRecreate( db.snlist, SERIAL_NUMBER_SIZE * devices, &cached ) ;
+		if ( dirblob_bench_ordered( sn, &cached ) >= 0 ) {
+			++found ;
+		}
+		DirblobClear( &cached ) ;
+	}
+	snprintf( name, sizeof(name), "devices=%-4d ordered found=%u", devices, found ) ;
+	owlib_bench_report( name, DIRBLOB_BENCH_LOOKUPS, owlib_bench_now() - start ) ;
+
+	found = 0 ;
+	start = owlib_bench_now() ;
+	for ( loop = 0 ; loop < DIRBLOB_BENCH_LOOKUPS ; ++loop ) {
+		struct dirblob cached ;
+		dirblob_bench_sn( sn, loop % ( 2 * devices ) ) ;
+		DirblobUnpack( packed, packed_size, &cached ) ;
+		if ( DirblobSearch( sn, &cached ) >= 0 ) {
+			++found ;
+		}
+		DirblobClear( &cached ) ;
+	}
+	snprintf( name, sizeof(name), "devices=%-4d unpacked found=%u", devices, found ) ;
+	owlib_bench_report( name, DIRBLOB_BENCH_LOOKUPS, owlib_bench_now() - start ) ;
+
+	found = 0 ;
+	start = owlib_bench_now() ;
+	for ( loop = 0 ; loop < DIRBLOB_BENCH_LOOKUPS ; ++loop ) {
+		dirblob_bench_sn( sn, loop % ( 2 * devices ) ) ;
+		if ( DirblobSearchPacked( sn, packed, packed_size ) >= 0 ) {
+			++found ;
+		}
+	}
+	snprintf( name, sizeof(name), "devices=%-4d in place found=%u", devices, found ) ;
+	owlib_bench_report( name, DIRBLOB_BENCH_LOOKUPS, owlib_bench_now() - start ) ;
+
+	owfree( packed ) ;
+	DirblobClear( &db ) ;
+}
+
+void ow_dirblob_bench(void)
+{
+	size_t size_index ;
+
+	for ( size_index = 0 ; size_index < sizeof(dirblob_bench_sizes)/sizeof(dirblob_bench_sizes[0]) ; ++size_index ) {
+		dirblob_bench_run( dirblob_bench_sizes[size_index] ) ;
+	}
+}
@@ -0,0 +1,390 @@
+#include "owlib_bench.h"
+#include "ow_connection.h"
+#include "ow_1820.h"
+#include <poll.h>
+
+// DS9097U (DS2480B) transactions, one at a time against bundled.
+//
+// A DS2480B and one DS18B20 sit on the far side of a pseudo terminal,
+// the library opens the slave side as its serial port. The adapter is
+// modeled at command level (modes, configuration, reset, single bits and
+// data bytes) and the slave at bit level. Time is virtual: every chunk the
+// adapter receives costs a round trip (serial latency), the bytes both ways
+// at the configured baud rate, and the 1-wire slots.
+// Results are 1-wire transactions per second of that virtual time.
+
+#define FAKE_LATENCY_US		1000	// per round trip, USB serial bridge
+#define FAKE_RESET_US		1000	// reset and presence
+#define FAKE_SLOT_US		65		// one bit, standard speed
+
+#define DS2480_BENCH_LOOPS	200
+
+static BYTE fake_rom[SERIAL_NUMBER_SIZE] = { 0x28, 0x31, 0x41, 0x59, 0x26, 0x53, 0x00, 0x00, } ;
+
+enum fake_state { fake_idle, fake_rom_command, fake_match, fake_function, } ;
+
+static struct {
+	int master ;				// pty master
+	pthread_t thread ;
+	int stop ;
+
+	// DS2480B
+	int command_mode ;
+	int escape ;				// MODE_COMMAND seen in data mode
+	BYTE config[8] ;			// parameter values, by parameter code
+
+	// DS18B20
+	enum fake_state state ;
+	int match_index ;
+	BYTE scratchpad[9] ;
+	const BYTE * tx ;			// bytes the slave sends
+	int tx_length ;
+	int tx_index ;
+	BYTE rx ;					// bits seen on the bus
+	int bit ;
+
+	long long onewire_us ;		// 1-wire time of this chunk
+	long long now ;				// virtual usec
+	UINT chunks ;				// round trips
+} fake ;
+
+static pthread_mutex_t fake_mutex = PTHREAD_MUTEX_INITIALIZER ;
+
+static long long fake_byte_us( void )
+{
+	// baud rate parameter (code 7), 10 bit times per byte
+	switch ( fake.config[7] & 0x06 ) {
+		case 0x02:
+			return 521 ;
+		case 0x04:
+			return 174 ;
+		case 0x06:
+			return 87 ;
+		default:
+			return 1042 ;
+	}
+}
+
+/* ---- the DS18B20 ---- */
+
+static void fake_slave_reset( void )
+{
+	fake.state = fake_rom_command ;
+	fake.tx_length = 0 ;
+	fake.bit = 0 ;
+	fake.rx = 0 ;
+	fake.onewire_us += FAKE_RESET_US ;
+}
+
+static void fake_slave_byte( BYTE b )
+{
+	switch ( fake.state ) {
+		case fake_rom_command:
+			if ( b == 0x55 ) {
+				fake.match_index = 0 ;
+				fake.state = fake_match ;
+			} else if ( b == 0xCC ) {
+				fake.state = fake_function ;
+			} else {
+				fake.state = fake_idle ;
+			}
+			break ;
+		case fake_match:
+			if ( b != fake_rom[fake.match_index] ) {
+				fake.state = fake_idle ;
+			} else if ( ++fake.match_index == SERIAL_NUMBER_SIZE ) {
+				fake.state = fake_function ;
+			}
+			break ;
+		case fake_function:
+			if ( b == 0xBE ) {
+				fake.tx = fake.scratchpad ;
+				fake.tx_length = sizeof(fake.scratchpad) ;
+				fake.tx_index = 0 ;
+			}
+			// 0x44 (convert) is done at once
+			fake.state = fake_idle ;
+			break ;
+		case fake_idle:
+			break ;
+	}
+}
+
+// one time slot, wired-AND of master and slave
+static int fake_slave_bit( int w )
+{
+	int r = w ;
+
+	if ( fake.tx_index < fake.tx_length ) {
+		r &= ( fake.tx[fake.tx_index] >> fake.bit ) & 1 ;
+	}
+	fake.rx |= r << fake.bit ;
+	fake.onewire_us += FAKE_SLOT_US ;
+	if ( ++fake.bit == 8 ) {
+		if ( fake.tx_index < fake.tx_length ) {
+			++fake.tx_index ;
+		} else {
+			fake_slave_byte( fake.rx ) ;
+		}
+		fake.bit = 0 ;
+		fake.rx = 0 ;
+	}
+	return r ;
+}
+
+static BYTE fake_slave_data( BYTE w )
+{
+	BYTE r = 0 ;
+	int i ;
+
+	for ( i = 0 ; i < 8 ; ++i ) {
+		r |= fake_slave_bit( ( w >> i ) & 1 ) << i ;
+	}
+	return r ;
+}
+
+/* ---- the DS2480B ---- */
+
+// command mode byte, the response (if any) appended
+static void fake_command( BYTE b, BYTE * out, size_t * out_length )
+{
+	switch ( b ) {
+		case 0xE1: // data mode
+			fake.command_mode = 0 ;
+			return ;
+		case 0xE3: // already in command mode
+			return ;
+		case 0xF1: // pulse termination
+			out[(*out_length)++] = b & 0xFE ;
+			return ;
+	}
+
+	if ( ( b & 0x81 ) == 0x01 ) {
+		// configuration
+		int parameter = ( b >> 4 ) & 0x07 ;
+		if ( parameter == 0 ) {
+			out[(*out_length)++] = fake.config[( b >> 1 ) & 0x07] ;
+		} else {
+			fake.config[parameter] = b & 0x0E ;
+			out[(*out_length)++] = b & 0xFE ;
+		}
+		return ;
+	}
+
+	if ( ( b & 0x81 ) == 0x81 ) {
+		switch ( b & 0x60 ) {
+			case 0x00: // single bit
+				out[(*out_length)++] = ( b & 0xFC ) | ( fake_slave_bit( ( b & 0x10 ) ? 1 : 0 ) ? 0x03 : 0x00 ) ;
+				return ;
+			case 0x40: // reset, DS9097U chip id and presence
+				fake_slave_reset() ;
+				out[(*out_length)++] = 0xCD ;
+				return ;
+			case 0x20: // search accelerator on or off
+				return ;
+			default: // pulse
+				out[(*out_length)++] = b & 0xFC ;
+				return ;
+		}
+	}
+}
+
+static void fake_data( BYTE b, BYTE * out, size_t * out_length )
+{
+	out[(*out_length)++] = fake_slave_data( b ) ;
+}
+
+static void fake_chunk( const BYTE * in, size_t in_length )
+{
+	BYTE out[in_length] ;
+	size_t out_length = 0 ;
+	size_t i ;
+
+	fake.onewire_us = 0 ;
+	for ( i = 0 ; i < in_length ; ++i ) {
+		BYTE b = in[i] ;
+		if ( fake.command_mode ) {
+			fake_command( b, out, &out_length ) ;
+		} else if ( fake.escape ) {
+			fake.escape = 0 ;
+			if ( b == 0xE3 ) {
+				fake_data( b, out, &out_length ) ;
+			} else {
+				fake.command_mode = 1 ;
+				fake_command( b, out, &out_length ) ;
+			}
+		} else if ( b == 0xE3 ) {
+			fake.escape = 1 ;
+		} else {
+			fake_data( b, out, &out_length ) ;
+		}
+	}
+
+	pthread_mutex_lock( &fake_mutex ) ;
+	++fake.chunks ;
+	fake.now += FAKE_LATENCY_US + ( in_length + out_length ) * fake_byte_us() + fake.onewire_us ;
+	pthread_mutex_unlock( &fake_mutex ) ;
+
+	if ( out_length > 0 && write( fake.master, out, out_length ) != (ssize_t) out_length ) {
+		fprintf( stderr, "DS2480B simulator write failed\n" ) ;
+	}
+}
+
+static void * fake_thread( void * v )
+{
+	(void) v ;
+	while ( ! fake.stop ) {
+		struct pollfd pfd = { .fd = fake.master, .events = POLLIN, } ;
+		BYTE in[256] ;
+		ssize_t in_length ;
+
+		if ( poll( &pfd, 1, 20 ) <= 0 ) {
+			continue ;
+		}
+		in_length = read( fake.master, in, sizeof(in) ) ;
+		if ( in_length > 0 ) {
+			fake_chunk( in, in_length ) ;
+		}
+	}
+	return NULL ;
+}
+
+static const char * fake_open( void )
+{
+	memset( &fake, 0, sizeof(fake) ) ;
+	fake.command_mode = 1 ;
+	fake.scratchpad[0] = 0x50 ; // 85C
+	fake.scratchpad[1] = 0x05 ;
+	fake.scratchpad[4] = 0x7F ;
+	fake.scratchpad[5] = 0xFF ;
+	fake.scratchpad[6] = 0x0C ;
+	fake.scratchpad[7] = 0x10 ;
+	fake.scratchpad[8] = CRC8compute( fake.scratchpad, 8, 0 ) ;
+	fake_rom[7] = CRC8compute( fake_rom, SERIAL_NUMBER_SIZE-1, 0 ) ;
+
+	fake.master = posix_openpt( O_RDWR | O_NOCTTY ) ;
+	if ( fake.master < 0 || grantpt( fake.master ) != 0 || unlockpt( fake.master ) != 0 ) {
+		return NULL ;
+	}
+	if ( pthread_create( &fake.thread, NULL, fake_thread, NULL ) != 0 ) {
+		return NULL ;
+	}
+	return ptsname( fake.master ) ;
+}
+
+static void fake_close( void )
+{
+	fake.stop = 1 ;
+	pthread_join( fake.thread, NULL ) ;
+	close( fake.master ) ;
+}
+
+/* ---- the benchmark ---- */
+
+static void ds2480_bench_run( const char * name, struct parsedname * pn, const struct transaction_log * t, int bundle )
+{
+	struct connection_in * in = pn->selected_connection ;
+	char label[64] ;
+	UINT loop ;
+	UINT bad = 0 ;
+	UINT chunks ;
+	long long start ;
+
+	if ( bundle ) {
+		in->iroutines.flags |= ADAP_FLAG_bundle ;
+	} else {
+		in->iroutines.flags &= ~ADAP_FLAG_bundle ;
+	}
+
+	// settle the bus first (pending pulse, baud change)
+	BUS_transaction( t, pn ) ;
+
+	pthread_mutex_lock( &fake_mutex ) ;
+	start = fake.now ;
+	chunks = fake.chunks ;
+	pthread_mutex_unlock( &fake_mutex ) ;
+
+	for ( loop = 0 ; loop < DS2480_BENCH_LOOPS ; ++loop ) {
+		if ( BAD( BUS_transaction( t, pn ) ) ) {
+			++bad ;
+		}
+	}
+
+	pthread_mutex_lock( &fake_mutex ) ;
+	start = fake.now - start ;
+	chunks = fake.chunks - chunks ;
+	pthread_mutex_unlock( &fake_mutex ) ;
+
+	snprintf( label, sizeof(label), "%-7s %-9s bad=%u writes=%.1f", bundle ? "bundled" : "single", name, bad, chunks / (double) DS2480_BENCH_LOOPS ) ;
+	owlib_bench_report( label, DS2480_BENCH_LOOPS, start / 1000000. ) ;
+}
+
+void ow_ds2480_bench(void)
+{
+	struct port_in * pin ;
+	struct connection_in * in ;
+	struct parsedname pn ;
+	const char * pts = fake_open() ;
+	BYTE read_scratchpad[1] = { 0xBE, } ;
+	BYTE convert[1] = { 0x44, } ;
+	BYTE data[9] ;
+	struct transaction_log t_read[] = {
+		TRXN_START,
+		TRXN_WRITE1(read_scratchpad),
+		TRXN_READ(data, 9),
+		TRXN_CRC8(data, 9),
+		TRXN_END,
+	} ;
+	struct transaction_log t_convert[] = {
+		TRXN_START,
+		TRXN_POWER(convert, 0),
+		TRXN_END,
+	} ;
+	static const speed_t bauds[] = { B9600, B115200, } ;
+	UINT baud_index ;
+
+	if ( pts == NULL ) {
+		printf( "No pseudo terminal for the DS2480B simulator\n" ) ;
+		return ;
+	}
+
+	pin = NewPort( NULL ) ;
+	if ( pin == NULL ) {
+		fake_close() ;
+		return ;
+	}
+	in = pin->first ;
+	pin->type = ct_serial ;
+	pin->busmode = bus_serial ;
+	DEVICENAME(in) = owstrdup( pts ) ;
+	pin->init_data = owstrdup( pts ) ;
+	if ( BAD( DS2480_detect( pin ) ) ) {
+		printf( "DS2480B simulator not detected\n" ) ;
+		RemovePort( pin ) ;
+		fake_close() ;
+		return ;
+	}
+
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	pn.selected_connection = in ;
+	pn.selected_device = &d_DS18B20 ;
+	memcpy( pn.sn, fake_rom, SERIAL_NUMBER_SIZE ) ;
+
+	for ( baud_index = 0 ; baud_index < sizeof(bauds)/sizeof(bauds[0]) ; ++baud_index ) {
+		char name[32] ;
+		pin->baud = bauds[baud_index] ;
+		++in->changed_bus_settings ;
+
+		snprintf( name, sizeof(name), "read %s", bauds[baud_index] == B9600 ? "9600" : "115200" ) ;
+		ds2480_bench_run( name, &pn, t_read, 0 ) ;
+		ds2480_bench_run( name, &pn, t_read, 1 ) ;
+
+		snprintf( name, sizeof(name), "convert %s", bauds[baud_index] == B9600 ? "9600" : "115200" ) ;
+		ds2480_bench_run( name, &pn, t_convert, 0 ) ;
+		ds2480_bench_run( name, &pn, t_convert, 1 ) ;
+	}
+
+	COM_close( in ) ;
+	RemovePort( pin ) ;
+	fake_close() ;
+}
@@ -0,0 +1,68 @@
+#include "owlib_bench.h"
+
+// FS_ParsedName over a mix of the paths owfs and owserver typically see,
+// with and without the parse cache. Devices are taken as present
+// (one_device) so no bus masters are needed.
+
+#define PARSENAME_BENCH_LOOPS	20000
+
+static const char * parsename_bench_paths[] = {
+	"/",
+	"/10.67C6697351FF/temperature",
+	"/10.67C6697351FF/type",
+	"/28.0123456789AB/temperature",
+	"/28.0123456789AB/temperature12",
+	"/uncached/28.0123456789AB/temperature",
+	"/text/uncached/10.67C6697351FF/address",
+	"/29.0123456789AB/PIO.ALL",
+	"/29.0123456789AB/PIO.BYTE",
+	"/29.0123456789AB/sensed.3",
+	"/12.0123456789AB/PIO.A",
+	"/1D.0123456789AB/counters.ALL",
+	"/26.0123456789AB/VAD",
+	"/26.0123456789AB/pages/page.3",
+	"/simultaneous/temperature",
+	"/statistics/cache/flips",
+	"/statistics/read/bytes",
+	"/settings/units/temperature_scale",
+	"/structure/10/temperature",
+	"/system/process/pid",
+} ;
+
+#define PARSENAME_BENCH_PATHS	( sizeof(parsename_bench_paths) / sizeof(parsename_bench_paths[0]) )
+
+static void parsename_bench_run( int parse_cache )
+{
+	char name[64] ;
+	double start ;
+	UINT loop ;
+	UINT bad = 0 ;
+
+	Globals.parse_cache = parse_cache ;
+	ParseCache_Configure() ;
+
+	start = owlib_bench_now() ;
+	for ( loop = 0 ; loop < PARSENAME_BENCH_LOOPS ; ++loop ) {
+		UINT path_index ;
+		for ( path_index = 0 ; path_index < PARSENAME_BENCH_PATHS ; ++path_index ) {
+			struct parsedname pn ;
+			if ( FS_ParsedName( parsename_bench_paths[path_index], &pn ) == 0 ) {
+				FS_ParsedName_destroy( &pn ) ;
+			} else {
+				++bad ;
+			}
+		}
+	}
+
+	snprintf( name, sizeof(name), "parse_cache=%-4d bad=%u", parse_cache, bad ) ;
+	owlib_bench_report( name, PARSENAME_BENCH_LOOPS * PARSENAME_BENCH_PATHS, owlib_bench_now() - start ) ;
+}
+
+void ow_parsename_bench(void)
+{
+	Globals.one_device = 1 ;
+	parsename_bench_run( 0 ) ;
+	parsename_bench_run( 256 ) ;
+	Globals.one_device = 0 ;
+	ParseCache_Close() ;
+}
@@ -0,0 +1,124 @@
+#include "owlib_bench.h"
+#include "ow_connection.h"
+#include "ow_counters.h"
+
+// Reads into a buffer the caller supplies (as owfs and owserver do),
+// from a simulated bus master: no 1-wire time, just the read path.
+// Counts the bytes copied after the value was formatted (/statistics/read/copybytes)
+// per request, for a few kinds of values and buffer sizes:
+//   4096 bytes, what fuse hands over
+//   the file length, the tightest a caller can ask for
+//   with an offset, which always needs a copy
+
+#define READ_BENCH_LOOPS	20000
+
+struct read_bench_case {
+	const char * property ;
+	size_t size ;	// 0 -- the file length
+	off_t offset ;
+} ;
+
+static const struct read_bench_case read_bench_cases[] = {
+	{ "temperature", 4096, 0, },
+	{ "temperature", 0, 0, },
+	{ "temperature", 4096, 1, },
+	{ "volt.ALL", 4096, 0, },
+	{ "PIO.ALL", 4096, 0, },
+	{ "memory", 4096, 0, },
+	{ "pages/page.ALL", 4096, 0, },
+	{ "address", 4096, 0, },
+} ;
+
+static void read_bench_path( char * path, const BYTE * sn, const char * property )
+{
+	snprintf( path, PATH_MAX, "/%.2X.%.2X%.2X%.2X%.2X%.2X%.2X/%s",
+		sn[0], sn[1], sn[2], sn[3], sn[4], sn[5], sn[6], property ) ;
+}
+
+static void read_bench_run( const struct read_bench_case * rc, const BYTE * sn )
+{
+	char path[PATH_MAX] ;
+	char label[64] ;
+	char * buffer ;
+	size_t size = rc->size ;
+	UINT copied ;
+	UINT bad = 0 ;
+	UINT loop ;
+	double start ;
+
+	read_bench_path( path, sn, rc->property ) ;
+	if ( size == 0 ) {
+		OWQ_allocate_struct_and_pointer( owq ) ;
+		if ( BAD( OWQ_create( path, owq ) ) ) {
+			printf( "Cannot parse %s\n", path ) ;
+			return ;
+		}
+		size = FullFileLength( PN(owq) ) ;
+		OWQ_destroy( owq ) ;
+	}
+	buffer = owmalloc( size ) ;
+	if ( buffer == NULL ) {
+		return ;
+	}
+
+	STATLOCK ;
+	copied = read_copybytes ;
+	STATUNLOCK ;
+
+	start = owlib_bench_now() ;
+	for ( loop = 0 ; loop < READ_BENCH_LOOPS ; ++loop ) {
+		if ( FS_read( path, buffer, size, rc->offset ) < 0 ) {
+			++bad ;
+		}
+	}
+
+	STATLOCK ;
+	copied = read_copybytes - copied ;
+	STATUNLOCK ;
+
+	snprintf( label, sizeof(label), "%-15s size=%-4d off=%d bad=%u copied=%.1f",
+		rc->property, (int) size, (int) rc->offset, bad, copied / (double) READ_BENCH_LOOPS ) ;
+	owlib_bench_report( label, READ_BENCH_LOOPS, owlib_bench_now() - start ) ;
+	owfree( buffer ) ;
+}
+
+void ow_read_bench(void)
+{
+	struct port_in * pin ;
+	struct connection_in * in ;
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	int device_index ;
+	size_t case_index ;
+
+	// DS18S20 temperature, DS2450 volt.ALL, DS2408 PIO.ALL, DS2433 memory, pages/page.ALL
+	if ( BAD( ARG_Fake( "10,20,29,23" ) ) ) {
+		return ;
+	}
+	pin = Inbound_Control.head_port ;
+	in = pin->first ;
+	if ( BAD( Fake_detect( pin ) ) ) {
+		RemovePort( pin ) ;
+		return ;
+	}
+	Globals.uncached = 1 ; // every read formats a fresh value
+
+	for ( case_index = 0 ; case_index < sizeof(read_bench_cases)/sizeof(read_bench_cases[0]) ; ++case_index ) {
+		const struct read_bench_case * rc = &read_bench_cases[case_index] ;
+		// each property on the first device that has it
+		for ( device_index = 0 ; device_index < DirblobElements( &(in->master.fake.main) ) ; ++device_index ) {
+			char path[PATH_MAX] ;
+			OWQ_allocate_struct_and_pointer( owq ) ;
+
+			DirblobGet( device_index, sn, &(in->master.fake.main) ) ;
+			read_bench_path( path, sn, rc->property ) ;
+			if ( GOOD( OWQ_create( path, owq ) ) ) {
+				OWQ_destroy( owq ) ;
+				read_bench_run( rc, sn ) ;
+				break ;
+			}
+		}
+	}
+
+	Globals.uncached = 0 ;
+	RemovePort( pin ) ;
+}
@@ -0,0 +1,309 @@
+#include "owlib_bench.h"
+#include "ow_connection.h"
+#include "ow_usb_msg.h"
+
+// DS9490 block I/O, synchronous against --usb_async, on a fake libusb.
+//
+// The libusb calls the library makes are answered here instead (the
+// program's definitions come first). A DS2490 is modeled on a virtual
+// clock: full speed USB, every transfer completes at the next 1 msec
+// frame, the 1-wire bus echoes each byte after a fixed byte time.
+// Results are 1-wire transactions per second of that virtual time.
+
+#if OW_USB
+
+#define FAKE_FRAME_US		1000
+#define FAKE_FIFO		USB_FIFO_SIZE
+#define FAKE_COMMANDS		16
+#define FAKE_TRANSFERS		8
+
+#define USB_BENCH_LOOPS		200
+
+static struct {
+	long long now ;				// virtual usec
+	long long byte_us ;			// 1-wire byte time
+	BYTE out[FAKE_FIFO] ;		// EP2 FIFO (bytes written, not yet on the 1-wire bus)
+	size_t out_count ;
+	BYTE in[FAKE_FIFO*2] ;		// EP3 FIFO, with the time each byte is done
+	long long in_done[FAKE_FIFO*2] ;
+	size_t in_count ;
+	long long busy_until ;		// 1-wire bus busy with BLOCK_IO commands
+	UINT transfers ;			// USB transfers, either API
+	struct libusb_transfer * pending[FAKE_TRANSFERS] ;
+	long long pending_done[FAKE_TRANSFERS] ;
+	int pending_count ;
+} fake ;
+
+static long long fake_next_frame( void )
+{
+	return ( fake.now / FAKE_FRAME_US + 1 ) * FAKE_FRAME_US ;
+}
+
+// bytes of the EP3 FIFO done at the current time
+static size_t fake_in_ready( void )
+{
+	size_t ready = 0 ;
+	while ( ready < fake.in_count && fake.in_done[ready] <= fake.now ) {
+		++ready ;
+	}
+	return ready ;
+}
+
+static void fake_bulk_out( BYTE * data, int length )
+{
+	if ( fake.out_count + length <= FAKE_FIFO ) {
+		memcpy( &fake.out[fake.out_count], data, length ) ;
+		fake.out_count += length ;
+	}
+}
+
+// BLOCK_IO: the bytes go over the 1-wire bus one after another and come back
+static void fake_block_io( UINT length )
+{
+	long long t = fake.busy_until > fake.now ? fake.busy_until : fake.now ;
+	UINT i ;
+
+	if ( length > fake.out_count ) {
+		length = fake.out_count ;
+	}
+	for ( i = 0 ; i < length && fake.in_count < FAKE_FIFO*2 ; ++i ) {
+		t += fake.byte_us ;
+		fake.in[fake.in_count] = fake.out[i] ;
+		fake.in_done[fake.in_count] = t ;
+		++fake.in_count ;
+	}
+	memmove( fake.out, &fake.out[length], fake.out_count - length ) ;
+	fake.out_count -= length ;
+	fake.busy_until = t ;
+}
+
+static int fake_bulk_in( BYTE * data, int length )
+{
+	size_t ready = fake_in_ready() ;
+	size_t n = ( (size_t) length < ready ) ? (size_t) length : ready ;
+
+	memcpy( data, fake.in, n ) ;
+	memmove( fake.in, &fake.in[n], ( fake.in_count - n ) * sizeof(BYTE) ) ;
+	memmove( fake.in_done, &fake.in_done[n], ( fake.in_count - n ) * sizeof(long long) ) ;
+	fake.in_count -= n ;
+	return n ;
+}
+
+static int fake_status( BYTE * data, int length )
+{
+	size_t ready = fake_in_ready() ;
+
+	memset( data, 0, length ) ;
+	data[8] = ( fake.busy_until <= fake.now ) ? STATUSFLAGS_IDLE : 0 ;
+	data[13] = ready > 255 ? 255 : ready ;
+	return DS9490_getstatus_BUFFER ;
+}
+
+// the transfer, done at the current (virtual) time
+static int fake_perform( unsigned char endpoint, BYTE * data, int length, UINT wValue, UINT wIndex )
+{
+	++fake.transfers ;
+	switch ( endpoint ) {
+		case DS2490_EP2:
+			fake_bulk_out( data, length ) ;
+			return length ;
+		case DS2490_EP3:
+			return fake_bulk_in( data, length ) ;
+		case DS2490_EP1:
+			return fake_status( data, length ) ;
+		default: // control
+			if ( wValue == ( 0x0074 | 0x0001 | 0x0800 ) ) { // COMM_BLOCK_IO | COMM_IM | COMM_F
+				fake_block_io( wIndex ) ;
+			}
+			return 0 ;
+	}
+}
+
+/* ---- libusb, synchronous ---- */
+
+int LIBUSB_CALL libusb_bulk_transfer(libusb_device_handle *dev_handle, unsigned char endpoint, unsigned char *data, int length, int *actual_length, unsigned int timeout)
+{
+	(void) dev_handle ;
+	(void) timeout ;
+	fake.now = fake_next_frame() ;
+	actual_length[0] = fake_perform( endpoint, data, length, 0, 0 ) ;
+	return 0 ;
+}
+
+int LIBUSB_CALL libusb_interrupt_transfer(libusb_device_handle *dev_handle, unsigned char endpoint, unsigned char *data, int length, int *actual_length, unsigned int timeout)
+{
+	return libusb_bulk_transfer( dev_handle, endpoint, data, length, actual_length, timeout ) ;
+}
+
+int LIBUSB_CALL libusb_control_transfer(libusb_device_handle *dev_handle, uint8_t request_type, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, unsigned char *data, uint16_t wLength, unsigned int timeout)
+{
+	(void) dev_handle ;
+	(void) request_type ;
+	(void) bRequest ;
+	(void) data ;
+	(void) wLength ;
+	(void) timeout ;
+	fake.now = fake_next_frame() ;
+	return fake_perform( 0, NULL, 0, wValue, wIndex ) ;
+}
+
+int LIBUSB_CALL libusb_clear_halt(libusb_device_handle *dev_handle, unsigned char endpoint)
+{
+	(void) dev_handle ;
+	(void) endpoint ;
+	return 0 ;
+}
+
+const char * LIBUSB_CALL libusb_error_name(int errcode)
+{
+	(void) errcode ;
+	return "fake" ;
+}
+
+/* ---- libusb, asynchronous ---- */
+
+struct libusb_transfer * LIBUSB_CALL libusb_alloc_transfer(int iso_packets)
+{
+	(void) iso_packets ;
+	return calloc( 1, sizeof(struct libusb_transfer) ) ;
+}
+
+void LIBUSB_CALL libusb_free_transfer(struct libusb_transfer *transfer)
+{
+	free( transfer ) ;
+}
+
+int LIBUSB_CALL libusb_submit_transfer(struct libusb_transfer *transfer)
+{
+	if ( fake.pending_count == FAKE_TRANSFERS ) {
+		return LIBUSB_ERROR_BUSY ;
+	}
+	transfer->status = LIBUSB_TRANSFER_COMPLETED ;
+	fake.pending[fake.pending_count] = transfer ;
+	fake.pending_done[fake.pending_count] = fake_next_frame() ;
+	++fake.pending_count ;
+	return 0 ;
+}
+
+int LIBUSB_CALL libusb_cancel_transfer(struct libusb_transfer *transfer)
+{
+	int i ;
+	for ( i = 0 ; i < fake.pending_count ; ++i ) {
+		if ( fake.pending[i] == transfer ) {
+			transfer->status = LIBUSB_TRANSFER_CANCELLED ;
+			fake.pending_done[i] = fake.now ;
+			return 0 ;
+		}
+	}
+	return LIBUSB_ERROR_NOT_FOUND ;
+}
+
+// complete the earliest transfer, moving the clock up to it
+int LIBUSB_CALL libusb_handle_events_timeout_completed(libusb_context *ctx, struct timeval *tv, int *completed)
+{
+	struct libusb_transfer * transfer ;
+	int first = 0 ;
+	int i ;
+
+	(void) ctx ;
+	(void) tv ;
+	if ( ( completed != NULL && completed[0] ) || fake.pending_count == 0 ) {
+		return 0 ;
+	}
+	for ( i = 1 ; i < fake.pending_count ; ++i ) {
+		if ( fake.pending_done[i] < fake.pending_done[first] ) {
+			first = i ;
+		}
+	}
+	transfer = fake.pending[first] ;
+	if ( fake.pending_done[first] > fake.now ) {
+		fake.now = fake.pending_done[first] ;
+	}
+	--fake.pending_count ;
+	fake.pending[first] = fake.pending[fake.pending_count] ;
+	fake.pending_done[first] = fake.pending_done[fake.pending_count] ;
+
+	if ( transfer->status == LIBUSB_TRANSFER_COMPLETED ) {
+		if ( transfer->type == LIBUSB_TRANSFER_TYPE_CONTROL ) {
+			struct libusb_control_setup * setup = (struct libusb_control_setup *) transfer->buffer ;
+			transfer->actual_length = fake_perform( 0, NULL, 0, libusb_le16_to_cpu(setup->wValue), libusb_le16_to_cpu(setup->wIndex) ) ;
+		} else {
+			transfer->actual_length = fake_perform( transfer->endpoint, transfer->buffer, transfer->length, 0, 0 ) ;
+		}
+	}
+	transfer->callback( transfer ) ;
+	return 0 ;
+}
+
+/* ---- the benchmark ---- */
+
+static void usb_bench_run( const char * speed, long long byte_us, size_t size, int async )
+{
+	struct connection_in in ;
+	struct parsedname pn ;
+	BYTE data[size] ;
+	BYTE resp[size] ;
+	char name[64] ;
+	UINT loop ;
+	UINT bad = 0 ;
+	UINT transfers ;
+	long long start ;
+
+	memset( &fake, 0, sizeof(fake) ) ;
+	fake.byte_us = byte_us ;
+
+	memset( &in, 0, sizeof(struct connection_in) ) ;
+	in.master.usb.lusb_handle = (libusb_device_handle *) &fake ; // any non-NULL handle
+	in.master.usb.timeout = 5000 ;
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	pn.selected_connection = &in ;
+
+	for ( loop = 0 ; loop < size ; ++loop ) {
+		data[loop] = BYTE_MASK( loop * 7 ) ;
+	}
+
+	start = fake.now ;
+	for ( loop = 0 ; loop < USB_BENCH_LOOPS ; ++loop ) {
+		GOOD_OR_BAD ret ;
+		memset( resp, 0, size ) ;
+		if ( async ) {
+			ret = DS9490_sendback_async( data, resp, size, 0x0074 | 0x0001 | 0x0800, &pn ) ;
+		} else {
+			ret = DS9490_sendback_sync( data, resp, size, &pn ) ;
+		}
+		if ( BAD(ret) || memcmp( data, resp, size ) != 0 ) {
+			++bad ;
+		}
+	}
+	transfers = fake.transfers ;
+
+	snprintf( name, sizeof(name), "%-5s %-9s %4d bytes bad=%u usb=%u", async ? "async" : "sync", speed, (int) size, bad, transfers / USB_BENCH_LOOPS ) ;
+	owlib_bench_report( name, USB_BENCH_LOOPS, ( fake.now - start ) / 1000000. ) ;
+}
+
+void ow_usb_bench(void)
+{
+	static const size_t sizes[] = { 10, 64, 256, } ;
+	UINT size_index ;
+	libusb_context * luc = Globals.luc ;
+
+	Globals.luc = (libusb_context *) &fake ; // any non-NULL context
+
+	for ( size_index = 0 ; size_index < sizeof(sizes)/sizeof(sizes[0]) ; ++size_index ) {
+		usb_bench_run( "regular", 520, sizes[size_index], 0 ) ;
+		usb_bench_run( "regular", 520, sizes[size_index], 1 ) ;
+		usb_bench_run( "overdrive", 80, sizes[size_index], 0 ) ;
+		usb_bench_run( "overdrive", 80, sizes[size_index], 1 ) ;
+	}
+
+	Globals.luc = luc ;
+}
+
+#else /* OW_USB */
+
+void ow_usb_bench(void)
+{
+	printf("USB support not compiled in\n") ;
+}
+
+#endif /* OW_USB */
@@ -0,0 +1,60 @@
+#include "ow_testhelper.h"
+#include "ow_counters.h"
+
+// A released block is handed out again without touching the heap
+START_TEST(test_pool_reuse)
+{
+	void * first ;
+	void * second ;
+	UINT hits ;
+
+	first = owpool_alloc( 100 ) ;
+	ck_assert_ptr_ne(NULL, first);
+	owpool_free( first ) ;
+
+	hits = pool_hits ;
+	second = owpool_alloc( 90 ) ;
+	ck_assert_ptr_eq(first, second);
+	ck_assert_int_eq(hits + 1, pool_hits);
+	owpool_free( second ) ;
+}
+END_TEST
+
+// Dirblobs keep their contents while growing through the size classes and beyond
+START_TEST(test_pool_dirblob_growth)
+{
+	struct dirblob db ;
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	int device ;
+
+	DirblobInit( &db ) ;
+	for ( device = 0 ; device < 1000 ; ++device ) {
+		memset( sn, BYTE_MASK(device), SERIAL_NUMBER_SIZE ) ;
+		sn[0] = BYTE_MASK( device >> 8 ) ;
+		ck_assert_int_eq(0, DirblobAdd( sn, &db ));
+	}
+	for ( device = 0 ; device < 1000 ; ++device ) {
+		BYTE expected[SERIAL_NUMBER_SIZE] ;
+		memset( expected, BYTE_MASK(device), SERIAL_NUMBER_SIZE ) ;
+		expected[0] = BYTE_MASK( device >> 8 ) ;
+		ck_assert_int_eq(0, DirblobGet( device, sn, &db ));
+		ck_assert_int_eq(0, memcmp( expected, sn, SERIAL_NUMBER_SIZE ));
+	}
+	DirblobClear( &db ) ;
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_alloc_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("alloc");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_pool_reuse);
+	tcase_add_test(tc, test_pool_dirblob_growth);
+	return s;
+}
@@ -0,0 +1,448 @@
+#include "ow_testhelper.h"
+#include "ow_connection.h"
+#include "ow_counters.h"
+
+static void sample_sn( BYTE * sn, int device ) {
+	memset( sn, 0, SERIAL_NUMBER_SIZE ) ;
+	sn[0] = 0x10 ;
+	sn[1] = BYTE_MASK( device ) ;
+	sn[2] = BYTE_MASK( device >> 8 ) ;
+	sn[7] = CRC8compute( sn, SERIAL_NUMBER_SIZE-1, 0 ) ;
+}
+
+// Add many device locations and read all of them back
+static void add_and_get_devices( int shards ) {
+	struct parsedname pn ;
+	int device ;
+
+	Globals.cache_shards = shards ;
+	Cache_Configure() ;
+
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	for ( device = 0 ; device < 500 ; ++device ) {
+		sample_sn( pn.sn, device ) ;
+		ck_assert_int_eq(gbGOOD, Cache_Add_Device( device % 7, pn.sn ) );
+	}
+	for ( device = 0 ; device < 500 ; ++device ) {
+		int bus_nr = -1 ;
+		sample_sn( pn.sn, device ) ;
+		ck_assert_int_eq(gbGOOD, Cache_Get_Device( &bus_nr, &pn ) );
+		ck_assert_int_eq(device % 7, bus_nr);
+	}
+
+	Globals.cache_shards = 1 ;
+}
+
+START_TEST(test_cache_single_shard)
+{
+	add_and_get_devices( 1 ) ;
+}
+END_TEST
+
+START_TEST(test_cache_many_shards)
+{
+	add_and_get_devices( 16 ) ;
+}
+END_TEST
+
+// Deleted entries are no longer found, others are untouched
+START_TEST(test_cache_delete)
+{
+	struct parsedname pn ;
+	int bus_nr ;
+
+	Globals.cache_shards = 8 ;
+	Cache_Configure() ;
+
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	sample_sn( pn.sn, 1 ) ;
+	ck_assert_int_eq(gbGOOD, Cache_Add_Device( 3, pn.sn ) );
+	sample_sn( pn.sn, 2 ) ;
+	ck_assert_int_eq(gbGOOD, Cache_Add_Device( 4, pn.sn ) );
+
+	sample_sn( pn.sn, 1 ) ;
+	Cache_Del_Device( &pn ) ;
+	ck_assert_int_eq(gbBAD, Cache_Get_Device( &bus_nr, &pn ) );
+
+	sample_sn( pn.sn, 2 ) ;
+	ck_assert_int_eq(gbGOOD, Cache_Get_Device( &bus_nr, &pn ) );
+	ck_assert_int_eq(4, bus_nr);
+
+	Globals.cache_shards = 1 ;
+}
+END_TEST
+
+// A bounded cache evicts instead of refusing, and keeps frequently read entries
+START_TEST(test_cache_eviction)
+{
+	struct parsedname pn ;
+	BYTE hot_sn[SERIAL_NUMBER_SIZE] ;
+	int device ;
+	int bus_nr ;
+
+	Globals.cache_shards = 1 ;
+	Globals.cache_size = 4000 ;
+	Cache_Configure() ;
+
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	sample_sn( hot_sn, 9999 ) ;
+	ck_assert_int_eq(gbGOOD, Cache_Add_Device( 5, hot_sn ) );
+
+	for ( device = 0 ; device < 200 ; ++device ) {
+		sample_sn( pn.sn, device ) ;
+		ck_assert_int_eq(gbGOOD, Cache_Add_Device( 1, pn.sn ) );
+		memcpy( pn.sn, hot_sn, SERIAL_NUMBER_SIZE ) ;
+		ck_assert_int_eq(gbGOOD, Cache_Get_Device( &bus_nr, &pn ) );
+		ck_assert_int_eq(5, bus_nr);
+	}
+
+	// newest entry is present, oldest cold one is gone
+	sample_sn( pn.sn, 199 ) ;
+	ck_assert_int_eq(gbGOOD, Cache_Get_Device( &bus_nr, &pn ) );
+	sample_sn( pn.sn, 0 ) ;
+	ck_assert_int_eq(gbBAD, Cache_Get_Device( &bus_nr, &pn ) );
+
+	ck_assert_int_le(cache_bytes, Globals.cache_size);
+	ck_assert_int_gt(cache_evictions, 0);
+
+	Globals.cache_size = 0 ;
+}
+END_TEST
+
+// Updating an entry in a full cache only needs room for its growth
+START_TEST(test_cache_update_full)
+{
+	struct parsedname pn ;
+	UINT evictions ;
+	int device ;
+	int bus_nr ;
+
+	Globals.cache_shards = 1 ;
+	Globals.cache_size = 4000 ;
+	Cache_Configure() ;
+
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	for ( device = 0 ; cache_evictions == 0 || device < 200 ; ++device ) {
+		sample_sn( pn.sn, device ) ;
+		ck_assert_int_eq(gbGOOD, Cache_Add_Device( 1, pn.sn ) );
+	}
+
+	// same size, nothing else has to go
+	evictions = cache_evictions ;
+	sample_sn( pn.sn, device - 1 ) ;
+	ck_assert_int_eq(gbGOOD, Cache_Add_Device( 2, pn.sn ) );
+	ck_assert_int_eq(evictions, cache_evictions);
+	ck_assert_int_eq(gbGOOD, Cache_Get_Device( &bus_nr, &pn ) );
+	ck_assert_int_eq(2, bus_nr);
+	ck_assert_int_le(cache_bytes, Globals.cache_size);
+
+	Globals.cache_size = 0 ;
+}
+END_TEST
+
+// Cache clock the tests move by hand
+static time_t test_clock_now ;
+
+static time_t test_clock( time_t * t )
+{
+	if ( t != NULL ) {
+		t[0] = test_clock_now ;
+	}
+	return test_clock_now ;
+}
+
+static void test_clock_start( void )
+{
+	test_clock_now = time( NULL ) ;
+	Cache_Set_Clock( test_clock ) ;
+	Cache_Configure() ;
+}
+
+static void test_clock_stop( void )
+{
+	Cache_Set_Clock( NULL ) ;
+	Cache_Configure() ;
+}
+
+// With the timer wheel, expired entries are freed one by one on later inserts
+START_TEST(test_cache_timer_wheel)
+{
+	struct parsedname pn ;
+	int device ;
+	int bus_nr ;
+	UINT reaped_before = cache_reaped ;
+
+	Globals.cache_timer_wheel = 1 ;
+	Globals.timeout_presence = 1 ;
+	test_clock_start() ;
+
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	for ( device = 0 ; device < 10 ; ++device ) {
+		sample_sn( pn.sn, device ) ;
+		ck_assert_int_eq(gbGOOD, Cache_Add_Device( 2, pn.sn ) );
+	}
+	sample_sn( pn.sn, 3 ) ;
+	ck_assert_int_eq(gbGOOD, Cache_Get_Device( &bus_nr, &pn ) );
+
+	// deletion frees the entry at once
+	Cache_Del_Device( &pn ) ;
+	ck_assert_int_eq(gbBAD, Cache_Get_Device( &bus_nr, &pn ) );
+
+	test_clock_now += 2 ;
+	sample_sn( pn.sn, 100 ) ;
+	ck_assert_int_eq(gbGOOD, Cache_Add_Device( 2, pn.sn ) );
+	ck_assert_int_eq(gbGOOD, Cache_Get_Device( &bus_nr, &pn ) );
+	ck_assert_int_eq(9, cache_reaped - reaped_before);
+
+	Globals.cache_timer_wheel = 0 ;
+	Globals.timeout_presence = 120 ;
+	test_clock_stop() ;
+}
+END_TEST
+
+// Entries that wrapped around the wheel don't hold it up (more than a
+// reaper batch of them in one bucket), and lookups alone reap
+START_TEST(test_cache_timer_wheel_wrapped)
+{
+	struct parsedname pn ;
+	int device ;
+	int bus_nr ;
+	UINT reaped_before = cache_reaped ;
+
+	Globals.cache_timer_wheel = 1 ;
+	test_clock_start() ;
+
+	// expiring one wheel turn (128 s) + 1 s out, in the bucket of the next second
+	Globals.timeout_presence = 129 ;
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	for ( device = 0 ; device < 100 ; ++device ) {
+		sample_sn( pn.sn, device ) ;
+		ck_assert_int_eq(gbGOOD, Cache_Add_Device( 2, pn.sn ) );
+	}
+	// and a few expiring in the seconds after it
+	Globals.timeout_presence = 3 ;
+	for ( device = 100 ; device < 110 ; ++device ) {
+		sample_sn( pn.sn, device ) ;
+		ck_assert_int_eq(gbGOOD, Cache_Add_Device( 2, pn.sn ) );
+	}
+
+	// no more inserts, only lookups from here
+	test_clock_now += 4 ;
+	sample_sn( pn.sn, 0 ) ;
+	for ( device = 0 ; device < 20 ; ++device ) {
+		ck_assert_int_eq(gbGOOD, Cache_Get_Device( &bus_nr, &pn ) );
+	}
+	ck_assert_int_eq(10, cache_reaped - reaped_before);
+
+	Globals.cache_timer_wheel = 0 ;
+	Globals.timeout_presence = 120 ;
+	test_clock_stop() ;
+}
+END_TEST
+
+// A bus that reads back what is written: every slave powered, every
+// conversion already done when polled. Bus-wide converts are counted.
+static struct {
+	BYTE last ;
+	UINT converts ;
+} coalesce_bus ;
+
+static RESET_TYPE coalesce_reset( const struct parsedname * pn )
+{
+	(void) pn ;
+	coalesce_bus.last = 0 ;
+	return BUS_RESET_OK ;
+}
+
+static GOOD_OR_BAD coalesce_sendback_data( const BYTE * data, BYTE * resp, const size_t length, const struct parsedname * pn )
+{
+	size_t i ;
+
+	(void) pn ;
+	for ( i = 0 ; i < length ; ++i ) {
+		if ( coalesce_bus.last == _1W_SKIP_ROM && data[i] == 0x44 ) {
+			// convert T
+			++coalesce_bus.converts ;
+		}
+		coalesce_bus.last = data[i] ;
+		resp[i] = data[i] ;
+	}
+	return gbGOOD ;
+}
+
+static UINT coalesce_count( void )
+{
+	UINT count ;
+
+	STATLOCK ;
+	count = convert_coalesced ;
+	STATUNLOCK ;
+	return count ;
+}
+
+// Temperature reads share a bus conversion only during its delay
+START_TEST(test_cache_coalesce)
+{
+	struct port_in * pin ;
+	struct parsedname pn ;
+	struct timeval before, after, waited ;
+	UINT coalesced ;
+
+	Cache_Configure() ;
+	ck_assert( GOOD( ARG_Fake( "28.0123456789AB" ) ) ) ;
+	pin = Inbound_Control.head_port ;
+	ck_assert( GOOD( Fake_detect( pin ) ) ) ;
+	pin->first->iroutines.reset = coalesce_reset ;
+	pin->first->iroutines.sendback_data = coalesce_sendback_data ;
+	memset( &coalesce_bus, 0, sizeof(coalesce_bus) ) ;
+	ck_assert_int_eq( 0, FS_ParsedName( "/28.0123456789AB/temperature", &pn ) ) ;
+	coalesced = coalesce_count() ;
+
+	// the first read converts the bus, done at the first poll
+	ck_assert( GOOD( FS_Coalesce_Simultaneous( 300, &pn ) ) ) ;
+	ck_assert_int_eq( 1, coalesce_bus.converts ) ;
+	ck_assert_int_eq( coalesced, coalesce_count() ) ;
+
+	// the next one, during the delay, shares it and waits out the rest
+	timernow( &before ) ;
+	ck_assert( GOOD( FS_Coalesce_Simultaneous( 300, &pn ) ) ) ;
+	timernow( &after ) ;
+	timersub( &after, &before, &waited ) ;
+	ck_assert_int_eq( 1, coalesce_bus.converts ) ;
+	ck_assert_int_eq( coalesced + 1, coalesce_count() ) ;
+	ck_assert_int_ge( waited.tv_sec * 1000 + waited.tv_usec / 1000, 200 ) ;
+
+	// the delay is over (timeout_volatile isn't), a conversion of its own
+	ck_assert( GOOD( FS_Coalesce_Simultaneous( 300, &pn ) ) ) ;
+	ck_assert_int_eq( 2, coalesce_bus.converts ) ;
+	ck_assert_int_eq( coalesced + 1, coalesce_count() ) ;
+
+	// an uncached read never shares one
+	pn.state |= ePS_uncached ;
+	ck_assert( BAD( FS_Coalesce_Simultaneous( 300, &pn ) ) ) ;
+	ck_assert_int_eq( 2, coalesce_bus.converts ) ;
+	ck_assert_int_eq( coalesced + 1, coalesce_count() ) ;
+
+	FS_ParsedName_destroy( &pn ) ;
+	RemovePort( pin ) ;
+}
+END_TEST
+
+// A cached value reports when it was stored and expires, without a read
+START_TEST(test_cache_expiry)
+{
+	time_t stored, expires, now ;
+	OWQ_allocate_struct_and_pointer(owq_temperature);
+
+	Cache_Configure() ;
+
+	Globals.one_device = 1 ; // no bus to look for it on
+	ck_assert_int_eq(gbGOOD, OWQ_create("/10.0123456789AB/temperature", owq_temperature));
+	Globals.one_device = 0 ;
+	ck_assert_int_eq(gbBAD, Cache_Get_Expiry( &stored, &expires, PN(owq_temperature) ) );
+
+	now = NOW_TIME ;
+	OWQ_F(owq_temperature) = 21.5 ;
+	ck_assert_int_eq(gbGOOD, OWQ_Cache_Add( owq_temperature ) );
+	ck_assert_int_eq(gbGOOD, Cache_Get_Expiry( &stored, &expires, PN(owq_temperature) ) );
+	ck_assert_int_le(now, stored);
+	ck_assert_int_le(stored, NOW_TIME);
+	ck_assert_int_eq(Globals.timeout_volatile, expires - stored);
+
+	OWQ_Cache_Del( owq_temperature ) ;
+	ck_assert_int_eq(gbBAD, Cache_Get_Expiry( &stored, &expires, PN(owq_temperature) ) );
+	OWQ_destroy( owq_temperature ) ;
+}
+END_TEST
+
+// Every device of a dirblob is found at its place, others aren't,
+// searched in order (short), by index, packed for the cache and unpacked
+static void dirblob_search_all( struct dirblob * db, int devices )
+{
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	int device ;
+
+	for ( device = 0 ; device < devices ; ++device ) {
+		sample_sn( sn, device ) ;
+		ck_assert_int_eq(device, DirblobSearch( sn, db ));
+	}
+	sample_sn( sn, devices ) ;
+	ck_assert_int_eq(INDEX_BAD, DirblobSearch( sn, db ));
+}
+
+START_TEST(test_cache_dirblob_index)
+{
+	static const int sizes[] = { 1, 7, 8, 9, 31, 500, } ;
+	size_t size_index ;
+
+	for ( size_index = 0 ; size_index < sizeof(sizes)/sizeof(sizes[0]) ; ++size_index ) {
+		int devices = sizes[size_index] ;
+		struct dirblob db ;
+		struct dirblob cached ;
+		BYTE sn[SERIAL_NUMBER_SIZE] ;
+		BYTE * packed ;
+		size_t packed_size ;
+		int device ;
+
+		DirblobInit( &db ) ;
+		for ( device = 0 ; device < devices ; ++device ) {
+			sample_sn( sn, device ) ;
+			ck_assert_int_eq(0, DirblobAdd( sn, &db ));
+			// searched while growing, the index has to keep up
+			dirblob_search_all( &db, device + 1 ) ;
+		}
+		// a repeat keeps the first place
+		sample_sn( sn, 0 ) ;
+		ck_assert_int_eq(0, DirblobAdd( sn, &db ));
+		ck_assert_int_eq(0, DirblobSearch( sn, &db ));
+
+		packed_size = DirblobPackedSize( &db ) ;
+		packed = owmalloc( packed_size ) ;
+		ck_assert_ptr_ne(NULL, packed);
+		DirblobPack( packed, &db ) ;
+		for ( device = 0 ; device < devices ; ++device ) {
+			sample_sn( sn, device ) ;
+			ck_assert_int_eq(device, DirblobSearchPacked( sn, packed, packed_size ));
+		}
+		sample_sn( sn, devices ) ;
+		ck_assert_int_eq(INDEX_BAD, DirblobSearchPacked( sn, packed, packed_size ));
+		ck_assert_int_eq(INDEX_BAD, DirblobSearchPacked( packed + 8, packed, packed_size - 1 ));
+
+		ck_assert_int_eq(0, DirblobUnpack( packed, packed_size, &cached ));
+		ck_assert_int_eq(devices + 1, DirblobElements( &cached ));
+		if ( devices > 100 ) {
+			// long lists bring their index along
+			ck_assert_ptr_ne(NULL, cached.index);
+		}
+		dirblob_search_all( &cached, devices ) ;
+		DirblobClear( &cached ) ;
+		ck_assert_int_ne(0, DirblobUnpack( packed, packed_size - 1, &cached ));
+
+		owfree( packed ) ;
+		DirblobClear( &db ) ;
+	}
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_cache_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("cache");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_cache_single_shard);
+	tcase_add_test(tc, test_cache_many_shards);
+	tcase_add_test(tc, test_cache_delete);
+	tcase_add_test(tc, test_cache_eviction);
+	tcase_add_test(tc, test_cache_update_full);
+	tcase_add_test(tc, test_cache_timer_wheel);
+	tcase_add_test(tc, test_cache_timer_wheel_wrapped);
+	tcase_add_test(tc, test_cache_coalesce);
+	tcase_add_test(tc, test_cache_expiry);
+	tcase_add_test(tc, test_cache_dirblob_index);
+	return s;
+}
@@ -0,0 +1,194 @@
+#include "ow_testhelper.h"
+#include "ow_connection.h"
+#include "ow_counters.h"
+
+// Real devices are taken as present (no bus masters in the test)
+static void dir_setup(void) {
+	owlib_test_setup() ;
+	Globals.one_device = 1 ;
+}
+
+static void dir_teardown(void) {
+	Globals.one_device = 0 ;
+	owlib_test_teardown() ;
+}
+
+#define DIR_LISTING_SIZE 65536
+
+struct dir_listing {
+	char text[DIR_LISTING_SIZE] ;
+	size_t length ;
+} ;
+
+// Everything a directory entry carries that callers look at
+static void dir_listing_add( void * v, const struct parsedname * pn_entry )
+{
+	struct dir_listing * dl = v ;
+	int length = snprintf( &dl->text[dl->length], DIR_LISTING_SIZE - dl->length,
+		"%s|%s|%d|%d|%s|%s|%d\n",
+		pn_entry->path,
+		pn_entry->path_to_server,
+		pn_entry->dirlength,
+		pn_entry->extension,
+		pn_entry->selected_filetype == NO_FILETYPE ? "-" : pn_entry->selected_filetype->name,
+		pn_entry->subdir == NO_SUBDIR ? "-" : pn_entry->subdir->name,
+		(int) pn_entry->ds2409_depth ) ;
+	ck_assert_int_lt( length, DIR_LISTING_SIZE - dl->length ) ;
+	dl->length += length ;
+}
+
+// DS2438 visibility would read the chip, say it isn't a DATANAB
+static void dir_not_datanab( void )
+{
+	struct parsedname s_pn ;
+
+	ck_assert_int_eq(0, FS_ParsedName("/26.0123456789AB", &s_pn));
+	SetVisibilityCache( 0, &s_pn ) ;
+	FS_ParsedName_destroy(&s_pn) ;
+}
+
+static void dir_list( const char * path, struct dir_listing * dl )
+{
+	struct parsedname s_pn ;
+	struct parsedname * pn = &s_pn ;
+
+	dl->length = 0 ;
+	dl->text[0] = '\0' ;
+	ck_assert_int_eq(0, FS_ParsedName(path, pn));
+	ck_assert_int_eq(0, FS_dir(dir_listing_add, dl, pn));
+	FS_ParsedName_destroy(pn) ;
+}
+
+// The listing made at startup gives the same entries as parsing each one
+START_TEST(test_dir_listing_matches_parse)
+{
+	static const char * paths[] = {
+		"/29.0123456789AB",			// bitfield, .BYTE
+		"/26.0123456789AB",			// visibility depends on the chip
+		"/23.0123456789AB",
+		"/23.0123456789AB/pages",	// subdirectory
+		"/uncached/10.0123456789AB",
+		"/1F.0123456789AB",			// DS2409 branches
+		"/02.0123456789AB",			// sparse
+		"/02.0123456789AB/subkey0",
+		"/statistics/read",
+	} ;
+	static struct dir_listing listed ;
+	static struct dir_listing parsed ;
+	size_t i ;
+
+	dir_not_datanab() ;
+	for ( i = 0 ; i < sizeof(paths)/sizeof(paths[0]) ; ++i ) {
+		struct parsedname s_pn ;
+		struct device_directory * dd ;
+
+		ck_assert_int_eq(0, FS_ParsedName(paths[i], &s_pn));
+		dd = s_pn.selected_device->directory ;
+		ck_assert_ptr_ne(NULL, dd);
+
+		dir_list( paths[i], &listed ) ;
+		ck_assert_int_gt( listed.length, 0 ) ;
+
+		s_pn.selected_device->directory = NULL ;
+		dir_list( paths[i], &parsed ) ;
+		s_pn.selected_device->directory = dd ;
+		FS_ParsedName_destroy(&s_pn) ;
+
+		ck_assert_str_eq( parsed.text, listed.text ) ;
+	}
+}
+END_TEST
+
+// A new visibility value drops the device's listing bitmap
+START_TEST(test_dir_visibility_cache)
+{
+	static struct dir_listing listed ;
+	struct parsedname s_pn ;
+	struct parsedname * pn = &s_pn ;
+	struct device_directory * dd ;
+	BYTE bitmaps[512] ;
+	size_t size ;
+
+	dir_not_datanab() ;
+	ck_assert_int_eq(0, FS_ParsedName("/26.0123456789AB", pn));
+	dd = pn->selected_device->directory ;
+	ck_assert_ptr_ne(NULL, dd);
+	ck_assert(dd->conditional);
+	size = 2 * ( ( dd->entries + 7 ) / 8 ) ;
+	ck_assert_int_le( size, sizeof(bitmaps) ) ;
+
+	dir_list( "/26.0123456789AB", &listed ) ;
+	ck_assert( GOOD( GetDirectoryVisibilityCache( bitmaps, size, pn ) ) ) ;
+
+	SetVisibilityCache( 1, pn ) ;
+	ck_assert( BAD( GetDirectoryVisibilityCache( bitmaps, size, pn ) ) ) ;
+
+	FS_ParsedName_destroy(pn) ;
+}
+END_TEST
+
+static int dir_listing_count( const struct dir_listing * dl, const char * name )
+{
+	const char * found = dl->text ;
+	int count = 0 ;
+
+	while ( ( found = strstr( found, name ) ) != NULL ) {
+		++count ;
+		found += strlen( name ) ;
+	}
+	return count ;
+}
+
+// A device on two buses is listed once, the others of each bus still are
+// (entries are "path|path_to_server|...")
+START_TEST(test_dir_all_connections_unique)
+{
+	static const char * buses[] = {
+		"10.67C6697351FF,28.0123456789AB",
+		"10.67C6697351FF,29.0123456789AB",
+	} ;
+	static struct dir_listing listed ;
+	struct port_in * pins[2] ;
+	UINT duplicates ;
+	size_t i ;
+
+	for ( i = 0 ; i < 2 ; ++i ) {
+		ck_assert( GOOD( ARG_Fake( buses[i] ) ) ) ;
+		pins[i] = Inbound_Control.head_port ;
+		ck_assert( GOOD( Fake_detect( pins[i] ) ) ) ;
+	}
+
+	STATLOCK ;
+	duplicates = dir_duplicates ;
+	STATUNLOCK ;
+	dir_list( "/uncached", &listed ) ;
+	STATLOCK ;
+	duplicates = dir_duplicates - duplicates ;
+	STATUNLOCK ;
+
+	ck_assert_int_eq( 1, dir_listing_count( &listed, "10.67C6697351FF|/" ) ) ;
+	ck_assert_int_eq( 1, dir_listing_count( &listed, "28.0123456789AB|/" ) ) ;
+	ck_assert_int_eq( 1, dir_listing_count( &listed, "29.0123456789AB|/" ) ) ;
+	ck_assert_int_eq( 1, duplicates ) ;
+
+	for ( i = 0 ; i < 2 ; ++i ) {
+		RemovePort( pins[i] ) ;
+	}
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_dir_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("dir");
+
+	tcase_add_checked_fixture(tc, dir_setup, dir_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_dir_listing_matches_parse);
+	tcase_add_test(tc, test_dir_visibility_cache);
+	tcase_add_test(tc, test_dir_all_connections_unique);
+	return s;
+}
@@ -0,0 +1,342 @@
+#include "ow_testhelper.h"
+#include "ow_connection.h"
+
+#if OW_I2C
+#include "i2c-dev.h"
+#include <stdarg.h>
+#include <sys/syscall.h>
+
+// DS2482 on a stubbed i2c-dev
+//
+// The ioctl calls the library makes on the i2c device are answered here
+// (the program's definition comes first). The "device" is a temporary
+// file, its descriptor is recognized by inode, everything else goes to the
+// real system call. A DS2482-100 is modeled at register level, the 1-wire
+// bus just echoes written bytes. Calls are counted per 1-wire transaction.
+
+#define FAKE_ADDRESS	0x18
+
+// register pointer codes and status bits (see ow_ds2482.c)
+#define FAKE_STATUS	0xF0
+#define FAKE_DATA	0xE1
+#define FAKE_CONFIG	0xC3
+#define FAKE_1WB	0x01
+#define FAKE_PPD	0x02
+#define FAKE_LL		0x08
+#define FAKE_RST	0x10
+
+static struct {
+	int fd ;
+	struct stat st ;
+	unsigned long funcs ;		// I2C_FUNCS answer
+	int slave ;
+	BYTE pointer ;
+	BYTE status ;
+	BYTE data ;
+	BYTE config ;
+	int busy_reads ;			// status reads busy after each 1-wire command
+	int busy_left ;
+	UINT calls ;				// ioctl on the device
+} fake ;
+
+// DS2482-100 command, 0 or -1 for NACK
+static int fake_command( BYTE command, BYTE param )
+{
+	switch ( command ) {
+		case 0xF0: // device reset
+			fake.status = FAKE_LL | FAKE_RST ;
+			fake.config = 0x00 ;
+			fake.pointer = FAKE_STATUS ;
+			return 0 ;
+		case 0xE1: // set read pointer, -100 has 3 registers
+			if ( param != FAKE_STATUS && param != FAKE_DATA && param != FAKE_CONFIG ) {
+				return -1 ;
+			}
+			fake.pointer = param ;
+			return 0 ;
+		case 0xD2: // write configuration
+			if ( ( ( param >> 4 ) ^ 0x0F ) != ( param & 0x0F ) ) {
+				return -1 ;
+			}
+			fake.config = param & 0x0F ;
+			fake.pointer = FAKE_CONFIG ;
+			return 0 ;
+		case 0xB4: // 1-wire reset, presence
+			fake.status = FAKE_LL | FAKE_PPD ;
+			fake.pointer = FAKE_STATUS ;
+			fake.busy_left = fake.busy_reads ;
+			return 0 ;
+		case 0xA5: // 1-wire write byte, nothing pulls the bus low
+			fake.data = param ;
+			fake.status = FAKE_LL ;
+			fake.pointer = FAKE_STATUS ;
+			fake.busy_left = fake.busy_reads ;
+			return 0 ;
+		default: // channel select and others are -800 or DS2483 only
+			return -1 ;
+	}
+}
+
+static BYTE fake_read( void )
+{
+	switch ( fake.pointer ) {
+		case FAKE_STATUS:
+			if ( fake.busy_left > 0 ) {
+				--fake.busy_left ;
+				return fake.status | FAKE_1WB ;
+			}
+			return fake.status ;
+		case FAKE_DATA:
+			return fake.data ;
+		default:
+			return fake.config ;
+	}
+}
+
+static int fake_smbus( struct i2c_smbus_ioctl_data * args )
+{
+	if ( fake.slave != FAKE_ADDRESS ) {
+		return -1 ;
+	}
+	if ( args->read_write == I2C_SMBUS_READ ) {
+		args->data->byte = fake_read() ;
+		return 0 ;
+	}
+	switch ( args->size ) {
+		case I2C_SMBUS_BYTE:
+			return fake_command( args->command, 0 ) ;
+		case I2C_SMBUS_BYTE_DATA:
+			return fake_command( args->command, args->data->byte ) ;
+		default:
+			return -1 ;
+	}
+}
+
+static int fake_rdwr( struct i2c_rdwr_ioctl_data * rdwr )
+{
+	int msg ;
+
+	if ( ( fake.funcs & I2C_FUNC_I2C ) == 0 ) {
+		return -1 ;
+	}
+	for ( msg = 0 ; msg < rdwr->nmsgs ; ++msg ) {
+		struct i2c_msg * m = &rdwr->msgs[msg] ;
+		if ( m->addr != FAKE_ADDRESS ) {
+			return -1 ;
+		}
+		if ( m->flags & I2C_M_RD ) {
+			int i ;
+			for ( i = 0 ; i < m->len ; ++i ) {
+				m->buf[i] = fake_read() ;
+			}
+		} else if ( m->len == 0 || fake_command( m->buf[0], m->len > 1 ? m->buf[1] : 0 ) < 0 ) {
+			return -1 ;
+		}
+	}
+	return rdwr->nmsgs ;
+}
+
+static int fake_device( int fd )
+{
+	struct stat st ;
+
+	if ( fd == fake.fd ) {
+		return 1 ;
+	}
+	if ( fstat( fd, &st ) == 0 && st.st_dev == fake.st.st_dev && st.st_ino == fake.st.st_ino ) {
+		fake.fd = fd ;
+		return 1 ;
+	}
+	return 0 ;
+}
+
+int ioctl( int fd, unsigned long int request, ... )
+{
+	va_list ap ;
+	void * arg ;
+
+	va_start( ap, request ) ;
+	arg = va_arg( ap, void * ) ;
+	va_end( ap ) ;
+
+	if ( ! fake_device( fd ) ) {
+		return syscall( SYS_ioctl, fd, request, arg ) ;
+	}
+
+	++fake.calls ;
+	switch ( request ) {
+		case I2C_SLAVE:
+			fake.slave = (int) (long) arg ;
+			return 0 ;
+		case I2C_FUNCS:
+			((unsigned long *) arg)[0] = fake.funcs ;
+			return 0 ;
+		case I2C_SMBUS:
+			return fake_smbus( arg ) ;
+		case I2C_RDWR:
+			return fake_rdwr( arg ) ;
+		default:
+			return -1 ;
+	}
+}
+
+/* ---- tests ---- */
+
+#define TEST_BYTES	16
+
+static char fake_path[] = "/tmp/owfs_i2c_XXXXXX" ;
+
+static struct port_in * fake_open( unsigned long funcs, int busy_reads )
+{
+	struct port_in * pin ;
+	int fd ;
+
+	memset( &fake, 0, sizeof(fake) ) ;
+	fake.fd = -1 ;
+	fake.funcs = funcs ;
+	fake.busy_reads = busy_reads ;
+
+	strcpy( fake_path, "/tmp/owfs_i2c_XXXXXX" ) ;
+	fd = mkstemp( fake_path ) ;
+	ck_assert_int_ge( fd, 0 ) ;
+	ck_assert_int_eq( 0, fstat( fd, &fake.st ) ) ;
+	close( fd ) ;
+
+	pin = NewPort( NULL ) ;
+	ck_assert_ptr_ne( NULL, pin ) ;
+	pin->busmode = bus_i2c ;
+	pin->init_data = owstrdup( fake_path ) ;
+	ck_assert_int_eq( gbGOOD, DS2482_detect( pin ) ) ;
+	ck_assert_int_eq( adapter_DS2482_100, pin->first->Adapter ) ;
+	ck_assert_int_eq( ds2482_100, pin->first->master.i2c.type ) ;
+	return pin ;
+}
+
+static void fake_close( struct port_in * pin )
+{
+	Test_and_Close( &pin->file_descriptor ) ;
+	RemovePort( pin ) ;
+	unlink( fake_path ) ;
+}
+
+// First transaction also writes the configuration register (APU)
+static void prime( struct port_in * pin )
+{
+	struct parsedname pn ;
+	BYTE data[1] = { 0xFF, } ;
+	BYTE resp[1] ;
+
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	pn.selected_connection = pin->first ;
+	ck_assert_int_eq( gbGOOD, BUS_sendback_data( data, resp, 1, &pn ) ) ;
+}
+
+// Echo TEST_BYTES through the adapter, return ioctl calls per byte
+static UINT sendback_calls( struct port_in * pin )
+{
+	struct parsedname pn ;
+	BYTE data[TEST_BYTES] ;
+	BYTE resp[TEST_BYTES] ;
+	UINT calls ;
+	int i ;
+
+	prime( pin ) ;
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	pn.selected_connection = pin->first ;
+	for ( i = 0 ; i < TEST_BYTES ; ++i ) {
+		data[i] = BYTE_MASK( i * 37 + 1 ) ;
+	}
+	memset( resp, 0, TEST_BYTES ) ;
+
+	calls = fake.calls ;
+	ck_assert_int_eq( gbGOOD, BUS_sendback_data( data, resp, TEST_BYTES, &pn ) ) ;
+	calls = fake.calls - calls ;
+	ck_assert_int_eq( 0, memcmp( data, resp, TEST_BYTES ) ) ;
+	ck_assert_int_eq( 0, calls % TEST_BYTES ) ;
+	return calls / TEST_BYTES ;
+}
+
+START_TEST(test_ds2482_smbus)
+{
+	struct port_in * pin = fake_open( I2C_FUNC_SMBUS_BYTE | I2C_FUNC_SMBUS_BYTE_DATA, 0 ) ;
+
+	ck_assert_int_eq( 0, pin->first->master.i2c.rdwr ) ;
+	// write byte, status, data pointer, data
+	ck_assert_int_eq( 4, sendback_calls( pin ) ) ;
+	fake_close( pin ) ;
+}
+END_TEST
+
+START_TEST(test_ds2482_rdwr)
+{
+	struct port_in * pin = fake_open( I2C_FUNC_I2C | I2C_FUNC_SMBUS_BYTE | I2C_FUNC_SMBUS_BYTE_DATA, 0 ) ;
+
+	ck_assert_int_eq( 1, pin->first->master.i2c.rdwr ) ;
+	// write byte, then status and data combined
+	ck_assert_int_eq( 2, sendback_calls( pin ) ) ;
+	fake_close( pin ) ;
+}
+END_TEST
+
+START_TEST(test_ds2482_rdwr_busy)
+{
+	struct port_in * pin = fake_open( I2C_FUNC_I2C | I2C_FUNC_SMBUS_BYTE | I2C_FUNC_SMBUS_BYTE_DATA, 2 ) ;
+
+	// busy status discards the data, read again
+	ck_assert_int_eq( 4, sendback_calls( pin ) ) ;
+
+	// still busy after all tries
+	fake.busy_reads = 10 ;
+	{
+		struct parsedname pn ;
+		BYTE data[1] = { 0x55, } ;
+		BYTE resp[1] ;
+		memset( &pn, 0, sizeof(struct parsedname) ) ;
+		pn.selected_connection = pin->first ;
+		ck_assert_int_eq( gbBAD, BUS_sendback_data( data, resp, 1, &pn ) ) ;
+	}
+	fake_close( pin ) ;
+}
+END_TEST
+
+START_TEST(test_ds2482_configuration)
+{
+	struct port_in * pin = fake_open( I2C_FUNC_I2C | I2C_FUNC_SMBUS_BYTE | I2C_FUNC_SMBUS_BYTE_DATA, 0 ) ;
+	struct parsedname pn ;
+	BYTE resp[1] ;
+	UINT calls ;
+
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	pn.selected_connection = pin->first ;
+	prime( pin ) ;
+
+	// strong pull-up set and read back in one call, then the byte
+	calls = fake.calls ;
+	ck_assert_int_eq( gbGOOD, BUS_PowerByte( 0xCC, resp, 0, &pn ) ) ;
+	ck_assert_int_eq( 3, fake.calls - calls ) ;
+	ck_assert_int_eq( 0xCC, resp[0] ) ;
+	ck_assert_int_eq( pin->first->master.i2c.configreg | 0x04, fake.config ) ;
+	fake_close( pin ) ;
+}
+END_TEST
+
+#endif /* OW_I2C */
+
+// Create test-suite
+Suite* ow_ds2482_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("ds2482");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+#if OW_I2C
+	tcase_add_test(tc, test_ds2482_smbus);
+	tcase_add_test(tc, test_ds2482_rdwr);
+	tcase_add_test(tc, test_ds2482_rdwr_busy);
+	tcase_add_test(tc, test_ds2482_configuration);
+#endif /* OW_I2C */
+	return s;
+}
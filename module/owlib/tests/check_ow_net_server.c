@@ -0,0 +1,240 @@
+#include "ow_testhelper.h"
+#include "ow_connection.h"
+#include "ow_counters.h"
+
+// Event loop (--server_workers) with one worker thread
+//
+// The request routine answers a one byte request with the same byte and
+// keeps the connection, 'w' waits until the test lets it go on.
+
+static struct {
+	pthread_mutex_t mutex ;
+	pthread_cond_t cond ;
+	int held ;					// a request is waiting in the worker
+	int go ;					// let it go on
+	int released ;				// connections closed
+} net ;
+
+static GOOD_OR_BAD net_request( FILE_DESCRIPTOR_OR_ERROR file_descriptor, void ** state )
+{
+	char c ;
+
+	(void) state ;
+	if ( read( file_descriptor, &c, 1 ) != 1 ) {
+		return gbBAD ;
+	}
+	if ( c == 'w' ) {
+		_MUTEX_LOCK( net.mutex ) ;
+		net.held = 1 ;
+		while ( ! net.go ) {
+			my_pthread_cond_wait( &net.cond, &net.mutex ) ;
+		}
+		_MUTEX_UNLOCK( net.mutex ) ;
+	}
+	state[0] = &net ;
+	return write( file_descriptor, &c, 1 ) == 1 ? gbGOOD : gbBAD ;
+}
+
+static void net_release( void * state )
+{
+	ck_assert( state == &net ) ;
+	_MUTEX_LOCK( net.mutex ) ;
+	++net.released ;
+	_MUTEX_UNLOCK( net.mutex ) ;
+}
+
+static void net_handler( FILE_DESCRIPTOR_OR_ERROR file_descriptor )
+{
+	(void) file_descriptor ;
+	ck_abort_msg( "whole connection handler called" ) ;
+}
+
+static void * net_serve( void * v )
+{
+	(void) v ;
+	ServerProcess( net_handler ) ;
+	return VOID_RETURN ;
+}
+
+static int net_port ;
+static pthread_t net_thread ;
+
+// listening socket of our own, as with systemd
+static void net_start( void )
+{
+	struct connection_out * out ;
+	struct sockaddr_in sin ;
+	socklen_t sin_len = sizeof(sin) ;
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor = socket( AF_INET, SOCK_STREAM, 0 ) ;
+
+	ck_assert( FILE_DESCRIPTOR_VALID( file_descriptor ) ) ;
+	memset( &sin, 0, sizeof(sin) ) ;
+	sin.sin_family = AF_INET ;
+	sin.sin_addr.s_addr = htonl( INADDR_LOOPBACK ) ;
+	ck_assert_int_eq( 0, bind( file_descriptor, (struct sockaddr *) &sin, sizeof(sin) ) ) ;
+	ck_assert_int_eq( 0, listen( file_descriptor, SOMAXCONN ) ) ;
+	ck_assert_int_eq( 0, getsockname( file_descriptor, (struct sockaddr *) &sin, &sin_len ) ) ;
+	net_port = ntohs( sin.sin_port ) ;
+
+	out = NewOut() ;
+	ck_assert( out != NULL ) ;
+	out->file_descriptor = file_descriptor ;
+	out->inet_type = inet_systemd ;
+
+	memset( &net, 0, sizeof(net) ) ;
+	_MUTEX_INIT( net.mutex ) ;
+	my_pthread_cond_init( &net.cond, NULL ) ;
+
+	Globals.announce_off = 1 ;
+	Globals.server_workers = 1 ;
+	ServerRequestRoutines( net_request, net_release ) ;
+	ck_assert_int_eq( 0, pthread_create( &net_thread, NULL, net_serve, NULL ) ) ;
+}
+
+static void net_stop( void )
+{
+	InterruptListening() ;
+	pthread_join( net_thread, NULL ) ;
+	ServerRequestRoutines( NULL, NULL ) ;
+	Globals.server_workers = 0 ;
+	Globals.announce_off = 0 ;
+	FreeOutAll() ;
+	my_pthread_cond_destroy( &net.cond ) ;
+	_MUTEX_DESTROY( net.mutex ) ;
+}
+
+static FILE_DESCRIPTOR_OR_ERROR net_connect( void )
+{
+	struct sockaddr_in sin ;
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor = socket( AF_INET, SOCK_STREAM, 0 ) ;
+
+	ck_assert( FILE_DESCRIPTOR_VALID( file_descriptor ) ) ;
+	memset( &sin, 0, sizeof(sin) ) ;
+	sin.sin_family = AF_INET ;
+	sin.sin_addr.s_addr = htonl( INADDR_LOOPBACK ) ;
+	sin.sin_port = htons( net_port ) ;
+	ck_assert_int_eq( 0, connect( file_descriptor, (struct sockaddr *) &sin, sizeof(sin) ) ) ;
+	return file_descriptor ;
+}
+
+static void net_send( FILE_DESCRIPTOR_OR_ERROR file_descriptor, char c )
+{
+	ck_assert_int_eq( 1, write( file_descriptor, &c, 1 ) ) ;
+}
+
+// the answer, within 5 seconds
+static void net_answer( FILE_DESCRIPTOR_OR_ERROR file_descriptor, char c )
+{
+	struct timeval tv = { 5, 0, } ;
+	fd_set readset ;
+	char answer ;
+
+	FD_ZERO( &readset ) ;
+	FD_SET( file_descriptor, &readset ) ;
+	ck_assert_int_eq( 1, select( file_descriptor + 1, &readset, NULL, NULL, &tv ) ) ;
+	ck_assert_int_eq( 1, read( file_descriptor, &answer, 1 ) ) ;
+	ck_assert_int_eq( c, answer ) ;
+}
+
+// An open connection between requests doesn't hold the only worker
+START_TEST(test_server_kept_connection)
+{
+	FILE_DESCRIPTOR_OR_ERROR first ;
+	FILE_DESCRIPTOR_OR_ERROR second ;
+
+	net_start() ;
+
+	first = net_connect() ;
+	net_send( first, 'a' ) ;
+	net_answer( first, 'a' ) ;
+
+	second = net_connect() ;
+	net_send( second, 'b' ) ;
+	net_answer( second, 'b' ) ;
+
+	// both still served, one request after the other
+	net_send( first, 'c' ) ;
+	net_answer( first, 'c' ) ;
+	net_send( second, 'd' ) ;
+	net_answer( second, 'd' ) ;
+
+	close( first ) ;
+	close( second ) ;
+	net_stop() ;
+	ck_assert_int_eq( 2, net.released ) ;
+}
+END_TEST
+
+#define NET_CLIENTS	8
+
+// With the worker busy and the queue full, the loop defers, it doesn't wait
+START_TEST(test_server_queue_full)
+{
+	FILE_DESCRIPTOR_OR_ERROR busy ;
+	FILE_DESCRIPTOR_OR_ERROR client[NET_CLIENTS] ;
+	UINT deferred_before ;
+	UINT deferred ;
+	int held = 0 ;
+	int wait ;
+	int i ;
+
+	STATLOCK ;
+	deferred_before = server_deferred ;
+	STATUNLOCK ;
+
+	net_start() ;
+
+	busy = net_connect() ;
+	net_send( busy, 'w' ) ;
+	for ( wait = 0 ; wait < 500 && ! held ; ++wait ) {
+		usleep( 10000 ) ;
+		_MUTEX_LOCK( net.mutex ) ;
+		held = net.held ;
+		_MUTEX_UNLOCK( net.mutex ) ;
+	}
+	ck_assert( held ) ;
+
+	// more than the queue holds (4 per worker)
+	for ( i = 0 ; i < NET_CLIENTS ; ++i ) {
+		client[i] = net_connect() ;
+		net_send( client[i], 'A' + i ) ;
+	}
+	deferred = 0 ;
+	for ( wait = 0 ; wait < 500 && deferred == 0 ; ++wait ) {
+		usleep( 10000 ) ;
+		STATLOCK ;
+		deferred = server_deferred - deferred_before ;
+		STATUNLOCK ;
+	}
+	ck_assert_int_gt( deferred, 0 ) ;
+
+	_MUTEX_LOCK( net.mutex ) ;
+	net.go = 1 ;
+	my_pthread_cond_signal( &net.cond ) ;
+	_MUTEX_UNLOCK( net.mutex ) ;
+
+	net_answer( busy, 'w' ) ;
+	for ( i = 0 ; i < NET_CLIENTS ; ++i ) {
+		net_answer( client[i], 'A' + i ) ;
+		close( client[i] ) ;
+	}
+	close( busy ) ;
+	net_stop() ;
+	ck_assert_int_eq( NET_CLIENTS + 1, net.released ) ;
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_net_server_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("net_server");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_server_kept_connection);
+	tcase_add_test(tc, test_server_queue_full);
+	return s;
+}
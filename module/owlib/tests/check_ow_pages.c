@@ -0,0 +1,174 @@
+#include "ow_testhelper.h"
+#include "ow_connection.h"
+#include "ow_counters.h"
+
+// Memory pages read as one array (pages/page.ALL)
+//
+// A fake bus with a DS2433, read as a passive adapter would be: the bus
+// reads back what is written (0xFF for the memory). Resets are counted, one
+// per bus transaction, and the data of one transaction can be made to fail.
+
+#define PAGES_DEVICE	"23.0123456789AB"
+#define PAGES_COUNT		16
+#define PAGES_SIZE		32
+
+static struct {
+	UINT resets ;
+	UINT fail_reset ;			// fail the transaction after this reset (0 none)
+	size_t fail_longer ;		// fail any read longer than this (0 none)
+} pages_bus ;
+
+static RESET_TYPE pages_reset( const struct parsedname * pn )
+{
+	(void) pn ;
+	++pages_bus.resets ;
+	return BUS_RESET_OK ;
+}
+
+static GOOD_OR_BAD pages_sendback_data( const BYTE * data, BYTE * resp, const size_t length, const struct parsedname * pn )
+{
+	(void) pn ;
+	if ( pages_bus.resets == pages_bus.fail_reset ) {
+		return gbBAD ;
+	}
+	if ( pages_bus.fail_longer > 0 && length > pages_bus.fail_longer ) {
+		return gbBAD ;
+	}
+	memcpy( resp, data, length ) ;
+	return gbGOOD ;
+}
+
+// the bus transactions page.ALL took, or -1 if it failed
+static int pages_read_all( struct port_in * pin )
+{
+	char buffer[PAGES_COUNT * PAGES_SIZE] ;
+	SIZE_OR_ERROR read_or_error ;
+	size_t page ;
+	UINT resets ;
+	OWQ_allocate_struct_and_pointer( owq_all ) ;
+
+	ck_assert_int_eq( gbGOOD, OWQ_create( "/uncached/" PAGES_DEVICE "/pages/page.ALL", owq_all ) ) ;
+	OWQ_assign_read_buffer( buffer, sizeof(buffer), 0, owq_all ) ;
+	PN(owq_all)->selected_connection = pin->first ;
+	memset( buffer, 0, sizeof(buffer) ) ;
+
+	resets = pages_bus.resets ;
+	read_or_error = FS_read_local( owq_all ) ;
+	resets = pages_bus.resets - resets ;
+	if ( read_or_error < 0 ) {
+		OWQ_destroy( owq_all ) ;
+		return -1 ;
+	}
+	ck_assert_int_eq( 0, read_or_error ) ;
+	for ( page = 0 ; page < PAGES_COUNT ; ++page ) {
+		ck_assert_int_eq( PAGES_SIZE, OWQ_array_length( owq_all, page ) ) ;
+	}
+	for ( page = 0 ; page < sizeof(buffer) ; ++page ) {
+		ck_assert_int_eq( 0xFF, BYTE_MASK(buffer[page]) ) ;
+	}
+	OWQ_destroy( owq_all ) ;
+	return resets ;
+}
+
+static struct port_in * pages_open( void )
+{
+	struct port_in * pin ;
+
+	ck_assert( GOOD( ARG_Fake( PAGES_DEVICE ) ) ) ;
+	pin = Inbound_Control.head_port ;
+	ck_assert( GOOD( Fake_detect( pin ) ) ) ;
+	// read from the bus, not made up
+	pin->first->Adapter = adapter_DS9097 ;
+	pin->first->iroutines.reset = pages_reset ;
+	pin->first->iroutines.sendback_data = pages_sendback_data ;
+	memset( &pages_bus, 0, sizeof(pages_bus) ) ;
+	// the first read also clears the (DS2409) branches, a reset more
+	ck_assert_int_ge( pages_read_all( pin ), 1 ) ;
+	return pin ;
+}
+
+static void pages_close( struct port_in * pin )
+{
+	pin->first->Adapter = adapter_fake ;
+	RemovePort( pin ) ;
+}
+
+static UINT pages_stat( UINT * stat )
+{
+	UINT count ;
+
+	STATLOCK ;
+	count = *stat ;
+	STATUNLOCK ;
+	return count ;
+}
+
+// All pages in one transaction, one per page without the bulk reader
+START_TEST(test_pages_bulk)
+{
+	struct port_in * pin = pages_open() ;
+	struct aggregate * ag ;
+	ZERO_OR_ERROR (*bulk_read) (struct one_wire_query *) ;
+	struct parsedname s_pn ;
+	UINT bulk ;
+
+	ck_assert_int_eq( 0, FS_ParsedName( "/" PAGES_DEVICE "/pages/page.ALL", &s_pn ) ) ;
+	ag = s_pn.selected_filetype->ag ;
+	FS_ParsedName_destroy( &s_pn ) ;
+	ck_assert_ptr_ne( NO_BULK_READ, ag->bulk_read ) ;
+
+	bulk = pages_stat( &read_bulk ) ;
+	ck_assert_int_eq( 1, pages_read_all( pin ) ) ;
+	ck_assert_int_eq( bulk + 1, pages_stat( &read_bulk ) ) ;
+
+	bulk_read = ag->bulk_read ;
+	ag->bulk_read = NO_BULK_READ ;
+	ck_assert_int_eq( PAGES_COUNT, pages_read_all( pin ) ) ;
+	ag->bulk_read = bulk_read ;
+
+	pages_close( pin ) ;
+}
+END_TEST
+
+// A failed bulk read falls back to the pages, each with its retries
+START_TEST(test_pages_bulk_fallback)
+{
+	struct port_in * pin = pages_open() ;
+	UINT bulk ;
+	UINT retries ;
+
+	// only a page fits through
+	pages_bus.fail_longer = PAGES_SIZE ;
+	bulk = pages_stat( &read_bulk ) ;
+	ck_assert_int_eq( 1 + PAGES_COUNT, pages_read_all( pin ) ) ;
+	ck_assert_int_eq( bulk, pages_stat( &read_bulk ) ) ;
+
+	// and one page needs a second try
+	retries = pages_stat( &read_tries[1] ) ;
+	pages_bus.fail_reset = pages_bus.resets + 1 + 3 ;
+	ck_assert_int_eq( 1 + PAGES_COUNT + 1, pages_read_all( pin ) ) ;
+	ck_assert_int_eq( retries + 1, pages_stat( &read_tries[1] ) ) ;
+
+	// a page that never reads fails the whole
+	pages_bus.fail_reset = 0 ;
+	pages_bus.fail_longer = 1 ;
+	ck_assert_int_eq( -1, pages_read_all( pin ) ) ;
+
+	pages_close( pin ) ;
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_pages_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("pages");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_pages_bulk);
+	tcase_add_test(tc, test_pages_bulk_fallback);
+	return s;
+}
@@ -0,0 +1,132 @@
+#include "ow_testhelper.h"
+#include "ow_counters.h"
+
+// Real devices are taken as present (no bus masters in the test)
+static void parsename_setup(void) {
+	owlib_test_setup() ;
+	Globals.one_device = 1 ;
+}
+
+static void parsename_teardown(void) {
+	Globals.one_device = 0 ;
+	Globals.parse_cache = 0 ;
+	ParseCache_Close() ;
+	owlib_test_teardown() ;
+}
+
+// Keywords are prefix matches in any case
+START_TEST(test_parse_keywords)
+{
+	struct parsedname s_pn ;
+	struct parsedname * pn = &s_pn ;
+
+	ck_assert_int_eq(0, FS_ParsedName("/statistics/cache/flips", pn));
+	ck_assert_int_eq(ePN_statistics, pn->type);
+	ck_assert_str_eq("flips", pn->selected_filetype->name);
+	FS_ParsedName_destroy(pn) ;
+
+	ck_assert_int_eq(0, FS_ParsedName("/UNCACHED/Text/settings/units/temperature_scale", pn));
+	ck_assert_int_eq(ePN_settings, pn->type);
+	ck_assert(IsUncachedDir(pn));
+	ck_assert(pn->state & ePS_text);
+	FS_ParsedName_destroy(pn) ;
+
+	ck_assert_int_eq(0, FS_ParsedName("/alarm", pn));
+	ck_assert(IsAlarmDir(pn));
+	FS_ParsedName_destroy(pn) ;
+
+	// no such bus
+	ck_assert_int_ne(0, FS_ParsedName("/bus.3/statistics", pn));
+	// not a keyword, not a device
+	ck_assert_int_ne(0, FS_ParsedName("/busy", pn));
+}
+END_TEST
+
+// Numbers, letters, ALL and BYTE after the property name
+START_TEST(test_parse_extensions)
+{
+	struct parsedname s_pn ;
+	struct parsedname * pn = &s_pn ;
+
+	ck_assert_int_eq(0, FS_ParsedName("/29.0123456789AB/PIO.3", pn));
+	ck_assert_int_eq(3, pn->extension);
+	FS_ParsedName_destroy(pn) ;
+
+	ck_assert_int_eq(0, FS_ParsedName("/29.0123456789AB/PIO.byte", pn));
+	ck_assert_int_eq(EXTENSION_BYTE, pn->extension);
+	FS_ParsedName_destroy(pn) ;
+
+	ck_assert_int_eq(0, FS_ParsedName("/29.0123456789AB/PIO.ALL", pn));
+	ck_assert_int_eq(EXTENSION_ALL, pn->extension);
+	FS_ParsedName_destroy(pn) ;
+
+	ck_assert_int_eq(0, FS_ParsedName("/12.0123456789AB/PIO.b", pn));
+	ck_assert_int_eq(1, pn->extension);
+	FS_ParsedName_destroy(pn) ;
+
+	ck_assert_int_ne(0, FS_ParsedName("/29.0123456789AB/PIO.8", pn));
+	ck_assert_int_ne(0, FS_ParsedName("/29.0123456789AB/PIO.x", pn));
+	ck_assert_int_ne(0, FS_ParsedName("/29.0123456789AB/PIO", pn));
+	ck_assert_int_ne(0, FS_ParsedName("/10.0123456789AB/temperature.0", pn));
+}
+END_TEST
+
+// A second parse of the same path comes from the parse cache, with the same result
+START_TEST(test_parse_cache)
+{
+	struct parsedname s_pn ;
+	struct parsedname * pn = &s_pn ;
+	struct parsedname s_pn_cached ;
+	struct parsedname * pn_cached = &s_pn_cached ;
+	UINT hits ;
+
+	Globals.parse_cache = 4 ;
+	ParseCache_Configure() ;
+
+	ck_assert_int_eq(0, FS_ParsedName("/uncached/29.0123456789AB/PIO.5", pn));
+	hits = parse_cache_hits ;
+	ck_assert_int_eq(0, FS_ParsedName("/uncached/29.0123456789AB/PIO.5", pn_cached));
+	ck_assert_int_eq(hits + 1, parse_cache_hits);
+
+	ck_assert_int_eq(pn->type, pn_cached->type);
+	ck_assert_int_eq(pn->state, pn_cached->state);
+	ck_assert_int_eq(0, memcmp(pn->sn, pn_cached->sn, SERIAL_NUMBER_SIZE));
+	ck_assert_ptr_eq(pn->selected_device, pn_cached->selected_device);
+	ck_assert_ptr_eq(pn->selected_filetype, pn_cached->selected_filetype);
+	ck_assert_int_eq(pn->extension, pn_cached->extension);
+	ck_assert_int_eq(pn->dirlength, pn_cached->dirlength);
+	ck_assert_str_eq(pn->path_to_server, pn_cached->path_to_server);
+	ck_assert_str_eq(pn->device_name, pn_cached->device_name);
+	FS_ParsedName_destroy(pn) ;
+	FS_ParsedName_destroy(pn_cached) ;
+
+	// bad paths are never kept
+	ck_assert_int_ne(0, FS_ParsedName("/29.0123456789AB/PIO.9", pn));
+	hits = parse_cache_hits ;
+	ck_assert_int_ne(0, FS_ParsedName("/29.0123456789AB/PIO.9", pn));
+	ck_assert_int_eq(hits, parse_cache_hits);
+
+	// flushed when bus masters change
+	ParseCache_Flush() ;
+	hits = parse_cache_hits ;
+	ck_assert_int_eq(0, FS_ParsedName("/uncached/29.0123456789AB/PIO.5", pn));
+	ck_assert_int_eq(hits, parse_cache_hits);
+	FS_ParsedName_destroy(pn) ;
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_parsename_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("parsename");
+
+	tcase_add_checked_fixture(tc, parsename_setup, parsename_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_parse_keywords);
+	tcase_add_test(tc, test_parse_extensions);
+	tcase_add_test(tc, test_parse_cache);
+	return s;
+}
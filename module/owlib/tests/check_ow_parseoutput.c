@@ -0,0 +1,162 @@
+#include "ow_testhelper.h"
+
+// Numbers and dates formatted for a read
+//
+// The value is formatted straight into the reader's buffer when there is
+// room, else in scratch and copied. Either way the bytes handed back must
+// be what snprintf (or ctime_r) gives for the value, as they always were,
+// and nothing may be written past the reader's buffer. (Numbers are padded
+// to their full width unless trimmed.)
+
+#define OUTPUT_BUFFER_SIZE	64
+#define OUTPUT_UNTOUCHED	0x5A
+
+static struct port_in * output_bus( void )
+{
+	struct port_in * pin ;
+
+	// DS18S20 (temperature), DS2415 (udate, date) and DS2417 (interval)
+	ck_assert( GOOD( ARG_Fake( "10.67C6697351FF,24.0123456789AB,27.0123456789AB" ) ) ) ;
+	pin = Inbound_Control.head_port ;
+	ck_assert( GOOD( Fake_detect( pin ) ) ) ;
+	return pin ;
+}
+
+// format value into size bytes at offset, check against expected
+static void output_read( struct one_wire_query * owq_read, const union value_object * value, size_t size, off_t offset, const char * expected, size_t min_size )
+{
+	char buffer[OUTPUT_BUFFER_SIZE] ;
+	size_t length = strlen( expected ) ;
+	size_t answer ;
+	size_t i ;
+
+	memset( buffer, OUTPUT_UNTOUCHED, sizeof(buffer) ) ;
+	OWQ_assign_read_buffer( buffer, size, offset, owq_read ) ;
+	// the length shares the value's place
+	memcpy( &OWQ_val(owq_read), value, sizeof(union value_object) ) ;
+
+	if ( size < min_size ) {
+		ck_assert_int_eq( -EMSGSIZE, OWQ_parse_output( owq_read ) ) ;
+		return ;
+	}
+	answer = length - offset ;
+	if ( answer > size ) {
+		answer = size ;
+	}
+	ck_assert_int_eq( answer, OWQ_parse_output( owq_read ) ) ;
+	if ( answer > 0 ) {
+		// (a read at the end of the file returns before formatting)
+		ck_assert_int_eq( answer, OWQ_length( owq_read ) ) ;
+	}
+	ck_assert_msg( memcmp( buffer, &expected[offset], answer ) == 0, "size %d offset %d: [%.*s] not [%.*s]", (int) size, (int) offset, (int) answer, buffer, (int) answer, &expected[offset] ) ;
+	for ( i = size ; i < sizeof(buffer) ; ++i ) {
+		ck_assert_msg( (BYTE) buffer[i] == OUTPUT_UNTOUCHED, "size %d offset %d: byte %d written", (int) size, (int) offset, (int) i ) ;
+	}
+}
+
+// every buffer size up to past the scratch space, then every offset
+static void output_check( const char * path, const union value_object * value, const char * padded, const char * trimmed, size_t min_size )
+{
+	struct one_wire_query * owq_read = OWQ_create_from_path( path ) ;
+	const char * expected ;
+	size_t length ;
+	size_t size ;
+	off_t offset ;
+
+	ck_assert( owq_read != NO_ONE_WIRE_QUERY ) ;
+	expected = ShouldTrim( PN(owq_read) ) ? trimmed : padded ;
+	length = strlen( expected ) ;
+	for ( size = 1 ; size <= length + 4 ; ++size ) {
+		output_read( owq_read, value, size, 0, expected, min_size ) ;
+	}
+	output_read( owq_read, value, OUTPUT_BUFFER_SIZE, 0, expected, min_size ) ;
+	for ( offset = 1 ; offset <= (off_t) length ; ++offset ) {
+		output_read( owq_read, value, OUTPUT_BUFFER_SIZE, offset, expected, min_size ) ;
+	}
+	OWQ_destroy( owq_read ) ;
+}
+
+START_TEST(test_output_integer)
+{
+	struct port_in * pin = output_bus() ;
+	union value_object value ;
+	char padded[PROPERTY_LENGTH_INTEGER + 2] ;
+	char trimmed[PROPERTY_LENGTH_INTEGER + 2] ;
+
+	memset( &value, 0, sizeof(value) ) ;
+	value.I = -123456 ;
+	snprintf( padded, PROPERTY_LENGTH_INTEGER + 1, "%*d", PROPERTY_LENGTH_INTEGER, value.I ) ;
+	snprintf( trimmed, PROPERTY_LENGTH_INTEGER + 1, "%1d", value.I ) ;
+	output_check( "/27.0123456789AB/interval", &value, padded, trimmed, 1 ) ;
+
+	RemovePort( pin ) ;
+}
+END_TEST
+
+START_TEST(test_output_unsigned)
+{
+	struct port_in * pin = output_bus() ;
+	union value_object value ;
+	char padded[PROPERTY_LENGTH_UNSIGNED + 2] ;
+	char trimmed[PROPERTY_LENGTH_UNSIGNED + 2] ;
+
+	memset( &value, 0, sizeof(value) ) ;
+	value.U = 4000000000U ;
+	snprintf( padded, PROPERTY_LENGTH_UNSIGNED + 1, "%*u", PROPERTY_LENGTH_UNSIGNED, value.U ) ;
+	snprintf( trimmed, PROPERTY_LENGTH_UNSIGNED + 1, "%1u", value.U ) ;
+	output_check( "/24.0123456789AB/udate", &value, padded, trimmed, 1 ) ;
+
+	RemovePort( pin ) ;
+}
+END_TEST
+
+START_TEST(test_output_float)
+{
+	struct port_in * pin = output_bus() ;
+	union value_object value ;
+	char padded[PROPERTY_LENGTH_FLOAT + 2] ;
+	char trimmed[PROPERTY_LENGTH_FLOAT + 2] ;
+
+	memset( &value, 0, sizeof(value) ) ;
+	value.F = -12.3125 ; // Celsius, as read
+	snprintf( padded, PROPERTY_LENGTH_FLOAT + 1, "%*G", PROPERTY_LENGTH_FLOAT, value.F ) ;
+	snprintf( trimmed, PROPERTY_LENGTH_FLOAT + 1, "%1G", value.F ) ;
+	output_check( "/10.67C6697351FF/temperature", &value, padded, trimmed, 1 ) ;
+
+	RemovePort( pin ) ;
+}
+END_TEST
+
+START_TEST(test_output_date)
+{
+	struct port_in * pin = output_bus() ;
+	union value_object value ;
+	char expected[PROPERTY_LENGTH_DATE + 2] ;
+
+	memset( &value, 0, sizeof(value) ) ;
+	value.D = 1234567890 ;
+	ctime_r( &value.D, expected ) ;
+	expected[PROPERTY_LENGTH_DATE] = '\0' ; // no newline
+	// never in part
+	output_check( "/24.0123456789AB/date", &value, expected, expected, PROPERTY_LENGTH_DATE ) ;
+
+	RemovePort( pin ) ;
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_parseoutput_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("parseoutput");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_output_integer);
+	tcase_add_test(tc, test_output_unsigned);
+	tcase_add_test(tc, test_output_float);
+	tcase_add_test(tc, test_output_date);
+	return s;
+}
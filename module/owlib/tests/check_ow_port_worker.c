@@ -0,0 +1,185 @@
+#include "ow_testhelper.h"
+#include "ow_connection.h"
+
+// Per-port worker threads
+//
+// Three fake buses, a device on each. A job on the workers of two of them
+// looks for the device on the other one while both workers are busy. (The
+// last port added is listed first, a presence check covers that one itself.)
+
+#define WORKER_PORTS	3
+
+static const char * worker_buses[WORKER_PORTS] = {
+	"10.67C6697351FF",
+	"28.0123456789AB",
+	"29.0123456789AB",
+} ;
+
+struct worker_job {
+	struct port_job job ;
+	const char * path ;
+	INDEX_OR_ERROR bus_nr ;
+} ;
+
+static struct {
+	pthread_mutex_t mutex ;
+	pthread_cond_t cond ;
+	int started ;
+} workers ;
+
+// both jobs running, or 5 seconds
+static void worker_meet( void )
+{
+	struct timespec deadline ;
+
+	clock_gettime( CLOCK_REALTIME, &deadline ) ;
+	deadline.tv_sec += 5 ;
+	_MUTEX_LOCK( workers.mutex ) ;
+	++workers.started ;
+	pthread_cond_broadcast( &workers.cond ) ;
+	while ( workers.started < 2 ) {
+		if ( pthread_cond_timedwait( &workers.cond, &workers.mutex, &deadline ) != 0 ) {
+			break ;
+		}
+	}
+	_MUTEX_UNLOCK( workers.mutex ) ;
+}
+
+static void worker_presence( void * v )
+{
+	struct worker_job * wj = v ;
+	struct parsedname pn ;
+
+	worker_meet() ;
+	wj->bus_nr = INDEX_BAD ;
+	if ( FS_ParsedName( wj->path, &pn ) != 0 ) {
+		return ;
+	}
+	UnsetKnownBus( &pn ) ;
+	Cache_Del_Device( &pn ) ;
+	wj->bus_nr = CheckPresence( &pn ) ;
+	FS_ParsedName_destroy( &pn ) ;
+}
+
+// Each port's worker checks presence across the ports, no worker waits on another
+START_TEST(test_port_worker_cross_presence)
+{
+	struct port_in * pins[WORKER_PORTS] ;
+	struct worker_job jobs[2] ;
+	struct port_batch batch ;
+	int i ;
+
+	for ( i = 0 ; i < WORKER_PORTS ; ++i ) {
+		ck_assert( GOOD( ARG_Fake( worker_buses[i] ) ) ) ;
+		pins[i] = Inbound_Control.head_port ;
+		ck_assert( GOOD( Fake_detect( pins[i] ) ) ) ;
+	}
+	memset( &workers, 0, sizeof(workers) ) ;
+	_MUTEX_INIT( workers.mutex ) ;
+	pthread_cond_init( &workers.cond, NULL ) ;
+
+	// the job on each port looks for the other port's device
+	jobs[0].path = "/uncached/28.0123456789AB" ;
+	jobs[1].path = "/uncached/10.67C6697351FF" ;
+	PortBatch_init( &batch ) ;
+	for ( i = 0 ; i < 2 ; ++i ) {
+		PortWorker_dispatch( pins[i], &jobs[i].job, worker_presence, &jobs[i], &batch ) ;
+	}
+	PortBatch_wait( &batch ) ;
+
+	ck_assert_int_eq( 2, workers.started ) ;
+	ck_assert_int_eq( pins[1]->first->index, jobs[0].bus_nr ) ;
+	ck_assert_int_eq( pins[0]->first->index, jobs[1].bus_nr ) ;
+
+	pthread_cond_destroy( &workers.cond ) ;
+	_MUTEX_DESTROY( workers.mutex ) ;
+	for ( i = 0 ; i < WORKER_PORTS ; ++i ) {
+		RemovePort( pins[i] ) ;
+	}
+}
+END_TEST
+
+// Jobs queued while the port's workers are stopped again and again
+#define WORKER_DISPATCHERS	4
+#define WORKER_DISPATCHES	2000
+
+static struct {
+	pthread_mutex_t mutex ;
+	struct port_in * pin ;
+	int ran ;
+	int dispatchers ; // still running
+} stopping ;
+
+static void worker_count( void * v )
+{
+	(void) v ;
+	_MUTEX_LOCK( stopping.mutex ) ;
+	++stopping.ran ;
+	_MUTEX_UNLOCK( stopping.mutex ) ;
+}
+
+static void * worker_dispatcher( void * v )
+{
+	int i ;
+
+	(void) v ;
+	for ( i = 0 ; i < WORKER_DISPATCHES ; ++i ) {
+		struct port_job job ;
+		struct port_batch batch ;
+
+		PortBatch_init( &batch ) ;
+		PortWorker_dispatch( stopping.pin, &job, worker_count, NULL, &batch ) ;
+		PortBatch_wait( &batch ) ;
+	}
+	_MUTEX_LOCK( stopping.mutex ) ;
+	--stopping.dispatchers ;
+	_MUTEX_UNLOCK( stopping.mutex ) ;
+	return VOID_RETURN ;
+}
+
+// Every job runs once, none is queued on workers already stopped
+START_TEST(test_port_worker_stop_race)
+{
+	pthread_t thread[WORKER_DISPATCHERS] ;
+	int dispatchers ;
+	int i ;
+
+	ck_assert( GOOD( ARG_Fake( worker_buses[0] ) ) ) ;
+	memset( &stopping, 0, sizeof(stopping) ) ;
+	_MUTEX_INIT( stopping.mutex ) ;
+	stopping.pin = Inbound_Control.head_port ;
+	stopping.dispatchers = WORKER_DISPATCHERS ;
+
+	for ( i = 0 ; i < WORKER_DISPATCHERS ; ++i ) {
+		ck_assert_int_eq( 0, pthread_create( &thread[i], NULL, worker_dispatcher, NULL ) ) ;
+	}
+	do {
+		PortWorker_stop( stopping.pin ) ;
+		_MUTEX_LOCK( stopping.mutex ) ;
+		dispatchers = stopping.dispatchers ;
+		_MUTEX_UNLOCK( stopping.mutex ) ;
+	} while ( dispatchers > 0 ) ;
+	for ( i = 0 ; i < WORKER_DISPATCHERS ; ++i ) {
+		pthread_join( thread[i], NULL ) ;
+	}
+
+	ck_assert_int_eq( WORKER_DISPATCHERS * WORKER_DISPATCHES, stopping.ran ) ;
+	_MUTEX_DESTROY( stopping.mutex ) ;
+	RemovePort( stopping.pin ) ;
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_port_worker_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("port_worker");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_port_worker_cross_presence);
+	tcase_add_test(tc, test_port_worker_stop_race);
+	return s;
+}
@@ -0,0 +1,266 @@
+#include "ow_testhelper.h"
+#include "ow_connection.h"
+#include "ow_counters.h"
+
+// Root searches of a bit-banging bus master
+//
+// A fake bus master gets bit level routines: the 1-wire devices below
+// answer the search ROM command slot by slot, everything else just reads
+// back what was written. Every call to the master (sendback_bits) is
+// counted.
+
+#define SEARCH_DEVICES	5
+
+static struct {
+	BYTE sn[SEARCH_DEVICES][SERIAL_NUMBER_SIZE] ;
+	int devices ;
+	int active[SEARCH_DEVICES] ;
+	int searching ;
+	int command_bits ;
+	BYTE command ;
+	int bit_number ;
+	int slot ;					// read, read complement, write
+	UINT exchanges ;
+} bus ;
+
+static RESET_TYPE bus_reset( const struct parsedname * pn )
+{
+	int device ;
+
+	for ( device = 0 ; device < bus.devices ; ++device ) {
+		bus.active[device] = 1 ;
+	}
+	bus.searching = 0 ;
+	bus.command_bits = 0 ;
+	bus.command = 0 ;
+	pn->selected_connection->AnyDevices = bus.devices ? anydevices_yes : anydevices_no ;
+	return BUS_RESET_OK ;
+}
+
+// open drain: any active device sending 0 wins
+static BYTE bus_search_read( int complement )
+{
+	BYTE line = 1 ;
+	int device ;
+
+	for ( device = 0 ; device < bus.devices ; ++device ) {
+		if ( bus.active[device] && UT_getbit( bus.sn[device], bus.bit_number ) == complement ) {
+			line = 0 ;
+		}
+	}
+	return line ;
+}
+
+static BYTE bus_bit( BYTE out )
+{
+	BYTE line = out ;
+	int device ;
+
+	if ( bus.command_bits < 8 ) {
+		bus.command |= out << bus.command_bits ;
+		if ( ++bus.command_bits == 8 && bus.command == _1W_SEARCH_ROM ) {
+			bus.searching = 1 ;
+			bus.bit_number = 0 ;
+			bus.slot = 0 ;
+		}
+		return line ;
+	}
+	if ( ! bus.searching ) {
+		return line ;
+	}
+	switch ( bus.slot ) {
+		case 0:
+			line = out & bus_search_read( 0 ) ;
+			break ;
+		case 1:
+			line = out & bus_search_read( 1 ) ;
+			break ;
+		default:
+			for ( device = 0 ; device < bus.devices ; ++device ) {
+				if ( UT_getbit( bus.sn[device], bus.bit_number ) != out ) {
+					bus.active[device] = 0 ;
+				}
+			}
+			if ( ++bus.bit_number == 64 ) {
+				bus.searching = 0 ;
+			}
+			break ;
+	}
+	bus.slot = ( bus.slot + 1 ) % 3 ;
+	return line ;
+}
+
+static GOOD_OR_BAD bus_sendback_bits( const BYTE * data, BYTE * resp, const size_t length, const struct parsedname * pn )
+{
+	size_t i ;
+
+	(void) pn ;
+	++bus.exchanges ;
+	for ( i = 0 ; i < length ; ++i ) {
+		resp[i] = bus_bit( data[i] ? 1 : 0 ) ;
+	}
+	return gbGOOD ;
+}
+
+// serial numbers that branch off early and late in the search
+static void bus_device( int device, BYTE family, BYTE last )
+{
+	BYTE * sn = bus.sn[device] ;
+
+	sn[0] = family ;
+	sn[1] = 0x67 ;
+	sn[2] = 0xC6 ;
+	sn[3] = 0x69 ;
+	sn[4] = 0x73 ;
+	sn[5] = 0x51 ;
+	sn[6] = last ;
+	sn[7] = CRC8compute( sn, 7, 0 ) ;
+}
+
+static struct port_in * bus_open( void )
+{
+	struct port_in * pin ;
+	struct connection_in * in ;
+
+	ck_assert( GOOD( ARG_Fake( "10" ) ) ) ;
+	pin = Inbound_Control.head_port ;
+	ck_assert( GOOD( Fake_detect( pin ) ) ) ;
+	in = pin->first ;
+	in->iroutines.reset = bus_reset ;
+	in->iroutines.next_both = NO_NEXT_BOTH_ROUTINE ;
+	in->iroutines.sendback_data = NO_SENDBACKDATA_ROUTINE ;
+	in->iroutines.sendback_bits = bus_sendback_bits ;
+
+	memset( &bus, 0, sizeof(bus) ) ;
+	bus_device( 0, 0x10, 0xFF ) ;
+	bus_device( 1, 0x28, 0xFF ) ;
+	bus_device( 2, 0x28, 0xFE ) ;
+	bus_device( 3, 0x29, 0x01 ) ;
+	bus.devices = 4 ;
+	return pin ;
+}
+
+struct search_listing {
+	int devices ;
+	UINT passes ;
+	UINT verified ;
+	UINT exchanges ;
+} ;
+
+// list the bus root, every device found must be on the bus
+static void search_list( struct connection_in * in, struct search_listing * sl )
+{
+	struct parsedname s_pn ;
+	struct device_search ds ;
+	enum search_status ret ;
+
+	ck_assert_int_eq( 0, FS_ParsedName( "/", &s_pn ) ) ;
+	s_pn.selected_connection = in ;
+
+	memset( sl, 0, sizeof(struct search_listing) ) ;
+	STATLOCK ;
+	sl->passes = dir_passes ;
+	sl->verified = dir_verified ;
+	STATUNLOCK ;
+	sl->exchanges = bus.exchanges ;
+
+	for ( ret = BUS_first( &ds, &s_pn ) ; ret == search_good ; ret = BUS_next( &ds, &s_pn ) ) {
+		int device ;
+		for ( device = 0 ; device < bus.devices ; ++device ) {
+			if ( memcmp( ds.sn, bus.sn[device], SERIAL_NUMBER_SIZE ) == 0 ) {
+				break ;
+			}
+		}
+		ck_assert_int_lt( device, bus.devices ) ;
+		++sl->devices ;
+	}
+	ck_assert_int_eq( search_done, ret ) ;
+
+	STATLOCK ;
+	sl->passes = dir_passes - sl->passes ;
+	sl->verified = dir_verified - sl->verified ;
+	STATUNLOCK ;
+	sl->exchanges = bus.exchanges - sl->exchanges ;
+
+	FS_ParsedName_destroy( &s_pn ) ;
+}
+
+// one exchange for the search command, the rest as the master's buffer allows
+#define SEARCH_VERIFY_EXCHANGES	( 1 + ( 3 * 64 + MAX_FIFO_SIZE - 1 ) / MAX_FIFO_SIZE )
+
+// An unchanged bus is listed from the last listing, one block per device
+START_TEST(test_search_seed_verified)
+{
+	struct port_in * pin = bus_open() ;
+	struct search_listing sl ;
+
+	search_list( pin->first, &sl ) ;
+	ck_assert_int_eq( 4, sl.devices ) ;
+	ck_assert_int_eq( 4, sl.passes ) ;
+	ck_assert_int_eq( 0, sl.verified ) ;
+	ck_assert_int_gt( sl.exchanges, 4 * 64 ) ;
+
+	search_list( pin->first, &sl ) ;
+	ck_assert_int_eq( 4, sl.devices ) ;
+	ck_assert_int_eq( 4, sl.passes ) ;
+	ck_assert_int_eq( 1, sl.verified ) ;
+	ck_assert_int_eq( 4 * SEARCH_VERIFY_EXCHANGES, sl.exchanges ) ;
+
+	RemovePort( pin ) ;
+}
+END_TEST
+
+// Added, removed or replaced devices fall back to a full search
+START_TEST(test_search_seed_changed)
+{
+	struct port_in * pin = bus_open() ;
+	struct search_listing sl ;
+
+	search_list( pin->first, &sl ) ;
+
+	// added, its path leaves a known one's where no branch was
+	bus_device( 4, 0x28, 0xFC ) ;
+	bus.devices = 5 ;
+	search_list( pin->first, &sl ) ;
+	ck_assert_int_eq( 5, sl.devices ) ;
+	ck_assert_int_eq( 0, sl.verified ) ;
+	search_list( pin->first, &sl ) ;
+	ck_assert_int_eq( 5, sl.devices ) ;
+	ck_assert_int_eq( 1, sl.verified ) ;
+
+	// removed
+	bus.devices = 3 ;
+	search_list( pin->first, &sl ) ;
+	ck_assert_int_eq( 3, sl.devices ) ;
+	ck_assert_int_eq( 0, sl.verified ) ;
+
+	// replaced
+	bus_device( 2, 0x3A, 0x10 ) ;
+	search_list( pin->first, &sl ) ;
+	ck_assert_int_eq( 3, sl.devices ) ;
+	ck_assert_int_eq( 0, sl.verified ) ;
+
+	// all gone
+	bus.devices = 0 ;
+	search_list( pin->first, &sl ) ;
+	ck_assert_int_eq( 0, sl.devices ) ;
+	ck_assert_int_eq( 0, sl.verified ) ;
+
+	RemovePort( pin ) ;
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_search_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("search");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_search_seed_verified);
+	tcase_add_test(tc, test_search_seed_changed);
+	return s;
+}
@@ -0,0 +1,263 @@
+#include "ow_testhelper.h"
+#include "ow_connection.h"
+
+// Pipelined reads from an owserver
+//
+// A minimal owserver on a loopback port, a thread per connection. It grants pipelining when asked and answers every read with the path it
+// was given, after the request id once pipelined. It hangs up after
+// "hangup" answers on a connection (0 never).
+
+#define SERVER_REPLY_SIZE	64
+#define SERVER_CONNECTIONS	64
+
+static struct {
+	FILE_DESCRIPTOR_OR_ERROR listen_fd ;
+	int port ;
+	int hangup ;
+	pthread_mutex_t mutex ;
+	int stop ;
+	UINT connections ;			// that carried requests
+	UINT pipelined ;			// requests that carried an id
+	pthread_t thread ;
+	pthread_t connection_thread[SERVER_CONNECTIONS] ;
+	int threads ;
+} server ;
+
+static GOOD_OR_BAD server_read( FILE_DESCRIPTOR_OR_ERROR file_descriptor, void * buffer, size_t length )
+{
+	BYTE * data = buffer ;
+
+	while ( length > 0 ) {
+		ssize_t got = read( file_descriptor, data, length ) ;
+		if ( got <= 0 ) {
+			return gbBAD ;
+		}
+		data += got ;
+		length -= got ;
+	}
+	return gbGOOD ;
+}
+
+static void * server_connection( void * v )
+{
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor = (FILE_DESCRIPTOR_OR_ERROR) (intptr_t) v ;
+	int pipelined = 0 ;
+	int answers = 0 ;
+
+	while ( server.hangup == 0 || answers < server.hangup ) {
+		struct server_msg sm ;
+		struct client_msg cm ;
+		uint32_t id = 0 ;
+		char path[SERVER_REPLY_SIZE] ;
+		size_t payload ;
+		size_t path_length ;
+		struct iovec io[3] ;
+		int nio = 0 ;
+
+		if ( BAD( server_read( file_descriptor, &sm, sizeof(sm) ) ) ) {
+			break ;
+		}
+		if ( pipelined && BAD( server_read( file_descriptor, &id, sizeof(id) ) ) ) {
+			break ;
+		}
+		payload = ntohl( sm.payload ) ;
+		ck_assert_int_le( payload, sizeof(path) ) ;
+		if ( BAD( server_read( file_descriptor, path, payload ) ) ) {
+			break ;
+		}
+		if ( answers == 0 ) {
+			_MUTEX_LOCK( server.mutex ) ;
+			++server.connections ;
+			_MUTEX_UNLOCK( server.mutex ) ;
+		}
+		path_length = strlen( path ) ;
+
+		memset( &cm, 0, sizeof(cm) ) ;
+		cm.payload = htonl( path_length ) ;
+		cm.ret = htonl( path_length ) ;
+		cm.size = htonl( path_length ) ;
+		cm.control_flags = sm.control_flags ;
+		if ( ntohl( sm.control_flags ) & PIPELINE_REQUEST ) {
+			cm.control_flags = htonl( ntohl( sm.control_flags ) | PERSISTENT_MASK | PIPELINE_GRANTED ) ;
+		}
+		io[nio].iov_base = &cm ;
+		io[nio].iov_len = sizeof(cm) ;
+		++nio ;
+		if ( pipelined ) {
+			io[nio].iov_base = &id ;
+			io[nio].iov_len = sizeof(id) ;
+			++nio ;
+			_MUTEX_LOCK( server.mutex ) ;
+			++server.pipelined ;
+			_MUTEX_UNLOCK( server.mutex ) ;
+		}
+		io[nio].iov_base = path ;
+		io[nio].iov_len = path_length ;
+		++nio ;
+		if ( writev( file_descriptor, io, nio ) < 0 ) {
+			break ;
+		}
+		if ( ntohl( cm.control_flags ) & PIPELINE_GRANTED ) {
+			pipelined = 1 ;
+		}
+		++answers ;
+	}
+	close( file_descriptor ) ;
+	return VOID_RETURN ;
+}
+
+static void * server_loop( void * v )
+{
+	(void) v ;
+	while ( 1 ) {
+		struct timeval tv = { 0, 50000, } ;
+		fd_set readset ;
+		FILE_DESCRIPTOR_OR_ERROR file_descriptor ;
+		int stop ;
+
+		_MUTEX_LOCK( server.mutex ) ;
+		stop = server.stop ;
+		_MUTEX_UNLOCK( server.mutex ) ;
+		if ( stop ) {
+			break ;
+		}
+		FD_ZERO( &readset ) ;
+		FD_SET( server.listen_fd, &readset ) ;
+		if ( select( server.listen_fd + 1, &readset, NULL, NULL, &tv ) != 1 ) {
+			continue ;
+		}
+		file_descriptor = accept( server.listen_fd, NULL, NULL ) ;
+		if ( FILE_DESCRIPTOR_NOT_VALID( file_descriptor ) ) {
+			continue ;
+		}
+		ck_assert_int_lt( server.threads, SERVER_CONNECTIONS ) ;
+		ck_assert_int_eq( 0, pthread_create( &server.connection_thread[server.threads], NULL, server_connection, (void *) (intptr_t) file_descriptor ) ) ;
+		++server.threads ;
+	}
+	return VOID_RETURN ;
+}
+
+static void server_start( int hangup )
+{
+	struct sockaddr_in sin ;
+	socklen_t sin_len = sizeof(sin) ;
+
+	memset( &server, 0, sizeof(server) ) ;
+	server.hangup = hangup ;
+	server.listen_fd = socket( AF_INET, SOCK_STREAM, 0 ) ;
+	ck_assert( FILE_DESCRIPTOR_VALID( server.listen_fd ) ) ;
+	memset( &sin, 0, sizeof(sin) ) ;
+	sin.sin_family = AF_INET ;
+	sin.sin_addr.s_addr = htonl( INADDR_LOOPBACK ) ;
+	ck_assert_int_eq( 0, bind( server.listen_fd, (struct sockaddr *) &sin, sizeof(sin) ) ) ;
+	ck_assert_int_eq( 0, listen( server.listen_fd, 8 ) ) ;
+	ck_assert_int_eq( 0, getsockname( server.listen_fd, (struct sockaddr *) &sin, &sin_len ) ) ;
+	server.port = ntohs( sin.sin_port ) ;
+	_MUTEX_INIT( server.mutex ) ;
+	ck_assert_int_eq( 0, pthread_create( &server.thread, NULL, server_loop, NULL ) ) ;
+}
+
+// every client connection must be closed by now
+static void server_stop( void )
+{
+	int thread ;
+
+	_MUTEX_LOCK( server.mutex ) ;
+	server.stop = 1 ;
+	_MUTEX_UNLOCK( server.mutex ) ;
+	pthread_join( server.thread, NULL ) ;
+	for ( thread = 0 ; thread < server.threads ; ++thread ) {
+		pthread_join( server.connection_thread[thread], NULL ) ;
+	}
+	close( server.listen_fd ) ;
+	_MUTEX_DESTROY( server.mutex ) ;
+}
+
+static struct port_in * server_port( void )
+{
+	char address[32] ;
+	struct port_in * pin ;
+
+	snprintf( address, sizeof(address), "127.0.0.1:%d", server.port ) ;
+	ck_assert( GOOD( ARG_Net( address ) ) ) ;
+	pin = Inbound_Control.head_port ;
+	ck_assert( GOOD( Server_detect( pin ) ) ) ;
+	return pin ;
+}
+
+// one read, answered with its own path
+static void server_read_check( struct connection_in * in, const char * path )
+{
+	struct one_wire_query owq_read ;
+	char buffer[SERVER_REPLY_SIZE] ;
+
+	memset( &owq_read, 0, sizeof(owq_read) ) ;
+	memset( buffer, 0, sizeof(buffer) ) ;
+	OWQ_buffer( &owq_read ) = buffer ;
+	OWQ_size( &owq_read ) = sizeof(buffer) ;
+	strncpy( PN( &owq_read )->path_to_server, path, PATH_MAX ) ;
+	PN( &owq_read )->selected_connection = in ;
+
+	ck_assert_int_eq( strlen( path ), ServerRead( &owq_read ) ) ;
+	ck_assert_str_eq( path, buffer ) ;
+}
+
+// The connection closes (reader thread running) right after pipelined reads
+START_TEST(test_pipeline_close_with_reader)
+{
+	int round ;
+
+	server_start( 0 ) ;
+	for ( round = 0 ; round < 20 ; ++round ) {
+		struct port_in * pin = server_port() ;
+		server_read_check( pin->first, "/negotiated" ) ;
+		server_read_check( pin->first, "/pipelined/1" ) ;
+		server_read_check( pin->first, "/pipelined/2" ) ;
+		RemovePort( pin ) ;
+	}
+	server_stop() ;
+
+	ck_assert_int_eq( 20, server.connections ) ;
+	ck_assert_int_eq( 40, server.pipelined ) ;
+}
+END_TEST
+
+// The owserver hangs up, reads go on over a new pipelined connection
+START_TEST(test_pipeline_reconnect)
+{
+	struct port_in * pin ;
+	int read ;
+
+	server_start( 3 ) ;
+	pin = server_port() ;
+	for ( read = 0 ; read < 12 ; ++read ) {
+		char path[SERVER_REPLY_SIZE] ;
+		snprintf( path, sizeof(path), "/read/%d", read ) ;
+		if ( read % 3 == 0 && read > 0 ) {
+			// the reader saw the hangup and let go of the connection
+			usleep( 100000 ) ;
+		}
+		server_read_check( pin->first, path ) ;
+	}
+	RemovePort( pin ) ;
+	server_stop() ;
+
+	ck_assert_int_eq( 4, server.connections ) ;
+	ck_assert_int_eq( 8, server.pipelined ) ;
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_server_message_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("server_message");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_pipeline_close_with_reader);
+	tcase_add_test(tc, test_pipeline_reconnect);
+	return s;
+}
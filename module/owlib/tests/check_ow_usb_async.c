@@ -0,0 +1,318 @@
+#include "ow_testhelper.h"
+#include "ow_connection.h"
+#include "ow_usb_msg.h"
+
+// DS9490 block I/O with --usb_async, on a fake libusb
+//
+// The libusb calls the library makes are answered here instead (the
+// program's definitions come first). The DS2490 echoes each block: bytes
+// written to EP2 come back on EP3 once a BLOCK_IO command moved them over
+// the 1-wire bus, the status packet tells how many are waiting.
+// Transfers complete in the order they were submitted, one per call to
+// handle the events. A cancelled transfer is called back the same way,
+// never before. Whatever goes wrong, every callback must have run before
+// the transfers are freed and the call returns.
+
+#if OW_USB
+
+#define FAKE_FIFO		( USB_FIFO_SIZE * 2 )
+#define FAKE_TRANSFERS	8
+#define FAKE_BLOCK_IO	( 0x0074 | 0x0001 | 0x0800 ) // COMM_BLOCK_IO | COMM_IM | COMM_F
+
+static struct {
+	BYTE out[FAKE_FIFO] ;		// EP2 FIFO, not on the 1-wire bus yet
+	size_t out_count ;
+	BYTE in[FAKE_FIFO] ;		// EP3 FIFO, echoed
+	size_t in_count ;
+	struct libusb_transfer * pending[FAKE_TRANSFERS] ;
+	int pending_count ;
+	int allocated ;				// transfers not freed
+	int allocs ;
+	int alloc_fail ;			// fail this allocation (1 is the first), 0 none
+	int submits ;
+	int submit_fail ;			// fail this submission (1 is the first), 0 none
+	int events ;				// events handled
+	int error_after ;			// events handled before the errors
+	int event_errors ;			// then event handling fails this many times
+	int hold ;					// status packets never come, until cancelled
+	int resets ;				// CTL_RESET_DEVICE
+} fake ;
+
+static int fake_perform( struct libusb_transfer * transfer )
+{
+	size_t n ;
+
+	if ( transfer->type == LIBUSB_TRANSFER_TYPE_CONTROL ) {
+		// BLOCK_IO: wIndex bytes over the 1-wire bus and back
+		struct libusb_control_setup * setup = (struct libusb_control_setup *) transfer->buffer ;
+		n = libusb_le16_to_cpu( setup->wIndex ) ;
+		if ( n > fake.out_count ) {
+			n = fake.out_count ;
+		}
+		memcpy( &fake.in[fake.in_count], fake.out, n ) ;
+		fake.in_count += n ;
+		memmove( fake.out, &fake.out[n], fake.out_count - n ) ;
+		fake.out_count -= n ;
+		return 0 ;
+	}
+	switch ( transfer->endpoint ) {
+		case DS2490_EP2:
+			ck_assert_int_le( fake.out_count + transfer->length, FAKE_FIFO ) ;
+			memcpy( &fake.out[fake.out_count], transfer->buffer, transfer->length ) ;
+			fake.out_count += transfer->length ;
+			return transfer->length ;
+		case DS2490_EP3:
+			n = ( (size_t) transfer->length < fake.in_count ) ? (size_t) transfer->length : fake.in_count ;
+			memcpy( transfer->buffer, fake.in, n ) ;
+			memmove( fake.in, &fake.in[n], fake.in_count - n ) ;
+			fake.in_count -= n ;
+			return n ;
+		case DS2490_EP1:
+			memset( transfer->buffer, 0, transfer->length ) ;
+			transfer->buffer[8] = STATUSFLAGS_IDLE ;
+			transfer->buffer[13] = fake.in_count > 255 ? 255 : fake.in_count ;
+			return DS9490_getstatus_BUFFER ;
+		default:
+			return 0 ;
+	}
+}
+
+int LIBUSB_CALL libusb_control_transfer(libusb_device_handle *dev_handle, uint8_t request_type, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, unsigned char *data, uint16_t wLength, unsigned int timeout)
+{
+	(void) dev_handle ;
+	(void) request_type ;
+	(void) wIndex ;
+	(void) data ;
+	(void) wLength ;
+	(void) timeout ;
+	if ( bRequest == CONTROL_CMD && wValue == CTL_RESET_DEVICE ) {
+		++fake.resets ;
+	}
+	return 0 ;
+}
+
+const char * LIBUSB_CALL libusb_error_name(int errcode)
+{
+	(void) errcode ;
+	return "fake" ;
+}
+
+struct libusb_transfer * LIBUSB_CALL libusb_alloc_transfer(int iso_packets)
+{
+	(void) iso_packets ;
+	if ( ++fake.allocs == fake.alloc_fail ) {
+		return NULL ;
+	}
+	++fake.allocated ;
+	return calloc( 1, sizeof(struct libusb_transfer) ) ;
+}
+
+void LIBUSB_CALL libusb_free_transfer(struct libusb_transfer *transfer)
+{
+	int i ;
+
+	for ( i = 0 ; i < fake.pending_count ; ++i ) {
+		ck_assert_msg( fake.pending[i] != transfer, "transfer freed before its callback" ) ;
+	}
+	--fake.allocated ;
+	free( transfer ) ;
+}
+
+int LIBUSB_CALL libusb_submit_transfer(struct libusb_transfer *transfer)
+{
+	if ( ++fake.submits == fake.submit_fail || fake.pending_count == FAKE_TRANSFERS ) {
+		return LIBUSB_ERROR_IO ;
+	}
+	transfer->status = LIBUSB_TRANSFER_COMPLETED ;
+	fake.pending[fake.pending_count] = transfer ;
+	++fake.pending_count ;
+	return 0 ;
+}
+
+int LIBUSB_CALL libusb_cancel_transfer(struct libusb_transfer *transfer)
+{
+	int i ;
+
+	for ( i = 0 ; i < fake.pending_count ; ++i ) {
+		if ( fake.pending[i] == transfer ) {
+			transfer->status = LIBUSB_TRANSFER_CANCELLED ;
+			return 0 ;
+		}
+	}
+	return LIBUSB_ERROR_NOT_FOUND ;
+}
+
+// call back the first transfer that is done
+int LIBUSB_CALL libusb_handle_events_timeout_completed(libusb_context *ctx, struct timeval *tv, int *completed)
+{
+	struct libusb_transfer * transfer = NULL ;
+	int i ;
+
+	(void) ctx ;
+	(void) tv ;
+	if ( completed != NULL && completed[0] ) {
+		return 0 ;
+	}
+	if ( fake.events >= fake.error_after && fake.event_errors > 0 ) {
+		--fake.event_errors ;
+		return LIBUSB_ERROR_IO ;
+	}
+	++fake.events ;
+	for ( i = 0 ; i < fake.pending_count ; ++i ) {
+		struct libusb_transfer * t = fake.pending[i] ;
+		if ( ! fake.hold || t->endpoint != DS2490_EP1 || t->status == LIBUSB_TRANSFER_CANCELLED ) {
+			transfer = t ;
+			break ;
+		}
+	}
+	ck_assert_msg( transfer != NULL, "waiting with nothing to call back" ) ;
+	--fake.pending_count ;
+	memmove( &fake.pending[i], &fake.pending[i+1], ( fake.pending_count - i ) * sizeof(struct libusb_transfer *) ) ;
+
+	if ( transfer->status == LIBUSB_TRANSFER_COMPLETED ) {
+		transfer->actual_length = fake_perform( transfer ) ;
+	} else {
+		transfer->actual_length = 0 ;
+	}
+	transfer->callback( transfer ) ;
+	return 0 ;
+}
+
+// sendback of size bytes on a fresh fake adapter
+static GOOD_OR_BAD usb_async_sendback( size_t size, BYTE * data, BYTE * resp )
+{
+	struct connection_in in ;
+	struct parsedname pn ;
+	size_t i ;
+
+	memset( &in, 0, sizeof(struct connection_in) ) ;
+	in.master.usb.lusb_handle = (libusb_device_handle *) &fake ; // any non-NULL handle
+	in.master.usb.timeout = 5000 ;
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	pn.selected_connection = &in ;
+
+	for ( i = 0 ; i < size ; ++i ) {
+		data[i] = BYTE_MASK( i * 7 + 1 ) ;
+	}
+	memset( resp, 0, size ) ;
+	return DS9490_sendback_async( data, resp, size, FAKE_BLOCK_IO, &pn ) ;
+}
+
+static void usb_async_setup( void )
+{
+	owlib_test_setup() ;
+	memset( &fake, 0, sizeof(fake) ) ;
+}
+
+// nothing left in flight or allocated
+static void usb_async_drained( void )
+{
+	ck_assert_int_eq( 0, fake.pending_count ) ;
+	ck_assert_int_eq( 0, fake.allocated ) ;
+}
+
+// Blocks overlap in the FIFOs and all come back, in order
+START_TEST(test_usb_async_echo)
+{
+	static const size_t sizes[] = { 1, USB_FIFO_EACH, USB_FIFO_EACH + 1, 300, } ;
+	BYTE data[300] ;
+	BYTE resp[300] ;
+	size_t i ;
+
+	for ( i = 0 ; i < sizeof(sizes) / sizeof(sizes[0]) ; ++i ) {
+		memset( &fake, 0, sizeof(fake) ) ;
+		ck_assert( GOOD( usb_async_sendback( sizes[i], data, resp ) ) ) ;
+		ck_assert( memcmp( data, resp, sizes[i] ) == 0 ) ;
+		ck_assert_int_eq( 0, fake.resets ) ;
+		usb_async_drained() ;
+	}
+}
+END_TEST
+
+// A transfer that can't be allocated fails the call, none is submitted
+START_TEST(test_usb_async_alloc_failure)
+{
+	BYTE data[100] ;
+	BYTE resp[100] ;
+	int fail ;
+
+	for ( fail = 1 ; fail <= 4 ; ++fail ) {
+		memset( &fake, 0, sizeof(fake) ) ;
+		fake.alloc_fail = fail ;
+		ck_assert( BAD( usb_async_sendback( sizeof(data), data, resp ) ) ) ;
+		ck_assert_int_eq( 0, fake.submits ) ;
+		usb_async_drained() ;
+	}
+}
+END_TEST
+
+// A submission refused midway: what is in flight is cancelled and waited for
+START_TEST(test_usb_async_submit_failure)
+{
+	BYTE data[200] ;
+	BYTE resp[200] ;
+	int fail ;
+
+	for ( fail = 1 ; fail <= 8 ; ++fail ) {
+		memset( &fake, 0, sizeof(fake) ) ;
+		fake.submit_fail = fail ;
+		ck_assert( BAD( usb_async_sendback( sizeof(data), data, resp ) ) ) ;
+		usb_async_drained() ;
+	}
+}
+END_TEST
+
+// Event handling starts failing with transfers in flight: they are
+// cancelled, and not freed until the cancellations have been called back
+START_TEST(test_usb_async_cancel_drain)
+{
+	BYTE data[200] ;
+	BYTE resp[200] ;
+	int after ;
+
+	for ( after = 0 ; after <= 3 ; ++after ) {
+		memset( &fake, 0, sizeof(fake) ) ;
+		fake.error_after = after ;
+		fake.event_errors = 12 ; // past the point of giving up (10)
+		ck_assert( BAD( usb_async_sendback( sizeof(data), data, resp ) ) ) ;
+		ck_assert_int_eq( 0, fake.event_errors ) ;
+		usb_async_drained() ;
+	}
+}
+END_TEST
+
+// The adapter never answers a status request: cancelled, and waited for
+START_TEST(test_usb_async_silent)
+{
+	BYTE data[200] ;
+	BYTE resp[200] ;
+
+	fake.hold = 1 ;
+	fake.error_after = 3 ; // a block written, started and polled for
+	fake.event_errors = 1 ;
+	ck_assert( BAD( usb_async_sendback( sizeof(data), data, resp ) ) ) ;
+	usb_async_drained() ;
+}
+END_TEST
+
+#endif /* OW_USB */
+
+// Create test-suite
+Suite* ow_usb_async_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("usb_async");
+
+#if OW_USB
+	tcase_add_checked_fixture(tc, usb_async_setup, owlib_test_teardown);
+	tcase_add_test(tc, test_usb_async_echo);
+	tcase_add_test(tc, test_usb_async_alloc_failure);
+	tcase_add_test(tc, test_usb_async_submit_failure);
+	tcase_add_test(tc, test_usb_async_cancel_drain);
+	tcase_add_test(tc, test_usb_async_silent);
+#endif /* OW_USB */
+	suite_add_tcase (s, tc);
+	return s;
+}
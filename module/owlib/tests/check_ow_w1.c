@@ -0,0 +1,265 @@
+#include "ow_testhelper.h"
+#include "ow_connection.h"
+
+#if OW_W1
+#include "ow_w1.h"
+#include <sys/socket.h>
+
+// w1 kernel bus masters with --w1_multiplex, on a netlink stand-in
+//
+// The monitor's netlink socket is one end of a datagram socketpair, a
+// thread on the other end plays the kernel. It answers every W1_MASTER_CMD
+// after a delay taken from the first data byte (FAKE_TICK_US units), with
+// the data XOR'ed by the bus master number, so each reply shows where it
+// went. The real dispatch thread routes the replies.
+//
+// Tests don't fork, so the stand-in is set up once and stays.
+
+#define FAKE_TICK_US	50000
+#define FAKE_SIZE	4
+
+static struct {
+	int kernel ;					// "kernel" end of the socketpair
+	struct port_in pin ;			// w1 monitor
+	struct connection_in in ;
+} fake ;
+
+static pthread_once_t fake_once = PTHREAD_ONCE_INIT ;
+
+struct fake_reply {
+	useconds_t delay ;
+	size_t length ;
+	BYTE buffer[0] ;
+} ;
+
+static void * fake_reply( void * v )
+{
+	struct fake_reply * reply = v ;
+
+	pthread_detach( pthread_self() ) ;
+	usleep( reply->delay ) ;
+	send( fake.kernel, reply->buffer, reply->length, 0 ) ;
+	free( reply ) ;
+	return NULL ;
+}
+
+static void * fake_kernel( void * v )
+{
+	BYTE buffer[1024] ;
+
+	(void) v ;
+	while ( 1 ) {
+		ssize_t length = recv( fake.kernel, buffer, sizeof(buffer), 0 ) ;
+		struct fake_reply * reply ;
+		struct nlmsghdr * nlm ;
+		struct w1_netlink_msg * w1m ;
+		struct w1_netlink_cmd * w1c ;
+		pthread_t thread ;
+		int i ;
+
+		if ( length < 0 ) {
+			return NULL ;
+		}
+		nlm = (struct nlmsghdr *) buffer ;
+		w1m = (struct w1_netlink_msg *) ((struct cn_msg *) NLMSG_DATA(nlm))->data ;
+		if ( w1m->type != W1_MASTER_CMD ) {
+			continue ; // no kernel bus masters to list
+		}
+
+		reply = malloc( sizeof(struct fake_reply) + length ) ;
+		reply->length = length ;
+		memcpy( reply->buffer, buffer, length ) ;
+		nlm = (struct nlmsghdr *) reply->buffer ;
+		nlm->nlmsg_pid = 0 ;
+		w1m = (struct w1_netlink_msg *) ((struct cn_msg *) NLMSG_DATA(nlm))->data ;
+		w1m->status = 0 ;
+		w1c = (struct w1_netlink_cmd *) w1m->data ;
+		reply->delay = ( w1c->len > 0 ) ? w1c->data[0] * FAKE_TICK_US : 0 ;
+		for ( i = 0 ; i < w1c->len ; ++i ) {
+			w1c->data[i] ^= NL_BUS( nlm->nlmsg_seq ) ;
+		}
+		if ( pthread_create( &thread, NULL, fake_reply, reply ) != 0 ) {
+			free( reply ) ;
+		}
+	}
+}
+
+static void fake_setup( void )
+{
+	int sv[2] ;
+	pthread_t thread ;
+
+	if ( socketpair( AF_UNIX, SOCK_DGRAM, 0, sv ) != 0 ) {
+		return ;
+	}
+	fake.kernel = sv[1] ;
+	fake.in.pown = &fake.pin ;
+	fake.pin.first = &fake.in ;
+	fake.pin.file_descriptor = sv[0] ;
+	_MUTEX_INIT( fake.in.master.w1_monitor.seq_mutex ) ;
+	_MUTEX_INIT( fake.in.master.w1_monitor.read_mutex ) ;
+	timernow( &fake.in.master.w1_monitor.last_read ) ;
+	fake.in.master.w1_monitor.seq = SEQ_INIT ;
+	fake.in.master.w1_monitor.pid = 0 ;
+	Inbound_Control.w1_monitor = &fake.in ;
+
+	pthread_create( &thread, NULL, fake_kernel, NULL ) ;
+	pthread_create( &thread, NULL, W1_Dispatch, NULL ) ;
+}
+
+static struct port_in * fake_open( int id )
+{
+	struct port_in * pin ;
+
+	pthread_once( &fake_once, fake_setup ) ;
+	ck_assert_ptr_eq( &fake.in, Inbound_Control.w1_monitor ) ;
+
+	Globals.w1_multiplex = 1 ;
+	pin = NewPort( NULL ) ;
+	ck_assert_ptr_ne( NULL, pin ) ;
+	ck_assert_int_eq( gbGOOD, W1_detect( pin ) ) ;
+	ck_assert_int_eq( FILE_DESCRIPTOR_BAD, pin->first->master.w1.netlink_pipe[fd_pipe_read] ) ;
+	pin->first->master.w1.id = id ;
+	return pin ;
+}
+
+static void fake_close( struct port_in * pin )
+{
+	RemovePort( pin ) ;
+	Globals.w1_multiplex = 0 ;
+}
+
+struct fake_call {
+	struct connection_in * in ;
+	BYTE data[FAKE_SIZE] ;
+	BYTE resp[FAKE_SIZE] ;
+	GOOD_OR_BAD ret ;
+	struct timeval done ;
+} ;
+
+static void fake_call_run( struct fake_call * call, BYTE ticks, BYTE fill )
+{
+	struct parsedname pn ;
+
+	memset( &pn, 0, sizeof(struct parsedname) ) ;
+	pn.selected_connection = call->in ;
+	memset( call->data, fill, FAKE_SIZE ) ;
+	call->data[0] = ticks ;
+	memset( call->resp, 0, FAKE_SIZE ) ;
+	call->ret = BUS_sendback_data( call->data, call->resp, FAKE_SIZE, &pn ) ;
+	timernow( &call->done ) ;
+}
+
+// reply came back from this call's bus master
+static void fake_call_check( struct fake_call * call )
+{
+	int i ;
+
+	ck_assert_int_eq( gbGOOD, call->ret ) ;
+	for ( i = 0 ; i < FAKE_SIZE ; ++i ) {
+		ck_assert_int_eq( call->data[i] ^ call->in->master.w1.id, call->resp[i] ) ;
+	}
+}
+
+static void * fake_slow_call( void * v )
+{
+	fake_call_run( v, 10, 0x5A ) ; // 0.5 sec
+	return NULL ;
+}
+
+static long fake_msec( struct timeval * start, struct timeval * end )
+{
+	struct timeval diff ;
+	timersub( end, start, &diff ) ;
+	return diff.tv_sec * 1000 + diff.tv_usec / 1000 ;
+}
+
+START_TEST(test_w1_parallel_masters)
+{
+	struct port_in * slow_pin = fake_open( 1 ) ;
+	struct port_in * fast_pin = fake_open( 2 ) ;
+	struct fake_call slow = { slow_pin->first, } ;
+	struct fake_call fast = { fast_pin->first, } ;
+	struct timeval start ;
+	pthread_t thread ;
+
+	timernow( &start ) ;
+	ck_assert_int_eq( 0, pthread_create( &thread, NULL, fake_slow_call, &slow ) ) ;
+	usleep( FAKE_TICK_US ) ;
+	fake_call_run( &fast, 0, 0x33 ) ;
+	pthread_join( thread, NULL ) ;
+
+	fake_call_check( &slow ) ;
+	fake_call_check( &fast ) ;
+	// the fast bus master isn't held up by the slow one
+	ck_assert( timercmp( &fast.done, &slow.done, < ) ) ;
+	ck_assert_int_lt( fake_msec( &start, &fast.done ), 5 * FAKE_TICK_US / 1000 ) ;
+
+	fake_close( fast_pin ) ;
+	fake_close( slow_pin ) ;
+}
+END_TEST
+
+START_TEST(test_w1_same_master)
+{
+	struct port_in * pin = fake_open( 3 ) ;
+	struct fake_call slow = { pin->first, } ;
+	struct fake_call fast = { pin->first, } ;
+	pthread_t thread ;
+
+	// two requests in flight on one bus master, replies out of order
+	ck_assert_int_eq( 0, pthread_create( &thread, NULL, fake_slow_call, &slow ) ) ;
+	usleep( FAKE_TICK_US ) ;
+	fake_call_run( &fast, 1, 0xC3 ) ;
+	pthread_join( thread, NULL ) ;
+
+	fake_call_check( &slow ) ;
+	fake_call_check( &fast ) ;
+	ck_assert( timercmp( &fast.done, &slow.done, < ) ) ;
+
+	fake_close( pin ) ;
+}
+END_TEST
+
+START_TEST(test_w1_late_reply)
+{
+	struct port_in * pin = fake_open( 4 ) ;
+	struct fake_call late = { pin->first, } ;
+	struct fake_call next = { pin->first, } ;
+	int timeout_w1 = Globals.timeout_w1 ;
+
+	// times out after 2 sec (1 sec, and 1 more while there was traffic)
+	Globals.timeout_w1 = 1 ;
+	fake_call_run( &late, 60, 0x11 ) ;
+	ck_assert_int_eq( gbBAD, late.ret ) ;
+	Globals.timeout_w1 = timeout_w1 ;
+
+	// the late reply is dropped, not taken as the next one
+	usleep( 30 * FAKE_TICK_US ) ;
+	fake_call_run( &next, 0, 0x22 ) ;
+	fake_call_check( &next ) ;
+
+	fake_close( pin ) ;
+}
+END_TEST
+
+#endif /* OW_W1 */
+
+// Create test-suite
+Suite* ow_w1_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("w1");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	tcase_set_timeout(tc, 10);
+	suite_add_tcase (s, tc);
+#if OW_W1
+	tcase_add_test(tc, test_w1_parallel_masters);
+	tcase_add_test(tc, test_w1_same_master);
+	tcase_add_test(tc, test_w1_late_reply);
+#endif /* OW_W1 */
+	return s;
+}
@@ -13,6 +13,7 @@ static void LockTeardown();
  */
 void owlib_test_setup(void) {
 	LockSetup();
+	Pool_Open();
 	Cache_Open();
 	Detail_Init();
 	DeviceSort();
@@ -27,6 +28,7 @@ void owlib_test_teardown(void) {
 		owq = NULL;
 	}
 	LockTeardown();
+	Pool_Close();
 	Detail_Close();
 }
 
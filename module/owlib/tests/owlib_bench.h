@@ -0,0 +1,17 @@
+#ifndef OWFS_OWBENCH_H
+#define OWFS_OWBENCH_H
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+
+void owlib_bench_setup(void);
+void owlib_bench_teardown(void);
+
+// Wall clock in seconds, for timing a benchmark loop
+double owlib_bench_now(void);
+
+// One result line: name, operations and elapsed seconds
+void owlib_bench_report(const char * name, UINT operations, double seconds);
+
+#endif //OWFS_OWBENCH_H
@@ -8,9 +8,35 @@
  */
 
 _DEFINE_SUITE(ow_parseinput_suite);
+_DEFINE_SUITE(ow_parseoutput_suite);
+_DEFINE_SUITE(ow_cache_suite);
+_DEFINE_SUITE(ow_alloc_suite);
+_DEFINE_SUITE(ow_parsename_suite);
+_DEFINE_SUITE(ow_ds2482_suite);
+_DEFINE_SUITE(ow_w1_suite);
+_DEFINE_SUITE(ow_dir_suite);
+_DEFINE_SUITE(ow_search_suite);
+_DEFINE_SUITE(ow_net_server_suite);
+_DEFINE_SUITE(ow_server_message_suite);
+_DEFINE_SUITE(ow_port_worker_suite);
+_DEFINE_SUITE(ow_pages_suite);
+_DEFINE_SUITE(ow_usb_async_suite);
 
 static void setup_test_suites(SRunner *runner) {
 	_INCLUDE_SUITE(ow_parseinput_suite);
+	_INCLUDE_SUITE(ow_parseoutput_suite);
+	_INCLUDE_SUITE(ow_cache_suite);
+	_INCLUDE_SUITE(ow_alloc_suite);
+	_INCLUDE_SUITE(ow_parsename_suite);
+	_INCLUDE_SUITE(ow_ds2482_suite);
+	_INCLUDE_SUITE(ow_w1_suite);
+	_INCLUDE_SUITE(ow_dir_suite);
+	_INCLUDE_SUITE(ow_search_suite);
+	_INCLUDE_SUITE(ow_net_server_suite);
+	_INCLUDE_SUITE(ow_server_message_suite);
+	_INCLUDE_SUITE(ow_port_worker_suite);
+	_INCLUDE_SUITE(ow_pages_suite);
+	_INCLUDE_SUITE(ow_usb_async_suite);
 }
 
 int main(void)
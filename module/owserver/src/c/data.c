@@ -44,6 +44,7 @@ void *DataHandler(void *v)
 {
 	struct handlerdata *hd = v;
 	char *retbuffer = NULL;
+	char read_buffer[OWSERVER_READ_BUFFER_SIZE]; // most values are read straight into this
 	struct client_msg cm; // the return message
 
 #if OW_CYGWIN
@@ -142,7 +143,7 @@ void *DataHandler(void *v)
 				break;
 			case msg_read:
 				LEVEL_CALL("Read message");
-				retbuffer = ReadHandler(hd, &cm, owq);
+				retbuffer = ReadHandler(hd, &cm, owq, read_buffer, sizeof(read_buffer));
 				LEVEL_DEBUG("Read message done value=%p", retbuffer);
 				break;
 			case msg_write:
@@ -173,7 +174,7 @@ void *DataHandler(void *v)
 					retbuffer = DirallHandler(hd, &cm, pn);
 				} else {
 					LEVEL_CALL("Get -> Read message");
-					retbuffer = ReadHandler(hd, &cm, owq);
+					retbuffer = ReadHandler(hd, &cm, owq, read_buffer, sizeof(read_buffer));
 				}
 				break;
 			case msg_getslash:
@@ -182,7 +183,7 @@ void *DataHandler(void *v)
 					retbuffer = DirallslashHandler(hd, &cm, pn);
 				} else {
 					LEVEL_CALL("Get -> Read message");
-					retbuffer = ReadHandler(hd, &cm, owq);
+					retbuffer = ReadHandler(hd, &cm, owq, read_buffer, sizeof(read_buffer));
 				}
 				break;
 			default:			// never reached
@@ -193,6 +194,15 @@ void *DataHandler(void *v)
 			LEVEL_DEBUG("DataHandler: FS_ParsedName_destroy done");
 		}
 		break;
+	case msg_readmany:			// good message
+		if (hd->sm.payload == 0) {	/* Bad query -- no paths */
+			LEVEL_DEBUG("No payload -- ignore.") ;
+			cm.ret = -EBADMSG;
+		} else {
+			LEVEL_CALL("Read many message");
+			retbuffer = ReadmanyHandler(hd, &cm);
+		}
+		break;
 	case msg_nop:				// "bad" message
 		LEVEL_CALL("NOP message");
 		cm.ret = 0;
@@ -208,7 +218,7 @@ void *DataHandler(void *v)
 
 	TOCLIENTLOCK(hd);
 	if (cm.ret != -EIO) {
-		ToClient(hd->file_descriptor, &cm, retbuffer);
+		ToClient(hd, &cm, retbuffer);
 	} else {
 		ErrorToClient(hd, &cm) ;
 	}
@@ -220,7 +230,7 @@ void *DataHandler(void *v)
 	}
 	TOCLIENTUNLOCK(hd);
 
-	if (retbuffer) {
+	if (retbuffer && retbuffer != read_buffer) {
 		owfree(retbuffer);
 	}
 	LEVEL_DEBUG("Finished with client request");
@@ -62,6 +62,17 @@ int FromClient(struct handlerdata *hd)
 	hd->sm.size = ntohl(hd->sm.size);
 	hd->sm.offset = ntohl(hd->sm.offset);
 
+	/* pipelined requests carry an id after the header */
+	if ( hd->pipeline != NULL ) {
+		uint32_t network_order_id ;
+		tcp_read(hd->file_descriptor, (BYTE *) &network_order_id, sizeof(uint32_t), &tv, &actual_read) ;
+		if (actual_read != sizeof(uint32_t)) {
+			hd->sm.type = msg_error;
+			return -EIO;
+		}
+		hd->request_id = ntohl(network_order_id) ;
+	}
+
 	LEVEL_DEBUG("FromClient payload=%d size=%d type=%d sg=0x%X offset=%d", hd->sm.payload, hd->sm.size, hd->sm.type, hd->sm.control_flags, hd->sm.offset);
 
 	/* figure out length of rest of message: payload plus tokens */
@@ -40,7 +40,22 @@
 int persistent_connections = 0;
 int handler_count = 0 ;
 
+/* One connection in the event loop, kept between its requests */
+struct handler_connection {
+	int persistent ;
+	int pipelined ;
+	struct pipeline pipeline ;
+} ;
+
+static int PersistenceGrant(struct handlerdata *hd, int *persistent);
+static void PersistenceRelease(int persistent);
 static void SingleHandler(struct handlerdata *hd);
+static GOOD_OR_BAD PersistentWait(FILE_DESCRIPTOR_OR_ERROR file_descriptor, const struct timeval * tv_low, const struct timeval * tv_high);
+static void PipelineHandler(struct handlerdata *hd_first, const struct timeval * tv_low, const struct timeval * tv_high);
+static void PipelineStart(struct pipeline *pl, FILE_DESCRIPTOR_OR_ERROR file_descriptor);
+static void PipelineStop(struct pipeline *pl);
+static GOOD_OR_BAD PipelineQueue(struct pipeline *pl, struct handlerdata *hd);
+static void PipelineDrain(struct pipeline *pl, int limit);
 
 /*
  * Main routine for actually handling a request
@@ -54,86 +69,174 @@ void Handler(FILE_DESCRIPTOR_OR_ERROR file_descriptor)
 	int persistent = 0;
 
 	hd.file_descriptor = file_descriptor;
+	hd.pipeline = NULL;
+	hd.request_id = 0;
 	_MUTEX_INIT(hd.to_client);
 
 	timersub(&tv_high, &tv_low, &tv_high);	// just the delta
 
 	while (FromClient(&hd) == 0) {
-		// Was persistence requested?
-		int loop_persistent = ((hd.sm.control_flags & PERSISTENT_MASK) != 0);
-
-		/* Persistence suppression? */
-		if (Globals.no_persistence) {
-			loop_persistent = 0;
+		int loop_persistent = PersistenceGrant(&hd, &persistent);
+
+		/* Pipelining needs a persistent connection */
+		hd.sm.control_flags &= ~PIPELINE_GRANTED;
+		if (loop_persistent && (hd.sm.control_flags & PIPELINE_REQUEST) && Globals.no_pipeline == 0) {
+			LEVEL_DEBUG("Pipelining granted");
+			hd.sm.control_flags |= PIPELINE_GRANTED;
+			/* This request is answered the usual way, the rest carry ids */
+			SingleHandler(&hd);
+			PipelineHandler(&hd, &tv_low, &tv_high);
+			break;
 		}
 
-		/* Persistence logic */
-		if (loop_persistent) {	/* Requested persistence */
-			LEVEL_DEBUG("Persistence requested");
-			if (persistent) {	/* already had persistence granted */
-				hd.persistent = 1;	/* so keep it */
-			} else {			/* See if available */
+		/* Do the real work */
+		SingleHandler(&hd);
 
-				PERSISTENCELOCK;
+		/* Now see if we should reloop */
+		if (loop_persistent == 0) {
+			break;				/* easiest one */
+		}
 
-				if (persistent_connections < Globals.clients_persistent_high) {	/* ok */
-					++persistent_connections;	/* global count */
-					persistent = 1;	/* connection toggle */
-					hd.persistent = 1;	/* for responses */
-				} else {
-					loop_persistent = 0;	/* denied! */
-					hd.persistent = 0;	/* for responses */
-				}
+		if ( BAD( PersistentWait(file_descriptor, &tv_low, &tv_high) ) ) {
+			break;
+		}
 
-				PERSISTENCEUNLOCK;
+		LEVEL_DEBUG("OWSERVER tcp connection persistence -- reusing connection now.");
+	}
 
-			}
-		} else {				/* No persistence requested this time */
-			hd.persistent = 0;	/* for responses */
+	LEVEL_DEBUG("OWSERVER handler done");
+	_MUTEX_DESTROY(hd.to_client);
+	// restore the persistent count
+	PersistenceRelease(persistent);
+}
+
+/*
+ * Event loop (--server_workers): one request per call. A kept connection
+ * goes back to the loop to wait for the next request rather than holding
+ * this worker. Pipelined reads are handed to the connection's own threads
+ * as in PipelineHandler, so the loop can pick up the next request while
+ * they are answered.
+ */
+GOOD_OR_BAD HandlerRequest(FILE_DESCRIPTOR_OR_ERROR file_descriptor, void ** state)
+{
+	struct handler_connection *hc = state[0];
+	struct handlerdata *hd;
+	int loop_persistent;
+
+	if (hc == NULL) {
+		hc = owcalloc(1, sizeof(struct handler_connection));
+		if (hc == NULL) {
+			return gbBAD;
 		}
+		state[0] = hc;
+	}
+
+	// kept by a pipeline thread if queued
+	hd = owcalloc(1, sizeof(struct handlerdata));
+	if (hd == NULL) {
+		return gbBAD;
+	}
+	hd->file_descriptor = file_descriptor;
+	hd->pipeline = hc->pipelined ? &(hc->pipeline) : NULL;
+	_MUTEX_INIT(hd->to_client);
+
+	if (FromClient(hd) != 0) {
+		_MUTEX_DESTROY(hd->to_client);
+		owfree(hd);
+		return gbBAD;
+	}
 
-		/* now set the sg flag because it usually is copied back to the client */
-		if (loop_persistent) {
-			hd.sm.control_flags |= PERSISTENT_MASK;
+	if (hc->pipelined) {
+		loop_persistent = 1;
+		hd->persistent = 1;
+		hd->sm.control_flags |= PERSISTENT_MASK | PIPELINE_GRANTED;
+		if ((enum msg_classification) hd->sm.type == msg_read || (enum msg_classification) hd->sm.type == msg_readmany) {
+			PipelineDrain(&(hc->pipeline), PIPELINE_MAX_IN_FLIGHT - 1);
+			if ( GOOD( PipelineQueue(&(hc->pipeline), hd) ) ) {
+				return gbGOOD;
+			}
+			LEVEL_DEBUG("Will handle request unthreaded");
 		} else {
-			hd.sm.control_flags &= ~PERSISTENT_MASK;
+			PipelineDrain(&(hc->pipeline), 0);
+		}
+	} else {
+		loop_persistent = PersistenceGrant(hd, &(hc->persistent));
+		hd->sm.control_flags &= ~PIPELINE_GRANTED;
+		if (loop_persistent && (hd->sm.control_flags & PIPELINE_REQUEST) && Globals.no_pipeline == 0) {
+			LEVEL_DEBUG("Pipelining granted");
+			hd->sm.control_flags |= PIPELINE_GRANTED;
+			/* This request is answered the usual way, the rest carry ids */
+			PipelineStart(&(hc->pipeline), file_descriptor);
+			hc->pipelined = 1;
 		}
+	}
 
-		/* Do the real work */
-		SingleHandler(&hd);
+	SingleHandler(hd);
+	_MUTEX_DESTROY(hd->to_client);
+	owfree(hd);
+	return loop_persistent ? gbGOOD : gbBAD;
+}
 
-		/* Now see if we should reloop */
-		if (loop_persistent == 0) {
-			break;				/* easiest one */
-		}
+/* Event loop connection closed */
+void HandlerRelease(void * state)
+{
+	struct handler_connection *hc = state;
 
-		/* Shorter wait */
-		if ( BAD(tcp_wait(file_descriptor, &tv_low)) ) {	// timed out
-			/* test if below threshold for longer wait */
+	if (hc->pipelined) {
+		PipelineStop(&(hc->pipeline));
+	}
+	PersistenceRelease(hc->persistent);
+	owfree(hc);
+}
 
-			PERSISTENCELOCK;
+/* Persistence for this request: granted while there is room for another
+ * persistent connection (counted once per connection in *persistent) */
+static int PersistenceGrant(struct handlerdata *hd, int *persistent)
+{
+	// Was persistence requested?
+	int loop_persistent = ((hd->sm.control_flags & PERSISTENT_MASK) != 0);
 
-			/* store the test because the mutex locks the variable */
-			loop_persistent = (persistent_connections < Globals.clients_persistent_low);
+	/* Persistence suppression? */
+	if (Globals.no_persistence) {
+		loop_persistent = 0;
+	}
 
-			PERSISTENCEUNLOCK;
+	/* Persistence logic */
+	if (loop_persistent) {	/* Requested persistence */
+		LEVEL_DEBUG("Persistence requested");
+		if (persistent[0]) {	/* already had persistence granted */
+			hd->persistent = 1;	/* so keep it */
+		} else {			/* See if available */
 
-			if (loop_persistent == 0) {
-				break;			/* too many connections and we're slow */
-			}
+			PERSISTENCELOCK;
 
-			/*  longer wait */
-			if ( BAD(tcp_wait(file_descriptor, &tv_high)) ) {
-				break;
+			if (persistent_connections < Globals.clients_persistent_high) {	/* ok */
+				++persistent_connections;	/* global count */
+				persistent[0] = 1;	/* connection toggle */
+				hd->persistent = 1;	/* for responses */
+			} else {
+				loop_persistent = 0;	/* denied! */
+				hd->persistent = 0;	/* for responses */
 			}
+
+			PERSISTENCEUNLOCK;
+
 		}
+	} else {				/* No persistence requested this time */
+		hd->persistent = 0;	/* for responses */
+	}
 
-		LEVEL_DEBUG("OWSERVER tcp connection persistence -- reusing connection now.");
+	/* now set the sg flag because it usually is copied back to the client */
+	if (loop_persistent) {
+		hd->sm.control_flags |= PERSISTENT_MASK;
+	} else {
+		hd->sm.control_flags &= ~PERSISTENT_MASK;
 	}
+	return loop_persistent;
+}
 
-	LEVEL_DEBUG("OWSERVER handler done");
-	_MUTEX_DESTROY(hd.to_client);
-	// restore the persistent count
+static void PersistenceRelease(int persistent)
+{
 	if (persistent) {
 
 		PERSISTENCELOCK;
@@ -174,3 +277,184 @@ static void SingleHandler(struct handlerdata *hd)
 		hd->sp.path = NULL;
 	}
 }
+
+/* Wait for the next request on a persistent connection */
+static GOOD_OR_BAD PersistentWait(FILE_DESCRIPTOR_OR_ERROR file_descriptor, const struct timeval * tv_low, const struct timeval * tv_high)
+{
+	int loop_persistent ;
+
+	/* Shorter wait */
+	if ( GOOD(tcp_wait(file_descriptor, tv_low)) ) {
+		return gbGOOD ;
+	}
+
+	/* timed out -- test if below threshold for longer wait */
+	PERSISTENCELOCK;
+
+	/* store the test because the mutex locks the variable */
+	loop_persistent = (persistent_connections < Globals.clients_persistent_low);
+
+	PERSISTENCEUNLOCK;
+
+	if (loop_persistent == 0) {
+		return gbBAD;			/* too many connections and we're slow */
+	}
+
+	/*  longer wait */
+	return tcp_wait(file_descriptor, tv_high) ;
+}
+
+/* One of a pipelined connection's threads, answers reads until it closes */
+static void *PipelineThread(void *v)
+{
+	struct pipeline *pl = v;
+
+	_MUTEX_LOCK(pl->count_mutex);
+	while (1) {
+		struct handlerdata *hd = pl->queue_head;
+
+		if (hd == NULL) {
+			if (pl->stop) {
+				break;
+			}
+			++pl->idle;
+			pthread_cond_wait(&pl->work_cond, &pl->count_mutex);
+			--pl->idle;
+			continue;
+		}
+		pl->queue_head = hd->pipeline_next;
+		if (pl->queue_head == NULL) {
+			pl->queue_tail = NULL;
+		}
+		--pl->queued;
+		_MUTEX_UNLOCK(pl->count_mutex);
+
+		SingleHandler(hd);
+		_MUTEX_DESTROY(hd->to_client);
+		owfree(hd);
+
+		_MUTEX_LOCK(pl->count_mutex);
+		--pl->in_flight;
+		pthread_cond_signal(&pl->count_cond);
+	}
+	_MUTEX_UNLOCK(pl->count_mutex);
+	return VOID_RETURN;
+}
+
+/* Hand a read to the connection's threads, starting another one if all are
+ * busy. gbBAD if there is no thread at all (answer it here) */
+static GOOD_OR_BAD PipelineQueue(struct pipeline *pl, struct handlerdata *hd)
+{
+	_MUTEX_LOCK(pl->count_mutex);
+	if (pl->queued >= pl->idle && pl->threads < PIPELINE_MAX_IN_FLIGHT) {
+		if (pthread_create(&(pl->thread[pl->threads]), DEFAULT_THREAD_ATTR, PipelineThread, pl) == 0) {
+			++pl->threads;
+		} else {
+			LEVEL_DEBUG("Thread creation problem. %d pipeline threads", pl->threads);
+		}
+	}
+	if (pl->threads == 0) {
+		_MUTEX_UNLOCK(pl->count_mutex);
+		return gbBAD;
+	}
+	hd->pipeline_next = NULL;
+	if (pl->queue_tail == NULL) {
+		pl->queue_head = hd;
+	} else {
+		pl->queue_tail->pipeline_next = hd;
+	}
+	pl->queue_tail = hd;
+	++pl->queued;
+	++pl->in_flight;
+	pthread_cond_signal(&pl->work_cond);
+	_MUTEX_UNLOCK(pl->count_mutex);
+	return gbGOOD;
+}
+
+/* Wait until at most "limit" requests are still being processed */
+static void PipelineDrain(struct pipeline *pl, int limit)
+{
+	_MUTEX_LOCK(pl->count_mutex);
+	while (pl->in_flight > limit) {
+		pthread_cond_wait(&pl->count_cond, &pl->count_mutex);
+	}
+	_MUTEX_UNLOCK(pl->count_mutex);
+}
+
+/* A pipelined connection's shared state, no threads until a read comes */
+static void PipelineStart(struct pipeline *pl, FILE_DESCRIPTOR_OR_ERROR file_descriptor)
+{
+	memset(pl, 0, sizeof(struct pipeline));
+	pl->file_descriptor = file_descriptor;
+	_MUTEX_INIT(pl->write_mutex);
+	_MUTEX_INIT(pl->count_mutex);
+	pthread_cond_init(&pl->count_cond, NULL);
+	pthread_cond_init(&pl->work_cond, NULL);
+}
+
+/* Connection done: answer what is queued, then end the threads */
+static void PipelineStop(struct pipeline *pl)
+{
+	int thread;
+
+	PipelineDrain(pl, 0);
+	_MUTEX_LOCK(pl->count_mutex);
+	pl->stop = 1;
+	pthread_cond_broadcast(&pl->work_cond);
+	_MUTEX_UNLOCK(pl->count_mutex);
+	for (thread = 0; thread < pl->threads; ++thread) {
+		pthread_join(pl->thread[thread], NULL);
+	}
+	pthread_cond_destroy(&pl->work_cond);
+	pthread_cond_destroy(&pl->count_cond);
+	_MUTEX_DESTROY(pl->count_mutex);
+	_MUTEX_DESTROY(pl->write_mutex);
+}
+
+/*
+ * Pipelined connection: every request and response header is followed by a
+ * 32 bit request id. Reads run concurrently and are answered as they finish,
+ * anything else waits for the reads in flight and runs alone, so a write is
+ * never reordered with the reads around it.
+ */
+static void PipelineHandler(struct handlerdata *hd_first, const struct timeval * tv_low, const struct timeval * tv_high)
+{
+	struct pipeline pl;
+
+	PipelineStart(&pl, hd_first->file_descriptor);
+
+	while ( GOOD( PersistentWait(pl.file_descriptor, tv_low, tv_high) ) ) {
+		struct handlerdata *hd = owcalloc(1, sizeof(struct handlerdata));
+
+		if (hd == NULL) {
+			break;
+		}
+		hd->file_descriptor = pl.file_descriptor;
+		hd->pipeline = &pl;
+		hd->persistent = 1;
+		_MUTEX_INIT(hd->to_client);
+
+		if (FromClient(hd) != 0) {
+			_MUTEX_DESTROY(hd->to_client);
+			owfree(hd);
+			break;
+		}
+		hd->sm.control_flags |= PERSISTENT_MASK | PIPELINE_GRANTED;
+
+		if ((enum msg_classification) hd->sm.type == msg_read || (enum msg_classification) hd->sm.type == msg_readmany) {
+			PipelineDrain(&pl, PIPELINE_MAX_IN_FLIGHT - 1);
+			if ( GOOD( PipelineQueue(&pl, hd) ) ) {
+				continue;
+			}
+			LEVEL_DEBUG("Will handle request unthreaded");
+		} else {
+			PipelineDrain(&pl, 0);
+		}
+
+		SingleHandler(hd);
+		_MUTEX_DESTROY(hd->to_client);
+		owfree(hd);
+	}
+
+	PipelineStop(&pl);
+}
@@ -39,6 +39,13 @@
 static void LoopCleanup(struct handlerdata *hd);
 static enum toclient_state Ping_or_Send( enum toclient_state last_toclient, struct handlerdata * hd );
 static GOOD_OR_BAD LoopSetup(struct handlerdata *hd) ;
+static void PingTimerLoop(struct handlerdata *hd) ;
+
+/* Requests in progress, for the shared ping timer */
+static struct handlerdata * ping_list = NULL ;
+static pthread_mutex_t ping_list_mutex ;
+static pthread_cond_t ping_sent_cond ; // a ping went out, the request may leave the list
+static int ping_timer_running = 0 ;
 
 static GOOD_OR_BAD LoopSetup(struct handlerdata *hd)
 {
@@ -136,6 +143,10 @@ static enum toclient_state Ping_or_Send( enum toclient_state last_toclient, stru
 void PingLoop(struct handlerdata *hd)
 {
 	enum toclient_state current_toclient = toclient_postping ;
+	if ( ping_timer_running && Globals.server_workers > 0 ) {
+		PingTimerLoop(hd) ;
+		return ;
+	}
 	if ( GOOD( LoopSetup(hd) ) ) {
 		pthread_t thread ;
 		
@@ -156,3 +167,116 @@ void PingLoop(struct handlerdata *hd)
 		LoopCleanup(hd);
 	}
 }
+
+/* Same keep-alive rules as Ping_or_Send, but all requests are checked
+ * from one thread every half second. No pipe or extra thread per request.
+ * The list lock only covers picking the requests due a ping, a slow client
+ * holds up its own request's end, not every request's start and end. */
+static void *PingTimer(void *v)
+{
+	(void) v ;
+	DETACH_THREAD;
+	while (1) {
+		struct timeval now ;
+		struct timeval tv = tv_short ;
+		struct handlerdata * hd ;
+		struct handlerdata * ping_send = NULL ;
+
+		select( 0, NULL, NULL, NULL, &tv ) ;
+		gettimeofday( &now, NULL ) ;
+
+		_MUTEX_LOCK( ping_list_mutex ) ;
+		for ( hd = ping_list ; hd != NULL ; hd = hd->ping_next ) {
+			TOCLIENTLOCK(hd);
+			switch ( hd->toclient ) {
+				case toclient_complete:
+					break ;
+				case toclient_postmessage:
+					LEVEL_DEBUG("Ping forestalled by a directory element");
+					hd->toclient = toclient_postping ;
+					timeradd( &now, &tv_long, &hd->ping_due ) ;
+					break ;
+				case toclient_postping:
+					if ( timercmp( &now, &hd->ping_due, >= ) ) {
+						hd->ping_sending = 1 ;
+						hd->ping_send_next = ping_send ;
+						ping_send = hd ;
+						timeradd( &now, &tv_long, &hd->ping_due ) ;
+					}
+					break ;
+			}
+			TOCLIENTUNLOCK(hd);
+		}
+		_MUTEX_UNLOCK( ping_list_mutex ) ;
+
+		while ( ping_send != NULL ) {
+			hd = ping_send ;
+			ping_send = hd->ping_send_next ;
+
+			TOCLIENTLOCK(hd);
+			if ( hd->toclient == toclient_postping ) {
+				// not answered meanwhile
+				LEVEL_DEBUG("Taking too long, send a keep-alive pulse");
+				PingClient(hd);	// send the ping
+			}
+			TOCLIENTUNLOCK(hd);
+
+			_MUTEX_LOCK( ping_list_mutex ) ;
+			hd->ping_sending = 0 ;
+			my_pthread_cond_broadcast( &ping_sent_cond ) ;
+			_MUTEX_UNLOCK( ping_list_mutex ) ;
+		}
+	}
+	return VOID_RETURN;
+}
+
+void PingTimerStart(void)
+{
+	pthread_t thread ;
+
+	_MUTEX_INIT( ping_list_mutex ) ;
+	my_pthread_cond_init( &ping_sent_cond, NULL ) ;
+	if ( pthread_create(&thread, DEFAULT_THREAD_ATTR, PingTimer, NULL) != 0 ) {
+		LEVEL_DEBUG("Cannot start the ping timer, one ping thread per request");
+		return ;
+	}
+	ping_timer_running = 1 ;
+}
+
+/* Run the request in this thread, the timer pings meanwhile */
+static void PingTimerLoop(struct handlerdata *hd)
+{
+	struct timeval now ;
+
+	Init_Pipe( hd->ping_pipe ) ; // no pipe to signal
+	hd->toclient = toclient_postping ;
+	gettimeofday( &now, NULL ) ;
+	timeradd( &now, &tv_long, &hd->ping_due ) ;
+	hd->ping_sending = 0 ;
+
+	_MUTEX_LOCK( ping_list_mutex ) ;
+	hd->ping_prev = NULL ;
+	hd->ping_next = ping_list ;
+	if ( ping_list != NULL ) {
+		ping_list->ping_prev = hd ;
+	}
+	ping_list = hd ;
+	_MUTEX_UNLOCK( ping_list_mutex ) ;
+
+	DataHandler(hd);
+
+	_MUTEX_LOCK( ping_list_mutex ) ;
+	while ( hd->ping_sending ) {
+		// the timer is pinging this client right now
+		my_pthread_cond_wait( &ping_sent_cond, &ping_list_mutex ) ;
+	}
+	if ( hd->ping_prev == NULL ) {
+		ping_list = hd->ping_next ;
+	} else {
+		hd->ping_prev->ping_next = hd->ping_next ;
+	}
+	if ( hd->ping_next != NULL ) {
+		hd->ping_next->ping_prev = hd->ping_prev ;
+	}
+	_MUTEX_UNLOCK( ping_list_mutex ) ;
+}
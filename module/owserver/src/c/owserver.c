@@ -99,7 +99,13 @@ int main(int argc, char **argv)
 	/* Set up "Antiloop" -- a unique token */
 	SetupAntiloop();
 
+	/* Pings come from one timer thread rather than one per request */
+	if ( Globals.server_workers > 0 ) {
+		PingTimerStart() ;
+	}
+
 	/* Call up main processing routine -- waits for network queries */
+	ServerRequestRoutines( HandlerRequest, HandlerRelease ) ;
 	ServerProcess( Handler );
 	LEVEL_DEBUG("ServerProcess done");
 
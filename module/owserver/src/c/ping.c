@@ -51,5 +51,5 @@ struct client_msg ping_cm = {
 
 void PingClient(struct handlerdata *hd)
 {
-		ToClient(hd->file_descriptor, &ping_cm, NULL);	// send the ping
+		ToClient(hd, &ping_cm, NULL);	// send the ping
 }
@@ -40,13 +40,15 @@
 /* path is path, already parsed, and null terminated */
 /* sm has been read, cm has been zeroed */
 /* pn is configured */
+/* buffer (buffer_size bytes) is where the caller wants the value */
 /* Read, will return: */
 /* cm fully constructed */
-/* a malloc'ed string, that must be free'd by Handler */
+/* the value, in buffer if it fits, else a malloc'ed string */
+/*   (anything but buffer must be free'd by Handler) */
 /* The length of string is cm.payload */
 /* If cm.payload is 0, then a NULL string is returned */
 /* cm.ret is also set to an error <0 or the read length */
-void *ReadHandler(struct handlerdata *hd, struct client_msg *cm, struct one_wire_query *owq)
+void *ReadHandler(struct handlerdata *hd, struct client_msg *cm, struct one_wire_query *owq, char *buffer, size_t buffer_size)
 {
 	BYTE * retbuffer = NULL ;
 	SIZE_OR_ERROR read_or_error;
@@ -64,12 +66,20 @@ void *ReadHandler(struct handlerdata *hd, struct client_msg *cm, struct one_wire
 	} else if ((hd->sm.size <= 0) || (hd->sm.size > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE)) {
 		cm->ret = -EMSGSIZE;
 		LEVEL_DEBUG("ReadHandler: error hd->sm.size == %d", hd->sm.size);
-	} else if ( BAD( OWQ_allocate_read_buffer(owq)) ) {	// allocate read buffer
-		LEVEL_DEBUG("ReadHandler: can't allocate memory");
-		cm->ret = -ENOBUFS;
 	} else {
 		struct parsedname *pn = PN(owq);
 
+		if ( buffer != NULL && FullFileLength(pn) < buffer_size ) {
+			// the value is read (formatted) right where it is sent from,
+			// with all of buffer: a number needs a little more than its length
+			memset( buffer, 0, FullFileLength(pn) + 1 ) ;
+			OWQ_assign_read_buffer( buffer, buffer_size, 0, owq ) ;
+		} else if ( BAD( OWQ_allocate_read_buffer(owq)) ) {	// allocate read buffer
+			LEVEL_DEBUG("ReadHandler: can't allocate memory");
+			cm->ret = -ENOBUFS;
+			return NULL ;
+		}
+
 		if ( OWQ_size(owq) > (size_t) hd->sm.size ) {
 			OWQ_size(owq) = hd->sm.size ;
 		}
@@ -0,0 +1,302 @@
+/*
+    OW_HTML -- OWFS used for the web
+    OW -- One-Wire filesystem
+
+    Written 2004 Paul H Alfille
+
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* owserver -- responds to requests over a network socket, and processes them on the 1-wire bus/
+         Basic idea: control the 1-wire bus and answer queries over a network socket
+         Clients can be owperl, owfs, owhttpd, etc...
+         Clients can be local or remote
+                 Eventually will also allow bounce servers.
+
+         syntax:
+                 owserver
+                 -u (usb)
+                 -d /dev/ttyS1 (serial)
+                 -p tcp port
+                 e.g. 3001 or 10.183.180.101:3001 or /tmp/1wire
+*/
+
+#include "owserver.h"
+#include "ow_counters.h"
+
+/* Readmany, called from DataHandler */
+/* payload is a list of paths, each null terminated */
+/* sm.size is the largest value wanted for each path */
+/* Readmany will return: */
+/* cm.ret the number of paths read or an error <0 */
+/* a malloc'ed buffer, that must be free'd by Handler */
+/*   for each path, in order: a 32 bit status (network order) */
+/*   which is the value length or an error <0, then the value */
+/* The values are read straight into that buffer, each in a slot of its */
+/* longest length, and only moved up if an earlier one came out shorter */
+
+/* Room a read may use past its slot: a number is formatted in place only
+ * with its length plus 2 (uClibc, see ow_parseoutput.c). That is in the
+ * next status, which is filled in last */
+#define READMANY_SLOT_PADDING	2
+
+/* Paths on the same bus are read one after the other by the port's
+ * worker thread, different buses at the same time */
+struct readmany_group {
+	struct connection_in * in ; // NULL -- bus not known yet
+	struct one_wire_query ** owq ; // this group's reads, in request order
+	int count ;
+	struct port_job job ;
+} ;
+
+struct readmany_item {
+	struct one_wire_query owq ;
+	SIZE_OR_ERROR result ;
+	size_t slot ; // room for the value in the reply
+	int created ;
+} ;
+
+static void ReadmanyGroup(void *v)
+{
+	struct readmany_group * rg = v ;
+	int i ;
+
+	for ( i = 0 ; i < rg->count ; ++i ) {
+		struct one_wire_query * owq = rg->owq[i] ;
+		struct readmany_item * ri = (struct readmany_item *) owq ; // owq is first
+		ri->result = FS_read_postparse(owq) ;
+		LEVEL_DEBUG("Readmany %s return = %d", PN(owq)->path, (int) ri->result) ;
+	}
+}
+
+/* Split the payload into paths, returns the count */
+static int ReadmanyPaths(const char * paths, int length, const char ** path_list)
+{
+	int count = 0 ;
+	int position = 0 ;
+
+	while ( position < length ) {
+		int path_length = strlen( &paths[position] ) ;
+		if ( path_length > 0 ) {
+			if ( path_list != NULL ) {
+				path_list[count] = &paths[position] ;
+			}
+			++count ;
+		}
+		position += path_length + 1 ;
+	}
+	return count ;
+}
+
+void *ReadmanyHandler(struct handlerdata *hd, struct client_msg *cm)
+{
+	int path_count ;
+	const char ** path_list = NULL ;
+	struct readmany_item * items = NULL ;
+	struct readmany_group * groups = NULL ;
+	struct one_wire_query ** owq_by_group = NULL ;
+	int group_count = 0 ;
+	size_t return_size = 0 ;
+	BYTE * retbuffer = NULL ;
+	BYTE * p ;
+	size_t moved = 0 ;
+	int i ;
+
+	if ((hd->sm.size <= 0) || (hd->sm.size > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE)) {
+		LEVEL_DEBUG("ReadmanyHandler: error hd->sm.size == %d", hd->sm.size);
+		cm->ret = -EMSGSIZE;
+		return NULL ;
+	}
+
+	path_count = ReadmanyPaths( hd->sp.path, hd->sm.payload, NULL ) ;
+	if ( path_count == 0 ) {
+		cm->ret = -EBADMSG;
+		return NULL ;
+	}
+	LEVEL_DEBUG("ReadmanyHandler: %d paths", path_count);
+	if ( path_count > READMANY_MAX_PATHS ) {
+		LEVEL_DEBUG("ReadmanyHandler: too many paths (%d > %d)", path_count, READMANY_MAX_PATHS);
+		cm->ret = -EMSGSIZE;
+		return NULL ;
+	}
+
+	path_list = owcalloc( path_count, sizeof(const char *) ) ;
+	items = owcalloc( path_count, sizeof(struct readmany_item) ) ;
+	groups = owcalloc( path_count, sizeof(struct readmany_group) ) ;
+	owq_by_group = owcalloc( path_count, sizeof(struct one_wire_query *) ) ;
+	if ( path_list == NULL || items == NULL || groups == NULL || owq_by_group == NULL ) {
+		cm->ret = -ENOMEM;
+		goto cleanup ;
+	}
+	ReadmanyPaths( hd->sp.path, hd->sm.payload, path_list ) ;
+
+	/* Parse every path and find its bus */
+	for ( i = 0 ; i < path_count ; ++i ) {
+		struct one_wire_query * owq = &(items[i].owq) ;
+		struct parsedname * pn = PN(owq) ;
+		int g ;
+
+		items[i].result = -ENOENT ;
+		if ( BAD( OWQ_create(path_list[i], owq) ) ) {
+			continue ;
+		}
+		items[i].created = 1 ;
+
+		/* Same client settings as a single read */
+		pn->control_flags = hd->sm.control_flags;
+		if ( (pn->control_flags & UNCACHED) != 0 ) {
+			pn->state |= ePS_uncached;
+		}
+		if ( (pn->control_flags & ALIAS_REQUEST) == 0 ) {
+			pn->state |= ePS_unaliased;
+		}
+		pn->tokens = hd->sp.tokens;
+		pn->tokenstring = hd->sp.tokenstring;
+
+		if ( IsDir(pn) ) {
+			items[i].result = -EISDIR ;
+			continue ;
+		}
+		items[i].slot = FullFileLength(pn) ;
+		if ( items[i].slot > (size_t) hd->sm.size ) {
+			items[i].slot = hd->sm.size ;
+		}
+		/* The reply must fit in one message, even with every value at full length */
+		return_size += sizeof(int32_t) + items[i].slot ;
+		if ( return_size > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE ) {
+			LEVEL_DEBUG("ReadmanyHandler: reply could reach %d bytes", (int) return_size);
+			cm->ret = -EMSGSIZE;
+			goto cleanup ;
+		}
+
+		for ( g = 0 ; g < group_count ; ++g ) {
+			if ( groups[g].in == (KnownBus(pn) ? pn->selected_connection : NO_CONNECTION) ) {
+				break ;
+			}
+		}
+		if ( g == group_count ) {
+			groups[g].in = KnownBus(pn) ? pn->selected_connection : NO_CONNECTION ;
+			++group_count ;
+		}
+		++groups[g].count ;
+		items[i].result = 0 ; // to be read
+	}
+
+	/* Lay out each group's reads contiguously, keeping request order */
+	{
+		int offset = 0 ;
+		int g ;
+		for ( g = 0 ; g < group_count ; ++g ) {
+			groups[g].owq = &owq_by_group[offset] ;
+			offset += groups[g].count ;
+			groups[g].count = 0 ;
+		}
+		for ( i = 0 ; i < path_count ; ++i ) {
+			struct parsedname * pn = PN(&(items[i].owq)) ;
+			if ( items[i].result < 0 ) {
+				continue ;
+			}
+			for ( g = 0 ; g < group_count ; ++g ) {
+				if ( groups[g].in == (KnownBus(pn) ? pn->selected_connection : NO_CONNECTION) ) {
+					groups[g].owq[groups[g].count++] = &(items[i].owq) ;
+					break ;
+				}
+			}
+		}
+	}
+
+	/* Reply buffer, values are read into their slots */
+	return_size = 0 ;
+	for ( i = 0 ; i < path_count ; ++i ) {
+		return_size += sizeof(int32_t) + items[i].slot ;
+	}
+	retbuffer = owcalloc( 1, return_size + READMANY_SLOT_PADDING ) ;
+	if ( retbuffer == NULL ) {
+		cm->ret = -ENOBUFS ;
+		goto cleanup ;
+	}
+	p = retbuffer ;
+	for ( i = 0 ; i < path_count ; ++i ) {
+		size_t room = items[i].slot ;
+		if ( room < (size_t) hd->sm.size ) {
+			// the whole value fits, and the padding
+			room += READMANY_SLOT_PADDING ;
+		}
+		p += sizeof(int32_t) ;
+		OWQ_assign_read_buffer( (char *) p, room, 0, &(items[i].owq) ) ;
+		p += items[i].slot ;
+	}
+
+	/* Read -- known buses on their port's worker, the rest here */
+	{
+		struct port_batch batch ;
+		PortBatch_init( &batch ) ;
+		for ( i = 0 ; i < group_count ; ++i ) {
+			if ( groups[i].in != NO_CONNECTION ) {
+				PortWorker_dispatch( groups[i].in->pown, &(groups[i].job), ReadmanyGroup, &groups[i], &batch ) ;
+			}
+		}
+		for ( i = 0 ; i < group_count ; ++i ) {
+			if ( groups[i].in == NO_CONNECTION ) {
+				ReadmanyGroup( &groups[i] ) ;
+			}
+		}
+		PortBatch_wait( &batch ) ;
+	}
+
+	/* Assemble the reply -- close the gaps behind short values */
+	p = retbuffer ;
+	for ( i = 0 ; i < path_count ; ++i ) {
+		int32_t status = htonl( items[i].result ) ;
+		memcpy( p, &status, sizeof(int32_t) ) ;
+		p += sizeof(int32_t) ;
+		if ( items[i].result > 0 ) {
+			if ( (char *) p != OWQ_buffer(&(items[i].owq)) ) {
+				memmove( p, OWQ_buffer(&(items[i].owq)), items[i].result ) ;
+				moved += items[i].result ;
+			}
+			p += items[i].result ;
+		}
+	}
+	STATLOCK;
+	read_copybytes += moved;	/* statistics */
+	STATUNLOCK;
+	return_size = p - retbuffer ;
+	if ( return_size > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE ) {
+		cm->ret = -EMSGSIZE ;
+		owfree( retbuffer ) ;
+		retbuffer = NULL ;
+		goto cleanup ;
+	}
+	cm->payload = return_size ;
+	cm->size = return_size ;
+	cm->offset = 0 ;
+	cm->ret = path_count ;
+
+cleanup:
+	if ( items != NULL ) {
+		for ( i = 0 ; i < path_count ; ++i ) {
+			if ( items[i].created ) {
+				OWQ_destroy( &(items[i].owq) ) ;
+			}
+		}
+	}
+	SAFEFREE( owq_by_group ) ;
+	SAFEFREE( groups ) ;
+	SAFEFREE( items ) ;
+	SAFEFREE( path_list ) ;
+	return retbuffer ;
+}
@@ -38,13 +38,17 @@
 
 /* Send fully configured message back to client.
    data is optional and length depends on "payload"
+   Pipelined connections get the request id right after the header
  */
-int ToClient(int file_descriptor, struct client_msg *machine_order_cm, const char *data)
+int ToClient(struct handlerdata *hd, struct client_msg *machine_order_cm, const char *data)
 {
 	struct client_msg s_cm;
 	struct client_msg *network_order_cm = &s_cm;
+	uint32_t network_order_id = htonl( hd->request_id ) ;
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor = hd->file_descriptor ;
+	int write_error ;
 	
-	int nio = 1; // at least header
+	int nio = 2; // at least header (and id)
 
 #if ( __GNUC__ > 4 ) || (__GNUC__ == 4 && __GNUC_MINOR__ > 4 )
 #pragma GCC diagnostic push
@@ -52,6 +56,7 @@ int ToClient(int file_descriptor, struct client_msg *machine_order_cm, const cha
 	// note data should be (const char *) but iovec complains about const arguments
 	struct iovec io[] = {
 		{network_order_cm, sizeof(struct client_msg),},
+		{&network_order_id, hd->pipeline ? sizeof(uint32_t) : 0,},
 		{ (char *) data, machine_order_cm->payload,},
 	};
 #pragma GCC diagnostic pop
@@ -59,6 +64,7 @@ int ToClient(int file_descriptor, struct client_msg *machine_order_cm, const cha
 	// note data should be (const char *) but iovec complains about const arguments
 	struct iovec io[] = {
 		{network_order_cm, sizeof(struct client_msg),},
+		{&network_order_id, hd->pipeline ? sizeof(uint32_t) : 0,},
 		{ (char *) data, machine_order_cm->payload,},
 	};
 #endif
@@ -85,9 +91,20 @@ int ToClient(int file_descriptor, struct client_msg *machine_order_cm, const cha
 	} else if ( data == NULL ) {
 		LEVEL_DEBUG("Bad data pointer -- NULL") ;
 	} else {
-		nio = 2; // add data segment
-		TrafficOutFD("to server data",io[1].iov_base,io[1].iov_len,file_descriptor);
+		nio = 3; // add data segment
+		TrafficOutFD("to server data",io[2].iov_base,io[2].iov_len,file_descriptor);
+	}
+	if ( nio < 3 ) {
+		io[2].iov_len = 0 ;
+	}
+
+	if ( hd->pipeline == NULL ) {
+		return writev(file_descriptor, io, nio) != (ssize_t) (io[0].iov_len + io[1].iov_len + io[2].iov_len);
 	}
 
-	return writev(file_descriptor, io, nio) != (ssize_t) (io[0].iov_len + io[1].iov_len);
+	// other requests on this connection answer at the same time
+	_MUTEX_LOCK( hd->pipeline->write_mutex ) ;
+	write_error = writev(file_descriptor, io, nio) != (ssize_t) (io[0].iov_len + io[1].iov_len + io[2].iov_len);
+	_MUTEX_UNLOCK( hd->pipeline->write_mutex ) ;
+	return write_error ;
 }
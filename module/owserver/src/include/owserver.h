@@ -25,12 +25,36 @@ extern pthread_mutex_t persistence_mutex ;
 #define TOCLIENTLOCK(hd) _MUTEX_LOCK( (hd)->to_client )
 #define TOCLIENTUNLOCK(hd) _MUTEX_UNLOCK( (hd)->to_client )
 
+/* Values up to this long are read straight into the handler's stack
+   and sent from there, longer ones (memory pages...) get a buffer */
+#define OWSERVER_READ_BUFFER_SIZE 512
+
 enum toclient_state {
 	toclient_postping , // also initial state
 	toclient_postmessage, // only for interme4diate messages like DIR entries
 	toclient_complete, // final payload has been sent
 } ;
 
+/* Most pipelined requests processed at once on one connection */
+#define PIPELINE_MAX_IN_FLIGHT 16
+
+// one pipelined connection, shared by all its requests in flight
+struct pipeline {
+	int file_descriptor;
+	pthread_mutex_t write_mutex; // responses are written whole
+	pthread_mutex_t count_mutex; // everything below
+	pthread_cond_t count_cond; // a request finished
+	pthread_cond_t work_cond; // a request queued (or stop)
+	int in_flight; // queued or being answered
+	struct handlerdata * queue_head; // reads waiting for a thread
+	struct handlerdata * queue_tail;
+	int queued;
+	int idle; // threads waiting for work
+	int stop;
+	int threads; // started as needed, kept until the connection closes
+	pthread_t thread[PIPELINE_MAX_IN_FLIGHT];
+};
+
 // this structure holds the data needed for the handler function called in a separate thread by the ping wrapper
 struct handlerdata {
 	int file_descriptor;
@@ -38,6 +62,14 @@ struct handlerdata {
 	pthread_mutex_t to_client;
 	int ping_pipe[2] ;
 	enum toclient_state toclient ;
+	struct timeval ping_due ; // shared ping timer (--server_workers)
+	struct handlerdata * ping_next ;
+	struct handlerdata * ping_prev ;
+	struct handlerdata * ping_send_next ; // due a ping, sent outside the list lock
+	int ping_sending ; // the timer holds it, not off the list until done
+	struct pipeline * pipeline ; // NULL unless pipelining was granted
+	struct handlerdata * pipeline_next ; // in the pipeline queue
+	uint32_t request_id ; // echoed in every response when pipelined
 	struct timeval tv;
 	struct server_msg sm;
 	struct serverpackage sp;
@@ -47,10 +79,10 @@ struct handlerdata {
 int FromClient(struct handlerdata *hd);
 
 /* Send fully configured message back to client */
-int ToClient(int file_descriptor, struct client_msg *cm, const char *data);
+int ToClient(struct handlerdata *hd, struct client_msg *cm, const char *data);
 
-/* Read from 1-wire bus and return file contents */
-void *ReadHandler(struct handlerdata *hd, struct client_msg *cm, struct one_wire_query *owq);
+/* Read from 1-wire bus and return file contents, in buffer if it fits */
+void *ReadHandler(struct handlerdata *hd, struct client_msg *cm, struct one_wire_query *owq, char *buffer, size_t buffer_size);
 
 /* write a new value ot a 1-wire device */
 void WriteHandler(struct handlerdata *hd, struct client_msg *cm, struct one_wire_query *owq);
@@ -58,6 +90,11 @@ void WriteHandler(struct handlerdata *hd, struct client_msg *cm, struct one_wire
 /* Clasic directory -- one value at a time */
 void DirHandler(struct handlerdata *hd, struct client_msg *cm, const struct parsedname *pn);
 
+/* Read a list of paths in one message */
+/* Most paths in one readmany message, each costs a parsed query */
+#define READMANY_MAX_PATHS 256
+void *ReadmanyHandler(struct handlerdata *hd, struct client_msg *cm);
+
 /* Newer directory-at-once */
 void *DirallHandler(struct handlerdata *hd, struct client_msg *cm, const struct parsedname *pn);
 
@@ -69,6 +106,8 @@ void *DataHandler(void *v);
 
 /* Handle a client request, including timeout pings */
 void Handler(FILE_DESCRIPTOR_OR_ERROR file_descriptor);
+GOOD_OR_BAD HandlerRequest(FILE_DESCRIPTOR_OR_ERROR file_descriptor, void ** state);
+void HandlerRelease(void * state);
 
 /* Send a response to client of an error */
 void ErrorToClient(struct handlerdata *hd, struct client_msg * cm ) ;
@@ -79,6 +118,9 @@ void PingClient(struct handlerdata *hd);
 /* Loop waiting for finish sending pings */
 void PingLoop(struct handlerdata *hd) ;
 
+/* Single thread sending pings for all requests (--server_workers) */
+void PingTimerStart(void) ;
+
 /* Create a md5 hash (for the token) */
 void md5(const uint8_t *initial_msg, size_t initial_len, uint8_t *digest) ;
 
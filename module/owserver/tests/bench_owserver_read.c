@@ -0,0 +1,167 @@
+#include "owserver_bench.h"
+#include "ow_connection.h"
+#include "ow_counters.h"
+
+// owserver's read and readmany messages, from a simulated bus master: no
+// 1-wire time, just the handlers.
+// Counts the bytes copied after the value was formatted (/statistics/read/copybytes)
+// per request. A number asked for whole needs none: a read is formatted in
+// the handler's buffer, readmany values in their slots of the reply.
+//   4096 bytes, what owfs asks for through owserver
+//   trimmed, readmany then closes the gaps behind the short values
+//   the file length, the tightest a client can ask for (copied)
+
+#define SERVER_READ_BENCH_LOOPS		20000
+#define SERVER_READMANY_PATHS		16
+
+struct server_read_bench_case {
+	const char * property ;
+	int size ;	// 0 -- the file length
+	int trim ;	// the client wants values trimmed
+} ;
+
+static const struct server_read_bench_case server_read_bench_cases[] = {
+	{ "temperature", 4096, 0, },
+	{ "temperature", 4096, 1, },
+	{ "temperature", 0, 0, },
+	{ "temphigh", 4096, 0, },
+	{ "type", 4096, 0, },
+} ;
+
+static char server_readmany_payload[SERVER_READMANY_PATHS * PATH_MAX] ;
+
+static UINT server_read_copybytes( void )
+{
+	UINT copied ;
+
+	STATLOCK ;
+	copied = read_copybytes ;
+	STATUNLOCK ;
+	return copied ;
+}
+
+static void server_read_bench_report( const char * message, const struct server_read_bench_case * rc, int size, UINT bad, UINT copied, UINT requests, double seconds )
+{
+	char label[64] ;
+
+	snprintf( label, sizeof(label), "%-8s %-11s size=%-4d trim=%d bad=%u copied=%.1f",
+		message, rc->property, size, rc->trim, bad, copied / (double) requests ) ;
+	owserver_bench_report( label, requests, seconds ) ;
+}
+
+// one read message at a time, as DataHandler answers it
+static void server_read_bench_run( const struct server_read_bench_case * rc, const char * path, int size )
+{
+	char read_buffer[OWSERVER_READ_BUFFER_SIZE] ;
+	struct handlerdata hd ;
+	UINT copied ;
+	UINT bad = 0 ;
+	UINT loop ;
+	double start ;
+
+	memset( &hd, 0, sizeof(hd) ) ;
+	hd.sm.payload = strlen( path ) + 1 ;
+	hd.sm.size = size ;
+	hd.sm.control_flags = rc->trim ? ( LocalControlFlags | TRIM ) : ( LocalControlFlags & ~TRIM ) ;
+
+	copied = server_read_copybytes() ;
+	start = owserver_bench_now() ;
+	for ( loop = 0 ; loop < SERVER_READ_BENCH_LOOPS ; ++loop ) {
+		struct client_msg cm ;
+		void * retbuffer ;
+		OWQ_allocate_struct_and_pointer( owq ) ;
+
+		if ( BAD( OWQ_create( path, owq ) ) ) {
+			++bad ;
+			continue ;
+		}
+		PN(owq)->control_flags = hd.sm.control_flags ;
+		memset( &cm, 0, sizeof(cm) ) ;
+		retbuffer = ReadHandler( &hd, &cm, owq, read_buffer, sizeof(read_buffer) ) ;
+		if ( cm.ret <= 0 ) {
+			++bad ;
+		}
+		if ( retbuffer != NULL && retbuffer != read_buffer ) {
+			owfree( retbuffer ) ;
+		}
+		OWQ_destroy( owq ) ;
+	}
+	server_read_bench_report( "read", rc, size, bad, server_read_copybytes() - copied, SERVER_READ_BENCH_LOOPS, owserver_bench_now() - start ) ;
+}
+
+// the same path SERVER_READMANY_PATHS times in one message
+static void server_readmany_bench_run( const struct server_read_bench_case * rc, const char * path, int size )
+{
+	struct handlerdata hd ;
+	size_t length = strlen( path ) + 1 ;
+	UINT copied ;
+	UINT bad = 0 ;
+	UINT loop ;
+	int i ;
+	double start ;
+
+	memset( &hd, 0, sizeof(hd) ) ;
+	for ( i = 0 ; i < SERVER_READMANY_PATHS ; ++i ) {
+		memcpy( &server_readmany_payload[i * length], path, length ) ;
+	}
+	hd.sm.payload = SERVER_READMANY_PATHS * length ;
+	hd.sm.size = size ;
+	hd.sm.control_flags = rc->trim ? ( LocalControlFlags | TRIM ) : ( LocalControlFlags & ~TRIM ) ;
+	hd.sp.path = server_readmany_payload ;
+
+	copied = server_read_copybytes() ;
+	start = owserver_bench_now() ;
+	for ( loop = 0 ; loop < SERVER_READ_BENCH_LOOPS / SERVER_READMANY_PATHS ; ++loop ) {
+		struct client_msg cm ;
+		void * retbuffer ;
+
+		memset( &cm, 0, sizeof(cm) ) ;
+		retbuffer = ReadmanyHandler( &hd, &cm ) ;
+		if ( cm.ret != SERVER_READMANY_PATHS ) {
+			++bad ;
+		}
+		SAFEFREE( retbuffer ) ;
+	}
+	// per value, as for single reads
+	server_read_bench_report( "readmany", rc, size, bad, server_read_copybytes() - copied, loop * SERVER_READMANY_PATHS, owserver_bench_now() - start ) ;
+}
+
+void owserver_read_bench(void)
+{
+	struct port_in * pin ;
+	size_t case_index ;
+
+	// DS18S20: temperature (float), temphigh (temperature), type (ascii)
+	if ( BAD( ARG_Fake( "10.67C6697351FF" ) ) ) {
+		return ;
+	}
+	pin = Inbound_Control.head_port ;
+	if ( BAD( Fake_detect( pin ) ) ) {
+		RemovePort( pin ) ;
+		return ;
+	}
+	Globals.uncached = 1 ; // every read formats a fresh value
+
+	for ( case_index = 0 ; case_index < sizeof(server_read_bench_cases)/sizeof(server_read_bench_cases[0]) ; ++case_index ) {
+		const struct server_read_bench_case * rc = &server_read_bench_cases[case_index] ;
+		char path[PATH_MAX] ;
+		int size = rc->size ;
+		OWQ_allocate_struct_and_pointer( owq ) ;
+
+		snprintf( path, sizeof(path), "/10.67C6697351FF/%s", rc->property ) ;
+		if ( BAD( OWQ_create( path, owq ) ) ) {
+			printf( "Cannot parse %s\n", path ) ;
+			continue ;
+		}
+		if ( size == 0 ) {
+			size = FullFileLength( PN(owq) ) ;
+		}
+		OWQ_destroy( owq ) ;
+
+		server_read_bench_run( rc, path, size ) ;
+		server_readmany_bench_run( rc, path, size ) ;
+	}
+
+	Globals.uncached = 0 ;
+	RemovePort( pin ) ;
+}
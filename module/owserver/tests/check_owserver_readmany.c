@@ -0,0 +1,147 @@
+#include "owserver_testhelper.h"
+
+// owserver's readmany message on a fake bus
+//
+// The paths go in as the client sends them, each null terminated, the
+// reply is a 32 bit status (network order) and the value for each path.
+
+#define READMANY_PAYLOAD_SIZE	( 300 * 32 )
+
+static char readmany_payload[READMANY_PAYLOAD_SIZE] ;
+
+static struct port_in * readmany_bus( void )
+{
+	struct port_in * pin ;
+
+	ck_assert( GOOD( ARG_Fake( "10.67C6697351FF,23.0123456789AB" ) ) ) ;
+	pin = Inbound_Control.head_port ;
+	ck_assert( GOOD( Fake_detect( pin ) ) ) ;
+	return pin ;
+}
+
+// the same path "count" times
+static void readmany_request( struct handlerdata * hd, const char * path, int count, int size )
+{
+	int length = 0 ;
+	int i ;
+
+	for ( i = 0 ; i < count ; ++i ) {
+		ck_assert_int_lt( length + strlen( path ) + 1, READMANY_PAYLOAD_SIZE ) ;
+		strcpy( &readmany_payload[length], path ) ;
+		length += strlen( path ) + 1 ;
+	}
+	memset( hd, 0, sizeof(struct handlerdata) ) ;
+	hd->sm.payload = length ;
+	hd->sm.size = size ;
+	hd->sp.path = readmany_payload ;
+}
+
+static const BYTE * readmany_status( const BYTE * p, int32_t expected )
+{
+	int32_t status ;
+
+	memcpy( &status, p, sizeof(int32_t) ) ;
+	ck_assert_int_eq( expected, (int32_t) ntohl( status ) ) ;
+	return p + sizeof(int32_t) ;
+}
+
+// Values of every path, in order, short ones packed together
+START_TEST(test_readmany_values)
+{
+	struct port_in * pin = readmany_bus() ;
+	static const char paths[] = "/10.67C6697351FF/type\0/23.0123456789AB/family\0/10.000000000000/type" ;
+	struct handlerdata hd ;
+	struct client_msg cm ;
+	const BYTE * p ;
+	BYTE * reply ;
+
+	memset( &hd, 0, sizeof(hd) ) ;
+	memset( &cm, 0, sizeof(cm) ) ;
+	memcpy( readmany_payload, paths, sizeof(paths) ) ;
+	hd.sm.payload = sizeof(paths) ;
+	hd.sm.size = 64 ;
+	hd.sp.path = readmany_payload ;
+
+	reply = ReadmanyHandler( &hd, &cm ) ;
+	ck_assert( reply != NULL ) ;
+	ck_assert_int_eq( 3, cm.ret ) ;
+	ck_assert_int_eq( 3 * sizeof(int32_t) + 7 + 2, cm.payload ) ;
+
+	p = readmany_status( reply, 7 ) ;
+	ck_assert( memcmp( p, "DS18S20", 7 ) == 0 ) ;
+	p = readmany_status( p + 7, 2 ) ;
+	ck_assert( memcmp( p, "23", 2 ) == 0 ) ;
+	readmany_status( p + 2, -ENOENT ) ;
+
+	owfree( reply ) ;
+	RemovePort( pin ) ;
+}
+END_TEST
+
+// No more paths than the cap, nothing allocated for them
+START_TEST(test_readmany_too_many_paths)
+{
+	struct port_in * pin = readmany_bus() ;
+	struct handlerdata hd ;
+	struct client_msg cm ;
+	BYTE * reply ;
+
+	memset( &cm, 0, sizeof(cm) ) ;
+	readmany_request( &hd, "/10.67C6697351FF/type", READMANY_MAX_PATHS, 16 ) ;
+	reply = ReadmanyHandler( &hd, &cm ) ;
+	ck_assert( reply != NULL ) ;
+	ck_assert_int_eq( READMANY_MAX_PATHS, cm.ret ) ;
+	owfree( reply ) ;
+
+	memset( &cm, 0, sizeof(cm) ) ;
+	readmany_request( &hd, "/10.67C6697351FF/type", READMANY_MAX_PATHS + 1, 16 ) ;
+	ck_assert( ReadmanyHandler( &hd, &cm ) == NULL ) ;
+	ck_assert_int_eq( -EMSGSIZE, cm.ret ) ;
+
+	RemovePort( pin ) ;
+}
+END_TEST
+
+// The reply must fit in one message before anything is read
+START_TEST(test_readmany_reply_too_big)
+{
+	struct port_in * pin = readmany_bus() ;
+	struct handlerdata hd ;
+	struct client_msg cm ;
+	BYTE * reply ;
+	int fits = MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE / ( sizeof(int32_t) + 512 ) ;
+
+	// 512 byte memory, asked in full
+	ck_assert_int_le( fits, READMANY_MAX_PATHS ) ;
+	memset( &cm, 0, sizeof(cm) ) ;
+	readmany_request( &hd, "/23.0123456789AB/memory", fits + 1, MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE ) ;
+	ck_assert( ReadmanyHandler( &hd, &cm ) == NULL ) ;
+	ck_assert_int_eq( -EMSGSIZE, cm.ret ) ;
+
+	// asked in part, the slots are smaller
+	memset( &cm, 0, sizeof(cm) ) ;
+	readmany_request( &hd, "/23.0123456789AB/memory", fits + 1, 8 ) ;
+	reply = ReadmanyHandler( &hd, &cm ) ;
+	ck_assert( reply != NULL ) ;
+	ck_assert_int_eq( fits + 1, cm.ret ) ;
+	owfree( reply ) ;
+
+	RemovePort( pin ) ;
+}
+END_TEST
+
+// Create test-suite
+Suite* owserver_readmany_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("readmany");
+
+	tcase_add_checked_fixture(tc, owserver_test_setup, owserver_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_readmany_values);
+	tcase_add_test(tc, test_readmany_too_many_paths);
+	tcase_add_test(tc, test_readmany_reply_too_big);
+	return s;
+}
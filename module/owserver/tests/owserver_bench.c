@@ -0,0 +1,56 @@
+#include "owserver_bench.h"
+
+#define _DEFINE_BENCH(bench_name) void bench_name(void);
+#define _RUN_BENCH(bench_name) printf("\n== %s ==\n", #bench_name); bench_name();
+
+/**
+ * Micro-benchmarks of owserver's message handlers. Not run by "make check", just built.
+ * Add all your benchmarks here, and in run_benchmarks below
+ */
+
+_DEFINE_BENCH(owserver_read_bench);
+
+static void run_benchmarks(void) {
+	_RUN_BENCH(owserver_read_bench);
+}
+
+/**
+ * Setup the owlib stack under the handlers, same as the unit tests use
+ */
+void owserver_bench_setup(void) {
+	LockSetup();
+	Pool_Open();
+	Cache_Open();
+	Detail_Init();
+	DeviceSort();
+	SetLocalControlFlags() ; // reset by every option and other change.
+}
+
+void owserver_bench_teardown(void) {
+	Cache_Close();
+	Pool_Close();
+	Detail_Close();
+}
+
+double owserver_bench_now(void) {
+	struct timeval tv ;
+	gettimeofday( &tv, NULL ) ;
+	return tv.tv_sec + tv.tv_usec / 1000000. ;
+}
+
+void owserver_bench_report(const char * name, UINT operations, double seconds) {
+	printf("%-40s %10u ops %8.3f s %12.0f ops/s\n", name, operations, seconds, seconds > 0 ? operations / seconds : 0. ) ;
+}
+
+int main(void)
+{
+	Globals.error_level = e_err_default ;
+	Globals.error_level_restore = e_err_default ;
+	Globals.error_print = e_err_print_console;
+
+	owserver_bench_setup() ;
+	run_benchmarks() ;
+	owserver_bench_teardown() ;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,17 @@
+#ifndef OWFS_OWSERVERBENCH_H
+#define OWFS_OWSERVERBENCH_H
+
+#include <config.h>
+#include "owfs_config.h"
+#include "owserver.h"
+
+void owserver_bench_setup(void);
+void owserver_bench_teardown(void);
+
+// Wall clock in seconds, for timing a benchmark loop
+double owserver_bench_now(void);
+
+// One result line: name, operations and elapsed seconds
+void owserver_bench_report(const char * name, UINT operations, double seconds);
+
+#endif //OWFS_OWSERVERBENCH_H
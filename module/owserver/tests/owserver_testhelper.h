@@ -0,0 +1,13 @@
+#ifndef OWFS_OWSERVERTEST_HELPER_H
+#define OWFS_OWSERVERTEST_HELPER_H
+
+#include <config.h>
+#include "owfs_config.h"
+#include "owserver.h"
+
+#include <check.h>
+
+void owserver_test_setup(void);
+void owserver_test_teardown(void);
+
+#endif //OWFS_OWSERVERTEST_HELPER_H
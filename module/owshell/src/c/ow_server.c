@@ -75,6 +75,88 @@ int ServerRead(ASCII * path)
 	return ret;
 }
 
+/* Read several paths with one message
+   returns -ENOMSG if the owserver is too old to understand it
+   or -EMSGSIZE if it's too much for one message */
+int ServerReadMany(int count, ASCII ** paths)
+{
+	struct server_msg sm;
+	struct client_msg cm;
+	struct serverpackage sp = { NULL, NULL, 0, NULL, 0, };
+	int size = 65536;
+	size_t length = 0;
+	char *path_list;
+	char *reply;
+	int connectfd;
+	int ret = 0;
+	int i;
+
+	// paths one after the other, each null terminated
+	for (i = 0; i < count; ++i) {
+		length += strlen(paths[i]) + 1;
+	}
+	if (length > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE) {
+		return -ENOMSG;			// do them one at a time instead
+	}
+	if ((path_list = (char *) malloc(length)) == NULL) {
+		return -ENOMEM;
+	}
+	length = 0;
+	for (i = 0; i < count; ++i) {
+		strcpy(&path_list[length], paths[i]);
+		length += strlen(paths[i]) + 1;
+	}
+	sp.data = (BYTE *) path_list;
+	sp.datasize = length;
+
+	if ((connectfd = ClientConnect()) < 0) {
+		free(path_list);
+		return -EIO;
+	}
+	memset(&sm, 0, sizeof(struct server_msg));
+	memset(&cm, 0, sizeof(struct client_msg));
+	sm.type = msg_readmany;
+	sm.size = size;
+
+	if ( size_of_data >=0 && size_of_data <= 65536 ) {
+		sm.size = size_of_data ;
+	}
+
+	if (ToServer(connectfd, &sm, &sp)) {
+		PRINT_ERROR("ServerReadMany: Error sending request\n");
+		ret = -EIO;
+	} else if ((reply = FromServerAlloc(connectfd, &cm)) == NULL) {
+		ret = (cm.ret < 0) ? cm.ret : -EIO;
+		if (ret != -ENOMSG && ret != -EMSGSIZE) {
+			PRINT_ERROR("ServerReadMany: Error receiving data\n");
+		}
+	} else {
+		// for each path: status (value length or error), then the value
+		char *p = reply;
+		char *end = reply + cm.payload;
+		for (i = 0; i < count && p + sizeof(int32_t) <= end; ++i) {
+			int32_t status;
+			memcpy(&status, p, sizeof(int32_t));
+			p += sizeof(int32_t);
+			ret = ntohl(status);
+			if (ret < 0 || ret > end - p) {
+				PRINT_ERROR("ServerRead: Data error on %s\n", paths[i]);
+				ret = (ret < 0) ? ret : -EIO;
+			} else {
+				Write(p, ret);
+				p += ret;
+			}
+		}
+		if (i < count) {
+			ret = -EIO;
+		}
+		free(reply);
+	}
+	close(connectfd);
+	free(path_list);
+	return ret;
+}
+
 int ServerWrite(ASCII * path, ASCII * data, int size)
 {
 	struct server_msg sm;
@@ -37,6 +37,14 @@ int main(int argc, char *argv[])
 	DefaultOwserver();
 	Server_detect();
 
+	/* several paths (whole values) in one message when the owserver allows */
+	if (argc - optind > 1 && offset_into_data == 0) {
+		rc = ServerReadMany(argc - optind, &argv[optind]);
+		if (rc != -ENOMSG && rc != -EMSGSIZE) {
+			optind = argc;
+		}
+	}
+
 	/* non-option arguments */
 	while (optind < argc) {
 		rc = ServerRead(argv[optind]);
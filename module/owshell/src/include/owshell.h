@@ -214,6 +214,7 @@ enum msg_classification {
 	msg_get,
 	msg_dirallslash,
 	msg_getslash,
+	msg_readmany,				// several paths read in one message
 };
 /* message to owserver */
 struct server_msg {
@@ -275,6 +276,7 @@ void OW_Browse(void);
 
 void Server_detect(void);
 int ServerRead(ASCII * path);
+int ServerReadMany(int count, ASCII ** paths);
 int ServerWrite(ASCII * path, ASCII * data, int size);
 int ServerDir(ASCII * path);
 int ServerDirall(ASCII * path);